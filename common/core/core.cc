@@ -170,8 +170,22 @@ Core::hookPeriodicInsCheck()
       m_instructions_hpi_last = m_instructions;
 
       // Quick, unlocked check if we should do the HOOK_PERIODIC_INS callback
-      if (g_instructions_hpi_global > g_instructions_hpi_global_callback)
-         hookPeriodicInsCall();
+      UInt64 callback = g_instructions_hpi_global_callback;
+      if (g_instructions_hpi_global > callback)
+      {
+         if (Sim()->getHooksManager()->hasHooks(HookType::HOOK_PERIODIC_INS))
+            hookPeriodicInsCall();
+         else
+         {
+            // Nobody is listening, but keep the callback threshold up with the instruction count,
+            // so a hook registered later (e.g. at ROI begin) doesn't get a burst of stale callbacks.
+            // If another core moves the threshold first, it has done the job for us.
+            UInt64 global = g_instructions_hpi_global;
+            UInt64 period = Sim()->getConfig()->getHPIInstructionsGlobal();
+            UInt64 next = period ? callback + (global - callback + period - 1) / period * period : global;
+            __sync_bool_compare_and_swap(&g_instructions_hpi_global_callback, callback, next);
+         }
+      }
    }
 }
 
@@ -265,10 +279,11 @@ void Core::accessMemoryFast(bool icache, mem_op_t mem_op_type, IntPtr address)
    if (m_cheetah_manager && icache == false)
       m_cheetah_manager->access(mem_op_type, address);
 
-   SubsecondTime latency = getMemoryManager()->coreInitiateMemoryAccessFast(icache, mem_op_type, address);
+   HitWhere::where_t hit_where;
+   SubsecondTime latency = getMemoryManager()->coreInitiateMemoryAccessFast(icache, mem_op_type, address, hit_where);
 
    if (latency > SubsecondTime::Zero())
-      m_performance_model->handleMemoryLatency(latency, HitWhere::MISS);
+      m_performance_model->handleMemoryLatency(latency, hit_where);
 }
 
 MemoryResult
@@ -368,7 +383,8 @@ Core::initiateMemoryAccess(MemComponent::component_t mem_component,
                mem_op_type,
                curr_addr_aligned, curr_offset,
                data_buf ? curr_data_buffer_head : NULL, curr_size,
-               modeled);
+               modeled,
+               eip);
 
       if (hit_where != (HitWhere::where_t)mem_component)
       {
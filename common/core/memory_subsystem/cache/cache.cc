@@ -1,5 +1,13 @@
 #include "simulator.h"
 #include "cache.h"
+#include "cache_set_lru.h"
+#include "cache_set_mru.h"
+#include "cache_set_nmru.h"
+#include "cache_set_nru.h"
+#include "cache_set_plru.h"
+#include "cache_set_random.h"
+#include "cache_set_round_robin.h"
+#include "cache_set_srrip.h"
 #include "log.h"
 
 // Cache class
@@ -25,10 +33,43 @@ Cache::Cache(
    m_fault_injector(fault_injector)
 {
    m_set_info = CacheSet::createCacheSetInfo(name, cfgname, core_id, replacement_policy, m_associativity);
+   m_set_storage = new CacheSetStorage(m_cache_type, m_num_sets, m_associativity);
    m_sets = new CacheSet*[m_num_sets];
    for (UInt32 i = 0; i < m_num_sets; i++)
    {
-      m_sets[i] = CacheSet::createCacheSet(cfgname, core_id, replacement_policy, m_cache_type, m_associativity, m_blocksize, m_set_info);
+      m_sets[i] = CacheSet::createCacheSet(cfgname, core_id, replacement_policy, m_cache_type, m_associativity, m_blocksize, m_set_info, m_set_storage, i);
+   }
+
+   switch(CacheSet::parsePolicyType(replacement_policy))
+   {
+      case CacheBase::ROUND_ROBIN:
+         setReplacementPolicy<CacheSetRoundRobin>();
+         break;
+      case CacheBase::LRU:
+      case CacheBase::LRU_QBS:
+         setReplacementPolicy<CacheSetLRU>();
+         break;
+      case CacheBase::NRU:
+         setReplacementPolicy<CacheSetNRU>();
+         break;
+      case CacheBase::MRU:
+         setReplacementPolicy<CacheSetMRU>();
+         break;
+      case CacheBase::NMRU:
+         setReplacementPolicy<CacheSetNMRU>();
+         break;
+      case CacheBase::PLRU:
+         setReplacementPolicy<CacheSetPLRU>();
+         break;
+      case CacheBase::SRRIP:
+      case CacheBase::SRRIP_QBS:
+         setReplacementPolicy<CacheSetSRRIP>();
+         break;
+      case CacheBase::RANDOM:
+         setReplacementPolicy<CacheSetRandom>();
+         break;
+      default:
+         LOG_PRINT_ERROR("Unrecognized Cache Replacement Policy: %s", replacement_policy.c_str());
    }
 
    #ifdef ENABLE_SET_USAGE_HIST
@@ -54,6 +95,7 @@ Cache::~Cache()
    for (SInt32 i = 0; i < (SInt32) m_num_sets; i++)
       delete m_sets[i];
    delete [] m_sets;
+   delete m_set_storage;
 }
 
 Lock&
@@ -80,8 +122,17 @@ Cache::invalidateSingleLine(IntPtr addr)
    return m_sets[set_index]->invalidate(tag);
 }
 
+template <class CacheSetType>
+void
+Cache::setReplacementPolicy()
+{
+   m_access_single_line = &Cache::accessSingleLinePolicy<CacheSetType>;
+   m_insert_single_line = &Cache::insertSingleLinePolicy<CacheSetType>;
+}
+
+template <class CacheSetType>
 CacheBlockInfo*
-Cache::accessSingleLine(IntPtr addr, access_t access_type,
+Cache::accessSingleLinePolicy(IntPtr addr, access_t access_type,
       Byte* buff, UInt32 bytes, SubsecondTime now, bool update_replacement)
 {
    //assert((buff == NULL) == (bytes == 0));
@@ -93,7 +144,8 @@ Cache::accessSingleLine(IntPtr addr, access_t access_type,
 
    splitAddress(addr, tag, set_index, block_offset);
 
-   CacheSet* set = m_sets[set_index];
+   // The replacement functions are final in CacheSetType, so calling them through set is not virtual
+   CacheSetType* set = static_cast<CacheSetType*>(m_sets[set_index]);
    CacheBlockInfo* cache_block_info = set->find(tag, &line_index);
 
    if (cache_block_info == NULL)
@@ -105,22 +157,26 @@ Cache::accessSingleLine(IntPtr addr, access_t access_type,
       if (m_fault_injector)
          m_fault_injector->preRead(addr, set_index * m_associativity + line_index, bytes, (Byte*)m_sets[set_index]->getDataPtr(line_index, block_offset), now);
 
-      set->read_line(line_index, block_offset, buff, bytes, update_replacement);
+      set->read_line(line_index, block_offset, buff, bytes, false);
    }
    else
    {
-      set->write_line(line_index, block_offset, buff, bytes, update_replacement);
+      set->write_line(line_index, block_offset, buff, bytes, false);
 
       // NOTE: assumes error occurs in memory. If we want to model bus errors, insert the error into buff instead
       if (m_fault_injector)
          m_fault_injector->postWrite(addr, set_index * m_associativity + line_index, bytes, (Byte*)m_sets[set_index]->getDataPtr(line_index, block_offset), now);
    }
 
+   if (update_replacement)
+      set->updateReplacementIndex(line_index);
+
    return cache_block_info;
 }
 
+template <class CacheSetType>
 void
-Cache::insertSingleLine(IntPtr addr, Byte* fill_buff,
+Cache::insertSingleLinePolicy(IntPtr addr, Byte* fill_buff,
       bool* eviction, IntPtr* evict_addr,
       CacheBlockInfo* evict_block_info, Byte* evict_buff,
       SubsecondTime now, CacheCntlr *cntlr)
@@ -132,8 +188,9 @@ Cache::insertSingleLine(IntPtr addr, Byte* fill_buff,
    CacheBlockInfo* cache_block_info = CacheBlockInfo::create(m_cache_type);
    cache_block_info->setTag(tag);
 
-   m_sets[set_index]->insert(cache_block_info, fill_buff,
-         eviction, evict_block_info, evict_buff, cntlr);
+   CacheSetType* set = static_cast<CacheSetType*>(m_sets[set_index]);
+   set->insertAtIndex(set->getReplacementIndex(cntlr), cache_block_info, fill_buff,
+         eviction, evict_block_info, evict_buff);
    *evict_addr = tagToAddress(evict_block_info->getTag());
 
    if (m_fault_injector) {
@@ -175,6 +232,14 @@ Cache::updateCounters(bool cache_hit)
    }
 }
 
+// Counts that were collected elsewhere while the cache was enabled
+void
+Cache::updateCounters(UInt64 accesses, UInt64 hits)
+{
+   m_num_accesses += accesses;
+   m_num_hits += hits;
+}
+
 void
 Cache::updateHits(Core::mem_op_t mem_op_type, UInt64 hits)
 {
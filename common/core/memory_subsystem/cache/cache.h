@@ -27,6 +27,7 @@ class Cache : public CacheBase
       // Generic Cache Info
       cache_t m_cache_type;
       CacheSet** m_sets;
+      CacheSetStorage* m_set_storage;
       CacheSetInfo* m_set_info;
 
       FaultInjector *m_fault_injector;
@@ -35,6 +36,24 @@ class Cache : public CacheBase
       UInt64* m_set_usage_hist;
       #endif
 
+      // Access and insert paths specialized for the concrete CacheSet type of our replacement policy.
+      // The policy is resolved once at construction, after which the hit path calls the policy's
+      // updateReplacementIndex() directly (and inlined) rather than through a virtual call per access
+      typedef CacheBlockInfo* (Cache::*AccessSingleLineFunc)(IntPtr addr,
+            access_t access_type, Byte* buff, UInt32 bytes, SubsecondTime now, bool update_replacement);
+      typedef void (Cache::*InsertSingleLineFunc)(IntPtr addr, Byte* fill_buff,
+            bool* eviction, IntPtr* evict_addr,
+            CacheBlockInfo* evict_block_info, Byte* evict_buff, SubsecondTime now, CacheCntlr *cntlr);
+      AccessSingleLineFunc m_access_single_line;
+      InsertSingleLineFunc m_insert_single_line;
+
+      template <class CacheSetType> void setReplacementPolicy();
+      template <class CacheSetType> CacheBlockInfo* accessSingleLinePolicy(IntPtr addr,
+            access_t access_type, Byte* buff, UInt32 bytes, SubsecondTime now, bool update_replacement);
+      template <class CacheSetType> void insertSingleLinePolicy(IntPtr addr, Byte* fill_buff,
+            bool* eviction, IntPtr* evict_addr,
+            CacheBlockInfo* evict_block_info, Byte* evict_buff, SubsecondTime now, CacheCntlr *cntlr);
+
    public:
 
       // constructors/destructors
@@ -54,20 +73,28 @@ class Cache : public CacheBase
 
       bool invalidateSingleLine(IntPtr addr);
       CacheBlockInfo* accessSingleLine(IntPtr addr,
-            access_t access_type, Byte* buff, UInt32 bytes, SubsecondTime now, bool update_replacement);
+            access_t access_type, Byte* buff, UInt32 bytes, SubsecondTime now, bool update_replacement)
+      {
+         return (this->*m_access_single_line)(addr, access_type, buff, bytes, now, update_replacement);
+      }
       void insertSingleLine(IntPtr addr, Byte* fill_buff,
             bool* eviction, IntPtr* evict_addr,
-            CacheBlockInfo* evict_block_info, Byte* evict_buff, SubsecondTime now, CacheCntlr *cntlr = NULL);
+            CacheBlockInfo* evict_block_info, Byte* evict_buff, SubsecondTime now, CacheCntlr *cntlr = NULL)
+      {
+         (this->*m_insert_single_line)(addr, fill_buff, eviction, evict_addr, evict_block_info, evict_buff, now, cntlr);
+      }
       CacheBlockInfo* peekSingleLine(IntPtr addr);
 
       CacheBlockInfo* peekBlock(UInt32 set_index, UInt32 way) const { return m_sets[set_index]->peekBlock(way); }
 
       // Update Cache Counters
       void updateCounters(bool cache_hit);
+      void updateCounters(UInt64 accesses, UInt64 hits);
       void updateHits(Core::mem_op_t mem_op_type, UInt64 hits);
 
       void enable() { m_enabled = true; }
       void disable() { m_enabled = false; }
+      bool isEnabled() const { return m_enabled; }
 };
 
 template <class T>
@@ -52,6 +52,51 @@ CacheBlockInfo::create(CacheBase::cache_t cache_type)
    }
 }
 
+CacheBlockInfo*
+CacheBlockInfo::createArray(CacheBase::cache_t cache_type, UInt64 count, UInt32 &size)
+{
+   switch (cache_type)
+   {
+      case CacheBase::PR_L1_CACHE:
+         size = sizeof(PrL1CacheBlockInfo);
+         return new PrL1CacheBlockInfo[count];
+
+      case CacheBase::PR_L2_CACHE:
+         size = sizeof(PrL2CacheBlockInfo);
+         return new PrL2CacheBlockInfo[count];
+
+      case CacheBase::SHARED_CACHE:
+         size = sizeof(SharedCacheBlockInfo);
+         return new SharedCacheBlockInfo[count];
+
+      default:
+         LOG_PRINT_ERROR("Unrecognized cache type (%u)", cache_type);
+         return NULL;
+   }
+}
+
+void
+CacheBlockInfo::destroyArray(CacheBase::cache_t cache_type, CacheBlockInfo* array)
+{
+   switch (cache_type)
+   {
+      case CacheBase::PR_L1_CACHE:
+         delete [] (PrL1CacheBlockInfo*)array;
+         break;
+
+      case CacheBase::PR_L2_CACHE:
+         delete [] (PrL2CacheBlockInfo*)array;
+         break;
+
+      case CacheBase::SHARED_CACHE:
+         delete [] (SharedCacheBlockInfo*)array;
+         break;
+
+      default:
+         LOG_PRINT_ERROR("Unrecognized cache type (%u)", cache_type);
+   }
+}
+
 void
 CacheBlockInfo::invalidate()
 {
@@ -36,6 +36,9 @@ class CacheBlockInfo
       virtual ~CacheBlockInfo();
 
       static CacheBlockInfo* create(CacheBase::cache_t cache_type);
+      // Allocate count blocks of the type matching cache_type in a single array, block i is at (char*)array + i * size
+      static CacheBlockInfo* createArray(CacheBase::cache_t cache_type, UInt64 count, UInt32 &size);
+      static void destroyArray(CacheBase::cache_t cache_type, CacheBlockInfo* array);
 
       virtual void invalidate(void);
       virtual void clone(CacheBlockInfo* cache_block_info);
@@ -13,16 +13,44 @@
 #include "config.h"
 #include "config.hpp"
 
+CacheSetStorage::CacheSetStorage(CacheBase::cache_t cache_type, UInt32 num_sets, UInt32 associativity)
+   : m_cache_type(cache_type)
+   , m_associativity(associativity)
+{
+   UInt64 num_blocks = UInt64(num_sets) * associativity;
+
+   m_partial_tags = new UInt32[num_blocks];
+   memset(m_partial_tags, 0xff, num_blocks * sizeof(UInt32));   // INVALID_PARTIAL_TAG
+
+   m_block_info = (char*)CacheBlockInfo::createArray(cache_type, num_blocks, m_block_info_size);
+
+   m_replacement_state = new UInt8[num_blocks];
+   memset(m_replacement_state, 0, num_blocks);
+}
+
+CacheSetStorage::~CacheSetStorage()
+{
+   delete [] m_partial_tags;
+   CacheBlockInfo::destroyArray(m_cache_type, (CacheBlockInfo*)m_block_info);
+   delete [] m_replacement_state;
+}
+
 CacheSet::CacheSet(CacheBase::cache_t cache_type,
-      UInt32 associativity, UInt32 blocksize):
-      m_associativity(associativity), m_blocksize(blocksize)
+      UInt32 associativity, UInt32 blocksize,
+      CacheSetStorage* storage, UInt32 set_index):
+      m_own_storage(NULL), m_associativity(associativity), m_blocksize(blocksize)
 {
-   m_cache_block_info_array = new CacheBlockInfo*[m_associativity];
-   for (UInt32 i = 0; i < m_associativity; i++)
+   if (storage == NULL)
    {
-      m_cache_block_info_array[i] = CacheBlockInfo::create(cache_type);
+      storage = m_own_storage = new CacheSetStorage(cache_type, 1, m_associativity);
+      set_index = 0;
    }
 
+   m_partial_tags = storage->getPartialTags(set_index);
+   m_block_info = storage->getBlockInfo(set_index);
+   m_block_info_size = storage->getBlockInfoSize();
+   m_replacement_state = storage->getReplacementState(set_index);
+
    if (Sim()->getFaultinjectionManager())
    {
       m_blocks = new char[m_associativity * m_blocksize];
@@ -34,82 +62,79 @@ CacheSet::CacheSet(CacheBase::cache_t cache_type,
 
 CacheSet::~CacheSet()
 {
-   for (UInt32 i = 0; i < m_associativity; i++)
-      delete m_cache_block_info_array[i];
-   delete [] m_cache_block_info_array;
+   delete m_own_storage;
    delete [] m_blocks;
 }
 
-void
-CacheSet::read_line(UInt32 line_index, UInt32 offset, Byte *out_buff, UInt32 bytes, bool update_replacement)
-{
-   assert(offset + bytes <= m_blocksize);
-   //assert((out_buff == NULL) == (bytes == 0));
-
-   if (out_buff != NULL && m_blocks != NULL)
-      memcpy((void*) out_buff, &m_blocks[line_index * m_blocksize + offset], bytes);
+// Four partial tags, compared at once using SSE2 or NEON
+typedef UInt32 PartialTagVector __attribute__((vector_size(16)));
+typedef UInt64 PartialTagMask __attribute__((vector_size(16)));
 
-   if (update_replacement)
-      updateReplacementIndex(line_index);
-}
-
-void
-CacheSet::write_line(UInt32 line_index, UInt32 offset, Byte *in_buff, UInt32 bytes, bool update_replacement)
+SInt32
+CacheSet::findWay(IntPtr tag) const
 {
-   assert(offset + bytes <= m_blocksize);
-   //assert((in_buff == NULL) == (bytes == 0));
-
-   if (in_buff != NULL && m_blocks != NULL)
-      memcpy(&m_blocks[line_index * m_blocksize + offset], (void*) in_buff, bytes);
+   const UInt32 partial_tag = tag;
 
-   if (update_replacement)
-      updateReplacementIndex(line_index);
+   // Search from the highest way down
+   UInt32 index = m_associativity;
+   while (index >= 4)
+   {
+      index -= 4;
+      PartialTagVector tags;
+      memcpy(&tags, &m_partial_tags[index], sizeof(tags));
+      PartialTagMask match = (PartialTagMask)(tags == partial_tag);
+      if (match[0] | match[1])
+      {
+         for (SInt32 way = index + 3; way >= (SInt32)index; way--)
+            if (m_partial_tags[way] == partial_tag && peekBlock(way)->getTag() == tag)
+               return way;
+      }
+   }
+   while (index > 0)
+   {
+      index--;
+      if (m_partial_tags[index] == partial_tag && peekBlock(index)->getTag() == tag)
+         return index;
+   }
+   return -1;
 }
 
 CacheBlockInfo*
 CacheSet::find(IntPtr tag, UInt32* line_index)
 {
-   for (SInt32 index = m_associativity-1; index >= 0; index--)
-   {
-      if (m_cache_block_info_array[index]->getTag() == tag)
-      {
-         if (line_index != NULL)
-            *line_index = index;
-         return (m_cache_block_info_array[index]);
-      }
-   }
-   return NULL;
+   SInt32 index = findWay(tag);
+   if (index < 0)
+      return NULL;
+
+   if (line_index != NULL)
+      *line_index = index;
+   return peekBlock(index);
 }
 
 bool
 CacheSet::invalidate(IntPtr& tag)
 {
-   for (SInt32 index = m_associativity-1; index >= 0; index--)
-   {
-      if (m_cache_block_info_array[index]->getTag() == tag)
-      {
-         m_cache_block_info_array[index]->invalidate();
-         return true;
-      }
-   }
-   return false;
+   SInt32 index = findWay(tag);
+   if (index < 0)
+      return false;
+
+   peekBlock(index)->invalidate();
+   m_partial_tags[index] = INVALID_PARTIAL_TAG;
+   return true;
 }
 
 void
-CacheSet::insert(CacheBlockInfo* cache_block_info, Byte* fill_buff, bool* eviction, CacheBlockInfo* evict_block_info, Byte* evict_buff, CacheCntlr *cntlr)
+CacheSet::insertAtIndex(UInt32 index, CacheBlockInfo* cache_block_info, Byte* fill_buff, bool* eviction, CacheBlockInfo* evict_block_info, Byte* evict_buff)
 {
-   // This replacement strategy does not take into account the fact that
-   // cache blocks can be voluntarily flushed or invalidated due to another write request
-   const UInt32 index = getReplacementIndex(cntlr);
    assert(index < m_associativity);
 
    assert(eviction != NULL);
 
-   if (m_cache_block_info_array[index]->isValid())
+   if (isValid(index))
    {
       *eviction = true;
       // FIXME: This is a hack. I dont know if this is the best way to do
-      evict_block_info->clone(m_cache_block_info_array[index]);
+      evict_block_info->clone(peekBlock(index));
       if (evict_buff != NULL && m_blocks != NULL)
          memcpy((void*) evict_buff, &m_blocks[index * m_blocksize], m_blocksize);
    }
@@ -119,7 +144,8 @@ CacheSet::insert(CacheBlockInfo* cache_block_info, Byte* fill_buff, bool* evicti
    }
 
    // FIXME: This is a hack. I dont know if this is the best way to do
-   m_cache_block_info_array[index]->clone(cache_block_info);
+   peekBlock(index)->clone(cache_block_info);
+   m_partial_tags[index] = cache_block_info->getTag();
 
    if (fill_buff != NULL && m_blocks != NULL)
       memcpy(&m_blocks[index * m_blocksize], (void*) fill_buff, m_blocksize);
@@ -135,36 +161,37 @@ CacheSet*
 CacheSet::createCacheSet(String cfgname, core_id_t core_id,
       String replacement_policy,
       CacheBase::cache_t cache_type,
-      UInt32 associativity, UInt32 blocksize, CacheSetInfo* set_info)
+      UInt32 associativity, UInt32 blocksize, CacheSetInfo* set_info,
+      CacheSetStorage* storage, UInt32 set_index)
 {
    CacheBase::ReplacementPolicy policy = parsePolicyType(replacement_policy);
    switch(policy)
    {
       case CacheBase::ROUND_ROBIN:
-         return new CacheSetRoundRobin(cache_type, associativity, blocksize);
+         return new CacheSetRoundRobin(cache_type, associativity, blocksize, storage, set_index);
 
       case CacheBase::LRU:
       case CacheBase::LRU_QBS:
-         return new CacheSetLRU(cache_type, associativity, blocksize, dynamic_cast<CacheSetInfoLRU*>(set_info), getNumQBSAttempts(policy, cfgname, core_id));
+         return new CacheSetLRU(cache_type, associativity, blocksize, storage, set_index, dynamic_cast<CacheSetInfoLRU*>(set_info), getNumQBSAttempts(policy, cfgname, core_id));
 
       case CacheBase::NRU:
-         return new CacheSetNRU(cache_type, associativity, blocksize);
+         return new CacheSetNRU(cache_type, associativity, blocksize, storage, set_index);
 
       case CacheBase::MRU:
-         return new CacheSetMRU(cache_type, associativity, blocksize);
+         return new CacheSetMRU(cache_type, associativity, blocksize, storage, set_index);
 
       case CacheBase::NMRU:
-         return new CacheSetNMRU(cache_type, associativity, blocksize);
+         return new CacheSetNMRU(cache_type, associativity, blocksize, storage, set_index);
 
       case CacheBase::PLRU:
-         return new CacheSetPLRU(cache_type, associativity, blocksize);
+         return new CacheSetPLRU(cache_type, associativity, blocksize, storage, set_index);
 
       case CacheBase::SRRIP:
       case CacheBase::SRRIP_QBS:
-         return new CacheSetSRRIP(cfgname, core_id, cache_type, associativity, blocksize, dynamic_cast<CacheSetInfoLRU*>(set_info), getNumQBSAttempts(policy, cfgname, core_id));
+         return new CacheSetSRRIP(cfgname, core_id, cache_type, associativity, blocksize, storage, set_index, dynamic_cast<CacheSetInfoLRU*>(set_info), getNumQBSAttempts(policy, cfgname, core_id));
 
       case CacheBase::RANDOM:
-         return new CacheSetRandom(cache_type, associativity, blocksize);
+         return new CacheSetRandom(cache_type, associativity, blocksize, storage, set_index);
 
       default:
          LOG_PRINT_ERROR("Unrecognized Cache Replacement Policy: %i",
@@ -233,7 +260,7 @@ CacheSet::parsePolicyType(String policy)
 
 bool CacheSet::isValidReplacement(UInt32 index)
 {
-   if (m_cache_block_info_array[index]->getCState() == CacheState::SHARED_UPGRADING)
+   if (peekBlock(index)->getCState() == CacheState::SHARED_UPGRADING)
    {
       return false;
    }
@@ -18,40 +18,106 @@ class CacheSetInfo
       virtual ~CacheSetInfo() {}
 };
 
+// Partial tags, block information and per-way replacement state for a number of sets, each kept in a single
+// array (structure of arrays) instead of in separately allocated objects per block. A Cache allocates one for
+// all of its sets, so that even a large DRAM cache only needs a handful of allocations. CacheSet::find() compares
+// the low 32 bits of a set's tags from a dense array, four at a time, and only looks at a block to confirm a match.
+class CacheSetStorage
+{
+   public:
+      CacheSetStorage(CacheBase::cache_t cache_type, UInt32 num_sets, UInt32 associativity);
+      ~CacheSetStorage();
+
+      UInt32* getPartialTags(UInt32 set_index) { return &m_partial_tags[UInt64(set_index) * m_associativity]; }
+      CacheBlockInfo* getBlockInfo(UInt32 set_index) { return (CacheBlockInfo*)(m_block_info + UInt64(set_index) * m_associativity * m_block_info_size); }
+      UInt32 getBlockInfoSize() const { return m_block_info_size; }
+      UInt8* getReplacementState(UInt32 set_index) { return &m_replacement_state[UInt64(set_index) * m_associativity]; }
+
+   private:
+      const CacheBase::cache_t m_cache_type;
+      const UInt32 m_associativity;
+      UInt32* m_partial_tags;
+      char* m_block_info;
+      UInt32 m_block_info_size;
+      UInt8* m_replacement_state;
+};
+
 // Everything related to cache sets
 class CacheSet
 {
    public:
 
-      static CacheSet* createCacheSet(String cfgname, core_id_t core_id, String replacement_policy, CacheBase::cache_t cache_type, UInt32 associativity, UInt32 blocksize, CacheSetInfo* set_info = NULL);
+      static CacheSet* createCacheSet(String cfgname, core_id_t core_id, String replacement_policy, CacheBase::cache_t cache_type, UInt32 associativity, UInt32 blocksize, CacheSetInfo* set_info = NULL, CacheSetStorage* storage = NULL, UInt32 set_index = 0);
       static CacheSetInfo* createCacheSetInfo(String name, String cfgname, core_id_t core_id, String replacement_policy, UInt32 associativity);
       static CacheBase::ReplacementPolicy parsePolicyType(String policy);
       static UInt8 getNumQBSAttempts(CacheBase::ReplacementPolicy, String cfgname, core_id_t core_id);
 
    protected:
-      CacheBlockInfo** m_cache_block_info_array;
+      // Low 32 bits of each way's tag, or INVALID_PARTIAL_TAG for invalid lines. These mirror the blocks' tags
+      // so tags may only change through this class (insert, invalidate), not through a CacheBlockInfo
+      // returned by find() or peekBlock()
+      UInt32* m_partial_tags;
+      CacheBlockInfo* m_block_info;
+      UInt32 m_block_info_size;
+      UInt8* m_replacement_state;   // One byte per way for use by the replacement policy
+      CacheSetStorage* m_own_storage;
       char* m_blocks;
       UInt32 m_associativity;
       UInt32 m_blocksize;
       Lock m_lock;
 
+      static const UInt32 INVALID_PARTIAL_TAG = ~(UInt32)0;
+
+      // Only a tag with all of its low bits set needs a look at the block itself
+      bool isValid(UInt32 way) const { return m_partial_tags[way] != INVALID_PARTIAL_TAG || peekBlock(way)->isValid(); }
+      SInt32 findWay(IntPtr tag) const;
+
    public:
 
+      // Without storage, the set allocates its own (e.g. for sampled sets in an ATD)
       CacheSet(CacheBase::cache_t cache_type,
-            UInt32 associativity, UInt32 blocksize);
+            UInt32 associativity, UInt32 blocksize,
+            CacheSetStorage* storage = NULL, UInt32 set_index = 0);
       virtual ~CacheSet();
 
       UInt32 getBlockSize() { return m_blocksize; }
       UInt32 getAssociativity() { return m_associativity; }
       Lock& getLock() { return m_lock; }
 
-      void read_line(UInt32 line_index, UInt32 offset, Byte *out_buff, UInt32 bytes, bool update_replacement);
-      void write_line(UInt32 line_index, UInt32 offset, Byte *in_buff, UInt32 bytes, bool update_replacement);
+      void read_line(UInt32 line_index, UInt32 offset, Byte *out_buff, UInt32 bytes, bool update_replacement)
+      {
+         assert(offset + bytes <= m_blocksize);
+         //assert((out_buff == NULL) == (bytes == 0));
+
+         if (out_buff != NULL && m_blocks != NULL)
+            memcpy((void*) out_buff, &m_blocks[line_index * m_blocksize + offset], bytes);
+
+         if (update_replacement)
+            updateReplacementIndex(line_index);
+      }
+      void write_line(UInt32 line_index, UInt32 offset, Byte *in_buff, UInt32 bytes, bool update_replacement)
+      {
+         assert(offset + bytes <= m_blocksize);
+         //assert((in_buff == NULL) == (bytes == 0));
+
+         if (in_buff != NULL && m_blocks != NULL)
+            memcpy(&m_blocks[line_index * m_blocksize + offset], (void*) in_buff, bytes);
+
+         if (update_replacement)
+            updateReplacementIndex(line_index);
+      }
       CacheBlockInfo* find(IntPtr tag, UInt32* line_index = NULL);
       bool invalidate(IntPtr& tag);
-      void insert(CacheBlockInfo* cache_block_info, Byte* fill_buff, bool* eviction, CacheBlockInfo* evict_block_info, Byte* evict_buff, CacheCntlr *cntlr = NULL);
+      void insert(CacheBlockInfo* cache_block_info, Byte* fill_buff, bool* eviction, CacheBlockInfo* evict_block_info, Byte* evict_buff, CacheCntlr *cntlr = NULL)
+      {
+         // This replacement strategy does not take into account the fact that
+         // cache blocks can be voluntarily flushed or invalidated due to another write request
+         insertAtIndex(getReplacementIndex(cntlr), cache_block_info, fill_buff, eviction, evict_block_info, evict_buff);
+      }
+      // Fill way index, as chosen by getReplacementIndex()
+      void insertAtIndex(UInt32 index, CacheBlockInfo* cache_block_info, Byte* fill_buff, bool* eviction, CacheBlockInfo* evict_block_info, Byte* evict_buff);
 
-      CacheBlockInfo* peekBlock(UInt32 way) const { return m_cache_block_info_array[way]; }
+      CacheBlockInfo* peekBlock(UInt32 way) const { return (CacheBlockInfo*)((char*)m_block_info + way * m_block_info_size); }
 
       char* getDataPtr(UInt32 line_index, UInt32 offset = 0);
       UInt32 getBlockSize(void) const { return m_blocksize; }
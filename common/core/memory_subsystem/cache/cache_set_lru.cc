@@ -6,19 +6,19 @@
 
 CacheSetLRU::CacheSetLRU(
       CacheBase::cache_t cache_type,
-      UInt32 associativity, UInt32 blocksize, CacheSetInfoLRU* set_info, UInt8 num_attempts)
-   : CacheSet(cache_type, associativity, blocksize)
+      UInt32 associativity, UInt32 blocksize,
+      CacheSetStorage* storage, UInt32 set_index, CacheSetInfoLRU* set_info, UInt8 num_attempts)
+   : CacheSet(cache_type, associativity, blocksize, storage, set_index)
    , m_num_attempts(num_attempts)
    , m_set_info(set_info)
 {
-   m_lru_bits = new UInt8[m_associativity];
+   m_lru_bits = m_replacement_state;
    for (UInt32 i = 0; i < m_associativity; i++)
       m_lru_bits[i] = i;
 }
 
 CacheSetLRU::~CacheSetLRU()
 {
-   delete [] m_lru_bits;
 }
 
 UInt32
@@ -27,7 +27,7 @@ CacheSetLRU::getReplacementIndex(CacheCntlr *cntlr)
    // First try to find an invalid block
    for (UInt32 i = 0; i < m_associativity; i++)
    {
-      if (!m_cache_block_info_array[i]->isValid())
+      if (!isValid(i))
       {
          // Mark our newly-inserted line as most-recently used
          moveToMRU(i);
@@ -54,7 +54,7 @@ CacheSetLRU::getReplacementIndex(CacheCntlr *cntlr)
       if (attempt < m_num_attempts - 1)
       {
          LOG_ASSERT_ERROR(cntlr != NULL, "CacheCntlr == NULL, QBS can only be used when cntlr is passed in");
-         qbs_reject = cntlr->isInLowerLevelCache(m_cache_block_info_array[index]);
+         qbs_reject = cntlr->isInLowerLevelCache(peekBlock(index));
       }
 
       if (qbs_reject)
@@ -77,23 +77,7 @@ CacheSetLRU::getReplacementIndex(CacheCntlr *cntlr)
    LOG_PRINT_ERROR("Should not reach here");
 }
 
-void
-CacheSetLRU::updateReplacementIndex(UInt32 accessed_index)
-{
-   m_set_info->increment(m_lru_bits[accessed_index]);
-   moveToMRU(accessed_index);
-}
 
-void
-CacheSetLRU::moveToMRU(UInt32 accessed_index)
-{
-   for (UInt32 i = 0; i < m_associativity; i++)
-   {
-      if (m_lru_bits[i] < m_lru_bits[accessed_index])
-         m_lru_bits[i] ++;
-   }
-   m_lru_bits[accessed_index] = 0;
-}
 
 CacheSetInfoLRU::CacheSetInfoLRU(String name, String cfgname, core_id_t core_id, UInt32 associativity, UInt8 num_attempts)
    : m_associativity(associativity)
@@ -30,17 +30,31 @@ class CacheSetLRU : public CacheSet
 {
    public:
       CacheSetLRU(CacheBase::cache_t cache_type,
-            UInt32 associativity, UInt32 blocksize, CacheSetInfoLRU* set_info, UInt8 num_attempts);
+            UInt32 associativity, UInt32 blocksize,
+            CacheSetStorage* storage, UInt32 set_index, CacheSetInfoLRU* set_info, UInt8 num_attempts);
       virtual ~CacheSetLRU();
 
-      virtual UInt32 getReplacementIndex(CacheCntlr *cntlr);
-      void updateReplacementIndex(UInt32 accessed_index);
+      UInt32 getReplacementIndex(CacheCntlr *cntlr) final;
+      void updateReplacementIndex(UInt32 accessed_index) final
+      {
+         m_set_info->increment(m_lru_bits[accessed_index]);
+         moveToMRU(accessed_index);
+      }
 
    protected:
       const UInt8 m_num_attempts;
       UInt8* m_lru_bits;
       CacheSetInfoLRU* m_set_info;
-      void moveToMRU(UInt32 accessed_index);
+      void moveToMRU(UInt32 accessed_index)
+      {
+         // Branch-free, and with the bounds in registers (stores through m_lru_bits may alias anything) it vectorizes
+         const UInt32 associativity = m_associativity;
+         const UInt8 accessed_bits = m_lru_bits[accessed_index];
+         UInt8* lru_bits = m_lru_bits;
+         for (UInt32 i = 0; i < associativity; i++)
+            lru_bits[i] += (lru_bits[i] < accessed_bits);
+         lru_bits[accessed_index] = 0;
+      }
 };
 
 #endif /* CACHE_SET_LRU_H */
@@ -7,11 +7,20 @@ class CacheSetMRU : public CacheSet
 {
    public:
       CacheSetMRU(CacheBase::cache_t cache_type,
-            UInt32 associativity, UInt32 blocksize);
+            UInt32 associativity, UInt32 blocksize,
+            CacheSetStorage* storage, UInt32 set_index);
       ~CacheSetMRU();
 
-      UInt32 getReplacementIndex(CacheCntlr *cntlr);
-      void updateReplacementIndex(UInt32 accessed_index);
+      UInt32 getReplacementIndex(CacheCntlr *cntlr) final;
+      void updateReplacementIndex(UInt32 accessed_index) final
+      {
+         const UInt32 associativity = m_associativity;
+         const UInt8 accessed_bits = m_lru_bits[accessed_index];
+         UInt8* lru_bits = m_lru_bits;
+         for (UInt32 i = 0; i < associativity; i++)
+            lru_bits[i] += (lru_bits[i] < accessed_bits);
+         lru_bits[accessed_index] = 0;
+      }
 
    private:
       UInt8* m_lru_bits;
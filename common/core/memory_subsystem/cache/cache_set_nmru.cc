@@ -5,10 +5,11 @@
 
 CacheSetNMRU::CacheSetNMRU(
       CacheBase::cache_t cache_type,
-      UInt32 associativity, UInt32 blocksize) :
-   CacheSet(cache_type, associativity, blocksize)
+      UInt32 associativity, UInt32 blocksize,
+      CacheSetStorage* storage, UInt32 set_index) :
+   CacheSet(cache_type, associativity, blocksize, storage, set_index)
 {
-   m_lru_bits = new UInt8[m_associativity];
+   m_lru_bits = m_replacement_state;
    for (UInt32 i = 0; i < m_associativity; i++)
       m_lru_bits[i] = i;
 
@@ -17,7 +18,6 @@ CacheSetNMRU::CacheSetNMRU(
 
 CacheSetNMRU::~CacheSetNMRU()
 {
-   delete [] m_lru_bits;
 }
 
 UInt32
@@ -27,7 +27,7 @@ CacheSetNMRU::getReplacementIndex(CacheCntlr *cntlr)
 
    for (UInt32 i = 0; i < m_associativity; i++)
    {
-      if (!m_cache_block_info_array[i]->isValid())
+      if (!isValid(i))
       {
          updateReplacementIndex(i);
          return i;
@@ -50,14 +50,3 @@ CacheSetNMRU::getReplacementIndex(CacheCntlr *cntlr)
 
    LOG_PRINT_ERROR("Error Finding LRU bits");
 }
-
-void
-CacheSetNMRU::updateReplacementIndex(UInt32 accessed_index)
-{
-   for (UInt32 i = 0; i < m_associativity; i++)
-   {
-      if (m_lru_bits[i] < m_lru_bits[accessed_index])
-         m_lru_bits[i]++;
-   }
-   m_lru_bits[accessed_index] = 0;
-}
@@ -5,10 +5,11 @@
 
 CacheSetNRU::CacheSetNRU(
       CacheBase::cache_t cache_type,
-      UInt32 associativity, UInt32 blocksize) :
-   CacheSet(cache_type, associativity, blocksize)
+      UInt32 associativity, UInt32 blocksize,
+      CacheSetStorage* storage, UInt32 set_index) :
+   CacheSet(cache_type, associativity, blocksize, storage, set_index)
 {
-   m_lru_bits = new UInt8[m_associativity];
+   m_lru_bits = m_replacement_state;
    for (UInt32 i = 0; i < m_associativity; i++)
       m_lru_bits[i] = 0;  // initially, lru bits of each set are set to zero, they are not touched yet
 
@@ -18,7 +19,6 @@ CacheSetNRU::CacheSetNRU(
 
 CacheSetNRU::~CacheSetNRU()
 {
-   delete [] m_lru_bits;
 }
 
 UInt32
@@ -30,7 +30,7 @@ CacheSetNRU::getReplacementIndex(CacheCntlr *cntlr)
 
    for (UInt32 i = 0; i < m_associativity; i++)
    {
-      if (!m_cache_block_info_array[i]->isValid())
+      if (!isValid(i))
       {
          // If there is an invalid line(s) in the set, regardless of the LRU bits of other lines, we choose the first invalid line to replace
          // Mark our newly-inserted line as recently used
@@ -64,22 +64,3 @@ CacheSetNRU::getReplacementIndex(CacheCntlr *cntlr)
 
    LOG_PRINT_ERROR("Error Finding LRU bits");
 }
-
-void
-CacheSetNRU::updateReplacementIndex(UInt32 accessed_index)
-{
-   m_lru_bits[accessed_index] = 1;
-   m_num_bits_set++;
-
-   // If all lru bits are set to 1 in the set, we make all of them 0
-
-   if (m_num_bits_set == m_associativity)
-   {
-      m_num_bits_set = 0;
-
-      for (UInt32 i = 0; i < m_associativity; i++)
-      {
-         m_lru_bits[i] = 0;
-      }
-   }
-}
@@ -7,11 +7,28 @@ class CacheSetNRU : public CacheSet
 {
    public:
       CacheSetNRU(CacheBase::cache_t cache_type,
-            UInt32 associativity, UInt32 blocksize);
+            UInt32 associativity, UInt32 blocksize,
+            CacheSetStorage* storage, UInt32 set_index);
       ~CacheSetNRU();
 
-      UInt32 getReplacementIndex(CacheCntlr *cntlr);
-      void updateReplacementIndex(UInt32 accessed_index);
+      UInt32 getReplacementIndex(CacheCntlr *cntlr) final;
+      void updateReplacementIndex(UInt32 accessed_index) final
+      {
+         m_lru_bits[accessed_index] = 1;
+         m_num_bits_set++;
+
+         // If all lru bits are set to 1 in the set, we make all of them 0
+
+         if (m_num_bits_set == m_associativity)
+         {
+            m_num_bits_set = 0;
+
+            for (UInt32 i = 0; i < m_associativity; i++)
+            {
+               m_lru_bits[i] = 0;
+            }
+         }
+      }
 
    private:
       UInt8* m_lru_bits;
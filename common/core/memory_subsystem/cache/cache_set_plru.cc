@@ -5,8 +5,9 @@
 
 CacheSetPLRU::CacheSetPLRU(
       CacheBase::cache_t cache_type,
-      UInt32 associativity, UInt32 blocksize) :
-   CacheSet(cache_type, associativity, blocksize)
+      UInt32 associativity, UInt32 blocksize,
+      CacheSetStorage* storage, UInt32 set_index) :
+   CacheSet(cache_type, associativity, blocksize, storage, set_index)
 {
    LOG_ASSERT_ERROR(associativity == 4 || associativity == 8,
       "PLRU not implemted for associativity %d (only 4, 8)", associativity);
@@ -25,7 +26,7 @@ CacheSetPLRU::getReplacementIndex(CacheCntlr *cntlr)
 
    for (UInt32 i = 0; i < m_associativity; i++)
    {
-      if (!m_cache_block_info_array[i]->isValid())
+      if (!isValid(i))
       {
          updateReplacementIndex(i);
          return i;
@@ -86,30 +87,3 @@ CacheSetPLRU::getReplacementIndex(CacheCntlr *cntlr)
    return retValue;
 
 }
-
-void
-CacheSetPLRU::updateReplacementIndex(UInt32 accessed_index)
-{
-   if (m_associativity == 4)
-   {
-      if      (accessed_index==0) { b[0]=1;b[1]=1;     }
-      else if (accessed_index==1) { b[0]=1;b[1]=0;     }
-      else if (accessed_index==2) { b[0]=0;       b[2]=1;}
-      else if (accessed_index==3) { b[0]=0;       b[2]=0;}
-   }
-   else if (m_associativity == 8)
-   {
-      if      (accessed_index==0) { b[0]=1;b[1]=1;b[2]=1;                            }
-      else if (accessed_index==1) { b[0]=1;b[1]=1;b[2]=0;                            }
-      else if (accessed_index==2) { b[0]=1;b[1]=0;       b[3]=1;                     }
-      else if (accessed_index==3) { b[0]=1;b[1]=0;       b[3]=0;                     }
-      else if (accessed_index==4) { b[0]=0;                     b[4]=1;b[5]=1;       }
-      else if (accessed_index==5) { b[0]=0;                     b[4]=1;b[5]=0;       }
-      else if (accessed_index==6) { b[0]=0;                     b[4]=0;       b[6]=1;}
-      else if (accessed_index==7) { b[0]=0;                     b[4]=0;       b[6]=0;}
-   }
-   else
-   {
-      LOG_PRINT_ERROR("PLRU doesn't support associativity %d", m_associativity);
-   }
-}
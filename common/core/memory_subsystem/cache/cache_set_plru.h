@@ -7,11 +7,36 @@ class CacheSetPLRU : public CacheSet
 {
    public:
       CacheSetPLRU(CacheBase::cache_t cache_type,
-            UInt32 associativity, UInt32 blocksize);
+            UInt32 associativity, UInt32 blocksize,
+            CacheSetStorage* storage, UInt32 set_index);
       ~CacheSetPLRU();
 
-      UInt32 getReplacementIndex(CacheCntlr *cntlr);
-      void updateReplacementIndex(UInt32 accessed_index);
+      UInt32 getReplacementIndex(CacheCntlr *cntlr) final;
+      void updateReplacementIndex(UInt32 accessed_index) final
+      {
+         if (m_associativity == 4)
+         {
+            if      (accessed_index==0) { b[0]=1;b[1]=1;     }
+            else if (accessed_index==1) { b[0]=1;b[1]=0;     }
+            else if (accessed_index==2) { b[0]=0;       b[2]=1;}
+            else if (accessed_index==3) { b[0]=0;       b[2]=0;}
+         }
+         else if (m_associativity == 8)
+         {
+            if      (accessed_index==0) { b[0]=1;b[1]=1;b[2]=1;                            }
+            else if (accessed_index==1) { b[0]=1;b[1]=1;b[2]=0;                            }
+            else if (accessed_index==2) { b[0]=1;b[1]=0;       b[3]=1;                     }
+            else if (accessed_index==3) { b[0]=1;b[1]=0;       b[3]=0;                     }
+            else if (accessed_index==4) { b[0]=0;                     b[4]=1;b[5]=1;       }
+            else if (accessed_index==5) { b[0]=0;                     b[4]=1;b[5]=0;       }
+            else if (accessed_index==6) { b[0]=0;                     b[4]=0;       b[6]=1;}
+            else if (accessed_index==7) { b[0]=0;                     b[4]=0;       b[6]=0;}
+         }
+         else
+         {
+            LOG_PRINT_ERROR("PLRU doesn't support associativity %d", m_associativity);
+         }
+      }
 
    private:
       UInt8 b[8];
@@ -7,8 +7,9 @@
 
 CacheSetRandom::CacheSetRandom(
       CacheBase::cache_t cache_type,
-      UInt32 associativity, UInt32 blocksize) :
-   CacheSet(cache_type, associativity, blocksize)
+      UInt32 associativity, UInt32 blocksize,
+      CacheSetStorage* storage, UInt32 set_index) :
+   CacheSet(cache_type, associativity, blocksize, storage, set_index)
 {
    m_rand.seed(time(NULL));
 }
@@ -24,7 +25,7 @@ CacheSetRandom::getReplacementIndex(CacheCntlr *cntlr)
 
    for (UInt32 i = 0; i < m_associativity; i++)
    {
-       if (!m_cache_block_info_array[i]->isValid())
+       if (!isValid(i))
           return i;   // if there is an invalid line, use that line
    }
 
@@ -39,8 +40,3 @@ CacheSetRandom::getReplacementIndex(CacheCntlr *cntlr)
       return getReplacementIndex(cntlr);
    }
 }
-
-void
-CacheSetRandom::updateReplacementIndex(UInt32 accessed_index)
-{
-}
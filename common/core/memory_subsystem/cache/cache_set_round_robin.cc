@@ -2,8 +2,9 @@
 
 CacheSetRoundRobin::CacheSetRoundRobin(
       CacheBase::cache_t cache_type,
-      UInt32 associativity, UInt32 blocksize) :
-   CacheSet(cache_type, associativity, blocksize)
+      UInt32 associativity, UInt32 blocksize,
+      CacheSetStorage* storage, UInt32 set_index) :
+   CacheSet(cache_type, associativity, blocksize, storage, set_index)
 {
    m_replacement_index = m_associativity - 1;
 }
@@ -22,9 +23,3 @@ CacheSetRoundRobin::getReplacementIndex(CacheCntlr *cntlr)
    else
       return curr_replacement_index;
 }
-
-void
-CacheSetRoundRobin::updateReplacementIndex(UInt32 accessed_index)
-{
-   return;
-}
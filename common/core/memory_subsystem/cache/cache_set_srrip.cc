@@ -8,8 +8,9 @@
 CacheSetSRRIP::CacheSetSRRIP(
       String cfgname, core_id_t core_id,
       CacheBase::cache_t cache_type,
-      UInt32 associativity, UInt32 blocksize, CacheSetInfoLRU* set_info, UInt8 num_attempts)
-   : CacheSet(cache_type, associativity, blocksize)
+      UInt32 associativity, UInt32 blocksize,
+      CacheSetStorage* storage, UInt32 set_index, CacheSetInfoLRU* set_info, UInt8 num_attempts)
+   : CacheSet(cache_type, associativity, blocksize, storage, set_index)
    , m_rrip_numbits(Sim()->getCfg()->getIntArray(cfgname + "/srrip/bits", core_id))
    , m_rrip_max((1 << m_rrip_numbits) - 1)
    , m_rrip_insert(m_rrip_max - 1)
@@ -17,14 +18,13 @@ CacheSetSRRIP::CacheSetSRRIP(
    , m_replacement_pointer(0)
    , m_set_info(set_info)
 {
-   m_rrip_bits = new UInt8[m_associativity];
+   m_rrip_bits = m_replacement_state;
    for (UInt32 i = 0; i < m_associativity; i++)
       m_rrip_bits[i] = m_rrip_insert;
 }
 
 CacheSetSRRIP::~CacheSetSRRIP()
 {
-   delete [] m_rrip_bits;
 }
 
 UInt32
@@ -32,7 +32,7 @@ CacheSetSRRIP::getReplacementIndex(CacheCntlr *cntlr)
 {
    for (UInt32 i = 0; i < m_associativity; i++)
    {
-      if (!m_cache_block_info_array[i]->isValid())
+      if (!isValid(i))
       {
          // If there is an invalid line(s) in the set, regardless of the LRU bits of other lines, we choose the first invalid line to replace
          // Prepare way for a new line: set prediction to 'long'
@@ -56,7 +56,7 @@ CacheSetSRRIP::getReplacementIndex(CacheCntlr *cntlr)
             if (attempt < m_num_attempts - 1)
             {
                LOG_ASSERT_ERROR(cntlr != NULL, "CacheCntlr == NULL, QBS can only be used when cntlr is passed in");
-               qbs_reject = cntlr->isInLowerLevelCache(m_cache_block_info_array[index]);
+               qbs_reject = cntlr->isInLowerLevelCache(peekBlock(index));
             }
 
             if (qbs_reject)
@@ -94,12 +94,3 @@ CacheSetSRRIP::getReplacementIndex(CacheCntlr *cntlr)
 
    LOG_PRINT_ERROR("Error finding replacement index");
 }
-
-void
-CacheSetSRRIP::updateReplacementIndex(UInt32 accessed_index)
-{
-   m_set_info->increment(m_rrip_bits[accessed_index]);
-
-   if (m_rrip_bits[accessed_index] > 0)
-      m_rrip_bits[accessed_index]--;
-}
@@ -9,11 +9,18 @@ class CacheSetSRRIP : public CacheSet
    public:
       CacheSetSRRIP(String cfgname, core_id_t core_id,
             CacheBase::cache_t cache_type,
-            UInt32 associativity, UInt32 blocksize, CacheSetInfoLRU* set_info, UInt8 num_attempts);
+            UInt32 associativity, UInt32 blocksize,
+            CacheSetStorage* storage, UInt32 set_index, CacheSetInfoLRU* set_info, UInt8 num_attempts);
       ~CacheSetSRRIP();
 
-      UInt32 getReplacementIndex(CacheCntlr *cntlr);
-      void updateReplacementIndex(UInt32 accessed_index);
+      UInt32 getReplacementIndex(CacheCntlr *cntlr) final;
+      void updateReplacementIndex(UInt32 accessed_index) final
+      {
+         m_set_info->increment(m_rrip_bits[accessed_index]);
+
+         if (m_rrip_bits[accessed_index] > 0)
+            m_rrip_bits[accessed_index]--;
+      }
 
    private:
       const UInt8 m_rrip_numbits;
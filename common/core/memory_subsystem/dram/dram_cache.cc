@@ -202,15 +202,16 @@ DramCache::accessDataArray(Cache::access_t access, core_id_t requester, Subsecon
 void
 DramCache::callPrefetcher(IntPtr train_address, bool cache_hit, bool prefetch_hit, SubsecondTime t_issue)
 {
-   // Always train the prefetcher
-   std::vector<IntPtr> prefetchList = m_prefetcher->getNextAddress(train_address, INVALID_CORE_ID);
-
-   // Only do prefetches on misses, or on hits to lines previously brought in by the prefetcher (if enabled)
+   // Always train the prefetcher, but only do prefetches on misses,
+   // or on hits to lines previously brought in by the prefetcher (if enabled)
    if (!cache_hit || (m_prefetch_on_prefetch_hit && prefetch_hit))
    {
-      for(std::vector<IntPtr>::iterator it = prefetchList.begin(); it != prefetchList.end(); ++it)
+      IntPtr prefetchList[Prefetcher::MAX_CANDIDATES];
+      UInt32 numPrefetches = m_prefetcher->getNextAddress(train_address, INVALID_CORE_ID, 0, prefetchList, Prefetcher::MAX_CANDIDATES);
+
+      for(UInt32 i = 0; i < numPrefetches; ++i)
       {
-         IntPtr prefetch_address = *it;
+         IntPtr prefetch_address = prefetchList[i];
          if (!m_cache->peekSingleLine(prefetch_address))
          {
             // Get data from DRAM
@@ -230,4 +231,8 @@ DramCache::callPrefetcher(IntPtr train_address, bool cache_hit, bool prefetch_hi
          }
       }
    }
+   else
+   {
+      m_prefetcher->train(train_address, INVALID_CORE_ID, 0);
+   }
 }
@@ -0,0 +1,40 @@
+#include "memory_manager.h"
+#include "stats.h"
+#include "log.h"
+#include "utils.h"
+#include "fast_cache.h"
+
+namespace FastNehalem
+{
+
+template <UInt32 assoc>
+static CacheBase* createCacheAssoc(Core *core, String name, MemComponent::component_t mem_component, UInt32 size_kb, UInt32 associativity,
+                                   const ComponentLatency &data_latency, const ComponentLatency &tags_latency, CacheBase* next_level, bool shared)
+{
+   if (shared)
+      return new CacheLocked<assoc>(core, name, mem_component, size_kb, associativity, data_latency, tags_latency, next_level);
+   else
+      return new Cache<assoc>(core, name, mem_component, size_kb, associativity, data_latency, tags_latency, next_level);
+}
+
+CacheBase* createCache(Core *core, String name, MemComponent::component_t mem_component, UInt32 size_kb, UInt32 associativity,
+                       const ComponentLatency &data_latency, const ComponentLatency &tags_latency, CacheBase* next_level, bool shared)
+{
+   switch(associativity)
+   {
+      case 1:
+         return createCacheAssoc<1>(core, name, mem_component, size_kb, associativity, data_latency, tags_latency, next_level, shared);
+      case 2:
+         return createCacheAssoc<2>(core, name, mem_component, size_kb, associativity, data_latency, tags_latency, next_level, shared);
+      case 4:
+         return createCacheAssoc<4>(core, name, mem_component, size_kb, associativity, data_latency, tags_latency, next_level, shared);
+      case 8:
+         return createCacheAssoc<8>(core, name, mem_component, size_kb, associativity, data_latency, tags_latency, next_level, shared);
+      case 16:
+         return createCacheAssoc<16>(core, name, mem_component, size_kb, associativity, data_latency, tags_latency, next_level, shared);
+      default:
+         return createCacheAssoc<0>(core, name, mem_component, size_kb, associativity, data_latency, tags_latency, next_level, shared);
+   }
+}
+
+}
@@ -8,12 +8,12 @@ namespace FastNehalem
    class Dram : public CacheBase
    {
       private:
-         const ComponentLatency m_latency;
+         const SubsecondTime m_latency;
          UInt64 m_reads, m_writes;
          SubsecondTime m_total_latency;
       public:
-         Dram(Core *core, String name, UInt64 latency)
-            : m_latency(core->getDvfsDomain(), latency)
+         Dram(Core *core, String name, SubsecondTime latency)
+            : m_latency(latency)
          {
             m_reads = m_writes = 0;
             registerStatsMetric(name, core->getId(), "reads", &m_reads);
@@ -21,73 +21,82 @@ namespace FastNehalem
             m_total_latency = SubsecondTime::Zero();
             registerStatsMetric(name, core->getId(), "total-access-latency", &m_total_latency);
          }
-         SubsecondTime access(Core::mem_op_t mem_op_type, IntPtr tag)
+         SubsecondTime access(Core::mem_op_t mem_op_type, IntPtr tag, HitWhere::where_t &hit_where)
          {
             if (mem_op_type == Core::WRITE)
                ++m_writes;
             else
                ++m_reads;
-            m_total_latency += m_latency.getLatency();
-            return m_latency.getLatency();
+            m_total_latency += m_latency;
+            hit_where = HitWhere::DRAM;
+            return m_latency;
          }
+         SubsecondTime getHitLatency() const { return m_latency; }
    };
 
+   // Set-associative LRU cache. The associativity is a template parameter so the way search can be unrolled,
+   // createCache() picks an instantiation for common associativities and falls back to assoc = 0 (known only at run time)
    template <UInt32 assoc>
-   class CacheSet
+   class Cache : public CacheBase
    {
       private:
-         IntPtr m_tags[assoc];
-         UInt64 m_lru[assoc];
+         const MemComponent::component_t m_mem_component;
+         const ComponentLatency m_data_latency;
+         const ComponentLatency m_tags_latency;
+         CacheBase* const m_next_level;
+         const UInt32 m_assoc;
+         const UInt64 m_num_sets;
+         const IntPtr m_sets_mask;
+         std::vector<IntPtr> m_tags;
+         std::vector<UInt64> m_lru;
          UInt64 m_lru_max;
-      public:
+         UInt64 m_loads, m_stores, m_load_misses, m_store_misses;
+
+         UInt32 ways() const { return assoc ? assoc : m_assoc; }
+
          bool find(IntPtr tag)
          {
-            for(unsigned int idx = 0; idx < assoc; ++idx)
+            IntPtr *tags = &m_tags[(tag & m_sets_mask) * ways()];
+            UInt64 *lru = &m_lru[(tag & m_sets_mask) * ways()];
+            for(unsigned int idx = 0; idx < ways(); ++idx)
             {
-               if (m_tags[idx] == tag)
+               if (tags[idx] == tag)
                {
-                  m_lru[idx] = ++m_lru_max;
+                  lru[idx] = ++m_lru_max;
                   return true;
                }
             }
             // Find replacement
             UInt64 lru_min = UINT64_MAX; unsigned int idx_min = 0;
-            for(unsigned int idx = 0; idx < assoc; ++idx)
+            for(unsigned int idx = 0; idx < ways(); ++idx)
             {
-               if (m_lru[idx] < lru_min)
+               if (lru[idx] < lru_min)
                {
-                  lru_min = m_lru[idx];
+                  lru_min = lru[idx];
                   idx_min = idx;
                }
             }
-            m_tags[idx_min] = tag;
-            m_lru[idx_min] = ++m_lru_max;
+            tags[idx_min] = tag;
+            lru[idx_min] = ++m_lru_max;
             return false;
          }
-   };
-
-   template <UInt32 assoc, UInt32 size_kb>
-   class Cache : public CacheBase
-   {
-      private:
-         const MemComponent::component_t m_mem_component;
-         const ComponentLatency m_latency;
-         CacheBase* const m_next_level;
-         const UInt64 m_num_sets;
-         const IntPtr m_sets_mask;
-         std::vector<CacheSet<assoc> > m_sets;
-         UInt64 m_loads, m_stores, m_load_misses, m_store_misses;
 
       public:
-         Cache(Core *core, String name, MemComponent::component_t mem_component, UInt64 latency, CacheBase* next_level)
+         Cache(Core *core, String name, MemComponent::component_t mem_component, UInt32 size_kb, UInt32 associativity,
+               const ComponentLatency &data_latency, const ComponentLatency &tags_latency, CacheBase* next_level)
             : m_mem_component(mem_component)
-            , m_latency(core->getDvfsDomain(), latency)
+            , m_data_latency(data_latency)
+            , m_tags_latency(tags_latency)
             , m_next_level(next_level)
-            , m_num_sets(size_kb * 1024 / 64 / assoc)
+            , m_assoc(associativity)
+            , m_num_sets(UInt64(size_kb) * 1024 / 64 / associativity)
             , m_sets_mask(m_num_sets - 1)
-            , m_sets(m_num_sets)
+            , m_tags(m_num_sets * associativity)
+            , m_lru(m_num_sets * associativity)
+            , m_lru_max(0)
          {
-            LOG_ASSERT_ERROR(UInt64(1) << floorLog2(m_num_sets) == m_num_sets, "Number of sets must be power of 2");
+            LOG_ASSERT_ERROR(assoc == 0 || assoc == associativity, "Cache<%u> instantiated for associativity %u", assoc, associativity);
+            LOG_ASSERT_ERROR(m_num_sets > 0 && UInt64(1) << floorLog2(m_num_sets) == m_num_sets, "Number of sets must be power of 2");
             m_loads = m_stores = m_load_misses = m_store_misses = 0;
             registerStatsMetric(name, core->getId(), "loads", &m_loads);
             registerStatsMetric(name, core->getId(), "stores", &m_stores);
@@ -96,34 +105,43 @@ namespace FastNehalem
          }
          virtual ~Cache() {}
 
-         SubsecondTime access(Core::mem_op_t mem_op_type, IntPtr tag)
+         SubsecondTime access(Core::mem_op_t mem_op_type, IntPtr tag, HitWhere::where_t &hit_where)
          {
             if (mem_op_type == Core::WRITE) ++m_stores; else ++m_loads;
-            if (m_sets[tag & m_sets_mask].find(tag))
-               return m_latency.getLatency();
+            if (find(tag))
+            {
+               hit_where = HitWhere::where_t(m_mem_component);
+               return m_data_latency.getLatency();
+            }
             else
             {
                if (mem_op_type == Core::WRITE) ++m_store_misses; else ++m_load_misses;
-               return m_next_level->access(mem_op_type, tag);
+               return m_tags_latency.getLatency() + m_next_level->access(mem_op_type, tag, hit_where);
             }
          }
+         SubsecondTime getHitLatency() const { return m_data_latency.getLatency(); }
    };
 
-   template <UInt32 assoc, UInt32 size_kb>
-   class CacheLocked : public Cache<assoc, size_kb>
+   template <UInt32 assoc>
+   class CacheLocked : public Cache<assoc>
    {
       private:
          Lock lock;
       public:
-         CacheLocked(Core *core, String name, MemComponent::component_t mem_component, UInt64 latency, CacheBase* next_level)
-            : Cache<assoc, size_kb>(core, name, mem_component, latency, next_level)
+         CacheLocked(Core *core, String name, MemComponent::component_t mem_component, UInt32 size_kb, UInt32 associativity,
+                     const ComponentLatency &data_latency, const ComponentLatency &tags_latency, CacheBase* next_level)
+            : Cache<assoc>(core, name, mem_component, size_kb, associativity, data_latency, tags_latency, next_level)
          {}
-         SubsecondTime access(Core::mem_op_t mem_op_type, IntPtr tag)
+         SubsecondTime access(Core::mem_op_t mem_op_type, IntPtr tag, HitWhere::where_t &hit_where)
          {
             ScopedLock sl(lock);
-            return Cache<assoc, size_kb>::access(mem_op_type, tag);
+            return Cache<assoc>::access(mem_op_type, tag, hit_where);
          }
    };
+
+   // Caches shared by several cores need to be locked
+   CacheBase* createCache(Core *core, String name, MemComponent::component_t mem_component, UInt32 size_kb, UInt32 associativity,
+                          const ComponentLatency &data_latency, const ComponentLatency &tags_latency, CacheBase* next_level, bool shared);
 }
 
 #endif // __FAST_CACHE_H
@@ -1,4 +1,8 @@
 #include "memory_manager.h"
+#include "simulator.h"
+#include "config.hpp"
+#include "dvfs_manager.h"
+#include "itostr.h"
 #include "stats.h"
 #include "log.h"
 #include "utils.h"
@@ -7,25 +11,69 @@
 namespace FastNehalem
 {
 
-CacheBase *MemoryManager::l3cache = NULL, *MemoryManager::dram = NULL;
+std::map<std::pair<UInt32, core_id_t>, CacheBase*> MemoryManager::s_shared_caches;
+CacheBase *MemoryManager::dram = NULL;
 
 MemoryManager::MemoryManager(Core* core, Network* network, ShmemPerfModel* shmem_perf_model)
    : MemoryManagerFast(core, network, shmem_perf_model)
 {
    if (!dram)
-      dram = new Dram(core, "dram", 150);
-   if (!l3cache)
-      l3cache = new CacheLocked<16, 8192>(core, "L3", MemComponent::L3_CACHE, 35, dram);
-   l2cache = new Cache<8, 256>(core, "L2", MemComponent::L2_CACHE, 9, l3cache);
-   icache = new Cache<4, 32>(core, "L1-I", MemComponent::L1_ICACHE, 0, l2cache);
-   dcache = new Cache<8, 32>(core, "L1-D", MemComponent::L1_DCACHE, 0, l2cache);
+      dram = new Dram(core, "dram", SubsecondTime::NS(Sim()->getCfg()->getInt("perf_model/dram/latency")));
+
+   // Build the hierarchy described by perf_model/l*_cache from the last level up, so each cache knows its next level
+   CacheBase *next_level = dram;
+   for(UInt32 level = Sim()->getCfg()->getInt("perf_model/cache/levels"); level > 1; --level)
+   {
+      next_level = createCache("l" + itostr(level) + "_cache", "L" + itostr(level),
+                               MemComponent::component_t(MemComponent::L2_CACHE + level - 2), next_level);
+   }
+   icache = createCache("l1_icache", "L1-I", MemComponent::L1_ICACHE, next_level);
+   dcache = createCache("l1_dcache", "L1-D", MemComponent::L1_DCACHE, next_level);
 }
 
 MemoryManager::~MemoryManager()
 {
-   delete icache;
-   delete dcache;
-   delete l2cache;
+   for(std::vector<CacheBase*>::iterator it = m_private_caches.begin(); it != m_private_caches.end(); ++it)
+      delete *it;
+}
+
+CacheBase*
+MemoryManager::createCache(String configName, String name, MemComponent::component_t mem_component, CacheBase* next_level)
+{
+   core_id_t core_id = getCore()->getId();
+   String prefix = "perf_model/" + configName + "/";
+
+   UInt32 shared_cores = Sim()->getCfg()->getIntArray(prefix + "shared_cores", core_id) * Sim()->getCfg()->getInt("perf_model/core/logical_cpus");
+   std::pair<UInt32, core_id_t> shared_key(mem_component, core_id - core_id % shared_cores);
+   if (shared_cores > 1 && s_shared_caches.count(shared_key))
+      return s_shared_caches[shared_key];
+
+   LOG_ASSERT_ERROR(Sim()->getCfg()->getIntArray(prefix + "cache_block_size", core_id) == CACHE_LINE_SIZE,
+                    "The fast_nehalem memory model only supports 64-byte cache lines (%s)", configName.c_str());
+
+   const ComponentPeriod *clock_domain = NULL;
+   String domain_name = Sim()->getCfg()->getStringArray(prefix + "dvfs_domain", core_id);
+   if (domain_name == "core")
+      clock_domain = getCore()->getDvfsDomain();
+   else if (domain_name == "global")
+      clock_domain = Sim()->getDvfsManager()->getGlobalDomain();
+   else
+      LOG_PRINT_ERROR("dvfs_domain %s is invalid", domain_name.c_str());
+
+   CacheBase *cache = FastNehalem::createCache(getCore(), name, mem_component,
+      Sim()->getCfg()->getIntArray(prefix + "cache_size", core_id),
+      Sim()->getCfg()->getIntArray(prefix + "associativity", core_id),
+      ComponentLatency(clock_domain, Sim()->getCfg()->getIntArray(prefix + "data_access_time", core_id)),
+      ComponentLatency(clock_domain, Sim()->getCfg()->getIntArray(prefix + "tags_access_time", core_id)),
+      next_level,
+      shared_cores > 1);
+
+   if (shared_cores > 1)
+      s_shared_caches[shared_key] = cache;
+   else
+      m_private_caches.push_back(cache);
+
+   return cache;
 }
 
 }
@@ -3,20 +3,30 @@
 
 #include "memory_manager_fast.h"
 
+#include <map>
+#include <vector>
+
 namespace FastNehalem
 {
    class CacheBase
    {
       public:
          virtual ~CacheBase() {}
-         virtual SubsecondTime access(Core::mem_op_t mem_op_type, IntPtr tag) = 0;
+         // Returns the access latency, hit_where is set to the level that had the data
+         virtual SubsecondTime access(Core::mem_op_t mem_op_type, IntPtr tag, HitWhere::where_t &hit_where) = 0;
+         virtual SubsecondTime getHitLatency() const = 0;
    };
 
    class MemoryManager : public MemoryManagerFast
    {
       private:
-         CacheBase *icache, *dcache, *l2cache;
-         static CacheBase *l3cache, *dram;
+         CacheBase *icache, *dcache;
+         std::vector<CacheBase*> m_private_caches;
+         // Shared caches by (level, first core sharing it), these and the DRAM are never deleted
+         static std::map<std::pair<UInt32, core_id_t>, CacheBase*> s_shared_caches;
+         static CacheBase *dram;
+
+         CacheBase* createCache(String configName, String name, MemComponent::component_t mem_component, CacheBase* next_level);
 
       public:
          MemoryManager(Core* core, Network* network, ShmemPerfModel* shmem_perf_model);
@@ -25,11 +35,14 @@ namespace FastNehalem
          SubsecondTime coreInitiateMemoryAccessFast(
                bool use_icache,
                Core::mem_op_t mem_op_type,
-               IntPtr address)
+               IntPtr address,
+               HitWhere::where_t &hit_where)
          {
             IntPtr tag = address >> CACHE_LINE_BITS;
-            return (use_icache ? icache : dcache)->access(mem_op_type, tag);
+            return (use_icache ? icache : dcache)->access(mem_op_type, tag, hit_where);
          }
+
+         SubsecondTime getL1HitLatency(void) { return icache->getHitLatency(); }
    };
 }
 
@@ -48,23 +48,26 @@ class MemoryManagerBase
             Core::mem_op_t mem_op_type,
             IntPtr address, UInt32 offset,
             Byte* data_buf, UInt32 data_length,
-            Core::MemModeled modeled) = 0;
+            Core::MemModeled modeled,
+            IntPtr eip) = 0;
       virtual SubsecondTime coreInitiateMemoryAccessFast(
             bool icache,
             Core::mem_op_t mem_op_type,
-            IntPtr address)
+            IntPtr address,
+            HitWhere::where_t &hit_where)
       {
          // Emulate fast interface by calling into slow interface
          SubsecondTime initial_time = getCore()->getPerformanceModel()->getElapsedTime();
          getShmemPerfModel()->setElapsedTime(ShmemPerfModel::_USER_THREAD, initial_time);
 
-         coreInitiateMemoryAccess(
+         hit_where = coreInitiateMemoryAccess(
                icache ? MemComponent::L1_ICACHE : MemComponent::L1_DCACHE,
                Core::NONE,
                mem_op_type,
                address - (address % getCacheBlockSize()), 0,
                NULL, getCacheBlockSize(),
-               Core::MEM_MODELED_COUNT_TLBTIME);
+               Core::MEM_MODELED_COUNT_TLBTIME,
+               0);
 
          // Get the final cycle time
          SubsecondTime final_time = getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD);
@@ -3,6 +3,7 @@
 
 #include "memory_manager_base.h"
 #include "mem_component.h"
+#include "hit_where.h"
 #include "fixed_types.h"
 #include "subsecond_time.h"
 
@@ -24,22 +25,23 @@ class MemoryManagerFast : public MemoryManagerBase
             Core::mem_op_t mem_op_type,
             IntPtr address, UInt32 offset,
             Byte* data_buf, UInt32 data_length,
-            Core::MemModeled modeled)
+            Core::MemModeled modeled,
+            IntPtr eip)
       {
          // Emulate slow interface by calling into fast interface
          assert(data_buf == NULL);
-         SubsecondTime latency = coreInitiateMemoryAccessFast(mem_component == MemComponent::L1_ICACHE ? true : false, mem_op_type, address);
+         HitWhere::where_t hit_where;
+         SubsecondTime latency = coreInitiateMemoryAccessFast(mem_component == MemComponent::L1_ICACHE ? true : false, mem_op_type, address, hit_where);
          getShmemPerfModel()->incrElapsedTime(latency,  ShmemPerfModel::_USER_THREAD);
-         if (latency > SubsecondTime::Zero())
-            return HitWhere::MISS;
-         else
-            return HitWhere::where_t(mem_component);
+         return hit_where;
       }
 
+      // Returns the access latency, hit_where is set to the level that had the data
       virtual SubsecondTime coreInitiateMemoryAccessFast(
             bool icache,
             Core::mem_op_t mem_op_type,
-            IntPtr address) = 0;
+            IntPtr address,
+            HitWhere::where_t &hit_where) = 0;
 
       void handleMsgFromNetwork(NetPacket& packet) { assert(false); }
 
@@ -56,7 +58,6 @@ class MemoryManagerFast : public MemoryManagerBase
       void sendMsg(PrL1PrL2DramDirectoryMSI::ShmemMsg::msg_t msg_type, MemComponent::component_t sender_mem_component, MemComponent::component_t receiver_mem_component, core_id_t requester, core_id_t receiver, IntPtr address, Byte* data_buf = NULL, UInt32 data_length = 0, HitWhere::where_t where = HitWhere::UNKNOWN, ShmemPerf *perf = NULL, ShmemPerfModel::Thread_t thread_num = ShmemPerfModel::NUM_CORE_THREADS) { assert(false); }
       void broadcastMsg(PrL1PrL2DramDirectoryMSI::ShmemMsg::msg_t msg_type, MemComponent::component_t sender_mem_component, MemComponent::component_t receiver_mem_component, core_id_t requester, IntPtr address, Byte* data_buf = NULL, UInt32 data_length = 0, ShmemPerf *perf = NULL, ShmemPerfModel::Thread_t thread_num = ShmemPerfModel::NUM_CORE_THREADS) { assert(false); }
 
-      SubsecondTime getL1HitLatency(void) { return SubsecondTime::Zero(); }
       void addL1Hits(bool icache, Core::mem_op_t mem_op_type, UInt64 hits) {}
 };
 
@@ -0,0 +1,44 @@
+#include "page_size_table.h"
+#include "log.h"
+
+const UInt32 PageSizeTable::LARGE_PAGE_SHIFTS[PageSizeTable::NUM_LARGE_SIZES] = { 30, 21 };
+IntPtr PageSizeTable::s_frames[PageSizeTable::NUM_LARGE_SIZES][PageSizeTable::TABLE_SIZE];
+
+void
+PageSizeTable::insert(IntPtr physical_address, UInt32 page_shift)
+{
+   UInt32 size = 0;
+   while (size < NUM_LARGE_SIZES && LARGE_PAGE_SHIFTS[size] != page_shift)
+      ++size;
+   LOG_ASSERT_ERROR(size < NUM_LARGE_SIZES, "Unsupported page size 2^%u", page_shift);
+
+   IntPtr *frames = s_frames[size];
+   IntPtr frame = (physical_address >> page_shift) + 1;
+   for(UInt32 probe = 0; probe < TABLE_SIZE; ++probe)
+   {
+      IntPtr &slot = frames[(hash(frame) + probe) % TABLE_SIZE];
+      IntPtr prev = __sync_val_compare_and_swap(&slot, 0, frame);
+      if (prev == 0 || prev == frame)
+         return;
+   }
+   LOG_PRINT_WARNING_ONCE("PageSizeTable full, further large pages will be modeled as 4 KB pages");
+}
+
+UInt32
+PageSizeTable::getPageShift(IntPtr physical_address)
+{
+   for(UInt32 size = 0; size < NUM_LARGE_SIZES; ++size)
+   {
+      const IntPtr *frames = s_frames[size];
+      IntPtr frame = (physical_address >> LARGE_PAGE_SHIFTS[size]) + 1;
+      for(UInt32 probe = 0; probe < TABLE_SIZE; ++probe)
+      {
+         IntPtr slot = __atomic_load_n(&frames[(hash(frame) + probe) % TABLE_SIZE], __ATOMIC_ACQUIRE);
+         if (slot == frame)
+            return LARGE_PAGE_SHIFTS[size];
+         if (slot == 0)
+            break;
+      }
+   }
+   return SMALL_PAGE_SHIFT;
+}
@@ -0,0 +1,27 @@
+#ifndef PAGE_SIZE_TABLE_H
+#define PAGE_SIZE_TABLE_H
+
+#include "fixed_types.h"
+
+// Large (2 MB and 1 GB) pages, by physical address, as found by the trace frontend in the application's
+// virtual-to-physical mapping. Entries are only ever added, so the TLBs can look them up without locking.
+class PageSizeTable
+{
+   public:
+      static const UInt32 SMALL_PAGE_SHIFT = 12;
+
+      static void insert(IntPtr physical_address, UInt32 page_shift);
+      // Returns SMALL_PAGE_SHIFT for addresses not in a known large page
+      static UInt32 getPageShift(IntPtr physical_address);
+
+   private:
+      static const UInt32 NUM_LARGE_SIZES = 2;
+      static const UInt32 LARGE_PAGE_SHIFTS[NUM_LARGE_SIZES];
+      // Open-addressed sets of frame numbers, stored plus one so zero marks an empty slot
+      static const UInt32 TABLE_SIZE = 1 << 16;
+      static IntPtr s_frames[NUM_LARGE_SIZES][TABLE_SIZE];
+
+      static UInt32 hash(IntPtr frame) { return (frame * 0x9e3779b97f4a7c15ULL) >> 48; }
+};
+
+#endif // PAGE_SIZE_TABLE_H
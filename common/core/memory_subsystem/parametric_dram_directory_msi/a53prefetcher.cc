@@ -18,8 +18,8 @@ A53Prefetcher::A53Prefetcher(String configName, core_id_t core_id)
 {
 }
 
-std::vector<IntPtr> A53Prefetcher::getNextAddress(IntPtr currentAddress, core_id_t core_id) {
-   std::vector<IntPtr> prefetchAddress;
+UInt32 A53Prefetcher::getNextAddress(IntPtr currentAddress, core_id_t core_id, IntPtr eip, IntPtr *addresses, UInt32 max_addresses) {
+   UInt32 count = 0;
 
    if (firstAddress) {
       firstAddress = false;
@@ -38,8 +38,8 @@ std::vector<IntPtr> A53Prefetcher::getNextAddress(IntPtr currentAddress, core_id
          }
 
          if (currentConsecutivePatternLength >= m_consecutivePatternLength) {
-            for (unsigned int i = 1; i <= m_numPrefetches; ++i) {
-               prefetchAddress.push_back(currentAddress + m_cacheLineSize*i);
+            for (unsigned int i = 1; i <= m_numPrefetches && count < max_addresses; ++i) {
+               addresses[count++] = currentAddress + m_cacheLineSize*i;
             }
          }
       }
@@ -53,13 +53,13 @@ std::vector<IntPtr> A53Prefetcher::getNextAddress(IntPtr currentAddress, core_id
          }
 
          if (currentPatternLength >= m_patternLength) {
-            for (unsigned int i = 1; i <= m_numPrefetches; ++i) {
-               prefetchAddress.push_back(currentAddress + stride*i);
+            for (unsigned int i = 1; i <= m_numPrefetches && count < max_addresses; ++i) {
+               addresses[count++] = currentAddress + stride*i;
             }
          }
       }
    }
 
    prevAddress = currentAddress;
-   return prefetchAddress;
+   return count;
 }
@@ -64,10 +64,105 @@ const char * ReasonString(Transition::reason_t reason) {
    }
 }
 
-MshrEntry make_mshr(SubsecondTime t_issue, SubsecondTime t_complete) {
-   MshrEntry e;
-   e.t_issue = t_issue; e.t_complete = t_complete;
-   return e;
+void Mshr::insert(IntPtr address, SubsecondTime t_issue, SubsecondTime t_complete)
+{
+   UInt32 index = 0;
+   while (index < m_size && m_address[index] != address)
+      ++index;
+
+   if (index == MSHR_HISTORY)
+   {
+      // Full: replace the entry that completes first, unless that is the new one
+      index = 0;
+      for(UInt32 i = 1; i < MSHR_HISTORY; ++i)
+         if (m_entry[i].t_complete < m_entry[index].t_complete)
+            index = i;
+      if (t_complete < m_entry[index].t_complete)
+         return;
+   }
+   else if (index == m_size)
+      ++m_size;
+
+   m_address[index] = address;
+   m_entry[index].t_issue = t_issue;
+   m_entry[index].t_complete = t_complete;
+}
+
+CacheDirectoryWaiterList::~CacheDirectoryWaiterList()
+{
+   for(CacheDirectoryWaiter* list : { m_head, m_free })
+   {
+      while (list)
+      {
+         CacheDirectoryWaiter* next = list->next;
+         delete list;
+         list = next;
+      }
+   }
+}
+
+CacheDirectoryWaiter*
+CacheDirectoryWaiterList::enqueue(IntPtr address, bool exclusive, bool isPrefetch, CacheCntlr* cache_cntlr, SubsecondTime t_issue)
+{
+   CacheDirectoryWaiter* waiter = m_free;
+   if (waiter)
+      m_free = waiter->next;
+   else
+      waiter = new CacheDirectoryWaiter();
+
+   waiter->exclusive = exclusive;
+   waiter->isPrefetch = isPrefetch;
+   waiter->cache_cntlr = cache_cntlr;
+   waiter->t_issue = t_issue;
+   waiter->address = address;
+   waiter->next = NULL;
+
+   if (m_tail)
+      m_tail->next = waiter;
+   else
+      m_head = waiter;
+   m_tail = waiter;
+
+   return waiter;
+}
+
+void
+CacheDirectoryWaiterList::dequeue(CacheDirectoryWaiter* waiter)
+{
+   LOG_ASSERT_ERROR(front(waiter->address) == waiter, "Waiter for address(0x%x) is not at the front", waiter->address);
+
+   CacheDirectoryWaiter* prev = NULL;
+   for(CacheDirectoryWaiter* it = m_head; it != waiter; it = it->next)
+      prev = it;
+
+   if (prev)
+      prev->next = waiter->next;
+   else
+      m_head = waiter->next;
+   if (m_tail == waiter)
+      m_tail = prev;
+
+   waiter->next = m_free;
+   m_free = waiter;
+}
+
+CacheDirectoryWaiter*
+CacheDirectoryWaiterList::front(IntPtr address) const
+{
+   for(CacheDirectoryWaiter* it = m_head; it; it = it->next)
+      if (it->address == address)
+         return it;
+   return NULL;
+}
+
+UInt32
+CacheDirectoryWaiterList::size(IntPtr address) const
+{
+   UInt32 count = 0;
+   for(CacheDirectoryWaiter* it = m_head; it; it = it->next)
+      if (it->address == address)
+         ++count;
+   return count;
 }
 
 #ifdef ENABLE_TRACK_SHARING_PREVCACHES
@@ -85,6 +180,10 @@ void CacheMasterCntlr::createSetLocks(UInt32 cache_block_size, UInt32 num_sets,
    m_log_blocksize = floorLog2(cache_block_size);
    m_num_sets = num_sets;
    m_setlocks.resize(m_num_sets, SetLock(core_offset, num_cores));
+
+   // Called before the first access, so the single stripe we started out with is still empty
+   delete [] m_stripes;
+   m_stripes = new CacheSetStripe[m_num_sets];
 }
 
 SetLock*
@@ -114,6 +213,7 @@ CacheMasterCntlr::accessATDs(Core::mem_op_t mem_op_type, bool hit, IntPtr addres
 CacheMasterCntlr::~CacheMasterCntlr()
 {
    delete m_cache;
+   delete [] m_stripes;
    for(std::vector<ATD*>::iterator it = m_atds.begin(); it != m_atds.end(); ++it)
    {
       delete *it;
@@ -154,6 +254,9 @@ CacheCntlr::CacheCntlr(MemComponent::component_t mem_component,
    m_shmem_perf_global(NULL),
    m_shmem_perf_model(shmem_perf_model)
 {
+   m_cache_counters.accesses = m_cache_counters.hits = 0;
+   m_cache_counters_merged = m_cache_counters;
+
    m_core_id_master = m_core_id - m_core_id % m_shared_cores;
    Sim()->getStatsManager()->logTopology(name, core_id, m_core_id_master);
 
@@ -201,6 +304,8 @@ CacheCntlr::CacheCntlr(MemComponent::component_t mem_component,
       m_master = getMemoryManager()->getCacheCntlrAt(m_core_id_master, mem_component)->m_master;
    }
 
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_PRE_STAT_WRITE, __mergeCacheCounters, (UInt64)this, HooksManager::ORDER_NOTIFY_PRE);
+
    if (m_master->m_prefetcher) {
       m_prefetch_on_prefetch_hit = Sim()->getCfg()->getBoolArray("perf_model/" + cache_params.configName + "/prefetcher/prefetch_on_prefetch_hit", core_id);
       if (Sim()->getCfg()->hasKey("perf_model/" + cache_params.configName + "/prefetcher/train_prefetcher_on_hit", core_id)) {
@@ -330,7 +435,8 @@ CacheCntlr::processMemOpFromCore(
       IntPtr ca_address, UInt32 offset,
       Byte* data_buf, UInt32 data_length,
       bool modeled,
-      bool count)
+      bool count,
+      IntPtr eip)
 {
    HitWhere::where_t hit_where = HitWhere::MISS;
 
@@ -384,15 +490,14 @@ LOG_ASSERT_ERROR(offset + data_length <= getCacheBlockSize(), "access until %u >
    else if (cache_hit && m_passthrough)
    {
       cache_hit = false;
-      cache_block_info->invalidate();
+      m_master->m_cache->invalidateSingleLine(ca_address);
       cache_block_info = NULL;
    }
 
    if (count)
    {
-      ScopedLock sl(getLock());
       // Update the Cache Counters
-      getCache()->updateCounters(cache_hit);
+      updateCacheCounters(cache_hit);
       updateCounters(mem_op_type, ca_address, cache_hit, getCacheState(cache_block_info), Prefetch::NONE);
    }
 
@@ -434,13 +539,15 @@ MYLOG("L1 hit");
 
       if (modeled)
       {
-         ScopedLock sl(getLock());
+         CacheSetStripe& stripe = m_master->getStripe(ca_address);
+         ScopedLock sl(stripe.lock);
          // This is a hit, but maybe the prefetcher filled it at a future time stamp. If so, delay.
          SubsecondTime t_now = getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD);
-         if (m_master->mshr.count(ca_address)
-            && (m_master->mshr[ca_address].t_issue < t_now && m_master->mshr[ca_address].t_complete > t_now))
+         const MshrEntry* entry = stripe.mshr.find(ca_address);
+         if (entry
+            && (entry->t_issue < t_now && entry->t_complete > t_now))
          {
-            SubsecondTime latency = m_master->mshr[ca_address].t_complete - t_now;
+            SubsecondTime latency = entry->t_complete - t_now;
             stats.mshr_latency += latency;
             getMemoryManager()->incrElapsedTime(latency, ShmemPerfModel::_USER_THREAD);
          }
@@ -482,7 +589,7 @@ MYLOG("L1 miss");
       }
 
 MYLOG("processMemOpFromCore l%d before next", m_mem_component);
-      hit_where = m_next_cache_cntlr->processShmemReqFromPrevCache(this, mem_op_type, ca_address, modeled, count, Prefetch::NONE, t_start, false);
+      hit_where = m_next_cache_cntlr->processShmemReqFromPrevCache(this, mem_op_type, ca_address, modeled, count, Prefetch::NONE, t_start, false, eip);
       bool next_cache_hit = hit_where != HitWhere::MISS;
 MYLOG("processMemOpFromCore l%d next hit = %d", m_mem_component, next_cache_hit);
 
@@ -509,7 +616,7 @@ MYLOG("processMemOpFromCore l%d got message reply", m_mem_component);
 
          /* have the next cache levels fill themselves with the new data */
 MYLOG("processMemOpFromCore l%d before next fill", m_mem_component);
-         hit_where = m_next_cache_cntlr->processShmemReqFromPrevCache(this, mem_op_type, ca_address, false, false, Prefetch::NONE, t_start, true);
+         hit_where = m_next_cache_cntlr->processShmemReqFromPrevCache(this, mem_op_type, ca_address, false, false, Prefetch::NONE, t_start, true, eip);
 MYLOG("processMemOpFromCore l%d after next fill", m_mem_component);
          LOG_ASSERT_ERROR(hit_where != HitWhere::MISS,
             "Tried to read in next-level cache, but data is already gone");
@@ -560,10 +667,8 @@ MYLOG("access done");
    SubsecondTime t_now = getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD);
    SubsecondTime total_latency = t_now - t_start;
 
-   // From here on downwards: not long anymore, only stats update so blanket cntrl lock
+   // From here on downwards: not long anymore, only stats update (which only we write, no need to lock)
    {
-      ScopedLock sl(getLock());
-
       if (! cache_hit && count) {
          stats.total_latency += total_latency;
       }
@@ -594,7 +699,7 @@ MYLOG("access done");
 
    if (modeled && m_master->m_prefetcher)
    {
-       trainPrefetcher(ca_address, cache_hit, prefetch_hit, false, t_start);
+       trainPrefetcher(ca_address, eip, cache_hit, prefetch_hit, false, t_start);
    }
 
    // Call Prefetch on next-level caches (but not for atomic instructions as that causes a locking mess)
@@ -614,11 +719,9 @@ MYLOG("access done");
 void
 CacheCntlr::updateHits(Core::mem_op_t mem_op_type, UInt64 hits)
 {
-   ScopedLock sl(getLock());
-
    while(hits > 0)
    {
-      getCache()->updateCounters(true);
+      updateCacheCounters(true);
       updateCounters(mem_op_type, 0, true, mem_op_type == Core::READ ? CacheState::SHARED : CacheState::MODIFIED, Prefetch::NONE);
       hits--;
    }
@@ -666,37 +769,34 @@ MYLOG("copyDataFromNextLevel l%d", m_mem_component);
 }
 
 void
-CacheCntlr::trainPrefetcher(IntPtr address, bool cache_hit, bool prefetch_hit, bool prefetch_own, SubsecondTime t_issue)
+CacheCntlr::trainPrefetcher(IntPtr address, IntPtr eip, bool cache_hit, bool prefetch_hit, bool prefetch_own, SubsecondTime t_issue)
 {
-   ScopedLock sl(getLock());
-
-   std::vector<IntPtr> prefetchList;
-
-   bool prefetcherTrained;
-
    // Train the prefetcher always or only on misses on lines that are not being brought by the prefetcher (load or store miss)
-   if (m_train_prefetcher_on_hit || (!prefetch_own && !cache_hit)) {
-      prefetchList = m_master->m_prefetcher->getNextAddress(address, m_core_id);
-      prefetcherTrained = true;
-   }
-   else prefetcherTrained = false;
+   if (!m_train_prefetcher_on_hit && (prefetch_own || cache_hit))
+      return;
+
+   ScopedLock sl(getLock());
 
    // Only do prefetches on misses, or on hits to lines previously brought in by the prefetcher (if enabled)
-   if (prefetcherTrained && (!cache_hit || (m_prefetch_on_prefetch_hit && prefetch_hit)))
+   if (cache_hit && !(m_prefetch_on_prefetch_hit && prefetch_hit))
    {
-      m_master->m_prefetch_list.clear();
+      m_master->m_prefetcher->train(address, m_core_id, eip);
+      return;
+   }
 
-      // Just talked to the next-level cache, wait a bit before we start to prefetch if enabled
-      m_master->m_prefetch_next = m_prefetch_delay ? t_issue + PREFETCH_INTERVAL:t_issue;
+   IntPtr prefetchList[Prefetcher::MAX_CANDIDATES];
+   UInt32 numPrefetches = m_master->m_prefetcher->getNextAddress(address, m_core_id, eip, prefetchList, Prefetcher::MAX_CANDIDATES);
 
-      for(std::vector<IntPtr>::iterator it = prefetchList.begin(); it != prefetchList.end(); ++it)
-      {
-         // Keep at most PREFETCH_MAX_QUEUE_LENGTH entries in the prefetch queue
-         if (m_master->m_prefetch_list.size() > PREFETCH_MAX_QUEUE_LENGTH)
-            break;
-         if (!operationPermissibleinCache(*it, Core::READ)) {
-            m_master->m_prefetch_list.push_back(*it);
-         }
+   m_master->m_prefetch_list.clear();
+
+   // Just talked to the next-level cache, wait a bit before we start to prefetch if enabled
+   m_master->m_prefetch_next = m_prefetch_delay ? t_issue + PREFETCH_INTERVAL:t_issue;
+
+   // Keep at most PREFETCH_MAX_QUEUE_LENGTH + 1 entries in the prefetch queue
+   for(UInt32 i = 0; i < numPrefetches && !m_master->m_prefetch_list.full(); ++i)
+   {
+      if (!operationPermissibleinCache(prefetchList[i], Core::READ)) {
+         m_master->m_prefetch_list.push_back(prefetchList[i]);
       }
    }
 }
@@ -713,8 +813,7 @@ CacheCntlr::Prefetch(SubsecondTime t_now)
       {
          while(!m_master->m_prefetch_list.empty())
          {
-            IntPtr address = m_master->m_prefetch_list.front();
-            m_master->m_prefetch_list.pop_front();
+            IntPtr address = m_master->m_prefetch_list.pop_front();
 
             // Check address again, maybe some other core already brought it into the cache
             if (!operationPermissibleinCache(address, Core::READ))
@@ -750,7 +849,7 @@ CacheCntlr::doPrefetch(IntPtr prefetch_address, SubsecondTime t_start)
    MYLOG("prefetching %lx", prefetch_address);
    SubsecondTime t_before = getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD);
    getShmemPerfModel()->setElapsedTime(ShmemPerfModel::_USER_THREAD, t_start); // Start the prefetch at the same time as the original miss
-   HitWhere::where_t hit_where = processShmemReqFromPrevCache(this, Core::READ, prefetch_address, true, true, Prefetch::OWN, t_start, false);
+   HitWhere::where_t hit_where = processShmemReqFromPrevCache(this, Core::READ, prefetch_address, true, true, Prefetch::OWN, t_start, false, 0);
 
    if (hit_where == HitWhere::MISS)
    {
@@ -760,7 +859,7 @@ CacheCntlr::doPrefetch(IntPtr prefetch_address, SubsecondTime t_start)
       waitForNetworkThread();
       wakeUpNetworkThread();
 
-      hit_where = processShmemReqFromPrevCache(this, Core::READ, prefetch_address, false, false, Prefetch::OWN, t_start, false);
+      hit_where = processShmemReqFromPrevCache(this, Core::READ, prefetch_address, false, false, Prefetch::OWN, t_start, false, 0);
 
       LOG_ASSERT_ERROR(hit_where != HitWhere::MISS, "Line was not there after prefetch");
    }
@@ -775,7 +874,7 @@ CacheCntlr::doPrefetch(IntPtr prefetch_address, SubsecondTime t_start)
  *****************************************************************************/
 
 HitWhere::where_t
-CacheCntlr::processShmemReqFromPrevCache(CacheCntlr* requester, Core::mem_op_t mem_op_type, IntPtr address, bool modeled, bool count, Prefetch::prefetch_type_t isPrefetch, SubsecondTime t_issue, bool have_write_lock)
+CacheCntlr::processShmemReqFromPrevCache(CacheCntlr* requester, Core::mem_op_t mem_op_type, IntPtr address, bool modeled, bool count, Prefetch::prefetch_type_t isPrefetch, SubsecondTime t_issue, bool have_write_lock, IntPtr eip)
 {
    #ifdef PRIVATE_L2_OPTIMIZATION
    bool have_write_lock_internal = have_write_lock;
@@ -806,16 +905,15 @@ CacheCntlr::processShmemReqFromPrevCache(CacheCntlr* requester, Core::mem_op_t m
    {
       // Passthrough == false: cache that always misses (except in the L1 fill path, detected by count==false, where it should return the data)
       cache_hit = first_hit = false;
-      cache_block_info->invalidate();
+      m_master->m_cache->invalidateSingleLine(address);
       cache_block_info = NULL;
       LOG_ASSERT_ERROR(m_next_cache_cntlr != NULL, "Cannot do passthrough on an LLC");
    }
 
    if (count)
    {
-      ScopedLock sl(getLock());
       if (isPrefetch == Prefetch::NONE)
-         getCache()->updateCounters(cache_hit);
+         updateCacheCounters(cache_hit);
       updateCounters(mem_op_type, address, cache_hit, getCacheState(address), isPrefetch);
    }
 
@@ -841,13 +939,15 @@ CacheCntlr::processShmemReqFromPrevCache(CacheCntlr* requester, Core::mem_op_t m
          of the previous-level cache, not our (longer) access time */
       if (modeled)
       {
-         ScopedLock sl(getLock());
+         CacheSetStripe& stripe = m_master->getStripe(address);
+         ScopedLock sl(stripe.lock);
          // This is a hit, but maybe the prefetcher filled it at a future time stamp. If so, delay.
          SubsecondTime t_now = getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD);
-         if (m_master->mshr.count(address)
-            && (m_master->mshr[address].t_issue < t_now && m_master->mshr[address].t_complete > t_now))
+         const MshrEntry* entry = stripe.mshr.find(address);
+         if (entry
+            && (entry->t_issue < t_now && entry->t_complete > t_now))
          {
-            SubsecondTime latency = m_master->mshr[address].t_complete - t_now;
+            SubsecondTime latency = entry->t_complete - t_now;
             stats.mshr_latency += latency;
             getMemoryManager()->incrElapsedTime(latency, ShmemPerfModel::_USER_THREAD);
          }
@@ -947,7 +1047,7 @@ CacheCntlr::processShmemReqFromPrevCache(CacheCntlr* requester, Core::mem_op_t m
             invalidateCacheBlock(address);
 
          // let the next cache level handle it.
-         hit_where = m_next_cache_cntlr->processShmemReqFromPrevCache(this, mem_op_type, address, modeled, count, isPrefetch == Prefetch::NONE ? Prefetch::NONE : Prefetch::OTHER, t_issue, have_write_lock_internal);
+         hit_where = m_next_cache_cntlr->processShmemReqFromPrevCache(this, mem_op_type, address, modeled, count, isPrefetch == Prefetch::NONE ? Prefetch::NONE : Prefetch::OTHER, t_issue, have_write_lock_internal, eip);
          if (hit_where != HitWhere::MISS)
          {
             cache_hit = true;
@@ -1023,15 +1123,15 @@ CacheCntlr::processShmemReqFromPrevCache(CacheCntlr* requester, Core::mem_op_t m
       /* Store completion time so we can detect overlapping accesses */
       if (modeled && !first_hit && !m_passthrough)
       {
-         ScopedLock sl(getLock());
-         m_master->mshr[address] = make_mshr(t_issue, getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD));
-         cleanupMshr();
+         CacheSetStripe& stripe = m_master->getStripe(address);
+         ScopedLock sl(stripe.lock);
+         stripe.mshr.insert(address, t_issue, getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD));
       }
    }
 
    if (modeled && m_master->m_prefetcher)
    {
-      trainPrefetcher(address, cache_hit, prefetch_hit, isPrefetch == Prefetch::prefetch_type_t::OWN, t_issue);
+      trainPrefetcher(address, eip, cache_hit, prefetch_hit, isPrefetch == Prefetch::prefetch_type_t::OWN, t_issue);
    }
 
    #ifdef PRIVATE_L2_OPTIMIZATION
@@ -1079,7 +1179,7 @@ CacheCntlr::updateUsageBits(IntPtr address, CacheBlockInfo::BitsUsedType used)
 {
    bool new_bits;
    {
-      ScopedLock sl(getLock());
+      ScopedLock sl(m_master->getStripe(address).lock);
       SharedCacheBlockInfo* cache_block_info = getCacheBlockInfo(address);
       new_bits = cache_block_info->updateUsage(used);
    }
@@ -1111,7 +1211,7 @@ CacheCntlr::walkUsageBits()
 boost::tuple<HitWhere::where_t, SubsecondTime>
 CacheCntlr::accessDRAM(Core::mem_op_t mem_op_type, IntPtr address, bool isPrefetch, Byte* data_buf)
 {
-   ScopedLock sl(getLock()); // DRAM is shared and owned by m_master
+   ScopedLock sl(m_master->m_dram_lock); // DRAM is shared and owned by m_master
 
    SubsecondTime t_issue = getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD);
    SubsecondTime dram_latency;
@@ -1157,10 +1257,10 @@ CacheCntlr::initiateDirectoryAccess(Core::mem_op_t mem_op_type, IntPtr address,
 
    bool first = false;
    {
-      ScopedLock sl(getLock());
-      CacheDirectoryWaiter* request = new CacheDirectoryWaiter(exclusive, isPrefetch, this, t_issue);
-      m_master->m_directory_waiters.enqueue(address, request);
-      if (m_master->m_directory_waiters.size(address) == 1)
+      CacheSetStripe& stripe = m_master->getStripe(address);
+      ScopedLock sl(stripe.lock);
+      CacheDirectoryWaiter* request = stripe.directory_waiters.enqueue(address, exclusive, isPrefetch, this, t_issue);
+      if (stripe.directory_waiters.front(address) == request)
          first = true;
    }
 
@@ -1189,7 +1289,7 @@ CacheCntlr::initiateDirectoryAccess(Core::mem_op_t mem_op_type, IntPtr address,
    else
    {
       // Someone else is busy with this cache line, they'll do everything for us
-      MYLOG("%u previous waiters", m_master->m_directory_waiters.size(address));
+      MYLOG("%u previous waiters", m_master->getStripe(address).directory_waiters.size(address));
    }
 }
 
@@ -1422,7 +1522,6 @@ MYLOG("evicting @%lx", evict_address);
       CacheState::cstate_t old_state = evict_block_info.getCState();
       MYLOG("evicting @%lx (state %c)", evict_address, CStateString(old_state));
       {
-         ScopedLock sl(getLock());
          transition(
             evict_address,
             Transition::EVICT,
@@ -1430,12 +1529,13 @@ MYLOG("evicting @%lx", evict_address);
             CacheState::INVALID
          );
 
-         ++stats.evict[old_state];
+         // The master cache's SimThread also inserts (and evicts) lines, so these can't be plain increments
+         __sync_fetch_and_add(&stats.evict[old_state], 1);
          // Line was prefetched, but is evicted without ever being used
          if (evict_block_info.hasOption(CacheBlockInfo::PREFETCH))
-            ++stats.evict_prefetch;
+            __sync_fetch_and_add(&stats.evict_prefetch, 1);
          if (evict_block_info.hasOption(CacheBlockInfo::WARMUP))
-            ++stats.evict_warmup;
+            __sync_fetch_and_add(&stats.evict_warmup, 1);
       }
 
       /* TODO: this part looks a lot like updateCacheBlock's dirty case, but with the eviction buffer
@@ -1490,7 +1590,7 @@ MYLOG("evicting @%lx", evict_address);
 
             if (m_master->m_dram_outstanding_writebacks)
             {
-               ScopedLock sl(getLock());
+               ScopedLock sl(m_master->m_dram_lock);
                // Delay if all evict buffers are full
                SubsecondTime t_issue = m_master->m_dram_outstanding_writebacks->getStartTime(t_now);
                getMemoryManager()->incrElapsedTime(t_issue - t_now, ShmemPerfModel::_USER_THREAD);
@@ -1504,7 +1604,7 @@ MYLOG("evicting @%lx", evict_address);
             // Occupy evict buffer
             if (m_master->m_dram_outstanding_writebacks)
             {
-               ScopedLock sl(getLock());
+               ScopedLock sl(m_master->m_dram_lock);
                m_master->m_dram_outstanding_writebacks->getCompletionTime(t_now, dram_latency);
             }
          }
@@ -1595,33 +1695,33 @@ CacheCntlr::updateCacheBlock(IntPtr address, CacheState::cstate_t new_cstate, Tr
    else
    {
       {
-         ScopedLock sl(getLock());
          transition(
             address,
             reason,
             getCacheState(address),
             new_cstate
          );
+         // Snoops come from any core sharing the next-level cache, and from the SimThread
          if (reason == Transition::COHERENCY)
          {
             if (new_cstate == CacheState::SHARED)
-               ++stats.coherency_downgrades;
+               __sync_fetch_and_add(&stats.coherency_downgrades, 1);
             else if (cache_block_info->getCState() == CacheState::MODIFIED)
-               ++stats.coherency_writebacks;
+               __sync_fetch_and_add(&stats.coherency_writebacks, 1);
             else
-               ++stats.coherency_invalidates;
+               __sync_fetch_and_add(&stats.coherency_invalidates, 1);
             if (cache_block_info->hasOption(CacheBlockInfo::PREFETCH) && new_cstate == CacheState::INVALID)
-               ++stats.invalidate_prefetch;
+               __sync_fetch_and_add(&stats.invalidate_prefetch, 1);
             if (cache_block_info->hasOption(CacheBlockInfo::WARMUP) && new_cstate == CacheState::INVALID)
-               ++stats.invalidate_warmup;
+               __sync_fetch_and_add(&stats.invalidate_warmup, 1);
          }
          if (reason == Transition::UPGRADE)
          {
-            ++stats.coherency_upgrades;
+            __sync_fetch_and_add(&stats.coherency_upgrades, 1);
          }
          else if (reason == Transition::BACK_INVAL)
          {
-            ++stats.backinval[cache_block_info->getCState()];
+            __sync_fetch_and_add(&stats.backinval[cache_block_info->getCState()], 1);
          }
       }
 
@@ -1775,11 +1875,12 @@ CacheCntlr::handleMsgFromDramDirectory(
    PrL1PrL2DramDirectoryMSI::ShmemMsg::msg_t shmem_msg_type = shmem_msg->getMsgType();
    IntPtr address = shmem_msg->getAddress();
    core_id_t requester = INVALID_CORE_ID;
+   CacheSetStripe& stripe = m_master->getStripe(address);
    if ((shmem_msg_type == PrL1PrL2DramDirectoryMSI::ShmemMsg::EX_REP) || (shmem_msg_type == PrL1PrL2DramDirectoryMSI::ShmemMsg::SH_REP)
          || (shmem_msg_type == PrL1PrL2DramDirectoryMSI::ShmemMsg::UPGRADE_REP) )
    {
-      ScopedLock sl(getLock()); // Keep lock when handling m_directory_waiters
-      CacheDirectoryWaiter* request = m_master->m_directory_waiters.front(address);
+      ScopedLock sl(stripe.lock); // Keep lock when handling directory_waiters
+      CacheDirectoryWaiter* request = stripe.directory_waiters.front(address);
       requester = request->cache_cntlr->m_core_id;
    }
 
@@ -1820,10 +1921,10 @@ MYLOG("WB REQ<%u @ %lx", sender, address);
    if ((shmem_msg_type == PrL1PrL2DramDirectoryMSI::ShmemMsg::EX_REP) || (shmem_msg_type == PrL1PrL2DramDirectoryMSI::ShmemMsg::SH_REP)
          || (shmem_msg_type == PrL1PrL2DramDirectoryMSI::ShmemMsg::UPGRADE_REP) )
    {
-      getLock().acquire(); // Keep lock when handling m_directory_waiters
-      while(! m_master->m_directory_waiters.empty(address)) {
-         CacheDirectoryWaiter* request = m_master->m_directory_waiters.front(address);
-         getLock().release();
+      stripe.lock.acquire(); // Keep lock when handling directory_waiters
+      while(! stripe.directory_waiters.empty(address)) {
+         CacheDirectoryWaiter* request = stripe.directory_waiters.front(address);
+         stripe.lock.release();
 
          request->cache_cntlr->m_shmem_perf->updateTime(getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_SIM_THREAD), ShmemPerf::PENDING_HIT);
 
@@ -1863,18 +1964,13 @@ MYLOG("wakeup user #%u", request->cache_cntlr->m_core_id);
          waitForUserThread(request->cache_cntlr->m_network_thread_sem);
          acquireStackLock(address);
 
-         {
-            ScopedLock sl(request->cache_cntlr->getLock());
-            request->cache_cntlr->m_master->mshr[address] = make_mshr(request->t_issue, getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_SIM_THREAD));
-            cleanupMshr();
-         }
+         stripe.lock.acquire();
+         stripe.mshr.insert(address, request->t_issue, getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_SIM_THREAD));
 
-         getLock().acquire();
-         MYLOG("about to dequeue request (%p) for address %lx", m_master->m_directory_waiters.front(address), address );
-         m_master->m_directory_waiters.dequeue(address);
-         delete request;
+         MYLOG("about to dequeue request (%p) for address %lx", request, address );
+         stripe.directory_waiters.dequeue(request);
       }
-      getLock().release();
+      stripe.lock.release();
 MYLOG("woke up all");
    }
 
@@ -2073,7 +2169,13 @@ CacheCntlr::updateCounters(Core::mem_op_t mem_op_type, IntPtr address, bool cach
       operationPermissibleinCache() will think it's a hit (so cache_hit == true) since the processing
       of the previous miss was done instantaneously. But mshr[address] contains its completion time */
    SubsecondTime t_now = getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD);
-   bool overlapping = m_master->mshr.count(address) && m_master->mshr[address].t_issue < t_now && m_master->mshr[address].t_complete > t_now;
+   bool overlapping;
+   {
+      CacheSetStripe& stripe = m_master->getStripe(address);
+      ScopedLock sl(stripe.lock);
+      const MshrEntry* entry = stripe.mshr.find(address);
+      overlapping = entry && entry->t_issue < t_now && entry->t_complete > t_now;
+   }
 
    // ATD doesn't track state, so when reporting hit/miss to it we shouldn't either (i.e. write hit to shared line becomes hit, not miss)
    bool cache_data_hit = (state != CacheState::INVALID);
@@ -2110,8 +2212,6 @@ CacheCntlr::updateCounters(Core::mem_op_t mem_op_type, IntPtr address, bool cach
       }
    }
 
-   cleanupMshr();
-
    #ifdef ENABLE_TRANSITIONS
    transition(
       address,
@@ -2123,26 +2223,34 @@ CacheCntlr::updateCounters(Core::mem_op_t mem_op_type, IntPtr address, bool cach
 }
 
 void
-CacheCntlr::cleanupMshr()
-{
-   /* Keep only last 8 MSHR entries */
-   while(m_master->mshr.size() > 8) {
-      IntPtr address_min = 0;
-      SubsecondTime time_min = SubsecondTime::MaxTime();
-      for(Mshr::iterator it = m_master->mshr.begin(); it != m_master->mshr.end(); ++it) {
-         if (it->second.t_complete < time_min) {
-            address_min = it->first;
-            time_min = it->second.t_complete;
-         }
-      }
-      m_master->mshr.erase(address_min);
+CacheCntlr::updateCacheCounters(bool cache_hit)
+{
+   // Only called by our own core, no need to lock
+   if (getCache()->isEnabled())
+   {
+      m_cache_counters.accesses++;
+      if (cache_hit)
+         m_cache_counters.hits++;
+   }
+}
+
+void
+CacheCntlr::mergeCacheCounters()
+{
+   UInt64 accesses = m_cache_counters.accesses, hits = m_cache_counters.hits;
+   {
+      ScopedLock sl(getLock());
+      getCache()->updateCounters(accesses - m_cache_counters_merged.accesses, hits - m_cache_counters_merged.hits);
    }
+   m_cache_counters_merged.accesses = accesses;
+   m_cache_counters_merged.hits = hits;
 }
 
 void
 CacheCntlr::transition(IntPtr address, Transition::reason_t reason, CacheState::cstate_t old_state, CacheState::cstate_t new_state)
 {
 #ifdef ENABLE_TRANSITIONS
+   ScopedLock sl(getLock());
    stats.transitions[old_state][new_state]++;
    if (old_state == CacheState::INVALID) {
       if (stats.seen.count(address) == 0)
@@ -2199,8 +2307,11 @@ CacheCntlr::updateUncoreStatistics(HitWhere::where_t hit_where, SubsecondTime no
    - (On Nehalem, the L2 is private so it is only the L3 (the first level with m_sharing_cores > 1) that takes the exclusive lock).
    #endif
 
-   Additionally, for per-cache objects that are not private to a cache set, each cache controller has its own (normal) lock,
-   use getLock() for this. This is required for statistics updates, the directory waiters queue, etc.
+   Additionally, per-address state (MSHR, directory waiters) lives in a CacheSetStripe, striped over the same sets as the
+   stack locks, and protected by its own (normal) lock. For per-cache objects that are not private to a cache set (prefetch
+   queue, eviction buffer), each cache controller has its own lock, use getLock() for this. DRAM access uses m_dram_lock.
+   Statistics are per core (and thus per cache controller) and need no lock: counters that other threads update as well
+   (evictions, coherency) use atomic increments, counters of a shared Cache are kept per core and merged at HOOK_PRE_STAT_WRITE.
 */
 
 void
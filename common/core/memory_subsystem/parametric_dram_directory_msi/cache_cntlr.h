@@ -13,7 +13,6 @@
 #include "fixed_types.h"
 #include "shmem_perf_model.h"
 #include "contention_model.h"
-#include "req_queue_list_template.h"
 #include "stats.h"
 #include "subsecond_time.h"
 #include "shmem_perf.h"
@@ -134,33 +133,102 @@ namespace ParametricDramDirectoryMSI
          bool isPrefetch;
          CacheCntlr* cache_cntlr;
          SubsecondTime t_issue;
-         CacheDirectoryWaiter(bool _exclusive, bool _isPrefetch, CacheCntlr* _cache_cntlr, SubsecondTime _t_issue) :
-            exclusive(_exclusive), isPrefetch(_isPrefetch), cache_cntlr(_cache_cntlr), t_issue(_t_issue)
-         {}
+         IntPtr address;
+         CacheDirectoryWaiter* next;   //< Next waiter in the CacheDirectoryWaiterList, or in its free list
    };
 
-   typedef ReqQueueListTemplate<CacheDirectoryWaiter> CacheDirectoryWaiterMap;
+   // Requests waiting for the directory, in arrival order, linked through the waiters themselves.
+   // Only a few misses are outstanding per stripe, so walking one list is cheaper than a map of queues.
+   // Waiters are recycled through a free list, so a miss does not allocate once the list has warmed up.
+   class CacheDirectoryWaiterList
+   {
+      public:
+         CacheDirectoryWaiterList() : m_head(NULL), m_tail(NULL), m_free(NULL) {}
+         ~CacheDirectoryWaiterList();
+
+         CacheDirectoryWaiter* enqueue(IntPtr address, bool exclusive, bool isPrefetch, CacheCntlr* cache_cntlr, SubsecondTime t_issue);
+         void dequeue(CacheDirectoryWaiter* waiter);   //< Waiter must be the front one for its address, it is recycled
+         CacheDirectoryWaiter* front(IntPtr address) const;
+         UInt32 size(IntPtr address) const;
+         bool empty(IntPtr address) const { return front(address) == NULL; }
+
+      private:
+         CacheDirectoryWaiter* m_head;
+         CacheDirectoryWaiter* m_tail;
+         CacheDirectoryWaiter* m_free;
+   };
 
    struct MshrEntry {
       SubsecondTime t_issue, t_complete;
    };
-   typedef std::unordered_map<IntPtr, MshrEntry> Mshr;
+
+   // Completion times of the last MSHR_HISTORY misses, used to detect accesses that overlap with a miss still in flight.
+   // When full, the entry that completes first is dropped (which may be the one being inserted).
+   class Mshr
+   {
+      public:
+         static const UInt32 MSHR_HISTORY = 8;
+
+         Mshr() : m_size(0) {}
+
+         const MshrEntry* find(IntPtr address) const
+         {
+            for(UInt32 i = 0; i < m_size; ++i)
+               if (m_address[i] == address)
+                  return &m_entry[i];
+            return NULL;
+         }
+         void insert(IntPtr address, SubsecondTime t_issue, SubsecondTime t_complete);
+
+      private:
+         IntPtr m_address[MSHR_HISTORY];
+         MshrEntry m_entry[MSHR_HISTORY];
+         UInt32 m_size;
+   };
+
+   // Addresses still to be prefetched. Refilled as a whole every time the prefetcher produces new candidates,
+   // so it only needs to be consumed from the front and never wraps around.
+   // Takes one entry past PREFETCH_MAX_QUEUE_LENGTH, as the std::deque it replaces did.
+   class PrefetchQueue
+   {
+      public:
+         PrefetchQueue() : m_head(0), m_size(0) {}
+
+         bool empty() const { return m_head == m_size; }
+         bool full() const { return m_size > PREFETCH_MAX_QUEUE_LENGTH; }
+         void clear() { m_head = m_size = 0; }
+         void push_back(IntPtr address) { m_address[m_size++] = address; }
+         IntPtr pop_front() { return m_address[m_head++]; }
+
+      private:
+         IntPtr m_address[PREFETCH_MAX_QUEUE_LENGTH + 1];
+         UInt32 m_head, m_size;
+   };
+
+   // State kept per address by a (shared) cache. It is striped over the same sets as the stack locks,
+   // so cores missing on different sets do not have to serialize on the cache-wide m_cache_lock
+   class CacheSetStripe
+   {
+      public:
+         Lock lock;
+         Mshr mshr;
+         CacheDirectoryWaiterList directory_waiters;
+   };
 
    class CacheMasterCntlr
    {
       private:
          Cache* m_cache;
-         Lock m_cache_lock;
+         Lock m_cache_lock;   //< Prefetch queue, eviction buffer and L1 MSHR contention model
+         Lock m_dram_lock;    //< Direct DRAM access
          Lock m_smt_lock; //< Only used in L1 cache, to protect against concurrent access from sibling SMT threads
          CacheCntlrList m_prev_cache_cntlrs;
          Prefetcher* m_prefetcher;
          DramCntlrInterface* m_dram_cntlr;
          ContentionModel* m_dram_outstanding_writebacks;
 
-         Mshr mshr;
          ContentionModel m_l1_mshr;
          ContentionModel m_next_level_read_bandwidth;
-         CacheDirectoryWaiterMap m_directory_waiters;
          IntPtr m_evicting_address;
          Byte* m_evicting_buf;
 
@@ -169,12 +237,14 @@ namespace ParametricDramDirectoryMSI
          std::vector<SetLock> m_setlocks;
          UInt32 m_log_blocksize;
          UInt32 m_num_sets;
+         CacheSetStripe* m_stripes;   //< m_num_sets entries, a single one until createSetLocks() is called
 
-         std::deque<IntPtr> m_prefetch_list;
+         PrefetchQueue m_prefetch_list;
          SubsecondTime m_prefetch_next;
 
          void createSetLocks(UInt32 cache_block_size, UInt32 num_sets, UInt32 core_offset, UInt32 num_cores);
          SetLock* getSetLock(IntPtr addr);
+         CacheSetStripe& getStripe(IntPtr addr) { return m_stripes[(addr >> m_log_blocksize) & (m_num_sets - 1)]; }
 
          void createATDs(String name, String configName, core_id_t core_id, UInt32 shared_cores, UInt32 size, UInt32 associativity, UInt32 block_size,
             String replacement_policy, CacheBase::hash_t hash_function);
@@ -190,6 +260,9 @@ namespace ParametricDramDirectoryMSI
             , m_evicting_address(0)
             , m_evicting_buf(NULL)
             , m_atds()
+            , m_log_blocksize(0)
+            , m_num_sets(1)
+            , m_stripes(new CacheSetStripe[1])
             , m_prefetch_list()
             , m_prefetch_next(SubsecondTime::Zero())
          {}
@@ -251,8 +324,15 @@ namespace ParametricDramDirectoryMSI
          std::unordered_map<HitWhere::where_t, StatHist> lat_by_where;
          #endif
 
+         // This core's accesses to the Cache (which may be shared), folded into it at HOOK_PRE_STAT_WRITE
+         struct {
+           UInt64 accesses, hits;
+         } m_cache_counters, m_cache_counters_merged;
+
          void updateCounters(Core::mem_op_t mem_op_type, IntPtr address, bool cache_hit, CacheState::cstate_t state, Prefetch::prefetch_type_t isPrefetch);
-         void cleanupMshr();
+         void updateCacheCounters(bool cache_hit);
+         void mergeCacheCounters();
+         static SInt64 __mergeCacheCounters(UInt64 arg0, UInt64 arg1) { ((CacheCntlr*)arg0)->mergeCacheCounters(); return 0; }
          void transition(IntPtr address, Transition::reason_t reason, CacheState::cstate_t old_state, CacheState::cstate_t new_state);
          void updateUncoreStatistics(HitWhere::where_t hit_where, SubsecondTime now);
 
@@ -286,7 +366,7 @@ namespace ParametricDramDirectoryMSI
                IntPtr address, Core::mem_op_t mem_op_type, CacheBlockInfo **cache_block_info = NULL);
 
          void copyDataFromNextLevel(Core::mem_op_t mem_op_type, IntPtr address, bool modeled, SubsecondTime t_start);
-         void trainPrefetcher(IntPtr address, bool cache_hit, bool prefetch_hit, bool prefetch_own, SubsecondTime t_issue);
+         void trainPrefetcher(IntPtr address, IntPtr eip, bool cache_hit, bool prefetch_hit, bool prefetch_own, SubsecondTime t_issue);
          void Prefetch(SubsecondTime t_start);
          void doPrefetch(IntPtr prefetch_address, SubsecondTime t_start);
 
@@ -306,7 +386,7 @@ namespace ParametricDramDirectoryMSI
          void writeCacheBlock(IntPtr address, UInt32 offset, Byte* data_buf, UInt32 data_length, ShmemPerfModel::Thread_t thread_num);
 
          // Handle Request from previous level cache
-         HitWhere::where_t processShmemReqFromPrevCache(CacheCntlr* requester, Core::mem_op_t mem_op_type, IntPtr address, bool modeled, bool count, Prefetch::prefetch_type_t isPrefetch, SubsecondTime t_issue, bool have_write_lock);
+         HitWhere::where_t processShmemReqFromPrevCache(CacheCntlr* requester, Core::mem_op_t mem_op_type, IntPtr address, bool modeled, bool count, Prefetch::prefetch_type_t isPrefetch, SubsecondTime t_issue, bool have_write_lock, IntPtr eip);
 
          // Process Request from L1 Cache
          boost::tuple<HitWhere::where_t, SubsecondTime> accessDRAM(Core::mem_op_t mem_op_type, IntPtr address, bool isPrefetch, Byte* data_buf);
@@ -380,7 +460,8 @@ namespace ParametricDramDirectoryMSI
                IntPtr ca_address, UInt32 offset,
                Byte* data_buf, UInt32 data_length,
                bool modeled,
-               bool count);
+               bool count,
+               IntPtr eip);
          void updateHits(Core::mem_op_t mem_op_type, UInt64 hits);
 
          // Notify next level cache of so it can update its sharing set
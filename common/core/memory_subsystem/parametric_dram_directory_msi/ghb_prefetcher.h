@@ -3,11 +3,13 @@
 
 #include "prefetcher.h"
 
+#include <vector>
+
 class GhbPrefetcher : public Prefetcher
 {
    public:
       GhbPrefetcher(String configName, core_id_t core_id);
-      std::vector<IntPtr> getNextAddress(IntPtr currentAddress, core_id_t core_id);
+      UInt32 getNextAddress(IntPtr currentAddress, core_id_t core_id, IntPtr eip, IntPtr *addresses, UInt32 max_addresses);
 
       ~GhbPrefetcher();
 
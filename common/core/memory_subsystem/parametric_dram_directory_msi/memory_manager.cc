@@ -4,6 +4,8 @@
 #include "nuca_cache.h"
 #include "dram_cache.h"
 #include "tlb.h"
+#include "page_walker.h"
+#include "page_size_table.h"
 #include "simulator.h"
 #include "log.h"
 #include "dvfs_manager.h"
@@ -29,6 +31,7 @@ namespace ParametricDramDirectoryMSI
 {
 
 std::map<CoreComponentType, CacheCntlr*> MemoryManager::m_all_cache_cntlrs;
+TLS* MemoryManager::s_sync_deliveries = NULL;
 
 MemoryManager::MemoryManager(Core* core,
       Network* network, ShmemPerfModel* shmem_perf_model):
@@ -37,11 +40,16 @@ MemoryManager::MemoryManager(Core* core,
    m_dram_cache(NULL),
    m_dram_directory_cntlr(NULL),
    m_dram_cntlr(NULL),
-   m_itlb(NULL), m_dtlb(NULL), m_stlb(NULL),
+   m_stlb(NULL),
+   m_page_walker(NULL),
    m_tlb_miss_penalty(NULL,0),
    m_tlb_miss_parallel(false),
+   m_page_size_from_trace(false),
+   m_page_size(TLB::PAGE_4K),
    m_tag_directory_present(false),
    m_dram_cntlr_present(false),
+   m_synchronous_home(false),
+   m_home_shmem_perf_model(shmem_perf_model),
    m_enabled(false)
 {
    // Read Parameters from the Config file
@@ -72,15 +80,34 @@ MemoryManager::MemoryManager(Core* core,
       UInt32 stlb_size = Sim()->getCfg()->getInt("perf_model/stlb/size");
       if (stlb_size)
          m_stlb = new TLB("stlb", "perf_model/stlb", getCore()->getId(), stlb_size, Sim()->getCfg()->getInt("perf_model/stlb/associativity"), NULL);
-      UInt32 itlb_size = Sim()->getCfg()->getInt("perf_model/itlb/size");
-      if (itlb_size)
-         m_itlb = new TLB("itlb", "perf_model/itlb", getCore()->getId(), itlb_size, Sim()->getCfg()->getInt("perf_model/itlb/associativity"), m_stlb);
-      UInt32 dtlb_size = Sim()->getCfg()->getInt("perf_model/dtlb/size");
-      if (dtlb_size)
-         m_dtlb = new TLB("dtlb", "perf_model/dtlb", getCore()->getId(), dtlb_size, Sim()->getCfg()->getInt("perf_model/dtlb/associativity"), m_stlb);
+      static const char *page_size_suffixes[TLB::NUM_PAGE_SIZES] = { "", "_2m", "_1g" };
+      for(UInt32 page_size = TLB::PAGE_4K; page_size < TLB::NUM_PAGE_SIZES; ++page_size)
+      {
+         String itlb_name = String("itlb") + page_size_suffixes[page_size];
+         UInt32 itlb_size = Sim()->getCfg()->getInt("perf_model/" + itlb_name + "/size");
+         m_itlb[page_size] = itlb_size
+            ? new TLB(itlb_name, "perf_model/" + itlb_name, getCore()->getId(), itlb_size, Sim()->getCfg()->getInt("perf_model/" + itlb_name + "/associativity"), m_stlb)
+            : NULL;
+         String dtlb_name = String("dtlb") + page_size_suffixes[page_size];
+         UInt32 dtlb_size = Sim()->getCfg()->getInt("perf_model/" + dtlb_name + "/size");
+         m_dtlb[page_size] = dtlb_size
+            ? new TLB(dtlb_name, "perf_model/" + dtlb_name, getCore()->getId(), dtlb_size, Sim()->getCfg()->getInt("perf_model/" + dtlb_name + "/associativity"), m_stlb)
+            : NULL;
+      }
       m_tlb_miss_penalty = ComponentLatency(core->getDvfsDomain(), Sim()->getCfg()->getInt("perf_model/tlb/penalty"));
       m_tlb_miss_parallel = Sim()->getCfg()->getBool("perf_model/tlb/penalty_parallel");
 
+      String page_size_policy = Sim()->getCfg()->getString("perf_model/tlb/page_size_policy");
+      LOG_ASSERT_ERROR(page_size_policy == "fixed" || page_size_policy == "trace", "Invalid perf_model/tlb/page_size_policy %s", page_size_policy.c_str());
+      m_page_size_from_trace = page_size_policy == "trace";
+      UInt64 page_size = Sim()->getCfg()->getInt("perf_model/tlb/page_size");
+      while (m_page_size < TLB::NUM_PAGE_SIZES && (UInt64(1) << TLB::getPageShift(m_page_size)) != page_size)
+         m_page_size = TLB::page_size_t(m_page_size + 1);
+      LOG_ASSERT_ERROR(m_page_size < TLB::NUM_PAGE_SIZES, "Invalid perf_model/tlb/page_size %ld, must be 4 KB, 2 MB or 1 GB", page_size);
+
+      if (Sim()->getCfg()->getBool("perf_model/tlb/page_walk"))
+         m_page_walker = new PageWalker(getCore()->getId(), Sim()->getCfg()->getInt("perf_model/tlb/pwc_size"), Sim()->getCfg()->getInt("perf_model/tlb/pwc_associativity"));
+
       smt_cores = Sim()->getCfg()->getInt("perf_model/core/logical_cpus");
 
       for(UInt32 i = MemComponent::FIRST_LEVEL_CACHE; i <= (UInt32)m_last_level_cache; ++i)
@@ -177,6 +204,9 @@ MemoryManager::MemoryManager(Core* core,
 
       // Dram Cntlr
       dram_direct_access = Sim()->getCfg()->getBool("perf_model/dram/direct_access");
+
+      // With direct access there are no messages to the DRAM controller or tag directory to begin with
+      m_synchronous_home = Sim()->getCfg()->getBool("perf_model/dram_directory/synchronous") && !dram_direct_access;
    }
    catch(...)
    {
@@ -186,6 +216,14 @@ MemoryManager::MemoryManager(Core* core,
    m_user_thread_sem = new Semaphore(0);
    m_network_thread_sem = new Semaphore(0);
 
+   if (m_synchronous_home)
+   {
+      m_home_shmem_perf_model = new ShmemPerfModel();
+      // Cores are created one at a time, from a single thread
+      if (!s_sync_deliveries)
+         s_sync_deliveries = TLS::create();
+   }
+
    std::vector<core_id_t> core_list_with_dram_controllers = getCoreListWithMemoryControllers();
    std::vector<core_id_t> core_list_with_tag_directories;
    String tag_directory_locations = Sim()->getCfg()->getString("perf_model/dram_directory/locations");
@@ -230,13 +268,13 @@ MemoryManager::MemoryManager(Core* core,
       m_dram_cntlr_present = true;
 
       m_dram_cntlr = new PrL1PrL2DramDirectoryMSI::DramCntlr(this,
-            getShmemPerfModel(),
+            m_home_shmem_perf_model,
             getCacheBlockSize());
       Sim()->getStatsManager()->logTopology("dram-cntlr", core->getId(), core->getId());
 
       if (Sim()->getCfg()->getBoolArray("perf_model/dram/cache/enabled", core->getId()))
       {
-         m_dram_cache = new DramCache(this, getShmemPerfModel(), m_dram_controller_home_lookup, getCacheBlockSize(), m_dram_cntlr);
+         m_dram_cache = new DramCache(this, m_home_shmem_perf_model, m_dram_controller_home_lookup, getCacheBlockSize(), m_dram_cntlr);
          Sim()->getStatsManager()->logTopology("dram-cache", core->getId(), core->getId());
       }
    }
@@ -251,7 +289,7 @@ MemoryManager::MemoryManager(Core* core,
          {
             m_nuca_cache = new NucaCache(
                this,
-               getShmemPerfModel(),
+               m_home_shmem_perf_model,
                m_tag_directory_home_lookup,
                getCacheBlockSize(),
                nuca_parameters);
@@ -269,7 +307,7 @@ MemoryManager::MemoryManager(Core* core,
                dram_directory_max_hw_sharers,
                dram_directory_type_str,
                dram_directory_cache_access_time,
-               getShmemPerfModel());
+               m_home_shmem_perf_model);
          Sim()->getStatsManager()->logTopology("tag-dir", core->getId(), core->getId());
       }
    }
@@ -383,9 +421,13 @@ MemoryManager::~MemoryManager()
 
    // Delete the Models
 
-   if (m_itlb) delete m_itlb;
-   if (m_dtlb) delete m_dtlb;
+   for(i = TLB::PAGE_4K; i < TLB::NUM_PAGE_SIZES; ++i)
+   {
+      if (m_itlb[i]) delete m_itlb[i];
+      if (m_dtlb[i]) delete m_dtlb[i];
+   }
    if (m_stlb) delete m_stlb;
+   if (m_page_walker) delete m_page_walker;
 
    for(i = MemComponent::FIRST_LEVEL_CACHE; i <= (UInt32)m_last_level_cache; ++i)
    {
@@ -412,6 +454,8 @@ MemoryManager::~MemoryManager()
       delete m_dram_cntlr;
    if (m_dram_directory_cntlr)
       delete m_dram_directory_cntlr;
+   if (m_home_shmem_perf_model != getShmemPerfModel())
+      delete m_home_shmem_perf_model;
 }
 
 HitWhere::where_t
@@ -421,14 +465,15 @@ MemoryManager::coreInitiateMemoryAccess(
       Core::mem_op_t mem_op_type,
       IntPtr address, UInt32 offset,
       Byte* data_buf, UInt32 data_length,
-      Core::MemModeled modeled)
+      Core::MemModeled modeled,
+      IntPtr eip)
 {
    LOG_ASSERT_ERROR(mem_component <= m_last_level_cache,
       "Error: invalid mem_component (%d) for coreInitiateMemoryAccess", mem_component);
 
-   if (mem_component == MemComponent::L1_ICACHE && m_itlb)
+   if (mem_component == MemComponent::L1_ICACHE && m_itlb[TLB::PAGE_4K])
       accessTLB(m_itlb, address, true, modeled);
-   else if (mem_component == MemComponent::L1_DCACHE && m_dtlb)
+   else if (mem_component == MemComponent::L1_DCACHE && m_dtlb[TLB::PAGE_4K])
       accessTLB(m_dtlb, address, false, modeled);
 
    return m_cache_cntlrs[mem_component]->processMemOpFromCore(
@@ -437,7 +482,8 @@ MemoryManager::coreInitiateMemoryAccess(
          address, offset,
          data_buf, data_length,
          modeled == Core::MEM_MODELED_NONE || modeled == Core::MEM_MODELED_COUNT ? false : true,
-         modeled == Core::MEM_MODELED_NONE ? false : true);
+         modeled == Core::MEM_MODELED_NONE ? false : true,
+         eip);
 }
 
 void
@@ -448,12 +494,12 @@ MYLOG("begin");
    PrL1PrL2DramDirectoryMSI::ShmemMsg* shmem_msg = PrL1PrL2DramDirectoryMSI::ShmemMsg::getShmemMsg((Byte*) packet.data, &m_dummy_shmem_perf);
    SubsecondTime msg_time = packet.time;
 
-   getShmemPerfModel()->setElapsedTime(ShmemPerfModel::_SIM_THREAD, msg_time);
-   shmem_msg->getPerf()->updatePacket(packet);
-
    MemComponent::component_t receiver_mem_component = shmem_msg->getReceiverMemComponent();
    MemComponent::component_t sender_mem_component = shmem_msg->getSenderMemComponent();
 
+   getComponentShmemPerfModel(receiver_mem_component)->setElapsedTime(ShmemPerfModel::_SIM_THREAD, msg_time);
+   shmem_msg->getPerf()->updatePacket(packet);
+
    if (m_enabled)
    {
       LOG_PRINT("Got Shmem Msg: type(%i), address(0x%x), sender_mem_component(%u), receiver_mem_component(%u), sender(%i), receiver(%i)",
@@ -544,7 +590,7 @@ MYLOG("send msg %u %ul%u > %ul%u", msg_type, requester, sender_mem_component, re
    shmem_msg.setWhere(where);
 
    Byte* msg_buf = shmem_msg.makeMsgBuf();
-   SubsecondTime msg_time = getShmemPerfModel()->getElapsedTime(thread_num);
+   SubsecondTime msg_time = getComponentShmemPerfModel(sender_mem_component)->getElapsedTime(thread_num);
    perf->updateTime(msg_time);
 
    if (m_enabled)
@@ -555,12 +601,53 @@ MYLOG("send msg %u %ul%u > %ul%u", msg_type, requester, sender_mem_component, re
    NetPacket packet(msg_time, SHARED_MEM_1,
          m_core_id_master, receiver,
          shmem_msg.getMsgLen(), (const void*) msg_buf);
+
+   if (m_synchronous_home && isHomeComponent(receiver_mem_component))
+   {
+      // Model the network traversal, then hand the packet (and msg_buf with it) to the receiving home directly
+      getNetwork()->netRoute(packet);
+      deliverSynchronously(packet);
+      return;
+   }
+
    getNetwork()->netSend(packet);
 
    // Delete the Msg Buf
    delete [] msg_buf;
 }
 
+void
+MemoryManager::deliverSynchronously(const NetPacket& packet)
+{
+   SyncDelivery delivery = { (MemoryManager*)Sim()->getCoreManager()->getCoreFromID(packet.receiver)->getMemoryManager(), packet };
+
+   // Messages sent by a handler are only delivered once that handler has returned, so a thread
+   // never holds more than one home lock, and two homes sending to each other cannot deadlock
+   SyncDeliveryList *pending = s_sync_deliveries->getPtr<SyncDeliveryList>();
+   if (pending)
+   {
+      pending->push_back(delivery);
+      return;
+   }
+
+   SyncDeliveryList deliveries;
+   deliveries.push_back(delivery);
+   s_sync_deliveries->set(&deliveries);
+
+   for(UInt32 i = 0; i < deliveries.size(); ++i)
+   {
+      // Copy, as pushing more deliveries may move the list
+      delivery = deliveries[i];
+      {
+         ScopedLock sl(delivery.receiver->m_home_lock);
+         delivery.receiver->handleMsgFromNetwork(delivery.packet);
+      }
+      delete [] (Byte*)delivery.packet.data;
+   }
+
+   s_sync_deliveries->set((void*)NULL);
+}
+
 void
 MemoryManager::broadcastMsg(PrL1PrL2DramDirectoryMSI::ShmemMsg::msg_t msg_type, MemComponent::component_t sender_mem_component, MemComponent::component_t receiver_mem_component, core_id_t requester, IntPtr address, Byte* data_buf, UInt32 data_length, ShmemPerf *perf, ShmemPerfModel::Thread_t thread_num)
 {
@@ -569,7 +656,7 @@ MYLOG("bcast msg");
    PrL1PrL2DramDirectoryMSI::ShmemMsg shmem_msg(msg_type, sender_mem_component, receiver_mem_component, requester, address, data_buf, data_length, perf);
 
    Byte* msg_buf = shmem_msg.makeMsgBuf();
-   SubsecondTime msg_time = getShmemPerfModel()->getElapsedTime(thread_num);
+   SubsecondTime msg_time = getComponentShmemPerfModel(sender_mem_component)->getElapsedTime(thread_num);
    perf->updateTime(msg_time);
 
    if (m_enabled)
@@ -586,22 +673,68 @@ MYLOG("bcast msg");
    delete [] msg_buf;
 }
 
+TLB::page_size_t
+MemoryManager::getPageSize(IntPtr address)
+{
+   if (m_page_size_from_trace)
+   {
+      UInt32 page_shift = PageSizeTable::getPageShift(address);
+      if (page_shift == TLB::getPageShift(TLB::PAGE_1G))
+         return TLB::PAGE_1G;
+      else if (page_shift == TLB::getPageShift(TLB::PAGE_2M))
+         return TLB::PAGE_2M;
+   }
+   return m_page_size;
+}
+
 void
-MemoryManager::accessTLB(TLB * tlb, IntPtr address, bool isIfetch, Core::MemModeled modeled)
+MemoryManager::accessTLB(TLB ** tlbs, IntPtr address, bool isIfetch, Core::MemModeled modeled)
 {
-   bool hit = tlb->lookup(address, getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD));
-   if (hit == false
-       && !(modeled == Core::MEM_MODELED_NONE || modeled == Core::MEM_MODELED_COUNT)
-       && m_tlb_miss_penalty.getLatency() != SubsecondTime::Zero()
-   )
+   TLB::page_size_t page_size = getPageSize(address);
+   TLB *tlb = tlbs[page_size] ? tlbs[page_size] : tlbs[TLB::PAGE_4K];
+   SubsecondTime t_start = getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD);
+
+   bool hit = tlb->lookup(address, t_start, true, page_size);
+   if (hit)
+      return;
+
+   bool modeled_latency = !(modeled == Core::MEM_MODELED_NONE || modeled == Core::MEM_MODELED_COUNT);
+   SubsecondTime latency = m_tlb_miss_penalty.getLatency();
+
+   if (m_page_walker)
+   {
+      IntPtr entries[PageWalker::NUM_LEVELS];
+      UInt32 num_entries = m_page_walker->walk(address, page_size, t_start, entries);
+
+      if (modeled_latency)
+      {
+         // Read the page-table entries through the data caches, one after the other as each one points to the next.
+         // Their latency is accounted for below, together with the fixed penalty
+         for(UInt32 i = 0; i < num_entries; ++i)
+         {
+            m_cache_cntlrs[MemComponent::L1_DCACHE]->processMemOpFromCore(
+                  Core::NONE,
+                  Core::READ,
+                  entries[i] & ~IntPtr(m_cache_block_size - 1), entries[i] & (m_cache_block_size - 1),
+                  NULL, sizeof(UInt64),
+                  true,
+                  true,
+                  0);
+         }
+         latency += getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD) - t_start;
+         getShmemPerfModel()->setElapsedTime(ShmemPerfModel::_USER_THREAD, t_start);
+      }
+   }
+
+   if (modeled_latency && latency != SubsecondTime::Zero())
    {
       if (m_tlb_miss_parallel)
       {
-         incrElapsedTime(m_tlb_miss_penalty.getLatency(), ShmemPerfModel::_USER_THREAD);
+         incrElapsedTime(latency, ShmemPerfModel::_USER_THREAD);
       }
       else
       {
-         PseudoInstruction *i = new TLBMissInstruction(m_tlb_miss_penalty.getLatency(), isIfetch);
+         PseudoInstruction *i = new TLBMissInstruction(latency, isIfetch);
          getCore()->getPerformanceModel()->queuePseudoInstruction(i);
       }
    }
@@ -640,6 +773,9 @@ MemoryManager::enableModels()
       m_cache_perf_models[(MemComponent::component_t)i]->enable();
    }
 
+   if (m_home_shmem_perf_model != getShmemPerfModel())
+      m_home_shmem_perf_model->enable();
+
    if (m_dram_cntlr_present)
       m_dram_cntlr->getDramPerfModel()->enable();
 }
@@ -655,6 +791,9 @@ MemoryManager::disableModels()
       m_cache_perf_models[(MemComponent::component_t)i]->disable();
    }
 
+   if (m_home_shmem_perf_model != getShmemPerfModel())
+      m_home_shmem_perf_model->disable();
+
    if (m_dram_cntlr_present)
       m_dram_cntlr->getDramPerfModel()->disable();
 }
@@ -9,10 +9,14 @@
 #include "../pr_l1_pr_l2_dram_directory_msi/shmem_msg.h"
 #include "mem_component.h"
 #include "sem.h"
+#include "lock.h"
+#include "tls.h"
+#include "small_vector.h"
 #include "fixed_types.h"
 #include "shmem_perf_model.h"
 #include "shared_cache_block_info.h"
 #include "subsecond_time.h"
+#include "tlb.h"
 
 #include <map>
 
@@ -21,7 +25,7 @@ class ShmemPerf;
 
 namespace ParametricDramDirectoryMSI
 {
-   class TLB;
+   class PageWalker;
 
    typedef std::pair<core_id_t, MemComponent::component_t> CoreComponentType;
    typedef std::map<CoreComponentType, CacheCntlr*> CacheCntlrMap;
@@ -36,15 +40,34 @@ namespace ParametricDramDirectoryMSI
          PrL1PrL2DramDirectoryMSI::DramCntlr* m_dram_cntlr;
          AddressHomeLookup* m_tag_directory_home_lookup;
          AddressHomeLookup* m_dram_controller_home_lookup;
-         TLB *m_itlb, *m_dtlb, *m_stlb;
+         // First-level TLBs per page size, sizes without a TLB of their own share the 4 KB one
+         TLB *m_itlb[TLB::NUM_PAGE_SIZES], *m_dtlb[TLB::NUM_PAGE_SIZES], *m_stlb;
+         PageWalker *m_page_walker;
          ComponentLatency m_tlb_miss_penalty;
          bool m_tlb_miss_parallel;
+         bool m_page_size_from_trace;
+         TLB::page_size_t m_page_size;
 
          core_id_t m_core_id_master;
 
          bool m_tag_directory_present;
          bool m_dram_cntlr_present;
 
+         // In synchronous mode, messages to the tag directory and DRAM controller are not sent over the transport,
+         // but handled by the sending thread itself while holding the receiving home's m_home_lock.
+         // The home side then needs its own clock, as the cache controllers' _SIM_THREAD time is in use by the SimThread.
+         bool m_synchronous_home;
+         Lock m_home_lock;
+         ShmemPerfModel* m_home_shmem_perf_model;
+
+         struct SyncDelivery
+         {
+            MemoryManager* receiver;
+            NetPacket packet;
+         };
+         typedef SmallVector<SyncDelivery, 4> SyncDeliveryList;
+         static TLS* s_sync_deliveries;   // SyncDeliveryList of the thread currently delivering, if any
+
          Semaphore* m_user_thread_sem;
          Semaphore* m_network_thread_sem;
 
@@ -60,7 +83,14 @@ namespace ParametricDramDirectoryMSI
          // Global map of all caches on all cores (within this process!)
          static CacheCntlrMap m_all_cache_cntlrs;
 
-         void accessTLB(TLB * tlb, IntPtr address, bool isIfetch, Core::MemModeled modeled);
+         void accessTLB(TLB ** tlbs, IntPtr address, bool isIfetch, Core::MemModeled modeled);
+         TLB::page_size_t getPageSize(IntPtr address);
+         void deliverSynchronously(const NetPacket& packet);
+
+         static bool isHomeComponent(MemComponent::component_t mem_component)
+         { return mem_component == MemComponent::TAG_DIR || mem_component == MemComponent::DRAM; }
+         ShmemPerfModel* getComponentShmemPerfModel(MemComponent::component_t mem_component)
+         { return isHomeComponent(mem_component) ? m_home_shmem_perf_model : getShmemPerfModel(); }
 
       public:
          MemoryManager(Core* core, Network* network, ShmemPerfModel* shmem_perf_model);
@@ -88,7 +118,8 @@ namespace ParametricDramDirectoryMSI
                Core::mem_op_t mem_op_type,
                IntPtr address, UInt32 offset,
                Byte* data_buf, UInt32 data_length,
-               Core::MemModeled modeled);
+               Core::MemModeled modeled,
+               IntPtr eip);
 
          void handleMsgFromNetwork(NetPacket& packet);
 
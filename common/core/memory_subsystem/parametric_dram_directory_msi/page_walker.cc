@@ -0,0 +1,75 @@
+#include "page_walker.h"
+#include "cache.h"
+#include "stats.h"
+#include "log.h"
+
+namespace ParametricDramDirectoryMSI
+{
+
+PageWalker::PageWalker(core_id_t core_id, UInt32 pwc_size, UInt32 pwc_associativity)
+   : m_walks(0)
+   , m_entry_reads(0)
+{
+   static const char *level_names[] = { "pml4", "pdp", "pd" };
+
+   LOG_ASSERT_ERROR(pwc_size == 0 || (pwc_size / pwc_associativity) * pwc_associativity == pwc_size,
+      "Invalid page-walk cache configuration: size(%d) must be a multiple of the associativity(%d)", pwc_size, pwc_associativity);
+
+   for(UInt32 level = PML4; level < PT; ++level)
+   {
+      m_pwc[level] = pwc_size
+         ? new Cache(String("pwc_") + level_names[level] + "_cache", "perf_model/tlb", core_id, pwc_size / pwc_associativity, pwc_associativity, 1 << 12, "lru", CacheBase::PR_L1_CACHE)
+         : NULL;
+      m_pwc_hits[level] = 0;
+      registerStatsMetric("page_walker", core_id, String("pwc_hits_") + level_names[level], &m_pwc_hits[level]);
+   }
+
+   registerStatsMetric("page_walker", core_id, "walks", &m_walks);
+   registerStatsMetric("page_walker", core_id, "entry_reads", &m_entry_reads);
+}
+
+PageWalker::~PageWalker()
+{
+   for(UInt32 level = PML4; level < PT; ++level)
+      delete m_pwc[level];
+}
+
+UInt32
+PageWalker::walk(IntPtr address, TLB::page_size_t page_size, SubsecondTime now, IntPtr entries[NUM_LEVELS])
+{
+   // Large pages are mapped directly by a PD (2 MB) or PDP (1 GB) entry
+   level_t leaf = page_size == TLB::PAGE_1G ? PDP : page_size == TLB::PAGE_2M ? PD : PT;
+
+   // Find the deepest level whose entry is cached, the walk continues below it
+   UInt32 first = PML4;
+   for(UInt32 level = leaf; level-- > PML4; )
+   {
+      if (m_pwc[level] && m_pwc[level]->accessSingleLine(getPwcKey(address, level_t(level)), Cache::LOAD, NULL, 0, now, true))
+      {
+         ++m_pwc_hits[level];
+         first = level + 1;
+         break;
+      }
+   }
+
+   UInt32 count = 0;
+   for(UInt32 level = first; level <= leaf; ++level)
+   {
+      entries[count++] = getEntryAddress(address, level_t(level));
+
+      if (level < leaf && m_pwc[level])
+      {
+         bool eviction;
+         IntPtr evict_addr;
+         CacheBlockInfo evict_block_info;
+         m_pwc[level]->insertSingleLine(getPwcKey(address, level_t(level)), NULL, &eviction, &evict_addr, &evict_block_info, NULL, now);
+      }
+   }
+
+   ++m_walks;
+   m_entry_reads += count;
+
+   return count;
+}
+
+}
@@ -0,0 +1,53 @@
+#ifndef PAGE_WALKER_H
+#define PAGE_WALKER_H
+
+#include "fixed_types.h"
+#include "tlb.h"
+
+class Cache;
+
+namespace ParametricDramDirectoryMSI
+{
+   // Four-level (x86-64) page table walk on a TLB miss. Page-walk caches hold the PML4, PDP and PD entries
+   // of recent walks, so a walk only has to read the levels below the deepest cached one.
+   // Page tables are not part of the simulated application, their entries are placed at synthetic physical
+   // addresses that keep the entries of neighbouring pages next to each other, as a real page table would.
+   class PageWalker
+   {
+      public:
+         enum level_t
+         {
+            PML4,
+            PDP,
+            PD,
+            PT,
+            NUM_LEVELS
+         };
+
+         PageWalker(core_id_t core_id, UInt32 pwc_size, UInt32 pwc_associativity);
+         ~PageWalker();
+
+         // Write the addresses of the page-table entries to be read to translate address into entries, in walk order,
+         // and return how many there are. The page-walk caches are updated as if the walk has completed.
+         UInt32 walk(IntPtr address, TLB::page_size_t page_size, SubsecondTime now, IntPtr entries[NUM_LEVELS]);
+
+      private:
+         static const IntPtr PAGE_TABLE_BASE = 0xfff0000000000000ULL;
+         static const UInt32 PAGE_TABLE_LEVEL_SHIFT = 40;
+
+         Cache* m_pwc[PT];  // No walk cache for the last level, that is what the TLB is for
+
+         UInt64 m_walks;
+         UInt64 m_pwc_hits[PT];
+         UInt64 m_entry_reads;
+
+         static UInt32 getLevelShift(level_t level) { return 12 + 9 * (PT - level); }
+         static IntPtr getEntryAddress(IntPtr address, level_t level)
+         {
+            return PAGE_TABLE_BASE + (IntPtr(level) << PAGE_TABLE_LEVEL_SHIFT) + (address >> getLevelShift(level)) * sizeof(UInt64);
+         }
+         static IntPtr getPwcKey(IntPtr address, level_t level) { return (address >> getLevelShift(level)) << 12; }
+   };
+}
+
+#endif // PAGE_WALKER_H
@@ -3,14 +3,21 @@
 
 #include "fixed_types.h"
 
-#include <vector>
-
 class Prefetcher
 {
    public:
+      // Most candidates a single getNextAddress() call will be asked for
+      static const UInt32 MAX_CANDIDATES = 64;
+
       static Prefetcher* createPrefetcher(String type, String configName, core_id_t core_id, UInt32 shared_cores);
 
-      virtual std::vector<IntPtr> getNextAddress(IntPtr current_address, core_id_t core_id) = 0;
+      virtual ~Prefetcher() {}
+
+      // Train on an access to current_address and write at most max_addresses prefetch candidates to addresses,
+      // returns the number of candidates written. eip is the instruction doing the access, or zero when not known
+      virtual UInt32 getNextAddress(IntPtr current_address, core_id_t core_id, IntPtr eip, IntPtr *addresses, UInt32 max_addresses) = 0;
+      // Train only, for accesses that will not prefetch. May be deferred until the next getNextAddress() call
+      virtual void train(IntPtr current_address, core_id_t core_id, IntPtr eip);
 };
 
 #endif // PREFETCHER_H
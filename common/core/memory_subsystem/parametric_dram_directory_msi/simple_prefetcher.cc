@@ -21,8 +21,8 @@ SimplePrefetcher::SimplePrefetcher(String configName, core_id_t _core_id, UInt32
       m_prev_address.at(idx).resize(n_flows);
 }
 
-std::vector<IntPtr>
-SimplePrefetcher::getNextAddress(IntPtr current_address, core_id_t _core_id)
+UInt32
+SimplePrefetcher::getNextAddress(IntPtr current_address, core_id_t _core_id, IntPtr eip, IntPtr *addresses, UInt32 max_addresses)
 {
    std::vector<IntPtr> &prev_address = m_prev_address.at(flows_per_core ? _core_id - core_id : 0);
 
@@ -48,17 +48,17 @@ SimplePrefetcher::getNextAddress(IntPtr current_address, core_id_t _core_id)
    IntPtr stride = current_address - prev_address[n_flow];
    prev_address[n_flow] = current_address;
 
-   std::vector<IntPtr> addresses;
+   UInt32 count = 0;
    if (stride != 0)
    {
-      for(unsigned int i = 0; i < num_prefetches; ++i)
+      for(unsigned int i = 0; i < num_prefetches && count < max_addresses; ++i)
       {
          IntPtr prefetch_address = current_address + i * stride;
          // But stay within the page if requested
          if (!stop_at_page || ((prefetch_address & PAGE_MASK) == (current_address & PAGE_MASK)))
-            addresses.push_back(prefetch_address);
+            addresses[count++] = prefetch_address;
       }
    }
 
-   return addresses;
+   return count;
 }
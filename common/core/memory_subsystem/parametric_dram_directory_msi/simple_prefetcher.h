@@ -3,11 +3,13 @@
 
 #include "prefetcher.h"
 
+#include <vector>
+
 class SimplePrefetcher : public Prefetcher
 {
    public:
       SimplePrefetcher(String configName, core_id_t core_id, UInt32 shared_cores);
-      virtual std::vector<IntPtr> getNextAddress(IntPtr current_address, core_id_t core_id);
+      virtual UInt32 getNextAddress(IntPtr current_address, core_id_t core_id, IntPtr eip, IntPtr *addresses, UInt32 max_addresses);
 
    private:
       const core_id_t core_id;
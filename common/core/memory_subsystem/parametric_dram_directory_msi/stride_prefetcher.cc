@@ -0,0 +1,85 @@
+#include "stride_prefetcher.h"
+#include "simulator.h"
+#include "config.hpp"
+#include "log.h"
+#include "utils.h"
+
+StridePrefetcher::StridePrefetcher(String configName, core_id_t core_id)
+   : m_block_mask(~(IntPtr(Sim()->getCfg()->getIntArray("perf_model/" + configName + "/cache_block_size", core_id)) - 1))
+   , m_degree(Sim()->getCfg()->getIntArray("perf_model/" + configName + "/prefetcher/stride/degree", core_id))
+   , m_confidence_threshold(Sim()->getCfg()->getIntArray("perf_model/" + configName + "/prefetcher/stride/confidence_threshold", core_id))
+   , m_table_size(Sim()->getCfg()->getIntArray("perf_model/" + configName + "/prefetcher/stride/table_size", core_id))
+   , m_table(m_table_size)
+   , m_batch_size(0)
+{
+   LOG_ASSERT_ERROR(isPower2(m_table_size), "perf_model/%s/prefetcher/stride/table_size must be a power of two", configName.c_str());
+}
+
+StridePrefetcher::Entry&
+StridePrefetcher::update(IntPtr address, IntPtr eip)
+{
+   address &= m_block_mask;
+   IntPtr tag = eip ? eip : address >> PAGE_SHIFT;
+   Entry &entry = m_table[(tag ^ (tag >> 12)) & (m_table_size - 1)];
+
+   if (!entry.valid || entry.tag != tag)
+   {
+      entry.tag = tag;
+      entry.last_address = address;
+      entry.stride = 0;
+      entry.confidence = 0;
+      entry.valid = true;
+      return entry;
+   }
+
+   SInt64 stride = address - entry.last_address;
+   // Repeated accesses to the same line neither confirm nor break the pattern
+   if (stride == 0)
+      return entry;
+
+   if (stride == entry.stride)
+   {
+      if (entry.confidence < m_confidence_threshold)
+         ++entry.confidence;
+   }
+   else if (entry.confidence > 0)
+      --entry.confidence;
+   else
+      entry.stride = stride;
+
+   entry.last_address = address;
+   return entry;
+}
+
+void
+StridePrefetcher::flush()
+{
+   for(UInt32 i = 0; i < m_batch_size; ++i)
+      update(m_batch[i].address, m_batch[i].eip);
+   m_batch_size = 0;
+}
+
+void
+StridePrefetcher::train(IntPtr current_address, core_id_t core_id, IntPtr eip)
+{
+   m_batch[m_batch_size].address = current_address;
+   m_batch[m_batch_size].eip = eip;
+   if (++m_batch_size == BATCH_SIZE)
+      flush();
+}
+
+UInt32
+StridePrefetcher::getNextAddress(IntPtr current_address, core_id_t core_id, IntPtr eip, IntPtr *addresses, UInt32 max_addresses)
+{
+   // Apply earlier training in order, so the table looks the same as when it had been trained right away
+   flush();
+
+   const Entry &entry = update(current_address, eip);
+   if (entry.stride == 0 || entry.confidence < m_confidence_threshold)
+      return 0;
+
+   UInt32 count = 0;
+   for(UInt32 i = 1; i <= m_degree && count < max_addresses; ++i)
+      addresses[count++] = entry.last_address + i * entry.stride;
+   return count;
+}
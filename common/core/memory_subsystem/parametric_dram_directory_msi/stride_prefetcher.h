@@ -0,0 +1,52 @@
+#ifndef __STRIDE_PREFETCHER_H
+#define __STRIDE_PREFETCHER_H
+
+#include "prefetcher.h"
+
+#include <vector>
+
+// Reference prediction table: one entry per load/store instruction, tracking the stride between the cache lines it touches.
+// Sequential streams are the special case of a one-line stride. Lower-level caches see the instruction address of
+// the access that missed in the levels above. Accesses without one (prefetches, the DRAM cache) are tracked per page instead.
+class StridePrefetcher : public Prefetcher
+{
+   public:
+      StridePrefetcher(String configName, core_id_t core_id);
+      UInt32 getNextAddress(IntPtr current_address, core_id_t core_id, IntPtr eip, IntPtr *addresses, UInt32 max_addresses);
+      void train(IntPtr current_address, core_id_t core_id, IntPtr eip);
+
+   private:
+      static const UInt32 PAGE_SHIFT = 12;
+      // Training-only accesses are queued up to this many, then applied to the table in one go
+      static const UInt32 BATCH_SIZE = 16;
+
+      struct Entry
+      {
+         IntPtr tag;
+         IntPtr last_address;
+         SInt64 stride;
+         UInt32 confidence;
+         bool valid;
+         Entry() : tag(0), last_address(0), stride(0), confidence(0), valid(false) {}
+      };
+
+      struct Access
+      {
+         IntPtr address;
+         IntPtr eip;
+      };
+
+      const IntPtr m_block_mask;
+      const UInt32 m_degree;
+      const UInt32 m_confidence_threshold;
+      const UInt32 m_table_size;
+      std::vector<Entry> m_table;
+
+      Access m_batch[BATCH_SIZE];
+      UInt32 m_batch_size;
+
+      Entry& update(IntPtr address, IntPtr eip);
+      void flush();
+};
+
+#endif // __STRIDE_PREFETCHER_H
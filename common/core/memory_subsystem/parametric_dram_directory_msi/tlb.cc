@@ -4,6 +4,8 @@
 namespace ParametricDramDirectoryMSI
 {
 
+const UInt32 TLB::PAGE_SHIFTS[TLB::NUM_PAGE_SIZES] = { 12, 21, 30 };
+
 TLB::TLB(String name, String cfgname, core_id_t core_id, UInt32 num_entries, UInt32 associativity, TLB *next_level)
    : m_size(num_entries)
    , m_associativity(associativity)
@@ -19,9 +21,9 @@ TLB::TLB(String name, String cfgname, core_id_t core_id, UInt32 num_entries, UIn
 }
 
 bool
-TLB::lookup(IntPtr address, SubsecondTime now, bool allocate_on_miss)
+TLB::lookupKey(IntPtr key, SubsecondTime now, bool allocate_on_miss)
 {
-   bool hit = m_cache.accessSingleLine(address, Cache::LOAD, NULL, 0, now, true);
+   bool hit = m_cache.accessSingleLine(key, Cache::LOAD, NULL, 0, now, true);
 
    m_access++;
 
@@ -32,28 +34,28 @@ TLB::lookup(IntPtr address, SubsecondTime now, bool allocate_on_miss)
 
    if (m_next_level)
    {
-      hit = m_next_level->lookup(address, now, false /* no allocation */);
+      hit = m_next_level->lookupKey(key, now, false /* no allocation */);
    }
 
    if (allocate_on_miss)
    {
-      allocate(address, now);
+      allocateKey(key, now);
    }
 
    return hit;
 }
 
 void
-TLB::allocate(IntPtr address, SubsecondTime now)
+TLB::allocateKey(IntPtr key, SubsecondTime now)
 {
    bool eviction;
    IntPtr evict_addr;
    CacheBlockInfo evict_block_info;
-   m_cache.insertSingleLine(address, NULL, &eviction, &evict_addr, &evict_block_info, NULL, now);
+   m_cache.insertSingleLine(key, NULL, &eviction, &evict_addr, &evict_block_info, NULL, now);
 
    // Use next level as a victim cache
    if (eviction && m_next_level)
-      m_next_level->allocate(evict_addr, now);
+      m_next_level->allocateKey(evict_addr, now);
 }
 
 }
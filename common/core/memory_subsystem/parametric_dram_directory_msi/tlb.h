@@ -8,10 +8,21 @@ namespace ParametricDramDirectoryMSI
 {
    class TLB
    {
+      public:
+         enum page_size_t
+         {
+            PAGE_4K,
+            PAGE_2M,
+            PAGE_1G,
+            NUM_PAGE_SIZES
+         };
+         static UInt32 getPageShift(page_size_t page_size) { return PAGE_SHIFTS[page_size]; }
+
       private:
          static const UInt32 SIM_PAGE_SHIFT = 12; // 4KB
          static const IntPtr SIM_PAGE_SIZE = (1L << SIM_PAGE_SHIFT);
          static const IntPtr SIM_PAGE_MASK = ~(SIM_PAGE_SIZE - 1);
+         static const UInt32 PAGE_SHIFTS[NUM_PAGE_SIZES];
 
          UInt32 m_size;
          UInt32 m_associativity;
@@ -20,10 +31,25 @@ namespace ParametricDramDirectoryMSI
          TLB *m_next_level;
 
          UInt64 m_access, m_miss;
+
+         // Entries are stored by page number, tagged with the page size so a TLB can hold pages of different sizes
+         static IntPtr getKey(IntPtr address, page_size_t page_size)
+         {
+            return ((address >> getPageShift(page_size)) | (IntPtr(page_size) << 48)) << SIM_PAGE_SHIFT;
+         }
+         bool lookupKey(IntPtr key, SubsecondTime now, bool allocate_on_miss);
+         void allocateKey(IntPtr key, SubsecondTime now);
+
       public:
          TLB(String name, String cfgname, core_id_t core_id, UInt32 num_entries, UInt32 associativity, TLB *next_level);
-         bool lookup(IntPtr address, SubsecondTime now, bool allocate_on_miss = true);
-         void allocate(IntPtr address, SubsecondTime now);
+         bool lookup(IntPtr address, SubsecondTime now, bool allocate_on_miss = true, page_size_t page_size = PAGE_4K)
+         {
+            return lookupKey(getKey(address, page_size), now, allocate_on_miss);
+         }
+         void allocate(IntPtr address, SubsecondTime now, page_size_t page_size = PAGE_4K)
+         {
+            allocateKey(getKey(address, page_size), now);
+         }
    };
 }
 
@@ -0,0 +1,203 @@
+#include "allocator.h"
+#include "tls.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cxxabi.h>
+
+TLS *PoolAllocator::s_tls = NULL;
+Lock PoolAllocator::s_lock;
+UInt64 PoolAllocator::s_num_allocators = 0;
+
+PoolAllocator::PoolAllocator(size_t size, UInt64 max_items, const std::type_info &type)
+   : m_size(size)
+   , m_max_items(max_items)
+   , m_type(type)
+   // Keep the data of every element 16-byte aligned
+   , m_stride((sizeof(DataElement) + size + 15) & ~15UL)
+   , m_index(registerAllocator())
+{
+}
+
+PoolAllocator::~PoolAllocator()
+{
+   UInt64 items = 0;
+   for(std::vector<Heap*>::iterator it = m_heaps.begin(); it != m_heaps.end(); ++it)
+   {
+      items += getCounter((*it)->allocations) - getCounter((*it)->frees);
+      for(FreeElement *elem = (*it)->remote; elem; elem = elem->next)
+         --items;
+   }
+   if (items)
+   {
+      int status;
+      char *nameoftype = abi::__cxa_demangle(m_type.name(), 0, 0, &status);
+      printf("[ALLOC] %" PRIu64 " items of type %s not freed\n", items, nameoftype);
+      free(nameoftype);
+   }
+
+   for(std::vector<Heap*>::iterator it = m_heaps.begin(); it != m_heaps.end(); ++it)
+      delete *it;
+   for(std::vector<char*>::iterator it = m_blocks.begin(); it != m_blocks.end(); ++it)
+      delete [] *it;
+}
+
+UInt64 PoolAllocator::registerAllocator()
+{
+   ScopedLock sl(s_lock);
+   // A single TLS key for all allocators, there can be many more of them than the system has keys
+   if (!s_tls)
+      s_tls = TLS::create(threadExit);
+   return s_num_allocators++;
+}
+
+void PoolAllocator::threadExit(void *arg)
+{
+   ThreadHeaps *thread_heaps = (ThreadHeaps*)arg;
+   for(std::vector<Heap*>::iterator it = thread_heaps->heaps.begin(); it != thread_heaps->heaps.end(); ++it)
+      if (*it)
+         (*it)->allocator->releaseHeap(*it);
+   delete thread_heaps;
+}
+
+void PoolAllocator::releaseHeap(Heap *heap)
+{
+   // The heap itself is kept: objects allocated from it may still be out, and will be freed to it
+   ScopedLock sl(m_heaps_lock);
+   __atomic_store_n(&heap->thread, (const void*)NULL, __ATOMIC_RELAXED);
+   m_unowned_heaps.push_back(heap);
+}
+
+PoolAllocator::Heap* PoolAllocator::getHeap()
+{
+   ThreadHeaps *thread_heaps = s_tls->getPtr<ThreadHeaps>();
+   if (thread_heaps && m_index < thread_heaps->heaps.size() && thread_heaps->heaps[m_index])
+      return thread_heaps->heaps[m_index];
+   else
+      return createHeap(thread_heaps);
+}
+
+PoolAllocator::Heap* PoolAllocator::createHeap(ThreadHeaps *thread_heaps)
+{
+   if (!thread_heaps)
+   {
+      thread_heaps = new ThreadHeaps();
+      s_tls->set(thread_heaps);
+   }
+   if (m_index >= thread_heaps->heaps.size())
+      thread_heaps->heaps.resize(m_index + 1, NULL);
+
+   Heap *heap;
+   {
+      ScopedLock sl(m_heaps_lock);
+      // Take over the heap of a thread that has exited, with everything left on its free lists
+      if (!m_unowned_heaps.empty())
+      {
+         heap = m_unowned_heaps.back();
+         m_unowned_heaps.pop_back();
+      }
+      else
+      {
+         heap = new Heap();
+         heap->allocator = this;
+         heap->free = NULL;
+         heap->remote = NULL;
+         heap->block = heap->block_end = NULL;
+         heap->block_elements = MIN_BLOCK_ELEMENTS;
+         heap->items = 0;
+         heap->allocations = 0;
+         heap->frees = 0;
+         m_heaps.push_back(heap);
+      }
+      __atomic_store_n(&heap->thread, (const void*)thread_heaps, __ATOMIC_RELAXED);
+   }
+
+   thread_heaps->heaps[m_index] = heap;
+   return heap;
+}
+
+PoolAllocator::FreeElement* PoolAllocator::refill(Heap *heap)
+{
+   // Take over everything other threads have freed so far. The list is taken as a whole, so popping
+   // it cannot race with the pushes from other threads.
+   FreeElement *remote = __atomic_exchange_n(&heap->remote, (FreeElement*)NULL, __ATOMIC_ACQUIRE);
+   if (remote)
+   {
+      UInt64 frees = 0;
+      for(FreeElement *elem = remote; elem; elem = elem->next)
+         ++frees;
+      addCounter(heap->frees, frees);
+      return remote;
+   }
+
+   if (heap->block == heap->block_end)
+   {
+      addCounter(heap->items, heap->block_elements);
+      LOG_ASSERT_ERROR(m_max_items == 0 || getCounter(heap->items) <= m_max_items,
+         "Allocator for objects of size %zu exceeded its maximum of %" PRIu64 " items per thread", m_size, m_max_items);
+
+      char *block = new char[heap->block_elements * m_stride];
+      {
+         ScopedLock sl(m_heaps_lock);
+         m_blocks.push_back(block);
+      }
+      heap->block = block;
+      heap->block_end = block + heap->block_elements * m_stride;
+      heap->block_elements = std::min(2 * heap->block_elements, MAX_BLOCK_ELEMENTS);
+   }
+
+   FreeElement *elem = (FreeElement*)heap->block;
+   heap->block += m_stride;
+   elem->next = NULL;
+   return elem;
+}
+
+void* PoolAllocator::alloc(size_t bytes)
+{
+   LOG_ASSERT_ERROR(bytes <= m_size, "Cannot allocate %zu bytes from an allocator for objects of size %zu", bytes, m_size);
+
+   Heap *heap = getHeap();
+   FreeElement *free = heap->free;
+   if (!free)
+      free = refill(heap);
+   heap->free = free->next;
+   addCounter(heap->allocations, 1);
+
+   DataElement *elem = (DataElement*)free;
+   elem->allocator = this;
+   elem->heap = heap;
+   return elem->data;
+}
+
+void PoolAllocator::_dealloc(void *ptr)
+{
+   Heap *heap = (Heap*)((DataElement*)ptr)->heap;
+   FreeElement *elem = (FreeElement*)ptr;
+
+   // A heap without owner never matches, also not for threads that have no heaps themselves (and get NULL)
+   const void *thread = __atomic_load_n(&heap->thread, __ATOMIC_RELAXED);
+   if (thread && thread == s_tls->get())
+   {
+      elem->next = heap->free;
+      heap->free = elem;
+      addCounter(heap->frees, 1);
+   }
+   else
+   {
+      FreeElement *head = __atomic_load_n(&heap->remote, __ATOMIC_RELAXED);
+      do
+      {
+         elem->next = head;
+      }
+      while (!__atomic_compare_exchange_n(&heap->remote, &head, elem, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+   }
+}
+
+UInt64 PoolAllocator::getAllocations()
+{
+   ScopedLock sl(m_heaps_lock);
+   UInt64 allocations = 0;
+   for(std::vector<Heap*>::iterator it = m_heaps.begin(); it != m_heaps.end(); ++it)
+      allocations += getCounter((*it)->allocations);
+   return allocations;
+}
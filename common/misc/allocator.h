@@ -2,10 +2,12 @@
 #define __ALLOCATOR_H
 
 #include "fixed_types.h"
-#include "FSBAllocator.hh"
+#include "lock.h"
 
+#include <vector>
 #include <typeinfo>
-#include <cxxabi.h>
+
+class TLS;
 
 // Pool allocator
 
@@ -15,6 +17,7 @@ class Allocator
       struct DataElement
       {
           Allocator *allocator;
+          void *heap;
           char data[];
       };
    public:
@@ -23,6 +26,9 @@ class Allocator
       virtual void *alloc(size_t bytes) = 0;
       virtual void _dealloc(void *ptr) = 0;
 
+      // Number of objects handed out so far
+      virtual UInt64 getAllocations() = 0;
+
       static void dealloc(void* ptr)
       {
          DataElement *elem = (DataElement*)(((char*)ptr) - sizeof(DataElement));
@@ -30,47 +36,88 @@ class Allocator
       }
 };
 
-template <typename T, unsigned MaxItems = 0> class TypedAllocator : public Allocator
+// Fixed-size objects, allocated without locks: every thread allocates from its own heap.
+// Objects are usually freed by the thread that allocated them, which puts them straight back on the heap's free list.
+// Others (e.g. ROB-SMT, where simulate() can run on any thread) push them onto the heap's remote-free list,
+// which the owning thread takes over in one go once its own free list runs dry.
+// When a thread exits, its heaps (with their free lists and any objects still out) are handed to the next thread that needs one.
+
+class PoolAllocator : public Allocator
 {
-   private:
-      UInt64 m_items;
-      FSBAllocator_ElemAllocator<sizeof(DataElement) + sizeof(T), MaxItems, T> m_alloc;
+   public:
+      PoolAllocator(size_t size, UInt64 max_items, const std::type_info &type);
+      virtual ~PoolAllocator();
 
-      // In ROB-SMT, DynamicMicroOps are allocated by their own thread but free'd in simulate() which can be called by anyone
-      Lock m_lock;
+      virtual void* alloc(size_t bytes);
+      virtual void _dealloc(void *ptr);
+      virtual UInt64 getAllocations();
 
-   public:
-      TypedAllocator()
-         : m_items(0)
-      {}
+   private:
+      // Heaps start with small blocks, as a thread may allocate only a few objects from a given allocator
+      // (e.g. pseudo-instructions queued on another core), and grow them up to MAX_BLOCK_ELEMENTS
+      static const UInt64 MIN_BLOCK_ELEMENTS = 16;
+      static const UInt64 MAX_BLOCK_ELEMENTS = 512;
 
-      virtual ~TypedAllocator()
+      struct FreeElement
       {
-         if (m_items)
-         {
-            int status;
-            char *nameoftype = abi::__cxa_demangle(typeid(T).name(), 0, 0, &status);
-            printf("[ALLOC] %" PRIu64 " items of type %s not freed\n", m_items, nameoftype);
-            free(nameoftype);
-         }
-      }
+         FreeElement *next;
+      };
 
-      virtual void* alloc(size_t bytes)
+      // The counters are only written by the owner, but read by others for statistics,
+      // so they are accessed through relaxed atomics
+      struct Heap
       {
-         ScopedLock sl(m_lock);
-         //LOG_ASSERT_ERROR(bytes == sizeof(T), "");
-         ++m_items;
-         DataElement *elem = (DataElement *)m_alloc.allocate();
-         elem->allocator = this;
-         return elem->data;
-      }
+         PoolAllocator *allocator;
+         const void *thread;              // ThreadHeaps of the owning thread, NULL while the heap has no owner
+         FreeElement *free;               // Owner only
+         FreeElement *remote;             // Pushed to by other threads, taken over by the owner
+         char *block;                     // Owner only: unused part of the current block
+         char *block_end;
+         UInt64 block_elements;           // Owner only: size of the next block
+         UInt64 items;                    // Written by the owner only: elements carved out of blocks
+         UInt64 allocations;              // Written by the owner only
+         UInt64 frees;                    // Written by the owner only, remote frees are counted when they are taken over
+      } __attribute__((aligned(64)));
 
-      virtual void _dealloc(void* ptr)
+      // Heaps of the current thread, indexed by allocator
+      struct ThreadHeaps
       {
-         ScopedLock sl(m_lock);
-         --m_items;
-         m_alloc.deallocate((T*)ptr);
+         std::vector<Heap*> heaps;
+      };
+
+      static TLS *s_tls;
+      static Lock s_lock;
+      static UInt64 s_num_allocators;
+
+      const size_t m_size;
+      const UInt64 m_max_items;
+      const std::type_info &m_type;
+      const size_t m_stride;
+      const UInt64 m_index;
+      Lock m_heaps_lock;                  // Taken only to create a heap or block, or to read statistics
+      std::vector<Heap*> m_heaps;
+      std::vector<Heap*> m_unowned_heaps; // Heaps of exited threads, waiting for a new owner
+      std::vector<char*> m_blocks;
+
+      static UInt64 registerAllocator();
+      static void threadExit(void *thread_heaps);
+      static void addCounter(UInt64 &counter, UInt64 n)
+      {
+         __atomic_store_n(&counter, __atomic_load_n(&counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
       }
+      static UInt64 getCounter(const UInt64 &counter) { return __atomic_load_n(&counter, __ATOMIC_RELAXED); }
+      Heap* getHeap();
+      Heap* createHeap(ThreadHeaps *thread_heaps);
+      void releaseHeap(Heap *heap);
+      FreeElement* refill(Heap *heap);
+};
+
+template <typename T, unsigned MaxItems = 0> class TypedAllocator : public PoolAllocator
+{
+   public:
+      TypedAllocator()
+         : PoolAllocator(sizeof(T), MaxItems, typeid(T))
+      {}
 };
 
 #endif // __ALLOCATOR_H
@@ -0,0 +1,20 @@
+#ifndef __CPU_RELAX_H
+#define __CPU_RELAX_H
+
+#include <sched.h>
+
+// Hint to the CPU that we're in a spin-wait loop, so it can save power and give a sibling hyperthread room.
+// Without a spin hint for the host architecture, give up the time slice instead.
+
+static inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+   __builtin_ia32_pause();
+#elif defined(__aarch64__)
+   asm volatile("yield" ::: "memory");
+#else
+   sched_yield();
+#endif
+}
+
+#endif // __CPU_RELAX_H
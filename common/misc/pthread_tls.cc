@@ -6,9 +6,9 @@
 class PthreadTLS : public TLS
 {
 public:
-    PthreadTLS()
+    PthreadTLS(void (*destructor)(void*))
     {
-        pthread_key_create(&m_key, NULL);
+        pthread_key_create(&m_key, destructor);
     }
 
     ~PthreadTLS()
@@ -35,7 +35,7 @@ private:
     pthread_key_t m_key;
 };
 
-__attribute__((weak)) TLS* TLS::create()
+__attribute__((weak)) TLS* TLS::create(void (*destructor)(void*))
 {
-    return new PthreadTLS();
+    return new PthreadTLS(destructor);
 }
@@ -0,0 +1,61 @@
+#ifndef __SMALL_VECTOR_H
+#define __SMALL_VECTOR_H
+
+#include "fixed_types.h"
+
+#include <cassert>
+
+// Vector with room for N elements inside the object itself, only going to the heap when it grows beyond that.
+// Meant for short-lived lists of plain data (e.g. network hops) that are built on every call.
+
+template <typename T, UInt32 N> class SmallVector
+{
+   public:
+      typedef T* iterator;
+      typedef const T* const_iterator;
+
+      SmallVector() : m_data(m_inline), m_size(0), m_capacity(N) {}
+      ~SmallVector() { if (m_data != m_inline) delete [] m_data; }
+
+      UInt32 size() const { return m_size; }
+      bool empty() const { return m_size == 0; }
+      void clear() { m_size = 0; }
+
+      T& operator[](UInt32 idx) { assert(idx < m_size); return m_data[idx]; }
+      const T& operator[](UInt32 idx) const { assert(idx < m_size); return m_data[idx]; }
+
+      iterator begin() { return m_data; }
+      iterator end() { return m_data + m_size; }
+      const_iterator begin() const { return m_data; }
+      const_iterator end() const { return m_data + m_size; }
+
+      void push_back(const T& t)
+      {
+         if (m_size == m_capacity)
+            grow();
+         m_data[m_size++] = t;
+      }
+
+   private:
+      T m_inline[N];
+      T *m_data;
+      UInt32 m_size;
+      UInt32 m_capacity;
+
+      void grow()
+      {
+         T *data = new T[2 * m_capacity];
+         for(UInt32 i = 0; i < m_size; ++i)
+            data[i] = m_data[i];
+         if (m_data != m_inline)
+            delete [] m_data;
+         m_data = data;
+         m_capacity *= 2;
+      }
+
+      // Copying would have to fix up m_data, not needed for now
+      SmallVector(const SmallVector&);
+      SmallVector& operator=(const SmallVector&);
+};
+
+#endif // __SMALL_VECTOR_H
@@ -1,8 +1,12 @@
 #include "stats.h"
 #include "simulator.h"
 #include "hooks_manager.h"
+#include "config.hpp"
 #include "utils.h"
 #include "itostr.h"
+#include "_thread.h"
+#include "lock.h"
+#include "cond.h"
 
 #include <math.h>
 #include <stdio.h>
@@ -11,6 +15,7 @@
 #include <string>
 #include <cstring>
 #include <zlib.h>
+#include <deque>
 #include <sys/time.h>
 
 template <> UInt64 makeStatsValue<UInt64>(UInt64 t) { return t; }
@@ -32,6 +37,244 @@ const char db_insert_stmt_name[] = "INSERT INTO `names` (nameid, objectname, met
 const char db_insert_stmt_prefix[] = "INSERT INTO `prefixes` (prefixid, prefixname) VALUES (?, ?);";
 const char db_insert_stmt_value[] = "INSERT INTO `values` (prefixid, nameid, core, value) VALUES (?, ?, ?, ?);";
 
+// sim.stats.bin layout (host byte order), merged into sim.stats.sqlite3 by tools/sniper_stats_bin.py
+//   header:   UInt32 magic, UInt32 version
+//   record:   UInt32 type, UInt32 payload length, payload
+//   LAYOUT:   UInt64 count, count x { UInt32 nameid, UInt32 index, UInt32 flags }
+//             written whenever metrics were registered since the previous snapshot
+//   SNAPSHOT: UInt32 prefixid, UInt32 length, prefix (padded to 8 bytes), UInt64 count, count x UInt64 value
+//             values are in the order of the most recent LAYOUT record
+//   DELETE:   UInt32 length, prefix (padded to 8 bytes)
+//   END:      empty, written when the file was closed cleanly
+// sim.stats.periodic.bin uses the same header, LAYOUT and END records, plus
+//   PERIODIC: UInt64 time (fs), UInt64 count, deltas against the previous PERIODIC record as
+//             { varint unchanged values skipped, varint zigzag(delta) } pairs up to the end of the record
+const UInt32 STATS_BINARY_MAGIC = 0x54534e53; // "SNST"
+const UInt32 STATS_BINARY_VERSION = 1;
+const UInt32 STATS_BINARY_LAYOUT_DEFAULT_OMITTED = 1; // Zero values are not recorded in sim.stats.sqlite3
+
+typedef enum {
+   STATS_BINARY_RECORD_END = 0,
+   STATS_BINARY_RECORD_LAYOUT,
+   STATS_BINARY_RECORD_SNAPSHOT,
+   STATS_BINARY_RECORD_DELETE,
+   STATS_BINARY_RECORD_PERIODIC,
+} stats_binary_record_t;
+
+// Appends records to sim.stats.bin from a background thread so recordStats() only has to pack the values
+class StatsBinaryWriter : public Runnable
+{
+   public:
+      class Record
+      {
+         public:
+            Record(stats_binary_record_t type)
+            {
+               m_data.reserve(64);
+               append<UInt32>(type);
+               append<UInt32>(0);
+            }
+            template <class T> void append(T value)
+            {
+               size_t offset = m_data.size();
+               m_data.resize(offset + sizeof(T));
+               memcpy(&m_data[offset], &value, sizeof(T));
+            }
+            void appendString(String str)
+            {
+               append<UInt32>(str.size());
+               size_t offset = m_data.size();
+               m_data.resize(offset + ((str.size() + 7) & ~7), 0);
+               memcpy(&m_data[offset], str.c_str(), str.size());
+            }
+            UInt64 *appendValues(UInt64 count)
+            {
+               append<UInt64>(count);
+               size_t offset = m_data.size();
+               m_data.resize(offset + count * sizeof(UInt64));
+               return (UInt64*)&m_data[offset];
+            }
+            void appendBytes(const void *data, size_t size)
+            {
+               size_t offset = m_data.size();
+               m_data.resize(offset + size);
+               memcpy(&m_data[offset], data, size);
+            }
+            const char *finish()
+            {
+               UInt32 length = m_data.size() - 2 * sizeof(UInt32);
+               memcpy(&m_data[sizeof(UInt32)], &length, sizeof(UInt32));
+               return &m_data[0];
+            }
+            size_t size() const { return m_data.size(); }
+
+         private:
+            std::vector<char> m_data;
+      };
+
+      StatsBinaryWriter(String filename);
+      ~StatsBinaryWriter();
+
+      // Queue a record for writing, takes ownership of the record
+      void write(Record *record);
+
+   private:
+      // Maximum number of queued records before recordStats() waits for the writer thread
+      static const size_t MAX_QUEUED = 64;
+
+      FILE *m_fp;
+      _Thread *m_thread;
+      Lock m_lock;
+      ConditionVariable m_cond_queued;
+      ConditionVariable m_cond_written;
+      std::deque<Record*> m_queue;
+      bool m_stop;
+      bool m_done;
+
+      void run();
+};
+
+StatsBinaryWriter::StatsBinaryWriter(String filename)
+   : m_stop(false)
+   , m_done(false)
+{
+   unlink(filename.c_str());
+   m_fp = fopen(filename.c_str(), "wb");
+   LOG_ASSERT_ERROR(m_fp, "Cannot create %s", filename.c_str());
+
+   UInt32 header[2] = { STATS_BINARY_MAGIC, STATS_BINARY_VERSION };
+   fwrite(header, sizeof(header), 1, m_fp);
+
+   m_thread = _Thread::create(this);
+   m_thread->run();
+}
+
+StatsBinaryWriter::~StatsBinaryWriter()
+{
+   write(new Record(STATS_BINARY_RECORD_END));
+
+   {
+      ScopedLock sl(m_lock);
+      m_stop = true;
+      m_cond_queued.signal();
+      while (!m_done)
+         m_cond_written.wait(m_lock);
+   }
+
+   fclose(m_fp);
+   delete m_thread;
+}
+
+void
+StatsBinaryWriter::write(Record *record)
+{
+   record->finish();
+
+   ScopedLock sl(m_lock);
+   while (m_queue.size() >= MAX_QUEUED)
+      m_cond_written.wait(m_lock);
+   m_queue.push_back(record);
+   m_cond_queued.signal();
+}
+
+void
+StatsBinaryWriter::run()
+{
+   ScopedLock sl(m_lock);
+   while (true)
+   {
+      while (m_queue.empty() && !m_stop)
+         m_cond_queued.wait(m_lock);
+      if (m_queue.empty())
+         break;
+
+      Record *record = m_queue.front();
+      m_queue.pop_front();
+
+      m_lock.release();
+      size_t written = fwrite(record->finish(), 1, record->size(), m_fp);
+      LOG_ASSERT_ERROR(written == record->size(), "Error writing to sim.stats.bin");
+      delete record;
+      m_lock.acquire();
+
+      m_cond_written.broadcast();
+   }
+   fflush(m_fp);
+   m_done = true;
+   m_cond_written.broadcast();
+}
+
+static void encodeVarint(std::vector<UInt8> &out, UInt64 value)
+{
+   while (value >= 0x80)
+   {
+      out.push_back(UInt8(value) | 0x80);
+      value >>= 7;
+   }
+   out.push_back(UInt8(value));
+}
+
+static UInt64 decodeVarint(const UInt8 *&ptr)
+{
+   UInt64 value = 0;
+   for(unsigned int shift = 0; ; shift += 7)
+   {
+      UInt8 byte = *ptr++;
+      value |= UInt64(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+         return value;
+   }
+}
+
+// Encode values - previous as { number of unchanged values skipped, zigzag(delta) } pairs, trailing unchanged values are omitted
+static void encodeDeltas(std::vector<UInt8> &out, const UInt64 *values, const UInt64 *previous, size_t count)
+{
+   size_t skipped = 0;
+   for(size_t i = 0; i < count; ++i)
+   {
+      SInt64 delta = values[i] - previous[i];
+      if (delta == 0)
+      {
+         ++skipped;
+         continue;
+      }
+      encodeVarint(out, skipped);
+      encodeVarint(out, (UInt64(delta) << 1) ^ UInt64(delta >> 63));
+      skipped = 0;
+   }
+}
+
+// Add the deltas encoded by encodeDeltas() to values
+static void applyDeltas(UInt64 *values, const std::vector<UInt8> &deltas)
+{
+   const UInt8 *ptr = deltas.data(), *end = ptr + deltas.size();
+   size_t i = 0;
+   while (ptr < end)
+   {
+      i += decodeVarint(ptr);
+      UInt64 zigzag = decodeVarint(ptr);
+      values[i++] += (zigzag >> 1) ^ -(zigzag & 1);
+   }
+}
+
+// Add the delta for a single slot, stops decoding as soon as it has been passed
+static UInt64 applyDelta(UInt64 value, const std::vector<UInt8> &deltas, size_t slot)
+{
+   const UInt8 *ptr = deltas.data(), *end = ptr + deltas.size();
+   size_t i = 0;
+   while (ptr < end)
+   {
+      i += decodeVarint(ptr);
+      if (i > slot)
+         break;
+      UInt64 zigzag = decodeVarint(ptr);
+      if (i == slot)
+         return value + ((zigzag >> 1) ^ -(zigzag & 1));
+      ++i;
+   }
+   return value;
+}
+
 UInt64 getWallclockTimeCallback(String objectName, UInt32 index, String metricName, UInt64 arg)
 {
    struct timeval tv = {0,0};
@@ -43,7 +286,16 @@ UInt64 getWallclockTimeCallback(String objectName, UInt32 index, String metricNa
 StatsManager::StatsManager()
    : m_keyid(0)
    , m_prefixnum(0)
+   , m_backend(BACKEND_SQLITE)
    , m_db(NULL)
+   , m_binary(NULL)
+   , m_binary_layout_size(0)
+   , m_periodic_interval(SubsecondTime::Zero())
+   , m_periodic_next(SubsecondTime::MaxTime())
+   , m_periodic_first(0)
+   , m_periodic_count(0)
+   , m_periodic_writer(NULL)
+   , m_periodic_layout_size(0)
 {
    init();
 
@@ -52,10 +304,13 @@ StatsManager::StatsManager()
 
 StatsManager::~StatsManager()
 {
-   for(StatsObjectList::iterator it1 = m_objects.begin(); it1 != m_objects.end(); ++it1)
-      for (StatsMetricList::iterator it2 = it1->second.begin(); it2 != it1->second.end(); ++it2)
-         for(StatsIndexList::iterator it3 = it2->second.second.begin(); it3 != it2->second.second.end(); ++it3)
-            delete it3->second;
+   for(std::vector<MetricSlot>::iterator it = m_metrics.begin(); it != m_metrics.end(); ++it)
+      delete it->metric;
+
+   if (m_binary)
+      delete m_binary;
+   if (m_periodic_writer)
+      delete m_periodic_writer;
 
    if (m_db)
    {
@@ -72,6 +327,14 @@ StatsManager::init()
    String filename = Sim()->getConfig()->formatOutputFileName("sim.stats.sqlite3");
    int ret;
 
+   String backend = Sim()->getCfg()->getString("stats/backend");
+   if (backend == "sqlite")
+      m_backend = BACKEND_SQLITE;
+   else if (backend == "binary")
+      m_backend = BACKEND_BINARY;
+   else
+      LOG_PRINT_ERROR("Invalid stats backend %s", backend.c_str());
+
    unlink(filename.c_str());
    ret = sqlite3_open(filename.c_str(), &m_db);
    LOG_ASSERT_ERROR(ret == SQLITE_OK, "Cannot create DB");
@@ -91,14 +354,121 @@ StatsManager::init()
    sqlite3_prepare(m_db, db_insert_stmt_value, -1, &m_stmt_insert_value, NULL);
 
    sqlite3_exec(m_db, "BEGIN TRANSACTION", NULL, NULL, NULL);
-   for(StatsObjectList::iterator it1 = m_objects.begin(); it1 != m_objects.end(); ++it1)
+   for(UInt64 keyId = 1; keyId <= m_keynames.size(); ++keyId)
+      recordMetricName(keyId, m_keynames[keyId - 1].first, m_keynames[keyId - 1].second);
+   sqlite3_exec(m_db, "END TRANSACTION", NULL, NULL, NULL);
+
+   if (m_backend == BACKEND_BINARY)
+      m_binary = new StatsBinaryWriter(Sim()->getConfig()->formatOutputFileName("sim.stats.bin"));
+}
+
+void
+StatsManager::initPeriodic()
+{
+   m_periodic_interval = SubsecondTime::NS(Sim()->getCfg()->getInt("stats/periodic/interval"));
+   if (m_periodic_interval == SubsecondTime::Zero())
+      return;
+
+   UInt64 snapshots = Sim()->getCfg()->getInt("stats/periodic/snapshots");
+   LOG_ASSERT_ERROR(snapshots > 0, "stats/periodic/snapshots must be at least 1");
+   m_periodic_ring.resize(snapshots);
+   m_periodic_writer = new StatsBinaryWriter(Sim()->getConfig()->formatOutputFileName("sim.stats.periodic.bin"));
+
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_PERIODIC, StatsManager::__hook_periodic, (UInt64)this);
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_ROI_BEGIN, StatsManager::__hook_roi_begin, (UInt64)this);
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_ROI_END, StatsManager::__hook_roi_end, (UInt64)this);
+}
+
+void
+StatsManager::hookRoiBegin()
+{
+   SubsecondTime now = Sim()->getClockSkewMinimizationServer()->getGlobalTime();
+   recordPeriodic(now);
+   m_periodic_next = now + m_periodic_interval;
+}
+
+void
+StatsManager::hookRoiEnd()
+{
+   m_periodic_next = SubsecondTime::MaxTime();
+}
+
+void
+StatsManager::hookPeriodic(SubsecondTime time)
+{
+   if (time >= m_periodic_next)
    {
-      for (StatsMetricList::iterator it2 = it1->second.begin(); it2 != it1->second.end(); ++it2)
-      {
-         recordMetricName(it2->second.first, it1->first, it2->first);
-      }
+      recordPeriodic(time);
+      // Skip intervals that passed without a barrier rather than taking several identical snapshots
+      do
+         m_periodic_next += m_periodic_interval;
+      while (m_periodic_next <= time);
    }
-   sqlite3_exec(m_db, "END TRANSACTION", NULL, NULL, NULL);
+}
+
+void
+StatsManager::recordPeriodic(SubsecondTime time)
+{
+   Sim()->getHooksManager()->callHooks(HookType::HOOK_PRE_STAT_WRITE, (UInt64)"periodic");
+
+   gatherValues();
+   size_t count = m_values.size();
+
+   if (m_periodic_last.size() < count)
+      m_periodic_last.resize(count, 0);
+   if (m_periodic_base.size() < count)
+      m_periodic_base.resize(count, 0);
+
+   // Make room by folding the oldest snapshot into the base values
+   if (m_periodic_count == m_periodic_ring.size())
+   {
+      applyDeltas(&m_periodic_base[0], m_periodic_ring[m_periodic_first].deltas);
+      m_periodic_first = (m_periodic_first + 1) % m_periodic_ring.size();
+      --m_periodic_count;
+   }
+
+   PeriodicSnapshot &snapshot = m_periodic_ring[(m_periodic_first + m_periodic_count) % m_periodic_ring.size()];
+   snapshot.time = time;
+   snapshot.count = count;
+   snapshot.deltas.clear();
+   encodeDeltas(snapshot.deltas, &m_values[0], &m_periodic_last[0], count);
+   ++m_periodic_count;
+   std::copy(m_values.begin(), m_values.end(), m_periodic_last.begin());
+
+   if (m_periodic_layout_size != count)
+   {
+      writeBinaryLayout(m_periodic_writer);
+      m_periodic_layout_size = count;
+   }
+
+   StatsBinaryWriter::Record *record = new StatsBinaryWriter::Record(STATS_BINARY_RECORD_PERIODIC);
+   record->append<UInt64>(time.getFS());
+   record->append<UInt64>(count);
+   record->appendBytes(snapshot.deltas.data(), snapshot.deltas.size());
+   m_periodic_writer->write(record);
+}
+
+bool
+StatsManager::getPeriodicStats(String objectName, UInt32 index, String metricName, std::vector<std::pair<SubsecondTime, UInt64> > &series)
+{
+   std::unordered_map<std::string, UInt64>::const_iterator key = m_keyids.find(makeKeyName(objectName, metricName));
+   if (key == m_keyids.end())
+      return false;
+   std::unordered_map<UInt64, UInt32>::const_iterator slot = m_slots.find((key->second << 32) | index);
+   if (slot == m_slots.end())
+      return false;
+
+   UInt64 value = slot->second < m_periodic_base.size() ? m_periodic_base[slot->second] : 0;
+   for(UInt64 i = 0; i < m_periodic_count; ++i)
+   {
+      const PeriodicSnapshot &snapshot = m_periodic_ring[(m_periodic_first + i) % m_periodic_ring.size()];
+      // Metrics registered after this snapshot was taken have no value yet
+      if (slot->second >= snapshot.count)
+         continue;
+      value = applyDelta(value, snapshot.deltas, slot->second);
+      series.push_back(std::make_pair(snapshot.time, value));
+   }
+   return true;
 }
 
 int
@@ -133,8 +503,34 @@ StatsManager::recordStats(String prefix)
    // Allow lazily-maintained statistics to be updated
    Sim()->getHooksManager()->callHooks(HookType::HOOK_PRE_STAT_WRITE, (UInt64)prefix.c_str());
 
+   UInt64 prefixid = ++m_prefixnum;
+
+   if (m_backend == BACKEND_BINARY)
+      recordStatsBinary(prefixid, prefix);
+   else
+      recordStatsSqlite(prefixid, prefix);
+}
+
+void
+StatsManager::gatherValues()
+{
+   m_values.resize(m_metrics.size());
+   UInt64 *values = &m_values[0];
+
+   for(std::vector<MetricPointer<UInt64> >::const_iterator it = m_metrics_uint64.begin(); it != m_metrics_uint64.end(); ++it)
+      values[it->slot] = *it->value;
+   for(std::vector<MetricPointer<SubsecondTime> >::const_iterator it = m_metrics_subsecond_time.begin(); it != m_metrics_subsecond_time.end(); ++it)
+      values[it->slot] = it->value->getFS();
+   for(std::vector<UInt32>::const_iterator it = m_metrics_other.begin(); it != m_metrics_other.end(); ++it)
+      values[*it] = m_metrics[*it].metric->recordMetric();
+}
+
+void
+StatsManager::recordStatsSqlite(UInt64 prefixid, String prefix)
+{
    int res;
-   int prefixid = ++m_prefixnum;
+
+   gatherValues();
 
    res = sqlite3_exec(m_db, "BEGIN TRANSACTION", NULL, NULL, NULL);
    LOG_ASSERT_ERROR(res == SQLITE_OK, "Error executing SQL statement: %s", sqlite3_errmsg(m_db));
@@ -145,60 +541,153 @@ StatsManager::recordStats(String prefix)
    res = sqlite3_step(m_stmt_insert_prefix);
    LOG_ASSERT_ERROR(res == SQLITE_DONE, "Error executing SQL statement: %s", sqlite3_errmsg(m_db));
 
-   for(StatsObjectList::iterator it1 = m_objects.begin(); it1 != m_objects.end(); ++it1)
+   for(size_t slot = 0; slot < m_metrics.size(); ++slot)
    {
-      for (StatsMetricList::iterator it2 = it1->second.begin(); it2 != it1->second.end(); ++it2)
-      {
-         for(StatsIndexList::iterator it3 = it2->second.second.begin(); it3 != it2->second.second.end(); ++it3)
-         {
-            if (!it3->second->isDefault())
-            {
-               sqlite3_reset(m_stmt_insert_value);
-               sqlite3_bind_int(m_stmt_insert_value, 1, prefixid);
-               sqlite3_bind_int(m_stmt_insert_value, 2, it2->second.first);   // Metric ID
-               sqlite3_bind_int(m_stmt_insert_value, 3, it3->second->index);  // Core ID
-               sqlite3_bind_int64(m_stmt_insert_value, 4, it3->second->recordMetric());
-               res = sqlite3_step(m_stmt_insert_value);
-               LOG_ASSERT_ERROR(res == SQLITE_DONE, "Error executing SQL statement: %s", sqlite3_errmsg(m_db));
-            }
-         }
-      }
+      if (m_values[slot] == 0 && m_metrics[slot].omitDefault)
+         continue;
+
+      sqlite3_reset(m_stmt_insert_value);
+      sqlite3_bind_int(m_stmt_insert_value, 1, prefixid);
+      sqlite3_bind_int(m_stmt_insert_value, 2, m_metrics[slot].keyId);           // Metric ID
+      sqlite3_bind_int(m_stmt_insert_value, 3, m_metrics[slot].metric->index);   // Core ID
+      sqlite3_bind_int64(m_stmt_insert_value, 4, m_values[slot]);
+      res = sqlite3_step(m_stmt_insert_value);
+      LOG_ASSERT_ERROR(res == SQLITE_DONE, "Error executing SQL statement: %s", sqlite3_errmsg(m_db));
    }
    res = sqlite3_exec(m_db, "END TRANSACTION", NULL, NULL, NULL);
    LOG_ASSERT_ERROR(res == SQLITE_OK, "Error executing SQL statement: %s", sqlite3_errmsg(m_db));
 }
 
 void
-StatsManager::registerMetric(StatsMetricBase *metric)
+StatsManager::writeBinaryLayout(StatsBinaryWriter *writer)
 {
-   std::string _objectName(metric->objectName.c_str()), _metricName(metric->metricName.c_str());
+   StatsBinaryWriter::Record *record = new StatsBinaryWriter::Record(STATS_BINARY_RECORD_LAYOUT);
+   record->append<UInt64>(m_metrics.size());
+   for(std::vector<MetricSlot>::const_iterator it = m_metrics.begin(); it != m_metrics.end(); ++it)
+   {
+      record->append<UInt32>(it->keyId);
+      record->append<UInt32>(it->metric->index);
+      record->append<UInt32>(it->omitDefault ? STATS_BINARY_LAYOUT_DEFAULT_OMITTED : 0);
+   }
+   writer->write(record);
+}
 
-   LOG_ASSERT_ERROR(m_objects[_objectName][_metricName].second.count(metric->index) == 0,
-      "Duplicate statistic %s.%s[%d]", _objectName.c_str(), _metricName.c_str(), metric->index);
-   m_objects[_objectName][_metricName].second[metric->index] = metric;
+void
+StatsManager::updateBinaryLayout()
+{
+   // Metrics are only ever appended, so (re)write the layout when new ones were registered since the last snapshot
+   writeBinaryLayout(m_binary);
+   m_binary_layout_size = m_metrics.size();
+}
 
-   if (m_objects[_objectName][_metricName].first == 0)
+void
+StatsManager::recordStatsBinary(UInt64 prefixid, String prefix)
+{
+   if (m_binary_layout_size != m_metrics.size())
+      updateBinaryLayout();
+
+   gatherValues();
+
+   StatsBinaryWriter::Record *record = new StatsBinaryWriter::Record(STATS_BINARY_RECORD_SNAPSHOT);
+   record->append<UInt32>(prefixid);
+   record->appendString(prefix);
+   UInt64 *values = record->appendValues(m_values.size());
+   memcpy(values, &m_values[0], m_values.size() * sizeof(UInt64));
+   m_binary->write(record);
+}
+
+void
+StatsManager::deleteStats(String prefix)
+{
+   LOG_ASSERT_ERROR(m_db, "m_db not yet set up !?");
+
+   if (m_backend == BACKEND_BINARY)
    {
-      m_objects[_objectName][_metricName].first = ++m_keyid;
+      // Snapshots are only appended to sim.stats.bin, tools/sniper_stats_bin.py drops them while merging
+      StatsBinaryWriter::Record *record = new StatsBinaryWriter::Record(STATS_BINARY_RECORD_DELETE);
+      record->appendString(prefix);
+      m_binary->write(record);
+      return;
+   }
+
+   const char *stmts[] = {
+      "DELETE FROM `values` WHERE prefixid IN (SELECT prefixid FROM `prefixes` WHERE prefixname = ?);",
+      "DELETE FROM `prefixes` WHERE prefixname = ?;",
+   };
+   for(unsigned int i = 0; i < sizeof(stmts)/sizeof(stmts[0]); ++i)
+   {
+      sqlite3_stmt *stmt;
+      sqlite3_prepare(m_db, stmts[i], -1, &stmt, NULL);
+      sqlite3_bind_text(stmt, 1, prefix.c_str(), -1, SQLITE_TRANSIENT);
+      int res = sqlite3_step(stmt);
+      LOG_ASSERT_ERROR(res == SQLITE_DONE, "Error executing SQL statement: %s", sqlite3_errmsg(m_db));
+      sqlite3_finalize(stmt);
+   }
+}
+
+std::string
+StatsManager::makeKeyName(const String &objectName, const String &metricName)
+{
+   std::string key(objectName.c_str(), objectName.size());
+   key.push_back('\t');
+   key.append(metricName.c_str(), metricName.size());
+   return key;
+}
+
+void
+StatsManager::registerMetric(StatsMetricBase *metric)
+{
+   std::string key = makeKeyName(metric->objectName, metric->metricName);
+
+   UInt64 &keyId = m_keyids[key];
+   if (keyId == 0)
+   {
+      keyId = ++m_keyid;
+      m_keynames.push_back(std::make_pair(std::string(metric->objectName.c_str()), std::string(metric->metricName.c_str())));
       if (m_db)
       {
          // Metrics name record was already written, but a new metric was registered afterwards: write a new record
-         recordMetricName(m_keyid, _objectName, _metricName);
+         recordMetricName(keyId, m_keynames.back().first, m_keynames.back().second);
       }
    }
+
+   UInt32 slot = m_metrics.size();
+   LOG_ASSERT_ERROR(m_slots.insert(std::make_pair((keyId << 32) | metric->index, slot)).second,
+      "Duplicate statistic %s.%s[%d]", metric->objectName.c_str(), metric->metricName.c_str(), metric->index);
+
+   MetricSlot entry = { keyId, metric, metric->isDefaultValue(0) };
+   m_metrics.push_back(entry);
+
+   switch(metric->type)
+   {
+      case STATS_METRIC_UINT64:
+      {
+         MetricPointer<UInt64> ptr = { (const UInt64 *)metric->value, slot };
+         m_metrics_uint64.push_back(ptr);
+         break;
+      }
+      case STATS_METRIC_SUBSECOND_TIME:
+      {
+         MetricPointer<SubsecondTime> ptr = { (const SubsecondTime *)metric->value, slot };
+         m_metrics_subsecond_time.push_back(ptr);
+         break;
+      }
+      default:
+         m_metrics_other.push_back(slot);
+         break;
+   }
 }
 
 StatsMetricBase *
 StatsManager::getMetricObject(String objectName, UInt32 index, String metricName)
 {
-   std::string _objectName(objectName.c_str()), _metricName(metricName.c_str());
-   if (m_objects.count(_objectName) == 0)
-      return NULL;
-   if (m_objects[_objectName].count(_metricName) == 0)
+   std::unordered_map<std::string, UInt64>::const_iterator key = m_keyids.find(makeKeyName(objectName, metricName));
+   if (key == m_keyids.end())
       return NULL;
-   if (m_objects[_objectName][_metricName].second.count(index) == 0)
+   std::unordered_map<UInt64, UInt32>::const_iterator slot = m_slots.find((key->second << 32) | index);
+   if (slot == m_slots.end())
       return NULL;
-   return m_objects[_objectName][_metricName].second[index];
+   return m_metrics[slot->second].metric;
 }
 
 void
@@ -4,20 +4,39 @@
 #include "itostr.h"
 
 #include <cstring>
+#include <vector>
+#include <unordered_map>
 #include <sqlite3.h>
 
+class StatsBinaryWriter;
+
+// How StatsManager reads a metric when taking a snapshot: plain UInt64 and SubsecondTime counters are read
+// directly through their pointer, everything else goes through the virtual recordMetric()
+typedef enum {
+   STATS_METRIC_OTHER,
+   STATS_METRIC_UINT64,
+   STATS_METRIC_SUBSECOND_TIME,
+} stats_metric_type_t;
+
+template <class T> struct StatsMetricType { static const stats_metric_type_t type = STATS_METRIC_OTHER; };
+template <> struct StatsMetricType<UInt64> { static const stats_metric_type_t type = STATS_METRIC_UINT64; };
+template <> struct StatsMetricType<SubsecondTime> { static const stats_metric_type_t type = STATS_METRIC_SUBSECOND_TIME; };
+
 class StatsMetricBase
 {
    public:
       String objectName;
       UInt32 index;
       String metricName;
-      StatsMetricBase(String _objectName, UInt32 _index, String _metricName) :
-         objectName(_objectName), index(_index), metricName(_metricName)
+      stats_metric_type_t type;
+      const void *value;
+      StatsMetricBase(String _objectName, UInt32 _index, String _metricName, stats_metric_type_t _type = STATS_METRIC_OTHER, const void *_value = NULL) :
+         objectName(_objectName), index(_index), metricName(_metricName), type(_type), value(_value)
       {}
       virtual ~StatsMetricBase() {}
       virtual UInt64 recordMetric() = 0;
       virtual bool isDefault() { return false; } // Return true when value hasn't changed from its initialization value
+      virtual bool isDefaultValue(UInt64 value) { return false; } // Return true when a recorded value equals the initialization value
 };
 
 template <class T> UInt64 makeStatsValue(T t);
@@ -27,7 +46,7 @@ template <class T> class StatsMetric : public StatsMetricBase
    public:
       T *metric;
       StatsMetric(String _objectName, UInt32 _index, String _metricName, T *_metric) :
-         StatsMetricBase(_objectName, _index, _metricName), metric(_metric)
+         StatsMetricBase(_objectName, _index, _metricName, StatsMetricType<T>::type, _metric), metric(_metric)
       {}
       virtual UInt64 recordMetric()
       {
@@ -37,6 +56,10 @@ template <class T> class StatsMetric : public StatsMetricBase
       {
          return recordMetric() == 0;
       }
+      virtual bool isDefaultValue(UInt64 value)
+      {
+         return value == 0;
+      }
 };
 
 typedef UInt64 (*StatsCallback)(String objectName, UInt32 index, String metricName, UInt64 arg);
@@ -71,7 +94,11 @@ class StatsManager
       StatsManager();
       ~StatsManager();
       void init();
+      void initPeriodic();
       void recordStats(String prefix);
+      void deleteStats(String prefix);
+      // Values of one metric in the periodic snapshots still held in memory, oldest first
+      bool getPeriodicStats(String objectName, UInt32 index, String metricName, std::vector<std::pair<SubsecondTime, UInt64> > &series);
       void registerMetric(StatsMetricBase *metric);
       StatsMetricBase *getMetricObject(String objectName, UInt32 index, String metricName);
       void logTopology(String component, core_id_t core_id, core_id_t master_id);
@@ -80,25 +107,86 @@ class StatsManager
       void logEvent(event_type_t event, SubsecondTime time, core_id_t core_id, thread_id_t thread_id, UInt64 value0, UInt64 value1, const char * description);
 
    private:
+      // Where snapshot values go: rows in sim.stats.sqlite3, or packed vectors appended to sim.stats.bin
+      // (names, topology and events are always written to sim.stats.sqlite3)
+      typedef enum {
+         BACKEND_SQLITE,
+         BACKEND_BINARY,
+      } backend_t;
+
+      // One slot per registered metric, in registration order. A snapshot is one value per slot.
+      struct MetricSlot
+      {
+         UInt64 keyId;
+         StatsMetricBase *metric;
+         bool omitDefault;    // Don't write zero values to sim.stats.sqlite3
+      };
+      template <class T> struct MetricPointer
+      {
+         const T *value;
+         UInt32 slot;
+      };
+
+      // A periodic snapshot, stored as the zigzag/varint-encoded difference with the previous one
+      struct PeriodicSnapshot
+      {
+         SubsecondTime time;
+         UInt32 count;
+         std::vector<UInt8> deltas;
+      };
+
       UInt64 m_keyid;
       UInt64 m_prefixnum;
 
+      backend_t m_backend;
+
       sqlite3 *m_db;
       sqlite3_stmt *m_stmt_insert_name;
       sqlite3_stmt *m_stmt_insert_prefix;
       sqlite3_stmt *m_stmt_insert_value;
 
+      StatsBinaryWriter *m_binary;
+      size_t m_binary_layout_size;
+
+      std::vector<MetricSlot> m_metrics;
+      std::vector<MetricPointer<UInt64> > m_metrics_uint64;
+      std::vector<MetricPointer<SubsecondTime> > m_metrics_subsecond_time;
+      std::vector<UInt32> m_metrics_other;  // Callbacks and other types, read through recordMetric()
+      std::vector<UInt64> m_values;
+
+      SubsecondTime m_periodic_interval;
+      SubsecondTime m_periodic_next;
+      std::vector<PeriodicSnapshot> m_periodic_ring;
+      UInt64 m_periodic_first;                // Ring index of the oldest snapshot
+      UInt64 m_periodic_count;
+      std::vector<UInt64> m_periodic_base;     // Values preceding the oldest snapshot in the ring
+      std::vector<UInt64> m_periodic_last;     // Values of the newest snapshot
+      StatsBinaryWriter *m_periodic_writer;
+      size_t m_periodic_layout_size;
+
       // Use std::string here because String (__versa_string) does not provide a hash function for STL containers with gcc < 4.6
-      typedef std::unordered_map<UInt64, StatsMetricBase *> StatsIndexList;
-      typedef std::pair<UInt64, StatsIndexList> StatsMetricWithKey;
-      typedef std::unordered_map<std::string, StatsMetricWithKey> StatsMetricList;
-      typedef std::unordered_map<std::string, StatsMetricList> StatsObjectList;
-      StatsObjectList m_objects;
+      std::unordered_map<std::string, UInt64> m_keyids;                       // makeKeyName(objectName, metricName) -> keyId
+      std::vector<std::pair<std::string, std::string> > m_keynames;           // keyId - 1 -> (objectName, metricName)
+      std::unordered_map<UInt64, UInt32> m_slots;                             // keyId << 32 | index -> slot
 
       static int __busy_handler(void* self, int count) { return ((StatsManager*)self)->busy_handler(count); }
       int busy_handler(int count);
 
       void recordMetricName(UInt64 keyId, std::string objectName, std::string metricName);
+      static std::string makeKeyName(const String &objectName, const String &metricName);
+      void gatherValues();
+      void recordStatsSqlite(UInt64 prefixid, String prefix);
+      void recordStatsBinary(UInt64 prefixid, String prefix);
+      void writeBinaryLayout(StatsBinaryWriter *writer);
+      void updateBinaryLayout();
+
+      static SInt64 __hook_periodic(UInt64 self, UInt64 time) { ((StatsManager*)self)->hookPeriodic(*(subsecond_time_t*)&time); return 0; }
+      static SInt64 __hook_roi_begin(UInt64 self, UInt64) { ((StatsManager*)self)->hookRoiBegin(); return 0; }
+      static SInt64 __hook_roi_end(UInt64 self, UInt64) { ((StatsManager*)self)->hookRoiEnd(); return 0; }
+      void hookPeriodic(SubsecondTime time);
+      void hookRoiBegin();
+      void hookRoiEnd();
+      void recordPeriodic(SubsecondTime time);
 };
 
 template <class T> void registerStatsMetric(String objectName, UInt32 index, String metricName, T *metric)
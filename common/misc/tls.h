@@ -32,7 +32,8 @@ public:
 
     void setInt(IntPtr i) { return set((void*)i); }
 
-    static TLS* create();
+    // destructor, if given, is called with the value of every thread that has one set when that thread exits
+    static TLS* create(void (*destructor)(void*) = NULL);
 
 protected:
     TLS();
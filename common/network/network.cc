@@ -1,6 +1,8 @@
 #include <string.h>
+#include <algorithm>
 
 #include "transport.h"
+#include "packet_buffer.h"
 #include "core.h"
 #include "network.h"
 #include "memory_manager_base.h"
@@ -19,6 +21,7 @@
 
 Network::Network(Core *core)
       : _core(core)
+      , _netQueueSeqnum(0)
 {
    LOG_ASSERT_ERROR(sizeof(g_type_to_static_network_map) / sizeof(EStaticNetwork) == NUM_PACKET_TYPES,
                     "Static network type map has incorrect number of entries.");
@@ -28,6 +31,9 @@ Network::Network(Core *core)
 
    _transport = Transport::getSingleton()->createNode(_core->getId());
 
+   _netQueue.resize(NUM_PACKET_TYPES * _numMod);
+   _netQueueSenders.resize(NUM_PACKET_TYPES, std::vector<UInt64>((_numMod + 63) / 64, 0));
+
    _callbacks = new NetworkCallback [NUM_PACKET_TYPES];
    _callbackObjs = new void* [NUM_PACKET_TYPES];
    for (SInt32 i = 0; i < NUM_PACKET_TYPES; i++)
@@ -96,7 +102,7 @@ void Network::netPullFromTransport()
          if (packet.receiver != NetPacket::BROADCAST)
          {
             if (packet.length > 0)
-               delete [] (Byte*) packet.data;
+               PacketBuffer::release(packet.data);
             continue;
          }
       }
@@ -118,7 +124,7 @@ void Network::netPullFromTransport()
          callback(_callbackObjs[packet.type], packet);
 
          if (packet.length > 0)
-            delete [] (Byte*) packet.data;
+            PacketBuffer::release(packet.data);
       }
 
       // synchronous I/O support
@@ -126,10 +132,7 @@ void Network::netPullFromTransport()
       {
          LOG_PRINT("Enqueuing packet : type %i, from %i, to %i, core_id %i, time %s.",
                (SInt32)packet.type, packet.sender, packet.receiver, _core->getId(), itostr(packet.time).c_str());
-         _netQueueLock.acquire();
-         _netQueue.push_back(packet);
-         _netQueueLock.release();
-         _netQueueCond.broadcast();
+         netQueuePush(packet);
       }
    }
    while (_transport->query());
@@ -155,11 +158,22 @@ SInt32 Network::netSend(NetPacket& packet)
 
    model->countPacket(packet);
 
-   std::vector<NetworkModel::Hop> hopVec;
+   NetworkModel::HopList hopVec;
    model->routePacket(packet, hopVec);
 
-   Byte *buffer = packet.makeBuffer();
-   SubsecondTime start_time = packet.time;
+   // Copy the payload once, all hops (more than one for broadcasts) share it and each receiver releases its reference
+   const void *payload = NULL;
+   if (packet.length > 0 && hopVec.size() > 0)
+   {
+      Byte *buffer = PacketBuffer::alloc(packet.length, hopVec.size());
+      memcpy(buffer, packet.data, packet.length);
+      payload = buffer;
+   }
+
+   NetPacket buff_pkt = packet;
+   buff_pkt.data = payload;
+   if (_core->getId() == buff_pkt.sender)
+      buff_pkt.start_time = packet.time;
 
    for (UInt32 i = 0; i < hopVec.size(); i++)
    {
@@ -169,124 +183,139 @@ SInt32 Network::netSend(NetPacket& packet)
 
       // Do a shortcut here
       if (hopVec[i].final_dest != NetPacket::BROADCAST)
-      {
-         // 1) Process Count = 1
-         // 2) The broadcast tree network model is not used
-         while (hopVec[i].next_dest != hopVec[i].final_dest)
-         {
-            packet.time = hopVec[i].time;
-            packet.receiver = hopVec[i].final_dest;
+         routeToFinalHop(packet, hopVec[i]);
 
-            Core* remote_core = Sim()->getCoreManager()->getCoreFromID(hopVec[i].next_dest);
-            NetworkModel* remote_network_model = remote_core->getNetwork()->getNetworkModelFromPacketType(packet.type);
+      buff_pkt.time = hopVec[i].time;
+      buff_pkt.receiver = hopVec[i].final_dest;
 
-            std::vector<NetworkModel::Hop> localHopVec;
-            remote_network_model->routePacket(packet, localHopVec);
-            assert(localHopVec.size() == 1);
+      // Only the header goes through the transport, the payload is passed by reference
+      _transport->send(hopVec[i].next_dest, &buff_pkt, sizeof(buff_pkt));
 
-            hopVec[i] = localHopVec[0];
-         }
-      }
+      LOG_PRINT("Sent packet");
+   }
 
-      NetPacket* buff_pkt = (NetPacket*) buffer;
+   return packet.length;
+}
 
-      if (_core->getId() == buff_pkt->sender)
-         buff_pkt->start_time = start_time;
+// Follow a unicast route through the network models of the intermediate nodes, until the next hop is the destination
+// (this assumes a single process and no broadcast tree network model)
 
-      buff_pkt->time = hopVec[i].time;
-      buff_pkt->receiver = hopVec[i].final_dest;
+void Network::routeToFinalHop(NetPacket& packet, NetworkModel::Hop& hop)
+{
+   while (hop.next_dest != hop.final_dest)
+   {
+      packet.time = hop.time;
+      packet.receiver = hop.final_dest;
 
-      _transport->send(hopVec[i].next_dest, buffer, packet.bufferSize());
+      Core* remote_core = Sim()->getCoreManager()->getCoreFromID(hop.next_dest);
+      NetworkModel* remote_network_model = remote_core->getNetwork()->getNetworkModelFromPacketType(packet.type);
 
-      LOG_PRINT("Sent packet");
+      NetworkModel::HopList localHopVec;
+      remote_network_model->routePacket(packet, localHopVec);
+      assert(localHopVec.size() == 1);
+
+      hop = localHopVec[0];
    }
+}
 
-   delete [] buffer;
+void Network::netRoute(NetPacket& packet)
+{
+   assert(packet.type >= 0 && packet.type < NUM_PACKET_TYPES);
+   LOG_ASSERT_ERROR(packet.receiver != NetPacket::BROADCAST, "netRoute() does not support broadcast packets");
 
-   return packet.length;
+   NetworkModel *model = _models[g_type_to_static_network_map[packet.type]];
+
+   model->countPacket(packet);
+
+   NetworkModel::HopList hopVec;
+   model->routePacket(packet, hopVec);
+   LOG_ASSERT_ERROR(hopVec.size() == 1, "Unicast packet routed to %u hops", hopVec.size());
+
+   if (_core->getId() == packet.sender)
+      packet.start_time = packet.time;
+
+   routeToFinalHop(packet, hopVec[0]);
+
+   packet.time = hopVec[0].time;
+   packet.receiver = hopVec[0].final_dest;
+
+   // Account for the packet at the receiver, as netPullFromTransport() would have done
+   Core* receiver_core = Sim()->getCoreManager()->getCoreFromID(packet.receiver);
+   receiver_core->getNetwork()->getNetworkModelFromPacketType(packet.type)->processReceivedPacket(packet);
 }
 
-// Stupid helper class to eliminate special cases for empty
-// sender/type vectors in a NetMatch
-class NetRecvIterator
+bool Network::netMatches(const NetMatch &match, SInt32 sender, PacketType type)
 {
-   public:
-      NetRecvIterator(UInt32 i)
-            : _mode(INT)
-            , _max(i)
-            , _i(0)
-      {
-      }
-      NetRecvIterator(const std::vector<SInt32> &v)
-            : _mode(SENDER_VECTOR)
-            , _senders(&v)
-            , _i(0)
-      {
-      }
-      NetRecvIterator(const std::vector<PacketType> &v)
-            : _mode(TYPE_VECTOR)
-            , _types(&v)
-            , _i(0)
-      {
-      }
+   // An empty sender or type list matches everything
+   if (!match.senders.empty() && std::find(match.senders.begin(), match.senders.end(), sender) == match.senders.end())
+      return false;
+   if (!match.types.empty() && std::find(match.types.begin(), match.types.end(), type) == match.types.end())
+      return false;
+   return true;
+}
 
-      inline UInt32 get()
-      {
-         switch (_mode)
-         {
-         case INT:
-            return _i;
-         case SENDER_VECTOR:
-            return (UInt32)_senders->at(_i);
-         case TYPE_VECTOR:
-            return (UInt32)_types->at(_i);
-         default:
-            assert(false);
-            return (UInt32)-1;
-         };
-      }
+void Network::netQueuePush(const NetPacket &packet)
+{
+   ScopedLock sl(_netQueueLock);
 
-      inline Boolean done()
-      {
-         switch (_mode)
-         {
-         case INT:
-            return _i >= _max;
-         case SENDER_VECTOR:
-            return _i >= _senders->size();
-         case TYPE_VECTOR:
-            return _i >= _types->size();
-         default:
-            assert(false);
-            return true;
-         };
-      }
+   NetQueueEntry entry = { _netQueueSeqnum++, packet };
+   _netQueue[packet.type * _numMod + packet.sender].push_back(entry);
+   _netQueueSenders[packet.type][packet.sender / 64] |= 1ULL << (packet.sender % 64);
 
-      inline void next()
-      {
-         ++_i;
-      }
+   for (std::list<NetWaiter*>::iterator it = _netWaiters.begin(); it != _netWaiters.end(); ++it)
+   {
+      if (netMatches(*(*it)->match, packet.sender, packet.type))
+         (*it)->cond.signal();
+   }
+}
 
-      inline void reset()
+// Keep the earliest packet of one (type, sender) queue in found, _netQueueLock must be held
+void Network::netQueueFindIn(UInt32 queue, bool &any, UInt32 &found_queue, NetQueue::iterator &found)
+{
+   for (NetQueue::iterator it = _netQueue[queue].begin(); it != _netQueue[queue].end(); ++it)
+   {
+      if (!any
+         || it->packet.time < found->packet.time
+         || (it->packet.time == found->packet.time && it->seqnum < found->seqnum))
       {
-         _i = 0;
+         any = true;
+         found_queue = queue;
+         found = it;
       }
+   }
+}
 
-   private:
-      enum
-      {
-         INT, SENDER_VECTOR, TYPE_VECTOR
-      } _mode;
+// Find the earliest packet matching match, _netQueueLock must be held
+bool Network::netQueueFind(const NetMatch &match, UInt32 &queue, NetQueue::iterator &found)
+{
+   bool any = false;
+   UInt32 num_types = match.types.empty() ? (UInt32)NUM_PACKET_TYPES : match.types.size();
+
+   for (UInt32 t = 0; t < num_types; ++t)
+   {
+      UInt32 type = match.types.empty() ? t : (UInt32)match.types[t];
+      assert(type < NUM_PACKET_TYPES);
 
-      union
+      if (match.senders.empty())
       {
-         UInt32 _max;
-         const std::vector<SInt32> *_senders;
-         const std::vector<PacketType> *_types;
-      };
+         // Only visit senders that have packets of this type queued
+         const std::vector<UInt64> &senders = _netQueueSenders[type];
+         for (UInt32 w = 0; w < senders.size(); ++w)
+            for (UInt64 bits = senders[w]; bits; bits &= bits - 1)
+               netQueueFindIn(type * _numMod + w * 64 + __builtin_ctzll(bits), any, queue, found);
+      }
+      else
+      {
+         for (std::vector<SInt32>::const_iterator it = match.senders.begin(); it != match.senders.end(); ++it)
+         {
+            assert(0 <= *it && *it < _numMod);
+            netQueueFindIn(type * _numMod + *it, any, queue, found);
+         }
+      }
+   }
 
-      UInt32 _i;
-};
+   return any;
+}
 
 NetPacket Network::netRecv(const NetMatch &match, UInt64 timeout_ns)
 {
@@ -294,60 +323,30 @@ NetPacket Network::netRecv(const NetMatch &match, UInt64 timeout_ns)
 
    // Track via iterator to minimize copying
    NetQueue::iterator itr;
+   UInt32 queue = 0;
    Boolean found = false, retry = true;
 
-   NetRecvIterator sender = match.senders.empty()
-                            ? NetRecvIterator(_numMod)
-                            : NetRecvIterator(match.senders);
-
-   NetRecvIterator type = match.types.empty()
-                          ? NetRecvIterator((UInt32)NUM_PACKET_TYPES)
-                          : NetRecvIterator(match.types);
-
    LOG_ASSERT_ERROR(_core && _core->getPerformanceModel(),
                     "Core and/or performance model not initialized.");
    SubsecondTime start_time = _core->getPerformanceModel()->getElapsedTime();
 
+   NetWaiter waiter;
+   waiter.match = &match;
+
    _netQueueLock.acquire();
 
    while (!found)
    {
-      itr = _netQueue.end();
-
-      // check every entry in the queue
-      for (NetQueue::iterator i = _netQueue.begin();
-            i != _netQueue.end();
-            i++)
-      {
-         // only find packets that match
-         for (sender.reset(); !sender.done(); sender.next())
-         {
-            if (i->sender != (SInt32)sender.get())
-               continue;
-
-            for (type.reset(); !type.done(); type.next())
-            {
-               if (i->type != (PacketType)type.get())
-                  continue;
-
-               found = true;
-
-               // find the earliest packet
-               if (itr == _netQueue.end() ||
-                   itr->time > i->time)
-               {
-                  itr = i;
-               }
-            }
-         }
-      }
+      found = netQueueFind(match, queue, itr);
 
       if (!found)
       {
          if (retry)
          {
-            // go to sleep until a packet arrives if none have been found
-            _netQueueCond.wait(_netQueueLock, timeout_ns);
+            // go to sleep until a matching packet arrives if none have been found
+            std::list<NetWaiter*>::iterator self = _netWaiters.insert(_netWaiters.end(), &waiter);
+            waiter.cond.wait(_netQueueLock, timeout_ns);
+            _netWaiters.erase(self);
 
             // After waking from either timeout or cond.signal, retry once but then no more
             if (timeout_ns)
@@ -362,14 +361,16 @@ NetPacket Network::netRecv(const NetMatch &match, UInt64 timeout_ns)
       }
    }
 
-   assert(found == true && itr != _netQueue.end());
-   assert(0 <= itr->sender && itr->sender < _numMod);
-   assert(0 <= itr->type && itr->type < NUM_PACKET_TYPES);
-   assert((itr->receiver == _core->getId()) || (itr->receiver == NetPacket::BROADCAST));
+   assert(found == true && itr != _netQueue[queue].end());
+   assert(0 <= itr->packet.sender && itr->packet.sender < _numMod);
+   assert(0 <= itr->packet.type && itr->packet.type < NUM_PACKET_TYPES);
+   assert((itr->packet.receiver == _core->getId()) || (itr->packet.receiver == NetPacket::BROADCAST));
 
    // Copy result
-   NetPacket packet = *itr;
-   _netQueue.erase(itr);
+   NetPacket packet = itr->packet;
+   _netQueue[queue].erase(itr);
+   if (_netQueue[queue].empty())
+      _netQueueSenders[packet.type][packet.sender / 64] &= ~(1ULL << (packet.sender % 64));
    _netQueueLock.release();
 
    LOG_PRINT("packet.time(%s), start_time(%s)", itostr(packet.time).c_str(), itostr(start_time).c_str());
@@ -505,19 +506,13 @@ NetPacket::NetPacket(SubsecondTime t, PacketType ty, SInt32 s,
 }
 
 
+// buffer holds the packet header as sent by Network::netSend(), data points to its payload PacketBuffer.
+// The transport buffer is released here, the receiver of the packet releases the payload.
 NetPacket::NetPacket(Byte *buffer)
 {
    memcpy(this, buffer, sizeof(*this));
 
-   // LOG_ASSERT_ERROR(length > 0, "type(%u), sender(%i), receiver(%i), length(%u)", type, sender, receiver, length);
-   if (length > 0)
-   {
-      Byte* data_buffer = new Byte[length];
-      memcpy(data_buffer, buffer + sizeof(*this), length);
-      data = data_buffer;
-   }
-
-   delete [] buffer;
+   PacketBuffer::release(buffer);
 }
 
 // This implementation is slightly wasteful because there is no need
@@ -527,16 +522,3 @@ UInt32 NetPacket::bufferSize() const
 {
    return (sizeof(*this) + length);
 }
-
-Byte* NetPacket::makeBuffer() const
-{
-   UInt32 size = bufferSize();
-   assert(size >= sizeof(NetPacket));
-
-   Byte *buffer = new Byte[size];
-
-   memcpy(buffer, this, sizeof(*this));
-   memcpy(buffer + sizeof(*this), data, length);
-
-   return buffer;
-}
@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include <vector>
+#include <deque>
 #include <list>
 
 // TODO: Do we need to support multicast to some (but not all)
@@ -38,13 +39,10 @@ public:
              SInt32 receiver, UInt32 length, const void *data);
 
    UInt32 bufferSize() const;
-   Byte *makeBuffer() const;
 
    static const SInt32 BROADCAST = 0xDEADBABE;
 };
 
-typedef std::list<NetPacket> NetQueue;
-
 // -- Network Matches -- //
 
 class NetMatch
@@ -82,8 +80,12 @@ class Network
 
       // -- Main interface -- //
 
+      // Received packets with length > 0 carry a PacketBuffer payload, release it with PacketBuffer::release(packet.data)
       SInt32 netSend(NetPacket& packet);
       NetPacket netRecv(const NetMatch &match, UInt64 timeout_ns = 0);
+      // Model a unicast packet's trip through the network without sending it: on return, packet.time is its arrival
+      // time at packet.receiver, and the caller is responsible for delivering it (packet.data is left untouched)
+      void netRoute(NetPacket& packet);
 
       // -- Wrappers -- //
 
@@ -114,11 +116,34 @@ class Network
       SInt32 _tid;
       SInt32 _numMod;
 
-      NetQueue _netQueue;
+      // Packets waiting for netRecv(), indexed by (type, sender) so only matching packets are looked at
+      struct NetQueueEntry
+      {
+         UInt64 seqnum;          // Arrival order, breaks ties between packets with the same time
+         NetPacket packet;
+      };
+      typedef std::deque<NetQueueEntry> NetQueue;
+
+      // A thread blocked in netRecv(), only woken up when a matching packet arrives
+      struct NetWaiter
+      {
+         const NetMatch *match;
+         ConditionVariable cond;
+      };
+
+      std::vector<NetQueue> _netQueue;                    // [type * _numMod + sender]
+      std::vector<std::vector<UInt64> > _netQueueSenders; // [type]: bitmap of senders with queued packets
+      UInt64 _netQueueSeqnum;
+      std::list<NetWaiter*> _netWaiters;
       Lock _netQueueLock;
-      ConditionVariable _netQueueCond;
 
       void forwardPacket(NetPacket& packet);
+      void routeToFinalHop(NetPacket& packet, NetworkModel::Hop& hop);
+
+      static bool netMatches(const NetMatch &match, SInt32 sender, PacketType type);
+      void netQueuePush(const NetPacket &packet);
+      bool netQueueFind(const NetMatch &match, UInt32 &queue, NetQueue::iterator &found);
+      void netQueueFindIn(UInt32 queue, bool &any, UInt32 &found_queue, NetQueue::iterator &found);
 };
 
 #endif // NETWORK_H
@@ -4,6 +4,7 @@
 #include "packet_type.h"
 #include "fixed_types.h"
 #include "subsecond_time.h"
+#include "small_vector.h"
 
 #include <vector>
 
@@ -36,9 +37,11 @@ class NetworkModel
          SInt32 next_dest;
          subsecond_time_t time;
       };
+      // Unicast routes fit inline, only broadcasts over many destinations go to the heap
+      typedef SmallVector<Hop, 4> HopList;
 
       virtual void routePacket(const NetPacket &pkt,
-                               std::vector<Hop> &nextHops) = 0;
+                               HopList &nextHops) = 0;
       virtual void processReceivedPacket(NetPacket &pkt) = 0;
 
       virtual void enable() = 0;
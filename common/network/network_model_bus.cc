@@ -63,7 +63,7 @@ NetworkModelBus::NetworkModelBus(Network *net, EStaticNetwork net_type)
 }
 
 void
-NetworkModelBus::routePacket(const NetPacket &pkt, std::vector<Hop> &nextHops)
+NetworkModelBus::routePacket(const NetPacket &pkt, HopList &nextHops)
 {
    SubsecondTime t_recv;
    if (accountPacket(pkt)) {
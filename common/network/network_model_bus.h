@@ -40,7 +40,7 @@ class NetworkModelBus : public NetworkModel
       NetworkModelBus(Network *net, EStaticNetwork net_type);
       ~NetworkModelBus() {}
 
-      void routePacket(const NetPacket &pkt, std::vector<Hop> &nextHops);
+      void routePacket(const NetPacket &pkt, HopList &nextHops);
 
       void processReceivedPacket(NetPacket& pkt);
 
@@ -114,7 +114,7 @@ NetworkModelEMeshHopByHop::createQueueModels(String name)
 }
 
 void
-NetworkModelEMeshHopByHop::routePacket(const NetPacket &pkt, std::vector<Hop> &nextHops)
+NetworkModelEMeshHopByHop::routePacket(const NetPacket &pkt, HopList &nextHops)
 {
    ScopedLock sl(m_lock);
 
@@ -266,7 +266,7 @@ void
 NetworkModelEMeshHopByHop::addHop(OutputDirection direction,
       core_id_t final_dest, core_id_t next_dest,
       SubsecondTime pkt_time, UInt32 pkt_length,
-      std::vector<Hop>& nextHops, core_id_t requester,
+      HopList& nextHops, core_id_t requester,
       subsecond_time_t *queue_delay_stats)
 {
    Hop h;
@@ -52,7 +52,7 @@ class NetworkModelEMeshHopByHop : public NetworkModel
       core_id_t computeCoreId(SInt32 x, SInt32 y);
       SInt32 computeDistance(core_id_t sender, core_id_t receiver);
 
-      void addHop(OutputDirection direction, core_id_t final_dest, core_id_t next_dest, SubsecondTime pkt_time, UInt32 pkt_length, std::vector<Hop>& nextHops, core_id_t requester, subsecond_time_t *queue_delay_stats = NULL);
+      void addHop(OutputDirection direction, core_id_t final_dest, core_id_t next_dest, SubsecondTime pkt_time, UInt32 pkt_length, HopList& nextHops, core_id_t requester, subsecond_time_t *queue_delay_stats = NULL);
       SubsecondTime computeLatency(OutputDirection direction, SubsecondTime pkt_time, UInt32 pkt_length, core_id_t requester, subsecond_time_t *queue_delay_stats);
       SubsecondTime computeProcessingTime(UInt32 pkt_length);
       core_id_t getNextDest(core_id_t final_dest, OutputDirection& direction);
@@ -81,7 +81,7 @@ class NetworkModelEMeshHopByHop : public NetworkModel
       NetworkModelEMeshHopByHop(Network* net, EStaticNetwork net_type);
       ~NetworkModelEMeshHopByHop();
 
-      void routePacket(const NetPacket &pkt, std::vector<Hop> &nextHops);
+      void routePacket(const NetPacket &pkt, HopList &nextHops);
       void processReceivedPacket(NetPacket &pkt);
       static void computeMeshDimensions(SInt32 &mesh_width, SInt32 &mesh_height);
       static std::pair<bool,std::vector<core_id_t> > computeMemoryControllerPositions(SInt32 num_memory_controllers, SInt32 core_count);
@@ -55,7 +55,7 @@ SInt32 NetworkModelEMeshHopCounter::computeDistance(SInt32 x1, SInt32 y1, SInt32
 }
 
 void NetworkModelEMeshHopCounter::routePacket(const NetPacket &pkt,
-                                         std::vector<Hop> &nextHops)
+                                         HopList &nextHops)
 {
    UInt32 pkt_length = getNetwork()->getModeledLength(pkt);
 
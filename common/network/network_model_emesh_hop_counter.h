@@ -12,7 +12,7 @@ public:
    ~NetworkModelEMeshHopCounter();
 
    void routePacket(const NetPacket &pkt,
-                    std::vector<Hop> &nextHops);
+                    HopList &nextHops);
    void processReceivedPacket(NetPacket &pkt);
 
    void enable() { _enabled = true; }
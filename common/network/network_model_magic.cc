@@ -14,7 +14,7 @@ NetworkModelMagic::NetworkModelMagic(Network *net, EStaticNetwork net_type) :
 { }
 
 void
-NetworkModelMagic::routePacket(const NetPacket &pkt, std::vector<Hop> &nextHops)
+NetworkModelMagic::routePacket(const NetPacket &pkt, HopList &nextHops)
 {
    // A latency of '1'
    if (pkt.receiver == NetPacket::BROADCAST)
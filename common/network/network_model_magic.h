@@ -22,7 +22,7 @@ class NetworkModelMagic : public NetworkModel
       NetworkModelMagic(Network *net, EStaticNetwork net_type);
       ~NetworkModelMagic() { }
 
-      void routePacket(const NetPacket &pkt, std::vector<Hop> &nextHops);
+      void routePacket(const NetPacket &pkt, HopList &nextHops);
 
       void processReceivedPacket(NetPacket& pkt);
 
@@ -5,6 +5,7 @@
 #include "subsecond_time.h"
 #include "hit_where.h"
 #include "allocator.h"
+#include "log.h"
 
 class Core;
 class Instruction;
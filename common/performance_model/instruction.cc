@@ -5,6 +5,9 @@
 #include "performance_model.h"
 #include "branch_predictor.h"
 #include "config.hpp"
+#include "allocator.h"
+
+#include <algorithm>
 
 // Instruction
 
@@ -13,6 +16,7 @@ Instruction::StaticInstructionCosts Instruction::m_instruction_costs;
 Instruction::Instruction(InstructionType type, OperandList &operands)
    : m_type(type)
    , m_uops(NULL)
+   , m_num_uops(0)
    , m_addr(0)
    , m_operands(operands)
 {
@@ -21,6 +25,7 @@ Instruction::Instruction(InstructionType type, OperandList &operands)
 Instruction::Instruction(InstructionType type)
    : m_type(type)
    , m_uops(NULL)
+   , m_num_uops(0)
    , m_addr(0)
 {
 }
@@ -74,6 +79,30 @@ SubsecondTime PseudoInstruction::getCost(Core *core) const
    return m_cost;
 }
 
+Allocator* PseudoInstruction::getAllocator()
+{
+   // One pool for all subclasses, so it is sized to hold the largest of them. New subclasses need to be added here,
+   // PoolAllocator::alloc() catches the ones that are not.
+   static constexpr size_t s_size = std::max({ sizeof(PseudoInstruction), sizeof(RecvInstruction), sizeof(SyncInstruction),
+      sizeof(SpawnInstruction), sizeof(TLBMissInstruction), sizeof(MemAccessInstruction), sizeof(DelayInstruction),
+      sizeof(UnknownInstruction) });
+   static_assert(std::max({ alignof(PseudoInstruction), alignof(RecvInstruction), alignof(SyncInstruction),
+      alignof(SpawnInstruction), alignof(TLBMissInstruction), alignof(MemAccessInstruction), alignof(DelayInstruction),
+      alignof(UnknownInstruction) }) <= 16, "PoolAllocator only aligns its elements to 16 bytes");
+   static Allocator *s_allocator = new PoolAllocator(s_size, 0, typeid(PseudoInstruction));
+   return s_allocator;
+}
+
+void* PseudoInstruction::operator new(size_t size)
+{
+   return getAllocator()->alloc(size);
+}
+
+void PseudoInstruction::operator delete(void *ptr)
+{
+   Allocator::dealloc(ptr);
+}
+
 // SyncInstruction
 
 SyncInstruction::SyncInstruction(SubsecondTime time, sync_type_t sync_type)
@@ -8,6 +8,7 @@
 #include <sstream>
 
 class Core;
+class Allocator;
 class MicroOp;
 
 enum InstructionType
@@ -71,11 +72,14 @@ public:
    void setDisassembly(String str) { m_disas = str; }
    const String& getDisassembly(void) const { return m_disas; }
 
-   void setMicroOps(const std::vector<const MicroOp *> *uops)
-   { m_uops = uops; }
+   // uops is a contiguous run of num_uops MicroOps, owned by whoever decoded the instruction
+   void setMicroOps(const MicroOp *uops, UInt32 num_uops)
+   { m_uops = uops; m_num_uops = num_uops; }
 
-   const std::vector<const MicroOp *>* getMicroOps(void) const
+   const MicroOp* getMicroOps(void) const
    { return m_uops; }
+   UInt32 getNumMicroOps(void) const
+   { return m_num_uops; }
 
 private:
    typedef std::vector<unsigned int> StaticInstructionCosts;
@@ -84,7 +88,8 @@ private:
    InstructionType m_type;
    String m_disas;
 
-   const std::vector<const MicroOp *> *m_uops;
+   const MicroOp *m_uops;
+   UInt32 m_num_uops;
 
    IntPtr m_addr;
    UInt32 m_size;
@@ -128,8 +133,15 @@ public:
 
    SubsecondTime getCost(Core *core) const;
 
+   // Pseudo-instructions are created and deleted for every synchronization event, memory access
+   // or TLB miss that is being modeled, allocate them from a pool rather than through malloc()
+   static void* operator new(size_t size);
+   static void operator delete(void *ptr);
+
 private:
    SubsecondTime m_cost;
+
+   static Allocator* getAllocator();
 };
 
 class RecvInstruction : public PseudoInstruction
@@ -13,6 +13,7 @@
 #include "dvfs_manager.h"
 #include "instruction_tracer.h"
 #include "dynamic_instruction.h"
+#include "allocator.h"
 
 PerformanceModel* PerformanceModel::create(Core* core)
 {
@@ -89,6 +90,8 @@ PerformanceModel::PerformanceModel(Core *core)
    registerStatsMetric("performance_model", core->getId(), "cpiSyncDvfsTransition", &m_cpiSyncDvfsTransition);
 
    registerStatsMetric("performance_model", core->getId(), "cpiRecv", &m_cpiRecv);
+
+   Sim()->getStatsManager()->registerMetric(new StatsMetricCallback("performance_model", core->getId(), "dynins_allocations", __getAllocations, (UInt64)m_dynins_alloc));
 }
 
 PerformanceModel::~PerformanceModel()
@@ -99,6 +102,11 @@ PerformanceModel::~PerformanceModel()
       delete m_instruction_tracer;
 }
 
+UInt64 PerformanceModel::__getAllocations(String objectName, UInt32 index, String metricName, UInt64 arg)
+{
+   return ((Allocator*)arg)->getAllocations();
+}
+
 void PerformanceModel::enable()
 {
    if (!m_enabled)
@@ -292,6 +300,46 @@ void PerformanceModel::handleIdleInstruction(PseudoInstruction *instruction)
 }
 
 void PerformanceModel::iterate()
+{
+   drainInstructionQueue();
+   synchronize();
+}
+
+void PerformanceModel::iterate(DynamicInstruction* const *instructions, UInt32 count)
+{
+   #ifdef ENABLE_PERF_MODEL_OWN_THREAD
+      for(UInt32 i = 0; i < count; ++i)
+         queueInstruction(instructions[i]);
+   #else
+      if (m_fastforward || !m_enabled)
+      {
+         for(UInt32 i = 0; i < count; ++i)
+            delete instructions[i];
+      }
+      else
+      {
+         // Pseudo-instructions that were queued before this batch go first
+         drainInstructionQueue();
+
+         // Bypass m_instruction_queue, but keep its ordering: pseudo-instructions queued while handling
+         // an instruction (e.g. TLB misses) are simulated before the next one
+         for(UInt32 i = 0; i < count; ++i)
+         {
+            DynamicInstruction *ins = instructions[i];
+            if (!m_fastforward && m_enabled)
+               handleInstruction(ins);
+            delete ins;
+
+            if (m_instruction_queue.size() > 0)
+               drainInstructionQueue();
+         }
+      }
+   #endif
+
+   iterate();
+}
+
+void PerformanceModel::drainInstructionQueue()
 {
    while (m_instruction_queue.size() > 0)
    {
@@ -312,8 +360,6 @@ void PerformanceModel::iterate()
 
       m_instruction_queue.pop();
    }
-
-   synchronize();
 }
 
 void PerformanceModel::synchronize()
@@ -31,6 +31,8 @@ public:
    void queuePseudoInstruction(PseudoInstruction *i);
    void handleIdleInstruction(PseudoInstruction *i);
    void iterate();
+   // Simulate a batch of instructions, equivalent to queueInstruction() on each of them followed by a single iterate()
+   void iterate(DynamicInstruction* const *instructions, UInt32 count);
    virtual void synchronize();
 
    UInt64 getInstructionCount() const { return m_instruction_count; }
@@ -91,6 +93,9 @@ protected:
    void incrementElapsedTime(SubsecondTime time) { m_elapsed_time.addLatency(time); }
    void incrementIdleElapsedTime(SubsecondTime time);
 
+   // Stats callback, arg is an Allocator*
+   static UInt64 __getAllocations(String objectName, UInt32 index, String metricName, UInt64 arg);
+
    #ifdef ENABLE_PERF_MODEL_OWN_THREAD
       typedef MTCircularQueue<DynamicInstruction*> InstructionQueue;
    #else
@@ -103,6 +108,8 @@ private:
 
    // Simulate a single instruction
    virtual void handleInstruction(DynamicInstruction *instruction) = 0;
+   // Simulate everything in m_instruction_queue
+   void drainInstructionQueue();
 
    // When time is jumped ahead outside of control of the performance model (synchronization instructions, etc.)
    // notify it here. This may be used to synchronize internal time or to flush various instruction queues
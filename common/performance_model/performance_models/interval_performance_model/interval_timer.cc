@@ -257,7 +257,7 @@ boost::tuple<uint64_t, uint64_t> IntervalTimer::dispatchWindow() {
          uint64_t insn_count = m_perf_model->getInstructionCount();
          uint64_t cycle_count = m_perf_model->getCycleCount();
 # ifdef ENABLE_MICROOP_STRINGS
-         const char *opcode_name = micro_op.getMicroOp()->getInstructionOpcodeName().c_str();
+         const char *opcode_name = micro_op.getMicroOp()->getInstructionOpcodeName();
 # else
          const char *opcode_name = "Unknown";
 # endif
@@ -459,7 +459,7 @@ uint64_t IntervalTimer::dispatchInstruction(Windows::WindowEntry& micro_op, Stop
             uint64_t insn_count = m_perf_model->getInstructionCount();
             uint64_t cycle_count = m_perf_model->getCycleCount();
 # ifdef ENABLE_MICROOP_STRINGS
-            const char *opcode_name = micro_op.getInstructionOpcodeName().c_str();
+            const char *opcode_name = micro_op.getInstructionOpcodeName();
 # else
             const char *opcode_name = "Unknown";
 # endif
@@ -1,6 +1,7 @@
 #include "instruction_decoder.h"
 #include "instruction.h"
 #include "micro_op.h"
+#include "micro_op_arena.h"
 
 extern "C" {
 #include <xed-reg-class.h>
@@ -10,30 +11,30 @@ extern "C" {
 }
 
 
-void InstructionDecoder::addSrcs(std::set<xed_reg_enum_t> regs, MicroOp * currentMicroOp) {
-   for(std::set<xed_reg_enum_t>::iterator it = regs.begin(); it != regs.end(); ++it)
+void InstructionDecoder::addSrcs(const std::set<xed_reg_enum_t> &regs, MicroOp * currentMicroOp) {
+   for(std::set<xed_reg_enum_t>::const_iterator it = regs.begin(); it != regs.end(); ++it)
       if (*it != XED_REG_INVALID) {
          xed_reg_enum_t reg = xed_get_largest_enclosing_register(*it);
          if (reg == XED_REG_EIP || reg == XED_REG_RIP) continue; // eip/rip is known at decode time, shouldn't be a dependency
-         currentMicroOp->addSourceRegister(reg, String(xed_reg_enum_t2str(reg)));
+         currentMicroOp->addSourceRegister(reg, xed_reg_enum_t2str(reg));
       }
 }
 
-void InstructionDecoder::addAddrs(std::set<xed_reg_enum_t> regs, MicroOp * currentMicroOp) {
-   for(std::set<xed_reg_enum_t>::iterator it = regs.begin(); it != regs.end(); ++it)
+void InstructionDecoder::addAddrs(const std::set<xed_reg_enum_t> &regs, MicroOp * currentMicroOp) {
+   for(std::set<xed_reg_enum_t>::const_iterator it = regs.begin(); it != regs.end(); ++it)
       if (*it != XED_REG_INVALID) {
          xed_reg_enum_t reg = xed_get_largest_enclosing_register(*it);
          if (reg == XED_REG_EIP || reg == XED_REG_RIP) continue; // eip/rip is known at decode time, shouldn't be a dependency
-         currentMicroOp->addAddressRegister(reg, String(xed_reg_enum_t2str(reg)));
+         currentMicroOp->addAddressRegister(reg, xed_reg_enum_t2str(reg));
       }
 }
 
-void InstructionDecoder::addDsts(std::set<xed_reg_enum_t> regs, MicroOp * currentMicroOp) {
-   for(std::set<xed_reg_enum_t>::iterator it = regs.begin(); it != regs.end(); ++it)
+void InstructionDecoder::addDsts(const std::set<xed_reg_enum_t> &regs, MicroOp * currentMicroOp) {
+   for(std::set<xed_reg_enum_t>::const_iterator it = regs.begin(); it != regs.end(); ++it)
       if (*it != XED_REG_INVALID) {
          xed_reg_enum_t reg = xed_get_largest_enclosing_register(*it);
          if (reg == XED_REG_EIP || reg == XED_REG_RIP) continue; // eip/rip is known at decode time, shouldn't be a dependency
-         currentMicroOp->addDestinationRegister(reg, String(xed_reg_enum_t2str(reg)));
+         currentMicroOp->addDestinationRegister(reg, xed_reg_enum_t2str(reg));
       }
 }
 
@@ -88,7 +89,7 @@ unsigned int InstructionDecoder::getNumExecs(const xed_decoded_inst_t *ins, int
  ///// IMPLEMENTATION OF INSTRUCTIONS /////
 //////////////////////////////////////////
 
-const std::vector<const MicroOp*>* InstructionDecoder::decode(IntPtr address, const xed_decoded_inst_t *ins, Instruction *ins_ptr)
+const MicroOp* InstructionDecoder::decode(IntPtr address, const xed_decoded_inst_t *ins, Instruction *ins_ptr, MicroOpArena &arena, uint32_t &num_uops)
 {
    // Determine register dependencies and number of microops per type
 
@@ -223,13 +224,13 @@ const std::vector<const MicroOp*>* InstructionDecoder::decode(IntPtr address, co
 
    // Generate list of microops
 
-   std::vector<const MicroOp*> *uops = new std::vector<const MicroOp*>(); //< Return value
    int totalMicroOps = numLoads + numExecs + numStores;
+   MicroOp *uops = arena.alloc(totalMicroOps); //< Return value
 
    for(int index = 0; index < totalMicroOps; ++index)
    {
 
-      MicroOp *currentMicroOp = new MicroOp();
+      MicroOp *currentMicroOp = &uops[index];
       currentMicroOp->setInstructionPointer(Memory::make_access(address));
 
       // We don't necessarily know the address at this point as it could
@@ -371,8 +372,8 @@ const std::vector<const MicroOp*>* InstructionDecoder::decode(IntPtr address, co
             currentMicroOp->setSerializing(true);
       }
 
-      uops->push_back(currentMicroOp);
    }
 
+   num_uops = totalMicroOps;
    return uops;
 }
@@ -1,6 +1,7 @@
 #include "instruction_decoder_wlib.h"
 #include "instruction.h"
 #include "micro_op.h"
+#include "micro_op_arena.h"
 #include "simulator.h"
 #include <x86_decoder.h>  // TODO delete
 
@@ -11,39 +12,69 @@
 //#endif
 //}
 
-void InstructionDecoder::addSrcs(std::set<dl::Decoder::decoder_reg> regs, MicroOp * currentMicroOp) {
+void InstructionDecoder::addSrcs(const RegList &regs, MicroOp * currentMicroOp) {
    dl::Decoder *dec = Sim()->getDecoder();
 
-   for(std::set<dl::Decoder::decoder_reg>::iterator it = regs.begin(); it != regs.end(); ++it)
-      if (!(Sim()->getDecoder()->invalid_register(*it))) {
-         dl::Decoder::decoder_reg reg = dec->largest_enclosing_register(*it);
+   for(uint32_t i = 0; i < regs.size(); ++i)
+      if (!(dec->invalid_register(regs[i]))) {
+         dl::Decoder::decoder_reg reg = dec->largest_enclosing_register(regs[i]);
          if (dec->reg_is_program_counter(reg)) continue; // eip/rip is known at decode time, shouldn't be a dependency
-         currentMicroOp->addSourceRegister(reg, String(dec->reg_name(reg)));
+         // Register names come from the decoder's static tables, no need to copy them
+         currentMicroOp->addSourceRegister(reg, dec->reg_name(reg));
       }
 }
 
-void InstructionDecoder::addAddrs(std::set<dl::Decoder::decoder_reg> regs, MicroOp * currentMicroOp) {
+void InstructionDecoder::addAddrs(const RegList &regs, MicroOp * currentMicroOp) {
    dl::Decoder *dec = Sim()->getDecoder();
 
-   for(std::set<dl::Decoder::decoder_reg>::iterator it = regs.begin(); it != regs.end(); ++it)
-      if (!(dec->invalid_register(*it))) {
-         dl::Decoder::decoder_reg reg = dec->largest_enclosing_register(*it);
+   for(uint32_t i = 0; i < regs.size(); ++i)
+      if (!(dec->invalid_register(regs[i]))) {
+         dl::Decoder::decoder_reg reg = dec->largest_enclosing_register(regs[i]);
          if (dec->reg_is_program_counter(reg)) continue; // eip/rip is known at decode time, shouldn't be a dependency
-         currentMicroOp->addAddressRegister(reg, String(dec->reg_name(reg)));
+         currentMicroOp->addAddressRegister(reg, dec->reg_name(reg));
       }
 }
 
-void InstructionDecoder::addDsts(std::set<dl::Decoder::decoder_reg> regs, MicroOp * currentMicroOp) {
+void InstructionDecoder::addDsts(const RegList &regs, MicroOp * currentMicroOp) {
    dl::Decoder *dec = Sim()->getDecoder();
 
-   for(std::set<dl::Decoder::decoder_reg>::iterator it = regs.begin(); it != regs.end(); ++it)
-      if (!(dec->invalid_register(*it))) {
-         dl::Decoder::decoder_reg reg = dec->largest_enclosing_register(*it);
+   for(uint32_t i = 0; i < regs.size(); ++i)
+      if (!(dec->invalid_register(regs[i]))) {
+         dl::Decoder::decoder_reg reg = dec->largest_enclosing_register(regs[i]);
          if (dec->reg_is_program_counter(reg)) continue; // eip/rip is known at decode time, shouldn't be a dependency
-         currentMicroOp->addDestinationRegister(reg, String(dec->reg_name(reg)));
+         currentMicroOp->addDestinationRegister(reg, dec->reg_name(reg));
       }
 }
 
+void InstructionDecoder::RegList::insert(dl::Decoder::decoder_reg reg)
+{
+   uint32_t idx = 0;
+   while (idx < m_size && m_regs[idx] < reg)
+      ++idx;
+   if (idx < m_size && m_regs[idx] == reg)
+      return;
+
+   LOG_ASSERT_ERROR(m_size < MAX_REGS, "Instruction uses more than %u registers", MAX_REGS);
+   for(uint32_t i = m_size; i > idx; --i)
+      m_regs[i] = m_regs[i - 1];
+   m_regs[idx] = reg;
+   ++m_size;
+}
+
+void InstructionDecoder::RegList::insert(const RegList &regs)
+{
+   for(uint32_t i = 0; i < regs.m_size; ++i)
+      insert(regs.m_regs[i]);
+}
+
+bool InstructionDecoder::RegList::count(dl::Decoder::decoder_reg reg) const
+{
+   for(uint32_t i = 0; i < m_size; ++i)
+      if (m_regs[i] == reg)
+         return true;
+   return false;
+}
+
 unsigned int InstructionDecoder::getNumExecs(const dl::DecodedInst *ins, int numLoads, int numStores)
 {
    return Sim()->getDecoder()->get_exec_microops(ins, numLoads, numStores);
@@ -54,14 +85,14 @@ unsigned int InstructionDecoder::getNumExecs(const dl::DecodedInst *ins, int num
  ///// IMPLEMENTATION OF INSTRUCTIONS /////
 //////////////////////////////////////////
 
-const std::vector<const MicroOp*>* InstructionDecoder::decode(IntPtr address,  const dl::DecodedInst *ins, Instruction *ins_ptr)
+const MicroOp* InstructionDecoder::decode(IntPtr address, const dl::DecodedInst *ins, Instruction *ins_ptr, MicroOpArena &arena, uint32_t &num_uops)
 {
    dl::Decoder *dec = Sim()->getDecoder();
    // Determine register dependencies and number of microops per type
 
-   std::vector<std::set<dl::Decoder::decoder_reg> > regs_loads, regs_stores;
-   std::set<dl::Decoder::decoder_reg> regs_mem, regs_src, regs_dst;
-   std::vector<uint16_t> memop_load_size, memop_store_size;
+   RegList regs_loads[MAX_MEMORY_OPERANDS], regs_stores[MAX_MEMORY_OPERANDS];
+   RegList regs_mem, regs_src, regs_dst;
+   uint16_t memop_load_size[MAX_MEMORY_OPERANDS], memop_store_size[MAX_MEMORY_OPERANDS];
 
    int numLoads = 0;
    int numExecs = 0;
@@ -70,25 +101,28 @@ const std::vector<const MicroOp*>* InstructionDecoder::decode(IntPtr address,  c
    // Ignore memory-referencing operands in NOP instructions
    if (!(ins->is_nop()))
    {
-      for(uint32_t mem_idx = 0; mem_idx < dec->num_memory_operands(ins); ++mem_idx)
+      uint32_t num_memory_operands = dec->num_memory_operands(ins);
+      LOG_ASSERT_ERROR(num_memory_operands <= MAX_MEMORY_OPERANDS, "Too many memory operands (%u) for instruction at %lx", num_memory_operands, address);
+
+      for(uint32_t mem_idx = 0; mem_idx < num_memory_operands; ++mem_idx)
       {
-         std::set<dl::Decoder::decoder_reg> regs;
+         RegList regs;
          regs.insert(dec->mem_base_reg(ins, mem_idx));
          regs.insert(dec->mem_index_reg(ins, mem_idx));
 
          if (dec->op_read_mem(ins, mem_idx)) {
-            regs_loads.push_back(regs);
-            memop_load_size.push_back(dec->size_mem_op(ins, mem_idx));
+            regs_loads[numLoads] = regs;
+            memop_load_size[numLoads] = dec->size_mem_op(ins, mem_idx);
             numLoads++;
          }
 
          if (dec->op_write_mem(ins, mem_idx)) {
-            regs_stores.push_back(regs);
-            memop_store_size.push_back(dec->size_mem_op(ins, mem_idx));
+            regs_stores[numStores] = regs;
+            memop_store_size[numStores] = dec->size_mem_op(ins, mem_idx);
             numStores++;
          }
 
-         regs_mem.insert(regs.begin(), regs.end());
+         regs_mem.insert(regs);
       }
    }
 
@@ -101,13 +135,13 @@ const std::vector<const MicroOp*>* InstructionDecoder::decode(IntPtr address,  c
       if (dec->is_addr_gen(ins, idx))
       {
          /* LEA-like instruction */
-         regs_src.insert(regs_mem.begin(), regs_mem.end());
+         regs_src.insert(regs_mem);
       }
       else if (dec->op_is_reg(ins, idx))  
       {
          dl::Decoder::decoder_reg reg = dec->get_op_reg(ins, idx);
 
-         if (dec->op_read_reg(ins, idx) && regs_mem.count(reg) == 0)
+         if (dec->op_read_reg(ins, idx) && !regs_mem.count(reg))
             regs_src.insert(reg);
          if (dec->op_write_reg(ins, idx))
             regs_dst.insert(reg);
@@ -137,7 +171,6 @@ const std::vector<const MicroOp*>* InstructionDecoder::decode(IntPtr address,  c
 
    // Generate list of microops
 
-   std::vector<const MicroOp*> *uops = new std::vector<const MicroOp*>(); //< Return value
    int totalMicroOps = numLoads + numExecs + numStores;
    // FIXME: 
    // Capstone bug: random incorrect disassembly --> ldr x1, [x0] to ldr w1, #0x7faa399350
@@ -145,10 +178,12 @@ const std::vector<const MicroOp*>* InstructionDecoder::decode(IntPtr address,  c
    if (totalMicroOps == 0) {
      numExecs = totalMicroOps = 1;
    }
-   
+
+   MicroOp *uops = arena.alloc(totalMicroOps); //< Return value
+
    for(int index = 0; index < totalMicroOps; ++index)
    {
-      MicroOp *currentMicroOp = new MicroOp();
+      MicroOp *currentMicroOp = &uops[index];
       // pass the decoder object to allow access to the library 
       currentMicroOp->setInstructionPointer(Memory::make_access(address));
       
@@ -280,8 +315,8 @@ const std::vector<const MicroOp*>* InstructionDecoder::decode(IntPtr address,  c
             currentMicroOp->setSerializing(true);
       }
 
-      uops->push_back(currentMicroOp);
    }
 
+   num_uops = totalMicroOps;
    return uops;
 }
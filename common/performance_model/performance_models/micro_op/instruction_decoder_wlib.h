@@ -9,20 +9,41 @@
 //#include <xed-decoded-inst.h>
 //}
 
-#include <vector>
-#include <set>
-
 class Instruction;
-class MicroOp;
+class MicroOpArena;
+struct MicroOp;
 
 class InstructionDecoder {
 private:
-   static void addSrcs(std::set<dl::Decoder::decoder_reg> regs, MicroOp *uop);
-   static void addAddrs(std::set<dl::Decoder::decoder_reg> regs, MicroOp *uop);
-   static void addDsts(std::set<dl::Decoder::decoder_reg> regs, MicroOp *uop);
+   // Sorted set of registers, stored inline: an instruction only names a handful of registers,
+   // so this replaces std::set without allocating on every decode
+   class RegList {
+   public:
+      static const uint32_t MAX_REGS = 32;
+
+      RegList() : m_size(0) {}
+
+      void insert(dl::Decoder::decoder_reg reg);
+      void insert(const RegList &regs);
+      bool count(dl::Decoder::decoder_reg reg) const;
+
+      uint32_t size() const { return m_size; }
+      dl::Decoder::decoder_reg operator[](uint32_t idx) const { return m_regs[idx]; }
+
+   private:
+      dl::Decoder::decoder_reg m_regs[MAX_REGS];
+      uint32_t m_size;
+   };
+
+   static const uint32_t MAX_MEMORY_OPERANDS = 4;
+
+   static void addSrcs(const RegList &regs, MicroOp *uop);
+   static void addAddrs(const RegList &regs, MicroOp *uop);
+   static void addDsts(const RegList &regs, MicroOp *uop);
    static unsigned int getNumExecs(const dl::DecodedInst *ins, int numLoads, int numStores);
 public:
-   static const std::vector<const MicroOp*>* decode(IntPtr address, const dl::DecodedInst *ins, Instruction *ins_ptr);
+   // Returns the instruction's MicroOps, allocated from arena, and sets num_uops to their count
+   static const MicroOp* decode(IntPtr address, const dl::DecodedInst *ins, Instruction *ins_ptr, MicroOpArena &arena, uint32_t &num_uops);
 };
 
 #endif /* INSTRUCTION_INFO_HPP_ */
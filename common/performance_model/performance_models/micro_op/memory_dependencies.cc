@@ -1,8 +1,9 @@
 #include "memory_dependencies.h"
 
 MemoryDependencies::MemoryDependencies()
-   : producers(1024) // Maximum size should be one ROB worth of instructions
+   : producers(MAX_PRODUCERS)
 {
+   static_assert(HASH_SIZE == 1 << 11, "hash() returns the upper 11 bits");
    clear();
 }
 
@@ -60,26 +61,62 @@ void MemoryDependencies::add(uint64_t sequenceNumber, uint64_t address)
 {
    Producer producer = {sequenceNumber, address};
    producers.push(producer);
+
+   // A later store to the same address replaces the earlier one, we only ever want the latest
+   uint32_t slot = hash(address);
+   while (table[slot].seqnr != INVALID_SEQNR && table[slot].address != address)
+      slot = (slot + 1) % HASH_SIZE;
+   table[slot] = producer;
 }
 
 uint64_t MemoryDependencies::find(uint64_t address)
 {
-   // There may be multiple entries with the same address, we want the latest one so traverse list in reverse order
-   for(int i = producers.size() - 1; i >= 0; --i)
-      if (producers.at(i).address == address)
-         return producers.at(i).seqnr;
+   for(uint32_t slot = hash(address); table[slot].seqnr != INVALID_SEQNR; slot = (slot + 1) % HASH_SIZE)
+      if (table[slot].address == address)
+         return table[slot].seqnr;
    return INVALID_SEQNR;
 }
 
+void MemoryDependencies::remove(uint32_t slot)
+{
+   // Backward-shift deletion: move later entries of the probe sequence into the hole, so find() can keep
+   // stopping at the first empty slot without needing tombstones
+   uint32_t hole = slot;
+   for(uint32_t i = (slot + 1) % HASH_SIZE; table[i].seqnr != INVALID_SEQNR; i = (i + 1) % HASH_SIZE)
+   {
+      // Entry i can fill the hole if the hole is not before its home slot
+      uint32_t home = hash(table[i].address);
+      if ((i - home) % HASH_SIZE >= (i - hole) % HASH_SIZE)
+      {
+         table[hole] = table[i];
+         hole = i;
+      }
+   }
+   table[hole].seqnr = INVALID_SEQNR;
+}
+
 void MemoryDependencies::clean(uint64_t lowestValidSequenceNumber)
 {
    while(!producers.empty() && producers.front().seqnr < lowestValidSequenceNumber)
-      producers.pop();
+   {
+      Producer producer = producers.pop();
+      for(uint32_t slot = hash(producer.address); table[slot].seqnr != INVALID_SEQNR; slot = (slot + 1) % HASH_SIZE)
+      {
+         if (table[slot].address == producer.address)
+         {
+            if (table[slot].seqnr == producer.seqnr)
+               remove(slot);
+            break;
+         }
+      }
+   }
 }
 
 void MemoryDependencies::clear()
 {
    while(!producers.empty())
       producers.pop();
+   for(uint32_t i = 0; i < HASH_SIZE; ++i)
+      table[i].seqnr = INVALID_SEQNR;
    membar = INVALID_SEQNR;
 }
@@ -13,19 +13,24 @@ class MemoryDependencies
          uint64_t seqnr;
          uint64_t address;
       };
-      // List of all active writers, ordered by sequence number
-      // This makes it easy to remove old entries, just compare the front of the queue with lowestValidSequenceNumber
-      // Finding the latest producer is a linear search, starting from the tail (there may be multiple entries
-      // with the same address, we want the latest one).
-      // Maximum number of entries is the number of instructions in the ROB, actual number of entries equals
-      // the number of writes in the ROB which is usually not larger than around 20.
-      // More fancy data structures, such as an underdered_map keyed on address, have a much higher overhead on insertion
-      // and put significant pressure on malloc()/free(), and are therefore not recommended.
+      // Maximum number of active writers, one ROB worth of instructions
+      static const uint32_t MAX_PRODUCERS = 1024;
+      // Open-addressed hash table with linear probing, keyed on physical address, holding the latest writer
+      // of each address. At least twice the number of writers so probe sequences stay short.
+      // Empty slots have seqnr == INVALID_SEQNR. The table is a fixed array: an unordered_map would put
+      // significant pressure on malloc()/free() for every store.
+      static const uint32_t HASH_SIZE = 2 * MAX_PRODUCERS;
+      Producer table[HASH_SIZE];
+      // All active writers, ordered by sequence number. Expired writers are popped off the front
+      // and removed from the table, unless a later store to the same address has replaced them.
       CircularQueue<Producer> producers;
       uint64_t membar;
 
+      static uint32_t hash(uint64_t address) { return (address * 0x9e3779b97f4a7c15ULL) >> 53; }
+
       void add(uint64_t sequenceNumber, uint64_t address);
       uint64_t find(uint64_t address);
+      void remove(uint32_t slot);
       void clean(uint64_t lowestValidSequenceNumber);
 
    public:
@@ -21,11 +21,6 @@
 #endif
 
 MicroOp::MicroOp()
-#ifdef ENABLE_MICROOP_STRINGS
-   : sourceRegisterNames(MAXIMUM_NUMBER_OF_SOURCE_REGISTERS)
-   , addressRegisterNames(MAXIMUM_NUMBER_OF_ADDRESS_REGISTERS)
-   , destinationRegisterNames(MAXIMUM_NUMBER_OF_DESTINATION_REGISTERS)
-#endif
 {
    this->uop_type = UOP_INVALID;
    this->instructionOpcode = dl::Decoder::DL_OPCODE_INVALID;
@@ -40,6 +35,8 @@ MicroOp::MicroOp()
    this->sourceRegistersLength = 0;
    this->addressRegistersLength = 0;
    this->destinationRegistersLength = 0;
+   this->sourceProducersLength = 0;
+   this->destinationProducersLength = 0;
 
    this->interrupt = false;
    this->serializing = false;
@@ -58,10 +55,13 @@ MicroOp::MicroOp()
       this->destinationRegisters[i] = dl::Decoder::DL_OPCODE_INVALID;
 
 #ifdef ENABLE_MICROOP_STRINGS
-   sourceRegisterNames.clear();
-   sourceRegisterNames.resize(MAXIMUM_NUMBER_OF_SOURCE_REGISTERS);
-   destinationRegisterNames.clear();
-   destinationRegisterNames.resize(MAXIMUM_NUMBER_OF_DESTINATION_REGISTERS);
+   this->instructionOpcodeName = "";
+   for(uint32_t i = 0 ; i < MAXIMUM_NUMBER_OF_SOURCE_REGISTERS; i++)
+      this->sourceRegisterNames[i] = "";
+   for(uint32_t i = 0 ; i < MAXIMUM_NUMBER_OF_ADDRESS_REGISTERS; i++)
+      this->addressRegisterNames[i] = "";
+   for(uint32_t i = 0 ; i < MAXIMUM_NUMBER_OF_DESTINATION_REGISTERS; i++)
+      this->destinationRegisterNames[i] = "";
 #endif
 
 #ifndef NDEBUG
@@ -71,7 +71,7 @@ MicroOp::MicroOp()
 #endif
 }
 
-void MicroOp::makeLoad(uint32_t offset, dl::Decoder::decoder_opcode instructionOpcode, const String& instructionOpcodeName, uint16_t mem_size) {
+void MicroOp::makeLoad(uint32_t offset, dl::Decoder::decoder_opcode instructionOpcode, const char *instructionOpcodeName, uint16_t mem_size) {
    this->uop_type = UOP_LOAD;               
    this->microOpTypeOffset = offset;
    this->memoryAccessSize = mem_size;
@@ -83,7 +83,7 @@ void MicroOp::makeLoad(uint32_t offset, dl::Decoder::decoder_opcode instructionO
    this->setTypes();
 }
 
-void MicroOp::makeExecute(uint32_t offset, uint32_t num_loads, dl::Decoder::decoder_opcode instructionOpcode, const String& instructionOpcodeName, bool isBranch) {
+void MicroOp::makeExecute(uint32_t offset, uint32_t num_loads, dl::Decoder::decoder_opcode instructionOpcode, const char *instructionOpcodeName, bool isBranch) {
    this->uop_type = UOP_EXECUTE;
    this->microOpTypeOffset = offset;
    this->intraInstructionDependencies = num_loads;
@@ -95,7 +95,7 @@ void MicroOp::makeExecute(uint32_t offset, uint32_t num_loads, dl::Decoder::deco
    this->setTypes();
 }
 
-void MicroOp::makeStore(uint32_t offset, uint32_t num_execute, dl::Decoder::decoder_opcode instructionOpcode, const String& instructionOpcodeName, uint16_t mem_size) {
+void MicroOp::makeStore(uint32_t offset, uint32_t num_execute, dl::Decoder::decoder_opcode instructionOpcode, const char *instructionOpcodeName, uint16_t mem_size) {
    this->uop_type = UOP_STORE;
    this->microOpTypeOffset = offset;
    this->memoryAccessSize = mem_size;
@@ -107,7 +107,7 @@ void MicroOp::makeStore(uint32_t offset, uint32_t num_execute, dl::Decoder::deco
    this->setTypes();
 }
 
-void MicroOp::makeDynamic(const String& instructionOpcodeName, uint32_t execLatency) {
+void MicroOp::makeDynamic(const char *instructionOpcodeName, uint32_t execLatency) {
    this->uop_type = UOP_EXECUTE;
    this->microOpTypeOffset = 0;
    this->intraInstructionDependencies = 0;
@@ -222,14 +222,14 @@ dl::Decoder::decoder_reg MicroOp::getSourceRegister(uint32_t index) const {
 }
 
 #ifdef ENABLE_MICROOP_STRINGS
-const String& MicroOp::getSourceRegisterName(uint32_t index) const {
+const char* MicroOp::getSourceRegisterName(uint32_t index) const {
    VERIFY_MICROOP();
    assert(index < this->sourceRegistersLength);
    return this->sourceRegisterNames[index];
 }
 #endif
 
-void MicroOp::addSourceRegister(dl::Decoder::decoder_reg registerId, const String& registerName) {
+void MicroOp::addSourceRegister(dl::Decoder::decoder_reg registerId, const char *registerName) {
    VERIFY_MICROOP();
    assert(sourceRegistersLength < MAXIMUM_NUMBER_OF_SOURCE_REGISTERS);
 // assert(registerId >= 0 && registerId < TOTAL_NUM_REGISTERS);
@@ -238,6 +238,8 @@ void MicroOp::addSourceRegister(dl::Decoder::decoder_reg registerId, const Strin
    sourceRegisterNames[sourceRegistersLength] = registerName;
 #endif
    sourceRegistersLength++;
+
+   addProducer(sourceProducers, sourceProducersLength, registerId);
 }
 
 uint32_t MicroOp::getAddressRegistersLength() const {
@@ -252,14 +254,14 @@ dl::Decoder::decoder_reg MicroOp::getAddressRegister(uint32_t index) const {
 }
 
 #ifdef ENABLE_MICROOP_STRINGS
-const String& MicroOp::getAddressRegisterName(uint32_t index) const {
+const char* MicroOp::getAddressRegisterName(uint32_t index) const {
    VERIFY_MICROOP();
    assert(index < this->addressRegistersLength);
    return this->addressRegisterNames[index];
 }
 #endif
 
-void MicroOp::addAddressRegister(dl::Decoder::decoder_reg registerId, const String& registerName) {
+void MicroOp::addAddressRegister(dl::Decoder::decoder_reg registerId, const char *registerName) {
    VERIFY_MICROOP();
    assert(addressRegistersLength < MAXIMUM_NUMBER_OF_ADDRESS_REGISTERS);
 // assert(registerId >= 0 && registerId < TOTAL_NUM_REGISTERS);
@@ -282,14 +284,14 @@ dl::Decoder::decoder_reg MicroOp::getDestinationRegister(uint32_t index) const {
 }
 
 #ifdef ENABLE_MICROOP_STRINGS
-const String& MicroOp::getDestinationRegisterName(uint32_t index) const {
+const char* MicroOp::getDestinationRegisterName(uint32_t index) const {
    VERIFY_MICROOP();
    assert(index < this->destinationRegistersLength);
    return this->destinationRegisterNames[index];
 }
 #endif
 
-void MicroOp::addDestinationRegister(dl::Decoder::decoder_reg registerId, const String& registerName) {
+void MicroOp::addDestinationRegister(dl::Decoder::decoder_reg registerId, const char *registerName) {
    VERIFY_MICROOP();
    assert(destinationRegistersLength < MAXIMUM_NUMBER_OF_DESTINATION_REGISTERS);
 // assert(registerId >= 0 && registerId < TOTAL_NUM_REGISTERS);
@@ -298,6 +300,17 @@ void MicroOp::addDestinationRegister(dl::Decoder::decoder_reg registerId, const
    destinationRegisterNames[destinationRegistersLength] = registerName;
 #endif
    destinationRegistersLength++;
+
+   addProducer(destinationProducers, destinationProducersLength, registerId);
+}
+
+void MicroOp::addProducer(uint16_t *producers, uint8_t &length, dl::Decoder::decoder_reg registerId) {
+   // Done once per static MicroOp, so the per-instance dependency tracking does not need to go through the decoder
+   LOG_ASSERT_ERROR(registerId < Sim()->getDecoder()->last_reg() && registerId <= UINT16_MAX, "Register %u is invalid", registerId);
+   for(uint32_t i = 0; i < length; ++i)
+      if (producers[i] == registerId)
+         return;
+   producers[length++] = registerId;
 }
 
 String MicroOp::toString() const {
@@ -82,7 +82,8 @@ struct MicroOp
    Instruction* instruction;
 
 #ifdef ENABLE_MICROOP_STRINGS
-   String instructionOpcodeName;
+   // Names point into the decoder's own (static) tables, so storing them does not allocate
+   const char *instructionOpcodeName;
 #endif
 
    /** The typeOffset field contains the offset of the microOp starting from the first microOp with that type. */
@@ -101,10 +102,17 @@ struct MicroOp
    /** This array contains the registers written by this MicroOperation, the integer is an id given by libdisasm64. Only valid for UOP_EXECUTE. */
    dl::Decoder::decoder_reg destinationRegisters[MAXIMUM_NUMBER_OF_DESTINATION_REGISTERS];
 
+   /** Register dependency template used by RegisterDependencies: the registers above, checked against the decoder's
+       register range when they are added, with duplicates removed. */
+   uint8_t sourceProducersLength;
+   uint8_t destinationProducersLength;
+   uint16_t sourceProducers[MAXIMUM_NUMBER_OF_SOURCE_REGISTERS];
+   uint16_t destinationProducers[MAXIMUM_NUMBER_OF_DESTINATION_REGISTERS];
+
 #ifdef ENABLE_MICROOP_STRINGS
-   std::vector<String> sourceRegisterNames;
-   std::vector<String> addressRegisterNames;
-   std::vector<String> destinationRegisterNames;
+   const char *sourceRegisterNames[MAXIMUM_NUMBER_OF_SOURCE_REGISTERS];
+   const char *addressRegisterNames[MAXIMUM_NUMBER_OF_ADDRESS_REGISTERS];
+   const char *destinationRegisterNames[MAXIMUM_NUMBER_OF_DESTINATION_REGISTERS];
 #endif
 
    /** The instruction pointer. */
@@ -128,10 +136,10 @@ struct MicroOp
    uint16_t operand_size;
    uint16_t memoryAccessSize;
 
-   void makeLoad(uint32_t offset, dl::Decoder::decoder_opcode instructionOpcode, const String& instructionOpcodeName, uint16_t mem_size);
-   void makeExecute(uint32_t offset, uint32_t num_loads, dl::Decoder::decoder_opcode instructionOpcode, const String& instructionOpcodeName, bool isBranch);
-   void makeStore(uint32_t offset, uint32_t num_execute, dl::Decoder::decoder_opcode instructionOpcode, const String& instructionOpcodeName, uint16_t mem_size);
-   void makeDynamic(const String& instructionOpcodeName, uint32_t execLatency);
+   void makeLoad(uint32_t offset, dl::Decoder::decoder_opcode instructionOpcode, const char *instructionOpcodeName, uint16_t mem_size);
+   void makeExecute(uint32_t offset, uint32_t num_loads, dl::Decoder::decoder_opcode instructionOpcode, const char *instructionOpcodeName, bool isBranch);
+   void makeStore(uint32_t offset, uint32_t num_execute, dl::Decoder::decoder_opcode instructionOpcode, const char *instructionOpcodeName, uint16_t mem_size);
+   void makeDynamic(const char *instructionOpcodeName, uint32_t execLatency);
 
    static uop_subtype_t getSubtype_Exec(const MicroOp& uop);
    static uop_subtype_t getSubtype(const MicroOp& uop);
@@ -163,22 +171,29 @@ struct MicroOp
 
    void verify() const;
 
+   static void addProducer(uint16_t *producers, uint8_t &length, dl::Decoder::decoder_reg registerId);
+
    uint32_t getSourceRegistersLength() const;
    dl::Decoder::decoder_reg getSourceRegister(uint32_t index) const;
-   void addSourceRegister(dl::Decoder::decoder_reg registerId, const String& registerName);
+   void addSourceRegister(dl::Decoder::decoder_reg registerId, const char *registerName);
 
    uint32_t getAddressRegistersLength() const;
    dl::Decoder::decoder_reg getAddressRegister(uint32_t index) const;
-   void addAddressRegister(dl::Decoder::decoder_reg registerId, const String& registerName);
+   void addAddressRegister(dl::Decoder::decoder_reg registerId, const char *registerName);
 
    uint32_t getDestinationRegistersLength() const;
    dl::Decoder::decoder_reg getDestinationRegister(uint32_t index) const;
-   void addDestinationRegister(dl::Decoder::decoder_reg registerId, const String& registerName);
+   void addDestinationRegister(dl::Decoder::decoder_reg registerId, const char *registerName);
+
+   uint32_t getSourceProducersLength() const { return sourceProducersLength; }
+   const uint16_t* getSourceProducers() const { return sourceProducers; }
+   uint32_t getDestinationProducersLength() const { return destinationProducersLength; }
+   const uint16_t* getDestinationProducers() const { return destinationProducers; }
 
 #ifdef ENABLE_MICROOP_STRINGS
-   const String& getSourceRegisterName(uint32_t index) const;
-   const String& getAddressRegisterName(uint32_t index) const;
-   const String& getDestinationRegisterName(uint32_t index) const;
+   const char* getSourceRegisterName(uint32_t index) const;
+   const char* getAddressRegisterName(uint32_t index) const;
+   const char* getDestinationRegisterName(uint32_t index) const;
 #endif
 
    const Memory::Access& getInstructionPointer() const { return this->instructionPointer; }
@@ -212,7 +227,7 @@ struct MicroOp
    uop_type_t getType() const { return uop_type; }
 
 #ifdef ENABLE_MICROOP_STRINGS
-   const String& getInstructionOpcodeName() { return instructionOpcodeName; }
+   const char* getInstructionOpcodeName() const { return instructionOpcodeName; }
 #endif
 };
 
@@ -0,0 +1,34 @@
+#include "micro_op_arena.h"
+#include "micro_op.h"
+#include "log.h"
+
+MicroOpArena::MicroOpArena()
+   : m_chunk(NULL)
+   , m_used(CHUNK_SIZE)
+{
+}
+
+MicroOpArena::~MicroOpArena()
+{
+   for(std::vector<MicroOp*>::iterator it = m_chunks.begin(); it != m_chunks.end(); ++it)
+      delete [] *it;
+}
+
+MicroOp* MicroOpArena::alloc(UInt32 count)
+{
+   LOG_ASSERT_ERROR(count <= CHUNK_SIZE, "Cannot allocate %u MicroOps at once", count);
+
+   ScopedLock sl(m_lock);
+
+   // The tail of a chunk too small for this instruction is left unused
+   if (m_used + count > CHUNK_SIZE)
+   {
+      m_chunk = new MicroOp[CHUNK_SIZE];
+      m_chunks.push_back(m_chunk);
+      m_used = 0;
+   }
+
+   MicroOp *uops = m_chunk + m_used;
+   m_used += count;
+   return uops;
+}
@@ -0,0 +1,31 @@
+#ifndef __MICRO_OP_ARENA_H
+#define __MICRO_OP_ARENA_H
+
+#include "fixed_types.h"
+#include "lock.h"
+
+#include <vector>
+
+struct MicroOp;
+
+// Owns the static MicroOps of all instructions decoded for a code cache. The MicroOps of one instruction
+// are handed out as a single contiguous run, carved from large chunks, and only freed when the arena goes away.
+class MicroOpArena
+{
+   public:
+      MicroOpArena();
+      ~MicroOpArena();
+
+      // Thread-safe, returns count default-constructed MicroOps
+      MicroOp* alloc(UInt32 count);
+
+   private:
+      static const UInt32 CHUNK_SIZE = 1024;
+
+      Lock m_lock;
+      MicroOp *m_chunk;
+      UInt32 m_used;
+      std::vector<MicroOp*> m_chunks;
+};
+
+#endif // __MICRO_OP_ARENA_H
@@ -9,34 +9,23 @@ RegisterDependencies::RegisterDependencies():
 
 void RegisterDependencies::setDependencies(DynamicMicroOp& microOp, uint64_t lowestValidSequenceNumber)
 {
-   // Create the dependencies for the microOp
-   for(uint32_t i = 0; i < microOp.getMicroOp()->getSourceRegistersLength(); i++)
+   // The MicroOp's register lists were validated and deduplicated at decode time
+   const MicroOp *uop = microOp.getMicroOp();
+
+   // Create the dependencies for the microOp. Producers that have left the window are simply left in place:
+   // lowestValidSequenceNumber only grows, so they will keep failing this check until they are overwritten.
+   const uint16_t *sources = uop->getSourceProducers();
+   for(uint32_t i = 0; i < uop->getSourceProducersLength(); i++)
    {
-      dl::Decoder::decoder_reg sourceRegister = microOp.getMicroOp()->getSourceRegister(i);
-      uint32_t mappedRegister = Sim()->getDecoder()->map_register(sourceRegister);
-
-      uint64_t producerSequenceNumber;
-      LOG_ASSERT_ERROR(sourceRegister < Sim()->getDecoder()->last_reg(), "Source register src[%u]=%u is invalid", i, sourceRegister);
-      if ((producerSequenceNumber = producers[sourceRegister]) != INVALID_SEQNR)
-      {
-         if (producerSequenceNumber >= lowestValidSequenceNumber)
-         {
-            microOp.addDependency(producerSequenceNumber);
-         }
-         else
-         {
-            producers[mappedRegister] = INVALID_SEQNR;
-         }
-      }
+      uint64_t producerSequenceNumber = producers[sources[i]];
+      if (producerSequenceNumber != INVALID_SEQNR && producerSequenceNumber >= lowestValidSequenceNumber)
+         microOp.addDependency(producerSequenceNumber);
    }
 
    // Update the producers
-   for(uint32_t i = 0; i < microOp.getMicroOp()->getDestinationRegistersLength(); i++)
-   {
-      uint32_t destinationRegister = microOp.getMicroOp()->getDestinationRegister(i);
-      LOG_ASSERT_ERROR(destinationRegister < Sim()->getDecoder()->last_reg(), "Destination register dst[%u] = %u is invalid", i, destinationRegister);
-      producers[destinationRegister] = microOp.getSequenceNumber();
-   }
+   const uint16_t *destinations = uop->getDestinationProducers();
+   for(uint32_t i = 0; i < uop->getDestinationProducersLength(); i++)
+      producers[destinations[i]] = microOp.getSequenceNumber();
 
 }
 
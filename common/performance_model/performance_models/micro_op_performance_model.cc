@@ -31,6 +31,7 @@ MicroOpPerformanceModel::MicroOpPerformanceModel(Core *core, bool issue_memops)
    registerStatsMetric("performance_model", core->getId(), "dyninsn_count", &m_dyninsn_count);
    registerStatsMetric("performance_model", core->getId(), "dyninsn_cost", &m_dyninsn_cost);
    registerStatsMetric("performance_model", core->getId(), "dyninsn_zero_count", &m_dyninsn_zero_count);
+   Sim()->getStatsManager()->registerMetric(new StatsMetricCallback("performance_model", core->getId(), "uop_allocations", __getAllocations, (UInt64)m_allocator));
 #if DEBUG_DYN_INSN_LOG
    String filename;
    filename = "sim.dyninsn_log." + itostr(core->getId());
@@ -165,12 +166,10 @@ void MicroOpPerformanceModel::handleInstruction(DynamicInstruction *dynins)
    UInt64 num_writes_done = 0;
    UInt64 num_nonmem_done = 0;
 
-   if (dynins->instruction->getMicroOps())
+   const MicroOp *uops = dynins->instruction->getMicroOps();
+   for(UInt32 i = 0; i < dynins->instruction->getNumMicroOps(); ++i)
    {
-      for(std::vector<const MicroOp*>::const_iterator it = dynins->instruction->getMicroOps()->begin(); it != dynins->instruction->getMicroOps()->end(); it++)
-      {
-         m_current_uops.push_back(m_core_model->createDynamicMicroOp(m_allocator, *it, insn_period));
-      }
+      m_current_uops.push_back(m_core_model->createDynamicMicroOp(m_allocator, &uops[i], insn_period));
    }
 
    // Find some information
@@ -398,7 +397,7 @@ void MicroOpPerformanceModel::handleInstruction(DynamicInstruction *dynins)
       if (exec_base_index != SIZE_MAX) {
          fprintf(m_insn_log, "X");
 #ifdef ENABLE_MICROOP_STRINGS
-         fprintf(m_insn_log, "-%s", m_current_uops[exec_base_index].getInstructionOpcodeName().c_str());
+         fprintf(m_insn_log, "-%s", m_current_uops[exec_base_index].getInstructionOpcodeName());
 #endif
       }
       fprintf(m_insn_log, "approx cost = %llu\n", (long long unsigned int)insn_cost);
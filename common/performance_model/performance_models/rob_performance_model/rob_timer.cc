@@ -60,6 +60,9 @@ RobTimer::RobTimer(
       , perf(_perf)
       , m_cpiCurrentFrontEndStall(NULL)
       , m_mlp_histogram(Sim()->getCfg()->getBoolArray("perf_model/core/rob_timer/mlp_histogram", core->getId()))
+      , m_first_waiting(0)
+      , m_first_executing(0)
+      , m_outstanding_loads_total(0)
 {
 
    registerStatsMetric("rob_timer", core->getId(), "time_skipped", &time_skipped);
@@ -165,6 +168,8 @@ RobTimer::RobTimer(
       }
 
       m_outstandingLoadsAll.resize(MAX_OUTSTANDING, SubsecondTime::Zero());
+      for(unsigned int h = 0; h < HitWhere::NUM_HITWHERES; ++h)
+         m_outstanding_loads_count[h] = 0;
       for(unsigned int i = 0; i < MAX_OUTSTANDING; ++i)
       {
          String name = String("outstandingLoadsAll") + "[" + itostr(i) + "]";
@@ -251,6 +256,34 @@ RobTimer::RobEntry *RobTimer::findEntryBySequenceNumber(UInt64 sequenceNumber)
    return entry;
 }
 
+RobTimer::RobEntry *RobTimer::findFirstWaiting()
+{
+   // Uops never become un-issued, so m_first_waiting only moves forward
+   if (m_num_in_rob == 0)
+      return NULL;
+   UInt64 first = rob[0].uop->getSequenceNumber();
+   if (m_first_waiting < first)
+      m_first_waiting = first;
+   for(uint64_t i = m_first_waiting - first; i < m_num_in_rob; ++i, ++m_first_waiting)
+      if (rob[i].done == SubsecondTime::MaxTime())
+         return &rob[i];
+   return NULL;
+}
+
+bool RobTimer::isDispatched(const RobEntry *entry)
+{
+   return m_num_in_rob > 0 && entry->uop->getSequenceNumber() - rob[0].uop->getSequenceNumber() < m_num_in_rob;
+}
+
+void RobTimer::setReady(RobEntry *entry)
+{
+   // Called once for each dispatched uop, when both its ready time is known and it has been dispatched
+   if (entry->ready <= now)
+      m_ready_uops.push(entry->uop->getSequenceNumber());
+   else
+      m_waiting_uops.push(RobEvent(entry->ready, entry->uop->getSequenceNumber()));
+}
+
 boost::tuple<uint64_t,SubsecondTime> RobTimer::simulate(const std::vector<DynamicMicroOp*>& insts)
 {
    uint64_t totalInsnExec = 0;
@@ -420,13 +453,30 @@ void RobTimer::synchronize(SubsecondTime time)
    // NOTE: depending on how far we jumped ahead (usually a considerable amount),
    //       we may want to flush the ROB and reset other queues
    //printf("RobTimer::synchronize(%lu) %+ld\n", time, (int64_t)time-now);
+   if (time < now)
+   {
+      // Uops that were ready may not be anymore
+      while (!m_ready_uops.empty())
+      {
+         RobEntry *entry = findEntryBySequenceNumber(m_ready_uops.top());
+         m_waiting_uops.push(RobEvent(entry->ready, entry->uop->getSequenceNumber()));
+         m_ready_uops.pop();
+      }
+      m_first_executing = 0;
+   }
    now.setElapsedTime(time);
 }
 
 SubsecondTime* RobTimer::findCpiComponent()
 {
    // Determine the CPI component corresponding to the first non-committed instruction
-   for(uint64_t i = 0; i < m_num_in_rob; ++i)
+   if (m_num_in_rob == 0)
+      return NULL;
+   // Completed instructions stay completed as time moves forward, start from where we left off last cycle
+   UInt64 first = rob[0].uop->getSequenceNumber();
+   if (m_first_executing < first)
+      m_first_executing = first;
+   for(uint64_t i = m_first_executing - first; i < m_num_in_rob; ++i, ++m_first_executing)
    {
       RobEntry *entry = &rob.at(i);
       DynamicMicroOp *uop = entry->uop;
@@ -451,6 +501,7 @@ SubsecondTime RobTimer::doDispatch(SubsecondTime **cpiComponent)
 {
    SubsecondTime next_event = SubsecondTime::MaxTime();
    SubsecondTime *cpiFrontEnd = NULL;
+   bool icache_miss_returned = false;
 
    if (frontend_stalled_until <= now)
    {
@@ -483,6 +534,7 @@ SubsecondTime RobTimer::doDispatch(SubsecondTime **cpiComponent)
                   std::cout<<"-- icache return"<<std::endl;
                #endif
                in_icache_miss = false;
+               icache_miss_returned = true;
             }
             else
             {
@@ -514,6 +566,10 @@ SubsecondTime RobTimer::doDispatch(SubsecondTime **cpiComponent)
          // If uop is already ready, we may need to issue it in the following cycle
          entry->ready = std::max(entry->ready, (now + 1ul).getElapsedTime());
          next_event = std::min(next_event, entry->ready);
+         if (entry->ready != SubsecondTime::MaxTime())
+            setReady(entry);
+         if (uop.getMicroOp()->isStore())
+            m_waiting_stores.push_back(uop.getSequenceNumber());
 
          #ifdef DEBUG_PERCYCLE
             std::cout<<"DISPATCH "<<entry->uop->getMicroOp()->toShortString()<<std::endl;
@@ -570,15 +626,17 @@ SubsecondTime RobTimer::doDispatch(SubsecondTime **cpiComponent)
    }
 
 
-   if (m_num_in_rob == windowSize)
-      return next_event; // front-end is effectively stalled so wait for another event
+   if (m_num_in_rob == windowSize || (cpiFrontEnd == &m_cpiRSFull && !icache_miss_returned))
+      // front-end is effectively stalled so wait for another event (an issue or commit making room),
+      // but do wake up when a front-end stall ends as that changes the CPI component.
+      // (An I-cache miss that returned but could not be dispatched restarts next cycle, so don't skip that one.)
+      return frontend_stalled_until > now ? std::min(frontend_stalled_until, next_event) : next_event;
    else
       return std::min(frontend_stalled_until, next_event);
 }
 
-void RobTimer::issueInstruction(uint64_t idx, SubsecondTime &next_event)
+void RobTimer::issueInstruction(RobEntry *entry)
 {
-   RobEntry *entry = &rob[idx];
    DynamicMicroOp &uop = *entry->uop;
 
    if ((uop.getMicroOp()->isLoad() || uop.getMicroOp()->isStore())
@@ -641,7 +699,18 @@ void RobTimer::issueInstruction(uint64_t idx, SubsecondTime &next_event)
    entry->issued = now;
    entry->done = cycle_done;
 
-   next_event = std::min(next_event, entry->done);
+   m_issued_uops.push(RobEvent(entry->done, uop.getSequenceNumber()));
+   if (uop.getMicroOp()->isStore())
+   {
+      LOG_ASSERT_ERROR(m_waiting_stores.front() == uop.getSequenceNumber(), "Store %ld issued out of order", uop.getSequenceNumber());
+      m_waiting_stores.pop_front();
+   }
+   if (m_mlp_histogram && uop.getMicroOp()->isLoad())
+   {
+      m_outstanding_loads.push(RobEvent(entry->done, uop.getDCacheHitWhere()));
+      ++m_outstanding_loads_count[uop.getDCacheHitWhere()];
+      ++m_outstanding_loads_total;
+   }
 
    --m_rs_entries_used;
 
@@ -663,6 +732,8 @@ void RobTimer::issueInstruction(uint64_t idx, SubsecondTime &next_event)
       {
          depEntry->ready = depEntry->readyMax;
          //std::cout<<"    ready @ "<<depEntry->ready<<std::endl;
+         if (isDispatched(depEntry))
+            setReady(depEntry);
       }
 
       // For stores, check if their address has been produced
@@ -709,36 +780,58 @@ void RobTimer::issueInstruction(uint64_t idx, SubsecondTime &next_event)
 
 SubsecondTime RobTimer::doIssue()
 {
+   // Visit ready uops in program order, which is the order a walk over the ROB would find them in.
+   // Uops that are not ready can never issue, and only influence the walk in ways that can be
+   // answered without visiting them: they make later uops not be at the head of the queue
+   // (findFirstWaiting()), stores among them block loads (m_waiting_stores), and in-order cores stop at them.
    uint64_t num_issued = 0;
-   SubsecondTime next_event = SubsecondTime::MaxTime();
-   bool head_of_queue = true, no_more_load = false, no_more_store = false, have_unresolved_store = false;
+   bool no_more_load = false, no_more_store = false, have_unresolved_store = false, port_blocked = false;
+   uint64_t stores_checked = 0;
+   SubsecondTime unresolved_store_ready = SubsecondTime::MaxTime();
+   SubsecondTime blocked_until = SubsecondTime::MaxTime(); // When a resource that blocked a ready uop frees up
 
    if (m_rob_contention)
       m_rob_contention->initCycle(now);
 
-   for(uint64_t i = 0; i < m_num_in_rob; ++i)
+   while(!m_waiting_uops.empty() && m_waiting_uops.top().time <= now)
    {
-      RobEntry *entry = &rob.at(i);
+      m_ready_uops.push(m_waiting_uops.top().value);
+      m_waiting_uops.pop();
+   }
+
+   while(!m_ready_uops.empty())
+   {
+      RobEntry *entry = findEntryBySequenceNumber(m_ready_uops.top());
       DynamicMicroOp *uop = entry->uop;
 
+      bool head_of_queue = (entry == findFirstWaiting());
+      if (inorder && !head_of_queue)
+         break;                     // In-order: an older uop could not be issued
 
-      if (entry->done != SubsecondTime::MaxTime())
+      m_ready_uops.pop();
+
+      if (uop->getMicroOp()->isLoad() && m_no_address_disambiguation)
       {
-         next_event = std::min(next_event, entry->done);
-         continue;                     // already done
+         // Look for an older store with unknown address. Stores only issue from the head of the queue,
+         // so the ones already checked this cycle are still waiting.
+         while(!have_unresolved_store && stores_checked < m_waiting_stores.size() && m_waiting_stores[stores_checked] < uop->getSequenceNumber())
+         {
+            RobEntry *store = findEntryBySequenceNumber(m_waiting_stores[stores_checked]);
+            if (store->addressReady > now)
+            {
+               have_unresolved_store = true;
+               unresolved_store_ready = store->addressReady;
+            }
+            ++stores_checked;
+         }
       }
 
-      next_event = std::min(next_event, entry->ready);
-
 
       // See if we can issue this instruction
 
       bool canIssue = false;
 
-      if (entry->ready > now)
-         canIssue = false;          // blocked by dependency
-
-      else if ((no_more_load && uop->getMicroOp()->isLoad()) || (no_more_store && uop->getMicroOp()->isStore()))
+      if ((no_more_load && uop->getMicroOp()->isLoad()) || (no_more_store && uop->getMicroOp()->isStore()))
          canIssue = false;          // blocked by mfence
 
       else if (uop->getMicroOp()->isSerializing())
@@ -746,7 +839,12 @@ SubsecondTime RobTimer::doIssue()
          if (head_of_queue && last_store_done <= now)
             canIssue = true;
          else
+         {
+            if (head_of_queue)
+               blocked_until = std::min(blocked_until, last_store_done);
+            m_ready_not_issued.push_back(uop->getSequenceNumber());
             break;
+         }
       }
 
       else if (uop->getMicroOp()->isMemBarrier())
@@ -754,22 +852,36 @@ SubsecondTime RobTimer::doIssue()
          if (head_of_queue && last_store_done <= now)
             canIssue = true;
          else
+         {
             // Don't issue any memory operations following a memory barrier
             no_more_load = no_more_store = true;
             // FIXME: L/SFENCE
+            if (head_of_queue)
+               blocked_until = std::min(blocked_until, last_store_done);
+         }
       }
 
       else if (!m_rob_contention && num_issued == dispatchWidth)
          canIssue = false;          // no issue contention: issue width == dispatch width
 
       else if (uop->getMicroOp()->isLoad() && !load_queue.hasFreeSlot(now))
+      {
          canIssue = false;          // load queue full
+         blocked_until = std::min(blocked_until, load_queue.getStartTime(now));
+      }
 
       else if (uop->getMicroOp()->isLoad() && m_no_address_disambiguation && have_unresolved_store)
+      {
          canIssue = false;          // preceding store with unknown address
+         blocked_until = std::min(blocked_until, unresolved_store_ready);
+      }
 
       else if (uop->getMicroOp()->isStore() && (!head_of_queue || !store_queue.hasFreeSlot(now)))
+      {
          canIssue = false;          // store queue full
+         if (head_of_queue)
+            blocked_until = std::min(blocked_until, store_queue.getStartTime(now));
+      }
 
       else
          canIssue = true;           // issue!
@@ -777,13 +889,16 @@ SubsecondTime RobTimer::doIssue()
 
       // canIssue already marks issue ports as in use, so do this one last
       if (canIssue && m_rob_contention && ! m_rob_contention->tryIssue(*uop))
+      {
          canIssue = false;          // blocked by structural hazard
+         port_blocked = true;
+      }
 
 
       if (canIssue)
       {
          num_issued++;
-         issueInstruction(i, next_event);
+         issueInstruction(entry);
 
          // Calculate memory-level parallelism (MLP) for long-latency loads (but ignore overlapped misses)
          if (uop->getMicroOp()->isLoad() && uop->isLongLatencyLoad() && uop->getDCacheHitWhere() != HitWhere::L1_OWN)
@@ -815,10 +930,7 @@ SubsecondTime RobTimer::doIssue()
       }
       else
       {
-         head_of_queue = false;     // Subsequent instructions are not at the head of the ROB
-
-         if (uop->getMicroOp()->isStore() && entry->addressReady > now)
-            have_unresolved_store = true;
+         m_ready_not_issued.push_back(uop->getSequenceNumber());
 
          if (inorder)
             // In-order: only issue from head of the ROB
@@ -838,6 +950,33 @@ SubsecondTime RobTimer::doIssue()
       }
    }
 
+   for(std::vector<UInt64>::iterator it = m_ready_not_issued.begin(); it != m_ready_not_issued.end(); ++it)
+      m_ready_uops.push(*it);
+   m_ready_not_issued.clear();
+
+   if (num_issued > 0 || port_blocked)
+      return now;                   // Issuing changes what can happen next cycle, and the contention models don't tell when ports free up
+
+   // Nothing issued, and nothing will until a uop becomes ready, a resource blocking a ready uop frees up,
+   // or an issued uop completes (which can make it commit or change the CPI component)
+   SubsecondTime next_event = blocked_until;
+
+   UInt64 first = m_num_in_rob ? rob[0].uop->getSequenceNumber() : nextSequenceNumber;
+   while(!m_issued_uops.empty() && (m_issued_uops.top().time < now || m_issued_uops.top().value < first))
+      m_issued_uops.pop();          // Already completed or committed
+   if (!m_issued_uops.empty())
+      next_event = std::min(next_event, m_issued_uops.top().time);
+
+   if (inorder)
+   {
+      // In-order cores only look at the oldest waiting uop
+      RobEntry *entry = findFirstWaiting();
+      if (entry)
+         next_event = std::min(next_event, entry->ready);
+   }
+   else if (!m_waiting_uops.empty())
+      next_event = std::min(next_event, m_waiting_uops.top().time);
+
    return next_event;
 }
 
@@ -878,7 +1017,9 @@ SubsecondTime RobTimer::doCommit(uint64_t& instructionsExecuted)
          break;
    }
 
-   if (rob.size())
+   if (num_committed > 0)
+      return now;                   // The ROB has room again, dispatch may continue next cycle
+   else if (rob.size())
       return rob.front().done;
    else
       return SubsecondTime::MaxTime();
@@ -931,6 +1072,10 @@ void RobTimer::execute(uint64_t& instructionsExecuted, SubsecondTime& latency)
       std::cout<<"Next event: D("<<SubsecondTime::divideRounded(next_dispatch, now.getPeriod())<<") I("<<SubsecondTime::divideRounded(next_issue, now.getPeriod())<<") C("<<SubsecondTime::divideRounded(next_commit, now.getPeriod())<<")"<<std::endl;
    #endif
    SubsecondTime next_event = std::min(next_dispatch, std::min(next_issue, next_commit));
+   // Once the front-end is free to dispatch but we're out of instructions, we'll hand back to simulate() for more.
+   // Don't skip past that cycle, the time until then belongs to the current instructions, the time after it to the next ones.
+   if (rob.size() < m_num_in_rob + 2*dispatchWidth)
+      next_event = std::min(next_event, std::max(frontend_stalled_until, (now + 1ul).getElapsedTime()));
    SubsecondTime skip;
    if (next_event != SubsecondTime::MaxTime() && next_event > now + 1ul)
    {
@@ -967,23 +1112,19 @@ void RobTimer::execute(uint64_t& instructionsExecuted, SubsecondTime& latency)
 
 void RobTimer::countOutstandingMemop(SubsecondTime time)
 {
-   UInt64 counts[HitWhere::NUM_HITWHERES] = {0}, total = 0;
-
-   for(unsigned int i = 0; i < m_num_in_rob; ++i)
+   // Loads are outstanding from issue until done
+   while(!m_outstanding_loads.empty() && m_outstanding_loads.top().time <= now)
    {
-      RobEntry *e = &rob.at(i);
-      if (e->done != SubsecondTime::MaxTime() && e->done > now && e->uop->getMicroOp()->isLoad())
-      {
-         ++counts[e->uop->getDCacheHitWhere()];
-         ++total;
-      }
+      --m_outstanding_loads_count[m_outstanding_loads.top().value];
+      --m_outstanding_loads_total;
+      m_outstanding_loads.pop();
    }
 
    for(unsigned int h = 0; h < HitWhere::NUM_HITWHERES; ++h)
-      if (counts[h] > 0)
-         m_outstandingLoads[h][counts[h] >= MAX_OUTSTANDING ? MAX_OUTSTANDING-1 : counts[h]] += time;
-   if (total > 0)
-      m_outstandingLoadsAll[total >= MAX_OUTSTANDING ? MAX_OUTSTANDING-1 : total] += time;
+      if (m_outstanding_loads_count[h] > 0)
+         m_outstandingLoads[h][m_outstanding_loads_count[h] >= MAX_OUTSTANDING ? MAX_OUTSTANDING-1 : m_outstanding_loads_count[h]] += time;
+   if (m_outstanding_loads_total > 0)
+      m_outstandingLoadsAll[m_outstanding_loads_total >= MAX_OUTSTANDING ? MAX_OUTSTANDING-1 : m_outstanding_loads_total] += time;
 }
 
 void RobTimer::printRob()
@@ -10,6 +10,7 @@
 #include "stats.h"
 
 #include <deque>
+#include <queue>
 
 class RobTimer
 {
@@ -135,7 +136,33 @@ private:
    std::vector<std::vector<SubsecondTime> > m_outstandingLoads;
    std::vector<SubsecondTime> m_outstandingLoadsAll;
 
+   // Event-driven issue: rather than walking the whole ROB each cycle, doIssue() only visits
+   // uops that are ready, and next-event times come from heaps instead of from a scan
+   struct RobEvent
+   {
+      SubsecondTime time;
+      UInt64 value;  // Sequence number, or HitWhere for m_outstanding_loads
+      RobEvent(SubsecondTime _time, UInt64 _value) : time(_time), value(_value) {}
+      bool operator>(const RobEvent &other) const { return time > other.time; }
+   };
+   typedef std::priority_queue<RobEvent, std::vector<RobEvent>, std::greater<RobEvent> > RobEventQueue;
+   typedef std::priority_queue<UInt64, std::vector<UInt64>, std::greater<UInt64> > SequenceNumberQueue;
+
+   RobEventQueue m_waiting_uops;            // Dispatched uops with all dependencies resolved, by ready time
+   SequenceNumberQueue m_ready_uops;        // Dispatched uops with ready <= now, in program order
+   std::vector<UInt64> m_ready_not_issued;  // Ready uops that could not issue this cycle
+   RobEventQueue m_issued_uops;             // Issued uops by completion time (may include already committed ones)
+   std::deque<UInt64> m_waiting_stores;     // Dispatched stores that have not yet issued, these issue in program order
+   UInt64 m_first_waiting;                  // No dispatched uop older than this is waiting to be issued
+   UInt64 m_first_executing;                // No uop older than this has done >= now
+   RobEventQueue m_outstanding_loads;       // Issued loads by completion time, for the MLP histogram
+   UInt64 m_outstanding_loads_count[HitWhere::NUM_HITWHERES];
+   UInt64 m_outstanding_loads_total;
+
    RobEntry *findEntryBySequenceNumber(UInt64 sequenceNumber);
+   RobEntry *findFirstWaiting();
+   bool isDispatched(const RobEntry *entry);
+   void setReady(RobEntry *entry);
    SubsecondTime* findCpiComponent();
    void countOutstandingMemop(SubsecondTime time);
    void printRob();
@@ -145,7 +172,7 @@ private:
    SubsecondTime doIssue();
    SubsecondTime doCommit(uint64_t& instructionsExecuted);
 
-   void issueInstruction(uint64_t idx, SubsecondTime &next_event);
+   void issueInstruction(RobEntry *entry);
 
 public:
 
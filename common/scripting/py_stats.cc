@@ -100,6 +100,51 @@ writeStats(PyObject *self, PyObject *args)
 }
 
 
+//////////
+// delete(): remove a previously written set of statistics
+//////////
+
+static PyObject *
+deleteStats(PyObject *self, PyObject *args)
+{
+   const char *prefix = NULL;
+
+   if (!PyArg_ParseTuple(args, "s", &prefix))
+      return NULL;
+
+   Sim()->getStatsManager()->deleteStats(prefix);
+
+   Py_RETURN_NONE;
+}
+
+
+//////////
+// periodic(): retrieve the values of a statistic in the periodic snapshots kept in memory
+//////////
+
+static PyObject *
+getPeriodicStats(PyObject *self, PyObject *args)
+{
+   const char *objectName = NULL, *metricName = NULL;
+   long int index = -1;
+
+   if (!PyArg_ParseTuple(args, "sls", &objectName, &index, &metricName))
+      return NULL;
+
+   std::vector<std::pair<SubsecondTime, UInt64> > series;
+   if (!Sim()->getStatsManager()->getPeriodicStats(objectName, index, metricName, series)) {
+      PyErr_SetString(PyExc_ValueError, "Stats metric not found");
+      return NULL;
+   }
+
+   PyObject *result = PyList_New(series.size());
+   for(size_t i = 0; i < series.size(); ++i)
+      PyList_SET_ITEM(result, i, Py_BuildValue("(KK)", series[i].first.getFS(), series[i].second));
+
+   return result;
+}
+
+
 //////////
 // register(): register a callback function that returns a statistics value
 //////////
@@ -208,6 +253,8 @@ static PyMethodDef PyStatsMethods[] = {
    {"get",  getStatsValue, METH_VARARGS, "Retrieve current value of statistic (objectName, index, metricName)."},
    {"getter", getStatsGetter, METH_VARARGS, "Return object to retrieve statistics value."},
    {"write", writeStats, METH_VARARGS, "Write statistics (<prefix>, [<filename>])."},
+   {"delete", deleteStats, METH_VARARGS, "Delete statistics previously written with write(<prefix>)."},
+   {"periodic", getPeriodicStats, METH_VARARGS, "Retrieve [(time, value), ...] of a statistic (objectName, index, metricName) from the periodic snapshots kept in memory."},
    {"register", registerStats, METH_VARARGS, "Register callback that defines statistics value for (objectName, index, metricName)."},
    {"register_per_thread", registerPerThread, METH_VARARGS, "Add a per-thread statistic (perthreadName) based on a named statistic (objectName, metricName)."},
    {"marker", writeMarker, METH_VARARGS, "Record a marker (coreid, threadid, arg0, arg1, [description])."},
@@ -33,26 +33,47 @@ static_assert(HookType::HOOK_TYPES_MAX == sizeof(HookType::hook_type_names) / si
 
 HooksManager::HooksManager()
 {
+   for(unsigned int type = 0; type < HookType::HOOK_TYPES_MAX; ++type)
+      m_registry[type] = NULL;
+}
+
+HooksManager::~HooksManager()
+{
+   for(unsigned int type = 0; type < HookType::HOOK_TYPES_MAX; ++type)
+      delete m_registry[type];
+   for(std::vector<const HookList*>::iterator it = m_retired.begin(); it != m_retired.end(); ++it)
+      delete *it;
 }
 
 void HooksManager::registerHook(HookType::hook_type_t type, HookCallbackFunc func, UInt64 argument, HookCallbackOrder order)
 {
-   m_registry[type].push_back(HookCallback(func, argument, order));
+   ScopedLock sl(m_lock);
+
+   const HookList *old_hooks = m_registry[type];
+   HookList *hooks = old_hooks ? new HookList(*old_hooks) : new HookList();
+
+   // Insert after all callbacks of the same order, these are called in order of registration
+   HookList::iterator it = hooks->begin();
+   while(it != hooks->end() && it->order <= order)
+      ++it;
+   hooks->insert(it, HookCallback(func, argument, order));
+
+   __atomic_store_n(&m_registry[type], hooks, __ATOMIC_RELEASE);
+   if (old_hooks)
+      m_retired.push_back(old_hooks);
 }
 
 SInt64 HooksManager::callHooks(HookType::hook_type_t type, UInt64 arg, bool expect_return)
 {
-   for(unsigned int order = 0; order < NUM_HOOK_ORDER; ++order)
+   const HookList *hooks = __atomic_load_n(&m_registry[type], __ATOMIC_ACQUIRE);
+   if (!hooks)
+      return -1;
+
+   for(HookList::const_iterator it = hooks->begin(); it != hooks->end(); ++it)
    {
-      for(std::vector<HookCallback>::iterator it = m_registry[type].begin(); it != m_registry[type].end(); ++it)
-      {
-         if (it->order == (HookCallbackOrder)order)
-         {
-            SInt64 result = it->func(it->arg, arg);
-            if (expect_return && result != -1)
-               return result;
-         }
-      }
+      SInt64 result = it->func(it->arg, arg);
+      if (expect_return && result != -1)
+         return result;
    }
 
    return -1;
@@ -4,6 +4,7 @@
 #include "fixed_types.h"
 #include "subsecond_time.h"
 #include "thread_manager.h"
+#include "lock.h"
 
 #include <vector>
 #include <unordered_map>
@@ -95,13 +96,23 @@ public:
    } ThreadMigrate;
 
    HooksManager();
+   ~HooksManager();
    void init();
    void fini();
    void registerHook(HookType::hook_type_t type, HookCallbackFunc func, UInt64 argument, HookCallbackOrder order = ORDER_NOTIFY_PRE);
    SInt64 callHooks(HookType::hook_type_t type, UInt64 argument, bool expect_return = false);
+   // Callers on hot paths can use this to skip building the hook argument when nobody is listening
+   bool hasHooks(HookType::hook_type_t type) const { return __atomic_load_n(&m_registry[type], __ATOMIC_ACQUIRE) != NULL; }
 
 private:
-   std::unordered_map<HookType::hook_type_t, std::vector<HookCallback> > m_registry;
+   typedef std::vector<HookCallback> HookList;
+
+   // Per hook type, all callbacks sorted on HookCallbackOrder (NULL when there are none), so callHooks() is a single
+   // pass over a flat array without taking a lock. registerHook() publishes a new list rather than modifying the
+   // current one, which may still be in use by callHooks() on another thread, or by the caller of registerHook().
+   const HookList *m_registry[HookType::HOOK_TYPES_MAX];
+   std::vector<const HookList*> m_retired;
+   Lock m_lock;
 };
 
 #endif /* __HOOKS_MANAGER_H */
@@ -165,6 +165,7 @@ void Simulator::start()
    PthreadEmu::init();
 
    m_hooks_manager->init();
+   m_stats_manager->initPeriodic();
    if (m_trace_manager)
       m_trace_manager->init();
 
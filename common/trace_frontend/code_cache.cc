@@ -0,0 +1,161 @@
+#include "code_cache.h"
+#include "instruction.h"
+#include "simulator.h"
+#include "stats.h"
+
+Instruction* CodeCacheEntry::setInstruction(Instruction *ins)
+{
+   Instruction *expected = NULL;
+   if (__atomic_compare_exchange_n(&instruction, &expected, ins, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      return ins;
+   delete ins;
+   return expected;
+}
+
+CodeCache::CodeCache(app_id_t app_id)
+{
+   static_assert(NUM_SHARDS == 64, "getShard() uses the upper 6 bits of the hash");
+
+   for(UInt64 i = 0; i < NUM_SHARDS; ++i)
+   {
+      m_shards[i].table = newTable(INITIAL_SIZE);
+      m_shards[i].count = 0;
+   }
+
+   // Private caches (not shared by the threads of an application) do not report statistics
+   if (app_id != INVALID_APP_ID)
+   {
+      Sim()->getStatsManager()->registerMetric(new StatsMetricCallback("decode_cache", app_id, "lookups", __getStats, (UInt64)this));
+      Sim()->getStatsManager()->registerMetric(new StatsMetricCallback("decode_cache", app_id, "misses", __getStats, (UInt64)this));
+      Sim()->getStatsManager()->registerMetric(new StatsMetricCallback("decode_cache", app_id, "inserts", __getStats, (UInt64)this));
+   }
+}
+
+CodeCache::~CodeCache()
+{
+   for(UInt64 i = 0; i < NUM_SHARDS; ++i)
+   {
+      Table *table = m_shards[i].table;
+      for(UInt64 j = 0; j < table->size; ++j)
+      {
+         if (table->slots[j])
+         {
+            delete table->slots[j]->decoded_inst;
+            delete table->slots[j];
+         }
+      }
+      m_shards[i].retired.push_back(table);
+      for(std::vector<Table*>::iterator it = m_shards[i].retired.begin(); it != m_shards[i].retired.end(); ++it)
+      {
+         delete [] (*it)->slots;
+         delete *it;
+      }
+   }
+   for(std::vector<Counters*>::iterator it = m_counters.begin(); it != m_counters.end(); ++it)
+      delete *it;
+}
+
+CodeCache::Counters* CodeCache::createCounters()
+{
+   Counters *counters = new Counters();
+   counters->lookups = 0;
+   counters->misses = 0;
+
+   ScopedLock sl(m_counters_lock);
+   m_counters.push_back(counters);
+   return counters;
+}
+
+UInt64 CodeCache::getStats(String metricName)
+{
+   UInt64 value = 0;
+   if (metricName == "inserts")
+   {
+      // Every insert adds exactly one entry to its shard
+      for(UInt64 i = 0; i < NUM_SHARDS; ++i)
+         value += __atomic_load_n(&m_shards[i].count, __ATOMIC_RELAXED);
+   }
+   else
+   {
+      ScopedLock sl(m_counters_lock);
+      for(std::vector<Counters*>::iterator it = m_counters.begin(); it != m_counters.end(); ++it)
+         value += metricName == "lookups" ? (*it)->lookups : (*it)->misses;
+   }
+   return value;
+}
+
+CodeCache::Table* CodeCache::newTable(UInt64 size)
+{
+   Table *table = new Table();
+   table->size = size;
+   table->slots = new CodeCacheEntry*[size]();
+   return table;
+}
+
+CodeCacheEntry* CodeCache::findInTable(const Table *table, IntPtr addr, UInt64 h)
+{
+   for(UInt64 i = h >> 26;; ++i)
+   {
+      CodeCacheEntry *entry = __atomic_load_n(&table->slots[i & (table->size - 1)], __ATOMIC_ACQUIRE);
+      if (entry == NULL || entry->addr == addr)
+         return entry;
+   }
+}
+
+void CodeCache::insertInTable(Table *table, CodeCacheEntry *entry, UInt64 h)
+{
+   for(UInt64 i = h >> 26;; ++i)
+   {
+      CodeCacheEntry **slot = &table->slots[i & (table->size - 1)];
+      if (*slot == NULL)
+      {
+         // Publish only after the entry (and for a new table, all slots) have been written
+         __atomic_store_n(slot, entry, __ATOMIC_RELEASE);
+         return;
+      }
+   }
+}
+
+CodeCacheEntry* CodeCache::find(IntPtr addr, Counters *counters)
+{
+   UInt64 h = hash(addr);
+   Table *table = __atomic_load_n(&getShard(h).table, __ATOMIC_ACQUIRE);
+   CodeCacheEntry *entry = findInTable(table, addr, h);
+
+   ++counters->lookups;
+   if (!entry)
+      ++counters->misses;
+
+   return entry;
+}
+
+CodeCacheEntry* CodeCache::insert(CodeCacheEntry *entry)
+{
+   UInt64 h = hash(entry->addr);
+   Shard &shard = getShard(h);
+   ScopedLock sl(shard.lock);
+
+   // Someone else may have decoded the same instruction while we were
+   CodeCacheEntry *existing = findInTable(shard.table, entry->addr, h);
+   if (existing)
+   {
+      delete entry->decoded_inst;
+      delete entry;
+      return existing;
+   }
+
+   if (2 * (shard.count + 1) > shard.table->size)
+   {
+      Table *table = newTable(2 * shard.table->size);
+      for(UInt64 i = 0; i < shard.table->size; ++i)
+         if (shard.table->slots[i])
+            insertInTable(table, shard.table->slots[i], hash(shard.table->slots[i]->addr));
+      shard.retired.push_back(shard.table);
+      __atomic_store_n(&shard.table, table, __ATOMIC_RELEASE);
+   }
+
+   insertInTable(shard.table, entry, h);
+   ++shard.count;
+
+   return entry;
+}
@@ -0,0 +1,105 @@
+#ifndef __CODE_CACHE_H
+#define __CODE_CACHE_H
+
+#include "fixed_types.h"
+#include "lock.h"
+#include "micro_op_arena.h"
+
+#include <decoder.h>
+
+#include <vector>
+
+class Instruction;
+
+// Everything the trace frontend needs to know about a static instruction, decoded once per PC so the
+// per-instruction path does not need to go back to the decoder. Entries are immutable once published,
+// except for instruction which is filled in (once) when the instruction is first simulated in detail.
+struct CodeCacheEntry
+{
+   static const uint32_t MAX_MEMORY_OPERANDS = 4;
+   typedef struct
+   {
+      uint32_t mem_idx;
+      uint32_t size;
+   } MemOp;
+
+   IntPtr addr;
+   const dl::DecodedInst *decoded_inst;
+   Instruction *instruction;
+   bool is_nop;
+   bool is_atomic;
+   bool is_prefetch;
+   bool is_indirect_branch;
+   bool is_mem_pair;
+   uint8_t num_reads;
+   uint8_t num_writes;
+   MemOp reads[MAX_MEMORY_OPERANDS];
+   MemOp writes[MAX_MEMORY_OPERANDS];
+
+   Instruction* getInstruction() const { return __atomic_load_n(&instruction, __ATOMIC_ACQUIRE); }
+   // Returns the instruction that ended up in the entry, which is not ours if another thread was faster
+   Instruction* setInstruction(Instruction *ins);
+};
+
+// Decoded instructions shared by all trace threads of an application.
+// Lookups do not take any locks, inserts lock one of NUM_SHARDS shards.
+class CodeCache
+{
+   public:
+      // Lookup statistics are kept per thread, so lookups do not write to any shared cache line
+      struct Counters
+      {
+         UInt64 lookups;
+         UInt64 misses;
+      } __attribute__ ((aligned (64)));
+
+      CodeCache(app_id_t app_id);
+      ~CodeCache();
+
+      // Every thread doing lookups gets its own counters, they are owned by the cache so they outlive the thread
+      Counters* createCounters();
+      CodeCacheEntry* find(IntPtr addr, Counters *counters);
+      // Returns the entry that ended up in the cache, which is not ours if another thread inserted the same address first
+      CodeCacheEntry* insert(CodeCacheEntry *entry);
+
+      // Owns the MicroOps of all instructions in the cache
+      MicroOpArena& getMicroOpArena() { return m_uop_arena; }
+
+   private:
+      static const UInt64 NUM_SHARDS = 64;
+      static const UInt64 INITIAL_SIZE = 1024;  // Per shard, must be a power of two
+
+      // Open-addressed table, replaced by one twice the size when it becomes half full.
+      // Old tables are kept around until the end, as readers may still be looking at them.
+      struct Table
+      {
+         UInt64 size;
+         CodeCacheEntry **slots;
+      };
+      struct Shard
+      {
+         Lock lock;
+         Table *table;
+         UInt64 count;
+         std::vector<Table*> retired;
+      } __attribute__ ((aligned (64)));
+
+      Shard m_shards[NUM_SHARDS];
+      MicroOpArena m_uop_arena;
+
+      Lock m_counters_lock;
+      std::vector<Counters*> m_counters;
+
+      static UInt64 __getStats(String objectName, UInt32 index, String metricName, UInt64 arg)
+      { return ((CodeCache*)arg)->getStats(metricName); }
+      UInt64 getStats(String metricName);
+
+      // The upper bits of the hash select the shard, the middle bits the first slot to probe
+      static UInt64 hash(IntPtr addr) { return (addr ^ (addr >> 17)) * 0x9e3779b97f4a7c15ULL; }
+      Shard& getShard(UInt64 h) { return m_shards[h >> 58]; }
+      static Table* newTable(UInt64 size);
+      static CodeCacheEntry* findInTable(const Table *table, IntPtr addr, UInt64 h);
+      static void insertInTable(Table *table, CodeCacheEntry *entry, UInt64 h);
+};
+
+#endif // __CODE_CACHE_H
@@ -1,5 +1,6 @@
 #include "trace_manager.h"
 #include "trace_thread.h"
+#include "code_cache.h"
 #include "simulator.h"
 #include "thread_manager.h"
 #include "hooks_manager.h"
@@ -23,9 +24,13 @@ TraceManager::TraceManager()
    , m_num_apps(Sim()->getCfg()->getInt("traceinput/num_apps"))
    , m_num_apps_nonfinish(m_num_apps)
    , m_app_info(m_num_apps)
+   , m_code_caches(m_num_apps)
    , m_tracefiles(m_num_apps)
    , m_responsefiles(m_num_apps)
 {
+   for (UInt32 i = 0 ; i < m_num_apps ; i++ )
+      m_code_caches[i] = new CodeCache(i);
+
    setupTraceFiles(0);
 }
 
@@ -245,6 +250,9 @@ void TraceManager::cleanup()
 TraceManager::~TraceManager()
 {
    cleanup();
+
+   for(std::vector<CodeCache *>::iterator it = m_code_caches.begin(); it != m_code_caches.end(); ++it)
+      delete *it;
 }
 
 void TraceManager::start()
@@ -9,6 +9,7 @@
 #include <vector>
 
 class TraceThread;
+class CodeCache;
 
 class TraceManager
 {
@@ -49,6 +50,7 @@ class TraceManager
       UInt32 m_num_apps;
       UInt32 m_num_apps_nonfinish;  //< Number of applications that have yet to complete their first run
       std::vector<app_info_t> m_app_info;
+      std::vector<CodeCache *> m_code_caches;
       std::vector<String> m_tracefiles;
       std::vector<String> m_responsefiles;
       String m_trace_prefix;
@@ -78,6 +80,8 @@ class TraceManager
       void endFrontEnd(); //Ask all trace_threads to send signal to front-end to shutdown
       void accessMemory(int core_id, Core::lock_signal_t lock_signal, Core::mem_op_t mem_op_type, IntPtr d_addr, char* data_buffer, UInt32 data_size);
 
+      CodeCache* getCodeCache(app_id_t app_id) { return m_code_caches.at(app_id); }
+
       UInt64 getProgressExpect();
       UInt64 getProgressValue();
 };
@@ -17,6 +17,7 @@
 #include "rng.h"
 #include "routine_tracer.h"
 #include "sim_api.h"
+#include "page_size_table.h"
 
 #include "stats.h"
 
@@ -35,7 +36,11 @@ TraceThread::TraceThread(Thread *thread, SubsecondTime time_start, String tracef
    , m_trace_has_pa(false)
    , m_address_randomization(Sim()->getCfg()->getBool("traceinput/address_randomization"))
    , m_appid_from_coreid(Sim()->getCfg()->getString("scheduler/type") == "sequential" ? true : false)
+   , m_detect_large_pages(Sim()->getCfg()->getString("perf_model/tlb/page_size_policy") == "trace")
    , m_stop(false)
+   , m_code_cache(NULL)
+   , m_code_cache_counters(NULL)
+   , m_code_cache_private(m_appid_from_coreid)
    , m_bbv_base(0)
    , m_bbv_count(0)
    , m_bbv_last(0)
@@ -47,6 +52,8 @@ TraceThread::TraceThread(Thread *thread, SubsecondTime time_start, String tracef
    , m_blocked(false)
    , m_cleanup(cleanup)
    , m_started(false)
+   , m_batch_size(0)
+   , m_batch_prfmdl(NULL)
    , m_stopped(false)
 {
 
@@ -62,6 +69,10 @@ TraceThread::TraceThread(Thread *thread, SubsecondTime time_start, String tracef
    m_trace.setHandleForkFunc(TraceThread::__handleForkFunc, this);
    if (Sim()->getRoutineTracer())
       m_trace.setHandleRoutineFunc(TraceThread::__handleRoutineChangeFunc, TraceThread::__handleRoutineAnnounceFunc, this);
+   m_trace.setPrefetch(Sim()->getCfg()->getBool("traceinput/prefetch"));
+
+   Sim()->getStatsManager()->registerMetric(new StatsMetricCallback("trace", thread->getId(), "prefetch_stall_time", TraceThread::__getPrefetchStats, (UInt64)this));
+   Sim()->getStatsManager()->registerMetric(new StatsMetricCallback("trace", thread->getId(), "prefetch_stalls", TraceThread::__getPrefetchStats, (UInt64)this));
 
    if (m_address_randomization)
    {
@@ -78,6 +89,20 @@ TraceThread::TraceThread(Thread *thread, SubsecondTime time_start, String tracef
       }
    }
 
+   for(UInt64 i = 0; i < CODE_CACHE_FRONT_SIZE; ++i)
+      m_code_cache_front[i] = NULL;
+
+   for(UInt64 i = 0; i < LARGE_PAGE_CHECKED_SIZE; ++i)
+      m_large_page_checked[i] = UINT64_MAX;
+
+   // Instructions are decoded into our physical address space, which with the sequential scheduler
+   // depends on the core we first run on, so we cannot share them with the rest of the application
+   if (m_code_cache_private)
+      m_code_cache = new CodeCache(INVALID_APP_ID);
+   else
+      m_code_cache = Sim()->getTraceManager()->getCodeCache(app_id);
+   m_code_cache_counters = m_code_cache->createCounters();
+
    thread->setVa2paFunc(_va2pa, (UInt64)this);
    
 }
@@ -90,10 +115,8 @@ TraceThread::~TraceThread()
       unlink(m_tracefile.c_str());
       unlink(m_responsefile.c_str());
    }
-   for(std::unordered_map<IntPtr, const dl::DecodedInst *>::iterator i = m_decoder_cache.begin() ; i != m_decoder_cache.end() ; ++i)
-   {
-      delete (*i).second;
-   }
+   if (m_code_cache_private)
+      delete m_code_cache;
 }
 
 UInt64 TraceThread::va2pa(UInt64 va, bool *noMapping)
@@ -103,6 +126,8 @@ UInt64 TraceThread::va2pa(UInt64 va, bool *noMapping)
       UInt64 pa = m_trace.va2pa(va);
       if (pa != 0)
       {
+         if (m_detect_large_pages && m_large_page_checked[(va >> va_page_shift) % LARGE_PAGE_CHECKED_SIZE] != (va >> va_page_shift))
+            detectLargePage(va, pa);
          return pa;
       }
       else
@@ -141,6 +166,31 @@ UInt64 TraceThread::va2pa(UInt64 va, bool *noMapping)
    }
 }
 
+void TraceThread::detectLargePage(UInt64 va, UInt64 pa)
+{
+   m_large_page_checked[(va >> va_page_shift) % LARGE_PAGE_CHECKED_SIZE] = va >> va_page_shift;
+
+   if (PageSizeTable::getPageShift(pa) != PageSizeTable::SMALL_PAGE_SHIFT)
+      return;
+
+   // The trace only has mappings for 4 KB pages. Take an aligned region to be a large page when its first and last
+   // 4 KB pages are mapped to the start and end of the physical region this address is in.
+   // This can only be seen once the application has touched both ends, until then the region counts as 4 KB pages.
+   static const UInt64 large_page_shifts[] = { 30, 21 };
+   for(UInt64 shift : large_page_shifts)
+   {
+      UInt64 mask = (UInt64(1) << shift) - 1;
+      UInt64 last_page = mask & ~va_page_mask;
+      if ((va & mask) == (pa & mask)
+         && m_trace.va2pa(va & ~mask) == (pa & ~mask)
+         && m_trace.va2pa((va & ~mask) | last_page) == ((pa & ~mask) | last_page))
+      {
+         PageSizeTable::insert(pa, shift);
+         return;
+      }
+   }
+}
+
 UInt64 TraceThread::remapAddress(UInt64 va_page)
 {
    // va is the virtual address shifted right by the page size
@@ -197,6 +247,8 @@ void TraceThread::handleOutputFunc(uint8_t fd, const uint8_t *data, uint32_t siz
 
 uint64_t TraceThread::handleSyscallFunc(uint16_t syscall_number, const uint8_t *data, uint32_t size)
 {
+   flushInstructions();
+
    // We may have been blocked in a system call, if we start executing instructions again that means we're continuing
    if (m_blocked)
    {
@@ -232,27 +284,37 @@ uint64_t TraceThread::handleSyscallFunc(uint16_t syscall_number, const uint8_t *
 
 int32_t TraceThread::handleNewThreadFunc()
 {
+   flushInstructions();
+
    return Sim()->getTraceManager()->createThread(m_app_id, getCurrentTime(), m_thread->getId());
 }
 
 int32_t TraceThread::handleForkFunc()
 {
+   flushInstructions();
+
    return Sim()->getTraceManager()->createApplication(getCurrentTime(), m_thread->getId());
 }
 
 int32_t TraceThread::handleJoinFunc(int32_t join_thread_id)
 {
+   flushInstructions();
+
    Sim()->getThreadManager()->joinThread(m_thread->getId(), join_thread_id);
    return 0;
 }
 
 uint64_t TraceThread::handleMagicFunc(uint64_t a, uint64_t b, uint64_t c)
 {
+   flushInstructions();
+
    return handleMagicInstruction(m_thread->getId(), a, b, c);
 }
 
 void TraceThread::handleRoutineChangeFunc(Sift::RoutineOpType event, uint64_t eip, uint64_t esp, uint64_t callEip)
 {
+   flushInstructions();
+
    switch(event)
    {
       case Sift::RoutineEnter:
@@ -271,6 +333,8 @@ void TraceThread::handleRoutineChangeFunc(Sift::RoutineOpType event, uint64_t ei
 
 bool TraceThread::handleEmuFunc(Sift::EmuType type, Sift::EmuRequest &req, Sift::EmuReply &res)
 {
+   flushInstructions();
+
    // We may have been blocked in a system call, if we start executing instructions again that means we're continuing
    if (m_blocked)
    {
@@ -369,35 +433,74 @@ void TraceThread::handleRoutineAnnounceFunc(uint64_t eip, const char *name, cons
    Sim()->getRoutineTracer()->addRoutine(eip, name, imgname, offset, column, line, filename);
 }
 
+UInt64 TraceThread::getPrefetchStats(String metricName)
+{
+   // Wall-clock time the simulation thread spent waiting for the decompression thread, in nanoseconds
+   if (metricName == "prefetch_stall_time")
+      return m_trace.getPrefetchStallTime();
+   else if (metricName == "prefetch_stalls")
+      return m_trace.getPrefetchStalls();
+   LOG_PRINT_ERROR("Unknown metric %s", metricName.c_str());
+}
+
 SubsecondTime TraceThread::getCurrentTime() const
 {
    LOG_ASSERT_ERROR(m_thread->getCore() != NULL, "Cannot get time while not on a core");
    return m_thread->getCore()->getPerformanceModel()->getElapsedTime();
 }
 
-Instruction* TraceThread::decode(Sift::Instruction &inst)
+CodeCacheEntry* TraceThread::lookupCodeCacheEntry(Sift::Instruction &inst)
 {
-
-   //printf("PC: %lx Size: %d num_addresses=%d is_branch=%d\n", inst.sinst->addr, inst.sinst->size, inst.num_addresses, inst.is_branch);
-   if (m_decoder_cache.count(inst.sinst->addr) == 0)
-      m_decoder_cache[inst.sinst->addr] = staticDecode(inst);
-   
-   const dl::DecodedInst& dec_inst = *(m_decoder_cache[inst.sinst->addr]);
-
-   OperandList list;
+   CodeCacheEntry *entry = m_code_cache->find(inst.sinst->addr, m_code_cache_counters);
+   if (entry)
+      return entry;
+
+   entry = new CodeCacheEntry();
+   entry->addr = inst.sinst->addr;
+   entry->decoded_inst = staticDecode(inst);
+   entry->instruction = NULL;
+
+   const dl::DecodedInst &dec_inst = *entry->decoded_inst;
+   entry->is_nop = dec_inst.is_nop();
+   entry->is_atomic = dec_inst.is_atomic();
+   entry->is_prefetch = dec_inst.is_prefetch();
+   entry->is_indirect_branch = dec_inst.is_indirect_branch();
+   entry->is_mem_pair = dec_inst.is_mem_pair();
+   entry->num_reads = entry->num_writes = 0;
 
    // Ignore memory-referencing operands in NOP instructions
-   if (!(dec_inst.is_nop()))
+   if (!entry->is_nop)
    {
-      for(uint32_t mem_idx = 0; mem_idx < Sim()->getDecoder()->num_memory_operands(&dec_inst); ++mem_idx)
-         if (Sim()->getDecoder()->op_read_mem(&dec_inst, mem_idx))
-            list.push_back(Operand(Operand::MEMORY, 0, Operand::READ));
+      uint32_t num_memory_operands = Sim()->getDecoder()->num_memory_operands(&dec_inst);
+      LOG_ASSERT_ERROR(num_memory_operands <= CodeCacheEntry::MAX_MEMORY_OPERANDS, "Too many memory operands (%u) for instruction at %lx", num_memory_operands, inst.sinst->addr);
 
-      for(uint32_t mem_idx = 0; mem_idx < Sim()->getDecoder()->num_memory_operands(&dec_inst); ++mem_idx)
+      for(uint32_t mem_idx = 0; mem_idx < num_memory_operands; ++mem_idx)
+      {
+         CodeCacheEntry::MemOp op = { mem_idx, Sim()->getDecoder()->size_mem_op(&dec_inst, mem_idx) };
+         if (Sim()->getDecoder()->op_read_mem(&dec_inst, mem_idx))
+            entry->reads[entry->num_reads++] = op;
          if (Sim()->getDecoder()->op_write_mem(&dec_inst, mem_idx))
-            list.push_back(Operand(Operand::MEMORY, 0, Operand::WRITE));
+            entry->writes[entry->num_writes++] = op;
+      }
    }
 
+   return m_code_cache->insert(entry);
+}
+
+Instruction* TraceThread::decode(Sift::Instruction &inst, const CodeCacheEntry &entry)
+{
+
+   //printf("PC: %lx Size: %d num_addresses=%d is_branch=%d\n", inst.sinst->addr, inst.sinst->size, inst.num_addresses, inst.is_branch);
+   const dl::DecodedInst& dec_inst = *entry.decoded_inst;
+
+   OperandList list;
+
+   for(uint32_t i = 0; i < entry.num_reads; ++i)
+      list.push_back(Operand(Operand::MEMORY, 0, Operand::READ));
+
+   for(uint32_t i = 0; i < entry.num_writes; ++i)
+      list.push_back(Operand(Operand::MEMORY, 0, Operand::WRITE));
+
    Instruction *instruction;
    if (inst.is_branch)
      instruction = new BranchInstruction(list); 
@@ -407,17 +510,20 @@ Instruction* TraceThread::decode(Sift::Instruction &inst)
 
    instruction->setAddress(va2pa(inst.sinst->addr));
    instruction->setSize(inst.sinst->size);
-   instruction->setAtomic(dec_inst.is_atomic());
+   instruction->setAtomic(entry.is_atomic);
    instruction->setDisassembly(dec_inst.disassembly_to_str().c_str());
    
-   const std::vector<const MicroOp*> *uops = InstructionDecoder::decode(inst.sinst->addr, &dec_inst, instruction);
-   instruction->setMicroOps(uops);
+   uint32_t num_uops;
+   const MicroOp *uops = InstructionDecoder::decode(inst.sinst->addr, &dec_inst, instruction, m_code_cache->getMicroOpArena(), num_uops);
+   instruction->setMicroOps(uops, num_uops);
 
    return instruction;
 }
 
 Sift::Mode TraceThread::handleInstructionCountFunc(uint32_t icount)
 {
+   flushInstructions();
+
    if (!m_started)
    {
       // Received first instruction, let TraceManager know our SIFT connection is up and running
@@ -467,6 +573,8 @@ Sift::Mode TraceThread::handleInstructionCountFunc(uint32_t icount)
 
 void TraceThread::handleCacheOnlyFunc(uint8_t icount, Sift::CacheOnlyType type, uint64_t eip, uint64_t address)
 {
+   flushInstructions();
+
    Core *core = m_thread->getCore();
    if (!core)
    {
@@ -519,10 +627,7 @@ const dl::DecodedInst* TraceThread::staticDecode(Sift::Instruction &inst)
 
 void TraceThread::handleInstructionWarmup(Sift::Instruction &inst, Sift::Instruction &next_inst, Core *core, bool do_icache_warmup, UInt64 icache_warmup_addr, UInt64 icache_warmup_size)
 {
-   if (m_decoder_cache.count(inst.sinst->addr) == 0)
-      m_decoder_cache[inst.sinst->addr] = staticDecode(inst);
-   
-   const dl::DecodedInst &dec_inst = *(m_decoder_cache[inst.sinst->addr]);
+   const CodeCacheEntry &entry = *getCodeCacheEntry(inst);
 
    // Warmup instruction caches
 
@@ -535,7 +640,7 @@ void TraceThread::handleInstructionWarmup(Sift::Instruction &inst, Sift::Instruc
 
    if (inst.is_branch)
    {
-      bool mispredict = core->accessBranchPredictor(va2pa(inst.sinst->addr), inst.taken, dec_inst.is_indirect_branch(), va2pa(next_inst.sinst->addr));
+      bool mispredict = core->accessBranchPredictor(va2pa(inst.sinst->addr), inst.taken, entry.is_indirect_branch, va2pa(next_inst.sinst->addr));
       if (mispredict)
          core->getPerformanceModel()->handleBranchMispredict();
    }
@@ -544,84 +649,77 @@ void TraceThread::handleInstructionWarmup(Sift::Instruction &inst, Sift::Instruc
 
    if (inst.executed)
    {
-      const bool is_atomic_update = dec_inst.is_atomic();
-      const bool is_prefetch = dec_inst.is_prefetch();
+      const bool is_atomic_update = entry.is_atomic;
+      const bool is_prefetch = entry.is_prefetch;
 
-      // Ignore memory-referencing operands in NOP instructions
-      if (!dec_inst.is_nop())
+      // Memory-referencing operands in NOP instructions were already left out of the code cache entry
+      for(uint32_t i = 0; i < entry.num_reads; ++i)
       {
-         for(uint32_t mem_idx = 0; mem_idx <  Sim()->getDecoder()->num_memory_operands(&dec_inst); ++mem_idx)
+         const CodeCacheEntry::MemOp &op = entry.reads[i];
+         UInt64 mem_address;
+         // LDP ARM instructions, second element to be loaded, using the address of the first element
+         if (entry.is_mem_pair && ((int)op.mem_idx == (inst.num_addresses + 1)))  
          {
-            if (Sim()->getDecoder()->op_read_mem(&dec_inst, mem_idx))
-            {
-               UInt64 mem_address;
-               // LDP ARM instructions, second element to be loaded, using the address of the first element
-               if (dec_inst.is_mem_pair() && ((int)mem_idx == (inst.num_addresses + 1)))  
-               {
-                  LOG_ASSERT_ERROR((int)mem_idx < (inst.num_addresses + 1), "Did not receive enough data addresses");
-                  
-                  mem_address = inst.addresses[mem_idx - 1] + Sim()->getDecoder()->size_mem_op(&dec_inst, mem_idx);
-               }
-               else
-               {
-                  LOG_ASSERT_ERROR(mem_idx < inst.num_addresses, "Did not receive enough data addresses");
-                 
-                  mem_address = inst.addresses[mem_idx];
-               }
-               
-               bool no_mapping = false;
-               UInt64 pa = va2pa(mem_address, is_prefetch ? &no_mapping : NULL);
-               if (no_mapping)
-                  continue;
-
-               core->accessMemory(
-                     /*(is_atomic_update) ? Core::LOCK :*/ Core::NONE,
-                     (is_atomic_update) ? Core::READ_EX : Core::READ,
-                     pa,
-                     NULL,
-                     Sim()->getDecoder()->size_mem_op(&dec_inst, mem_idx),
-                     Core::MEM_MODELED_COUNT,
-                     va2pa(inst.sinst->addr));
-            }
+            LOG_ASSERT_ERROR((int)op.mem_idx < (inst.num_addresses + 1), "Did not receive enough data addresses");
+            
+            mem_address = inst.addresses[op.mem_idx - 1] + op.size;
          }
+         else
+         {
+            LOG_ASSERT_ERROR(op.mem_idx < inst.num_addresses, "Did not receive enough data addresses");
+           
+            mem_address = inst.addresses[op.mem_idx];
+         }
+         
+         bool no_mapping = false;
+         UInt64 pa = va2pa(mem_address, is_prefetch ? &no_mapping : NULL);
+         if (no_mapping)
+            continue;
 
-         for(uint32_t mem_idx = 0; mem_idx < Sim()->getDecoder()->num_memory_operands(&dec_inst); ++mem_idx)
+         core->accessMemory(
+               /*(is_atomic_update) ? Core::LOCK :*/ Core::NONE,
+               (is_atomic_update) ? Core::READ_EX : Core::READ,
+               pa,
+               NULL,
+               op.size,
+               Core::MEM_MODELED_COUNT,
+               va2pa(inst.sinst->addr));
+      }
+
+      for(uint32_t i = 0; i < entry.num_writes; ++i)
+      {
+         const CodeCacheEntry::MemOp &op = entry.writes[i];
+         UInt64 mem_address;
+         // STP ARM instructions, second element to be stored, using the address of the first element
+         if (entry.is_mem_pair && ((int)op.mem_idx == (inst.num_addresses + 1)))  
          {
-            if (Sim()->getDecoder()->op_write_mem(&dec_inst, mem_idx))
-            {
-               UInt64 mem_address;
-               // STP ARM instructions, second element to be stored, using the address of the first element
-               if (dec_inst.is_mem_pair() && ((int)mem_idx == (inst.num_addresses + 1)))  
-               {
-                  LOG_ASSERT_ERROR((int)mem_idx < (inst.num_addresses + 1), "Did not receive enough data addresses");
-                  
-                  mem_address = inst.addresses[mem_idx - 1] + Sim()->getDecoder()->size_mem_op(&dec_inst, mem_idx);
-               }
-               else
-               {
-                  LOG_ASSERT_ERROR(mem_idx < inst.num_addresses, "Did not receive enough data addresses");
-                 
-                  mem_address = inst.addresses[mem_idx];
-               }
-               
-               bool no_mapping = false;
-               UInt64 pa = va2pa(mem_address, is_prefetch ? &no_mapping : NULL);
-               if (no_mapping)
-                  continue;
-
-               if (is_atomic_update)
-                  core->logMemoryHit(false, Core::WRITE, pa, Core::MEM_MODELED_COUNT, va2pa(inst.sinst->addr));
-               else
-                  core->accessMemory(
-                        /*(is_atomic_update) ? Core::UNLOCK :*/ Core::NONE,
-                        Core::WRITE,
-                        pa,
-                        NULL,
-                        Sim()->getDecoder()->size_mem_op(&dec_inst, mem_idx),
-                        Core::MEM_MODELED_COUNT,
-                        va2pa(inst.sinst->addr));
-            }
+            LOG_ASSERT_ERROR((int)op.mem_idx < (inst.num_addresses + 1), "Did not receive enough data addresses");
+            
+            mem_address = inst.addresses[op.mem_idx - 1] + op.size;
+         }
+         else
+         {
+            LOG_ASSERT_ERROR(op.mem_idx < inst.num_addresses, "Did not receive enough data addresses");
+           
+            mem_address = inst.addresses[op.mem_idx];
          }
+         
+         bool no_mapping = false;
+         UInt64 pa = va2pa(mem_address, is_prefetch ? &no_mapping : NULL);
+         if (no_mapping)
+            continue;
+
+         if (is_atomic_update)
+            core->logMemoryHit(false, Core::WRITE, pa, Core::MEM_MODELED_COUNT, va2pa(inst.sinst->addr));
+         else
+            core->accessMemory(
+                  /*(is_atomic_update) ? Core::UNLOCK :*/ Core::NONE,
+                  Core::WRITE,
+                  pa,
+                  NULL,
+                  op.size,
+                  Core::MEM_MODELED_COUNT,
+                  va2pa(inst.sinst->addr));
       }
    }
 }
@@ -631,69 +729,65 @@ void TraceThread::handleInstructionDetailed(Sift::Instruction &inst, Sift::Instr
 
    // Set up instruction
 
-   if (m_icache.count(inst.sinst->addr) == 0)
-      m_icache[inst.sinst->addr] = decode(inst);
-   // Here get the decoder instruction without checking, because we must have it for sure
-   const dl::DecodedInst &dec_inst = *(m_decoder_cache[inst.sinst->addr]);
+   CodeCacheEntry &entry = *getCodeCacheEntry(inst);
+   Instruction *ins = entry.getInstruction();
+   if (ins == NULL)
+      ins = entry.setInstruction(decode(inst, entry));
 
-   Instruction *ins = m_icache[inst.sinst->addr];
    DynamicInstruction *dynins = prfmdl->createDynamicInstruction(ins, va2pa(inst.sinst->addr));
 
    // Add dynamic instruction info
 
    if (inst.is_branch)
    {
-      dynins->addBranch(inst.taken, va2pa(next_inst.sinst->addr), dec_inst.is_indirect_branch());
+      dynins->addBranch(inst.taken, va2pa(next_inst.sinst->addr), entry.is_indirect_branch);
    }
 
-   // Ignore memory-referencing operands in NOP instructions
-   if (!dec_inst.is_nop())
+   // Memory-referencing operands in NOP instructions were already left out of the code cache entry
+   for(uint32_t i = 0; i < entry.num_reads; ++i)
    {
-      const bool is_prefetch = dec_inst.is_prefetch();
-
-      for(uint32_t mem_idx = 0; mem_idx < Sim()->getDecoder()->num_memory_operands(&dec_inst); ++mem_idx)
-      {
-         if (Sim()->getDecoder()->op_read_mem(&dec_inst, mem_idx))
-         {
-            addDetailedMemoryInfo(dynins, inst, dec_inst, mem_idx, Operand::READ, is_prefetch, prfmdl);
-         }
-      }
-
-      for(uint32_t mem_idx = 0; mem_idx < Sim()->getDecoder()->num_memory_operands(&dec_inst); ++mem_idx)
-      {
-         if (Sim()->getDecoder()->op_write_mem(&dec_inst, mem_idx))
-         {
-            addDetailedMemoryInfo(dynins, inst, dec_inst, mem_idx, Operand::WRITE, is_prefetch, prfmdl);
-         }
-      }
+      addDetailedMemoryInfo(dynins, inst, entry, entry.reads[i], Operand::READ);
    }
 
-   // Push instruction
+   for(uint32_t i = 0; i < entry.num_writes; ++i)
+   {
+      addDetailedMemoryInfo(dynins, inst, entry, entry.writes[i], Operand::WRITE);
+   }
 
-   prfmdl->queueInstruction(dynins);
+   // Push instruction, simulate once we have a full basic block
 
-   // simulate
+   m_batch[m_batch_size++] = dynins;
+   m_batch_prfmdl = prfmdl;
+   if (inst.is_branch || m_batch_size == BATCH_SIZE)
+      flushInstructions();
+}
 
-   prfmdl->iterate();
+void TraceThread::flushInstructions()
+{
+   if (m_batch_size)
+   {
+      m_batch_prfmdl->iterate(m_batch, m_batch_size);
+      m_batch_size = 0;
+   }
 }
 
-void TraceThread::addDetailedMemoryInfo(DynamicInstruction *dynins, Sift::Instruction &inst, const dl::DecodedInst &decoded_inst, uint32_t mem_idx, Operand::Direction op_type, bool is_prefetch, PerformanceModel *prfmdl)
+void TraceThread::addDetailedMemoryInfo(DynamicInstruction *dynins, Sift::Instruction &inst, const CodeCacheEntry &entry, const CodeCacheEntry::MemOp &op, Operand::Direction op_type)
 {
    UInt64 mem_address;
    // LDP/STP ARM instructions, second element to be ld/st, using the address of the first element
-   if (decoded_inst.is_mem_pair() && ((int)mem_idx == inst.num_addresses))  
+   if (entry.is_mem_pair && ((int)op.mem_idx == inst.num_addresses))  
    {
-      assert((int)mem_idx < (inst.num_addresses + 1));
-      mem_address = inst.addresses[mem_idx - 1] + Sim()->getDecoder()->size_mem_op(&decoded_inst, mem_idx);
+      assert((int)op.mem_idx < (inst.num_addresses + 1));
+      mem_address = inst.addresses[op.mem_idx - 1] + op.size;
    }
    else
    {
-      assert(mem_idx < inst.num_addresses);
-      mem_address = inst.addresses[mem_idx];
+      assert(op.mem_idx < inst.num_addresses);
+      mem_address = inst.addresses[op.mem_idx];
    }
                
    bool no_mapping = false;
-   UInt64 pa = va2pa(mem_address, is_prefetch ? &no_mapping : NULL);
+   UInt64 pa = va2pa(mem_address, entry.is_prefetch ? &no_mapping : NULL);
 
    if (no_mapping)
    {
@@ -701,7 +795,7 @@ void TraceThread::addDetailedMemoryInfo(DynamicInstruction *dynins, Sift::Instru
          inst.executed,
          SubsecondTime::Zero(),
          0,
-         Sim()->getDecoder()->size_mem_op(&decoded_inst, mem_idx),
+         op.size,
          op_type,
          0,
          HitWhere::PREFETCH_NO_MAPPING);
@@ -712,7 +806,7 @@ void TraceThread::addDetailedMemoryInfo(DynamicInstruction *dynins, Sift::Instru
          inst.executed,
          SubsecondTime::Zero(),
          pa,
-         Sim()->getDecoder()->size_mem_op(&decoded_inst, mem_idx),
+         op.size,
          op_type,
          0,
          HitWhere::UNKNOWN);
@@ -819,9 +913,11 @@ void TraceThread::run()
       switch(Sim()->getInstrumentationMode())
       {
          case InstMode::FAST_FORWARD:
+            flushInstructions();
             break;
 
          case InstMode::CACHE_ONLY:
+            flushInstructions();
             handleInstructionWarmup(inst, next_inst, core, do_icache_warmup, icache_warmup_addr, icache_warmup_size);
             break;
 
@@ -835,13 +931,18 @@ void TraceThread::run()
 
 
       // We may have been rescheduled to a different core
-      // by prfmdl->iterate (in handleInstructionDetailed),
-      // or core->countInstructions (when using a fast-forward performance model)
-      SubsecondTime time = prfmdl->getElapsedTime();
-      if (m_thread->reschedule(time, core))
+      // by prfmdl->iterate (in flushInstructions),
+      // or core->countInstructions (when using a fast-forward performance model).
+      // Time only advances when a batch is flushed, so only check then, unless we lost our core.
+      if (m_batch_size == 0 || m_thread->getCore() != core)
       {
-         core = m_thread->getCore();
-         prfmdl = core->getPerformanceModel();
+         flushInstructions();
+         SubsecondTime time = prfmdl->getElapsedTime();
+         if (m_thread->reschedule(time, core))
+         {
+            core = m_thread->getCore();
+            prfmdl = core->getPerformanceModel();
+         }
       }
 
 
@@ -851,6 +952,8 @@ void TraceThread::run()
       inst = next_inst;
    }
 
+   flushInstructions();
+
    printf("[TRACE:%u] -- %s --\n", m_thread->getId(), m_stop ? "STOP" : "DONE");
 
    SubsecondTime time_end = prfmdl->getElapsedTime();
@@ -8,6 +8,7 @@
 #include "sift_reader.h"
 #include "operand.h"
 #include "sem.h"
+#include "code_cache.h"
 
 #include <decoder.h>
 
@@ -45,6 +46,7 @@ class TraceThread : public Runnable
       static UInt64 _va2pa(UInt64 self, UInt64 va) { return ((TraceThread*)self)->va2pa(va); }
       UInt64 va2pa(UInt64 va, bool *noMapping = NULL);
       UInt64 remapAddress(UInt64 va_page);
+      void detectLargePage(UInt64 va, UInt64 pa);
 
       _Thread *m__thread;
       Thread *m_thread;
@@ -53,10 +55,19 @@ class TraceThread : public Runnable
       bool m_trace_has_pa;
       bool m_address_randomization;
       bool m_appid_from_coreid;
+      // Report large pages in the trace's physical mapping to the TLBs, pages checked recently are not checked again
+      static const UInt64 LARGE_PAGE_CHECKED_SIZE = 64;
+      bool m_detect_large_pages;
+      UInt64 m_large_page_checked[LARGE_PAGE_CHECKED_SIZE];
       uint8_t m_address_randomization_table[256];
       bool m_stop;
-      std::unordered_map<IntPtr, Instruction *> m_icache;
-      std::unordered_map<IntPtr, const dl::DecodedInst *> m_decoder_cache;
+
+      // Direct-mapped, per-thread front for the code cache shared by all threads of our application
+      static const UInt64 CODE_CACHE_FRONT_SIZE = 4096;
+      CodeCacheEntry *m_code_cache_front[CODE_CACHE_FRONT_SIZE];
+      CodeCache *m_code_cache;
+      CodeCache::Counters *m_code_cache_counters;
+      bool m_code_cache_private;
       UInt64 m_bbv_base;
       UInt64 m_bbv_count;
       UInt64 m_bbv_last;
@@ -70,6 +81,15 @@ class TraceThread : public Runnable
       bool m_blocked;
       bool m_cleanup;
       bool m_started;
+      // Detailed instructions are handed to the performance model a basic block (or up to BATCH_SIZE) at a time.
+      // The batch is flushed before anything else can touch the performance model: trace callbacks
+      // (syscalls, magic, synchronization, ...), instrumentation mode changes and rescheduling.
+      // A mode change made by another thread (e.g. its ROI end) is only seen at our next instruction,
+      // by then the performance model drops the pending batch like queueInstruction() drops late instructions.
+      static const UInt32 BATCH_SIZE = 32;
+      DynamicInstruction *m_batch[BATCH_SIZE];
+      UInt32 m_batch_size;
+      PerformanceModel *m_batch_prfmdl;
 
       void run();
       static Sift::Mode __handleInstructionCountFunc(void* arg, uint32_t icount)
@@ -94,6 +114,8 @@ class TraceThread : public Runnable
       { ((TraceThread*)arg)->handleRoutineAnnounceFunc(eip, name, imgname, offset, line, column, filename); }
       static int32_t __handleForkFunc(void* arg)
       { return ((TraceThread*)arg)->handleForkFunc();}
+      static UInt64 __getPrefetchStats(String objectName, UInt32 index, String metricName, UInt64 arg)
+      { return ((TraceThread*)arg)->getPrefetchStats(metricName); }
 
       Sift::Mode handleInstructionCountFunc(uint32_t icount);
       void handleCacheOnlyFunc(uint8_t icount, Sift::CacheOnlyType type, uint64_t eip, uint64_t address);
@@ -106,11 +128,21 @@ class TraceThread : public Runnable
       bool handleEmuFunc(Sift::EmuType type, Sift::EmuRequest &req, Sift::EmuReply &res);
       void handleRoutineChangeFunc(Sift::RoutineOpType event, uint64_t eip, uint64_t esp, uint64_t callEip);
       void handleRoutineAnnounceFunc(uint64_t eip, const char *name, const char *imgname, uint64_t offset, uint32_t line, uint32_t column, const char *filename);
-
-      Instruction* decode(Sift::Instruction &inst);
+      UInt64 getPrefetchStats(String metricName);
+
+      CodeCacheEntry* getCodeCacheEntry(Sift::Instruction &inst)
+      {
+         CodeCacheEntry *&entry = m_code_cache_front[(inst.sinst->addr ^ (inst.sinst->addr >> 12)) % CODE_CACHE_FRONT_SIZE];
+         if (entry == NULL || entry->addr != inst.sinst->addr)
+            entry = lookupCodeCacheEntry(inst);
+         return entry;
+      }
+      CodeCacheEntry* lookupCodeCacheEntry(Sift::Instruction &inst);
+      Instruction* decode(Sift::Instruction &inst, const CodeCacheEntry &entry);
       void handleInstructionWarmup(Sift::Instruction &inst, Sift::Instruction &next_inst, Core *core, bool do_icache_warmup, UInt64 icache_warmup_addr, UInt64 icache_warmup_size);
       void handleInstructionDetailed(Sift::Instruction &inst, Sift::Instruction &next_inst, PerformanceModel *prfmdl);
-      void addDetailedMemoryInfo(DynamicInstruction *dynins, Sift::Instruction &inst, const dl::DecodedInst &decoded_inst, uint32_t mem_idx, Operand::Direction op_type, bool is_pretetch, PerformanceModel *prfmdl);
+      void flushInstructions();
+      void addDetailedMemoryInfo(DynamicInstruction *dynins, Sift::Instruction &inst, const CodeCacheEntry &entry, const CodeCacheEntry::MemOp &op, Operand::Direction op_type);
       void unblock();
 
       SubsecondTime getCurrentTime() const;
@@ -0,0 +1,135 @@
+#include "packet_buffer.h"
+#include "log.h"
+#include "cpu_relax.h"
+
+PacketBuffer::FreeList PacketBuffer::s_free[PacketBuffer::NUM_SIZE_CLASSES][PacketBuffer::NUM_SHARDS];
+
+Byte* PacketBuffer::alloc(UInt32 size, UInt32 refcount)
+{
+   UInt32 size_class = 0;
+   while (size_class < NUM_SIZE_CLASSES && size > (1U << (size_class + MIN_SIZE_SHIFT)))
+      ++size_class;
+
+   Header *h = NULL;
+   if (size_class < NUM_SIZE_CLASSES)
+   {
+      // Thread stacks are at least 1 MB apart, so the stack address picks a shard per thread without needing TLS
+      UInt64 stack = (UInt64)&size_class;
+      UInt32 shard = ((stack >> 20) * 0x9e3779b97f4a7c15ULL) >> 60;
+      FreeList &list = s_free[size_class][shard % NUM_SHARDS];
+
+      while (__sync_lock_test_and_set(&list.lock, 1))
+         while (list.lock)
+            cpu_relax();
+      h = list.head;
+      if (h)
+         list.head = h->next;
+      __sync_lock_release(&list.lock);
+
+      if (!h)
+      {
+         h = (Header*)new Byte[sizeof(Header) + (1U << (size_class + MIN_SIZE_SHIFT))];
+         h->size_class = size_class;
+         h->shard = shard % NUM_SHARDS;
+      }
+   }
+   else
+   {
+      h = (Header*)new Byte[sizeof(Header) + size];
+      h->size_class = NUM_SIZE_CLASSES;
+      h->shard = 0;
+   }
+
+   h->next = NULL;
+   h->refcount = refcount;
+   return data(h);
+}
+
+void PacketBuffer::release(const void *buffer)
+{
+   Header *h = header(buffer);
+
+   LOG_ASSERT_ERROR(h->refcount > 0, "PacketBuffer %p released too many times", buffer);
+   // With a single reference left it is ours, so the common unshared case needs no atomic decrement
+   if (__atomic_load_n(&h->refcount, __ATOMIC_ACQUIRE) > 1 && __sync_sub_and_fetch(&h->refcount, 1) > 0)
+      return;
+
+   if (h->size_class == NUM_SIZE_CLASSES)
+   {
+      delete [] (Byte*)h;
+      return;
+   }
+
+   // Return to the shard it was allocated from, so no shard accumulates buffers
+   FreeList &list = s_free[h->size_class][h->shard];
+   while (__sync_lock_test_and_set(&list.lock, 1))
+      while (list.lock)
+         cpu_relax();
+   h->next = list.head;
+   list.head = h;
+   __sync_lock_release(&list.lock);
+}
+
+// Intrusive MPSC queue, after Dmitry Vyukov's node-based design: producers only swap the tail,
+// the consumer owns the head. m_stub keeps the list non-empty so push never has to touch the head.
+
+PacketBufferQueue::PacketBufferQueue()
+   : m_head(&m_stub)
+   , m_tail(&m_stub)
+{
+   m_stub.next = NULL;
+}
+
+void PacketBufferQueue::push(Byte *buffer)
+{
+   push(PacketBuffer::header(buffer));
+}
+
+void PacketBufferQueue::push(PacketBuffer::Header *h)
+{
+   h->next = NULL;
+   PacketBuffer::Header *prev = __atomic_exchange_n(&m_tail, h, __ATOMIC_SEQ_CST);
+   __atomic_store_n(&prev->next, h, __ATOMIC_SEQ_CST);
+}
+
+Byte* PacketBufferQueue::pop()
+{
+   PacketBuffer::Header *head = m_head;
+   PacketBuffer::Header *next = __atomic_load_n(&head->next, __ATOMIC_SEQ_CST);
+
+   if (head == &m_stub)
+   {
+      if (!next)
+         return NULL;
+      m_head = next;
+      head = next;
+      next = __atomic_load_n(&head->next, __ATOMIC_SEQ_CST);
+   }
+
+   if (next)
+   {
+      m_head = next;
+      return PacketBuffer::data(head);
+   }
+
+   // head is the last element: only take it once the stub is queued behind it,
+   // if a producer is halfway through a push report empty, it will complete shortly
+   if (head != __atomic_load_n(&m_tail, __ATOMIC_SEQ_CST))
+      return NULL;
+
+   push(&m_stub);
+
+   next = __atomic_load_n(&head->next, __ATOMIC_SEQ_CST);
+   if (next)
+   {
+      m_head = next;
+      return PacketBuffer::data(head);
+   }
+
+   return NULL;
+}
+
+bool PacketBufferQueue::empty() const
+{
+   return m_head == &m_stub && __atomic_load_n(&m_stub.next, __ATOMIC_SEQ_CST) == NULL;
+}
@@ -0,0 +1,64 @@
+#ifndef PACKET_BUFFER_H
+#define PACKET_BUFFER_H
+
+#include "fixed_types.h"
+
+// Pooled, reference-counted buffers for network packets and their payloads.
+// Released buffers go back to a free list for their size class instead of to the heap,
+// so steady-state network traffic does not allocate. A payload sent to several
+// destinations (broadcast) is shared by all receivers and recycled after the last release().
+
+class PacketBuffer
+{
+   public:
+      static Byte* alloc(UInt32 size, UInt32 refcount = 1);
+      static void release(const void *buffer);
+
+   private:
+      friend class PacketBufferQueue;
+
+      struct Header
+      {
+         Header *next;        // Free list or PacketBufferQueue link
+         UInt16 size_class;
+         UInt16 shard;
+         UInt32 refcount;
+      };
+
+      // Size classes of 64 bytes up to 64 KB, larger buffers come from the heap
+      static const UInt32 MIN_SIZE_SHIFT = 6;
+      static const UInt32 NUM_SIZE_CLASSES = 11;
+      // Free lists are sharded to keep sending threads from contending on a single list
+      static const UInt32 NUM_SHARDS = 16;
+
+      struct FreeList
+      {
+         volatile UInt32 lock;
+         Header *head;
+      } __attribute__((aligned(64)));
+
+      static FreeList s_free[NUM_SIZE_CLASSES][NUM_SHARDS];
+
+      static Header* header(const void *buffer) { return (Header*)buffer - 1; }
+      static Byte* data(Header *header) { return (Byte*)(header + 1); }
+};
+
+// Lock-free multi-producer, single-consumer queue of PacketBuffers, linked through their headers
+class PacketBufferQueue
+{
+   public:
+      PacketBufferQueue();
+
+      void push(Byte *buffer);  // Any thread
+      Byte* pop();              // Consumer only, returns NULL when empty
+      bool empty() const;       // Consumer only
+
+   private:
+      PacketBuffer::Header m_stub;
+      PacketBuffer::Header *m_head;
+      PacketBuffer::Header *m_tail;
+
+      void push(PacketBuffer::Header *header);
+};
+
+#endif // PACKET_BUFFER_H
@@ -68,6 +68,7 @@ void SmTransport::clearNodeForId(core_id_t core_id)
 
 SmTransport::SmNode::SmNode(core_id_t core_id, SmTransport *smt)
    : Node(core_id)
+   , m_waiting(false)
    , m_smt(smt)
 {
 }
@@ -93,49 +94,46 @@ void SmTransport::SmNode::send(SInt32 dest_id, const void* buffer, UInt32 length
 
 void SmTransport::SmNode::send(SmNode *dest_node, const void *buffer, UInt32 length)
 {
-   Byte *data = new Byte[length];
+   Byte *data = PacketBuffer::alloc(length);
    memcpy(data, buffer, length);
 
    LOG_PRINT("sending msg -- size: %i, data: %p, dest: %p", length, data, dest_node);
 
-   dest_node->m_lock.acquire();
    dest_node->m_queue.push(data);
-   dest_node->m_lock.release();
-   dest_node->m_cond.broadcast();
+
+   // Pairs with the store to m_waiting in recv(): either the receiver sees our packet, or we see it waiting
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   if (__atomic_load_n(&dest_node->m_waiting, __ATOMIC_SEQ_CST))
+   {
+      ScopedLock sl(dest_node->m_lock);
+      dest_node->m_cond.signal();
+   }
 }
 
+// Returns a PacketBuffer, to be freed by the caller using PacketBuffer::release()
 Byte* SmTransport::SmNode::recv()
 {
    LOG_PRINT("attempting recv -- this: %p", this);
 
-   m_lock.acquire();
-
    while (true)
    {
-      if (!m_queue.empty())
+      Byte *data = m_queue.pop();
+      if (data)
       {
-         Byte *data = m_queue.front();
-         m_queue.pop();
-         m_lock.release();
-
          LOG_PRINT("msg recv'd -- data: %p, this: %p", data, this);
-
          return data;
       }
-      else
-      {
+
+      ScopedLock sl(m_lock);
+      __atomic_store_n(&m_waiting, true, __ATOMIC_SEQ_CST);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      if (m_queue.empty())
          m_cond.wait(m_lock);
-      }
+      __atomic_store_n(&m_waiting, false, __ATOMIC_SEQ_CST);
    }
 }
 
 bool SmTransport::SmNode::query()
 {
-   bool result = false;
-
-   m_lock.acquire();
-   result = !m_queue.empty();
-   m_lock.release();
-
-   return result;
+   return !m_queue.empty();
 }
@@ -1,9 +1,8 @@
 #ifndef SMTRANSPORT_H
 #define SMTRANSPORT_H
 
-#include <queue>
-
 #include "transport.h"
+#include "packet_buffer.h"
 #include "cond.h"
 
 class SmTransport : public Transport
@@ -26,7 +25,8 @@ public:
    private:
       void send(SmNode *dest, const void *buffer, UInt32 length);
 
-      std::queue<Byte*> m_queue;
+      PacketBufferQueue m_queue;
+      bool m_waiting;         // Receiver is (about to go) asleep in recv(), senders should signal m_cond
       Lock m_lock;
       ConditionVariable m_cond;
       SmTransport *m_smt;
@@ -0,0 +1,210 @@
+// Decode throughput over a small corpus of x86, ARM and RISC-V encodings.
+// Every instruction is decoded and then queried the way Sniper's InstructionDecoder does when it builds
+// MicroOps (memory operands, register operands, enclosing registers and names), so this roughly measures
+// the first-touch decode cost of a static instruction.
+// For the architecture the simulator is configured for, the instructions are also run through
+// InstructionDecoder::decode into a MicroOpArena, which is the full first-touch cost in the simulator.
+//
+// Usage: bench_decode [-c <sniper config>] [iterations]
+
+#include "simulator.h"
+#include "config_file.hpp"
+#include "instruction.h"
+#include "instruction_decoder_wlib.h"
+#include "micro_op_arena.h"
+
+#include <decoder.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <sys/time.h>
+
+struct Corpus
+{
+  const char *name;
+  dl::dl_arch arch;
+  dl::dl_mode mode;
+  const char *code;
+  size_t size;
+  size_t insn_size;  // 0 for variable-length encodings
+};
+
+// push rbp; mov rbp,rsp; mov rax,[rip+0x13b8]; sub rsp,0x10; mov [rbp-4],edi; mov eax,[rbp-4]; add eax,edx;
+// imul eax,ecx; lock cmpxchg [rdx],rcx; vmovaps ymm0,[rdi+rax]; pxor xmm0,xmm0; mulsd xmm0,xmm1;
+// lea rax,[rax+rcx*4]; rep stosq; mfence; call; je; ret
+static const char X86_CODE[] =
+  "\x55\x48\x89\xe5\x48\x8b\x05\xb8\x13\x00\x00\x48\x83\xec\x10\x89\x7d\xfc\x8b\x45\xfc\x01\xd0"
+  "\x0f\xaf\xc1\xf0\x48\x0f\xb1\x0a\xc5\xfc\x28\x04\x07\x66\x0f\xef\xc0\xf2\x0f\x59\xc1"
+  "\x48\x8d\x04\x88\xf3\x48\xab\x0f\xae\xf0\xe8\x00\x00\x00\x00\x74\x05\xc3";
+
+// stp x29,x30,[sp,#-16]!; mov x29,sp; ldr x1,[x2,#4]!; ldr w2,[x1,#4]; ldp x2,x1,[x0]; eor w1,w2,w1,lsr #1;
+// add x0,x1,x2; mul x0,x0,x1; str x0,[x1]; ldxr x0,[x1]; scvtf d2,x1,#1; dup v0.8b,w0; nop; b .; ret
+static const char ARM_CODE[] =
+  "\xfd\x7b\xbf\xa9\xfd\x03\x00\x91\x41\x4c\x40\xf8\x22\x04\x40\xb9\x02\x04\x40\xa9\x41\x04\x41\x4a"
+  "\x20\x00\x02\x8b\x00\x7c\x01\x9b\x20\x00\x00\xf9\x20\x7c\x5f\xc8\x22\xfc\x42\x9e\x00\x0c\x01\x0e"
+  "\x1f\x20\x03\xd5\x00\x00\x00\x14\xc0\x03\x5f\xd6";
+
+// addi sp,sp,-16; sd ra,8(sp); ld ra,8(sp); add a1,a0,a1; mul a0,a0,a1; beq a0,a1,8; lr.d a0,(a0);
+// fadd.d fa0,fa0,fa1; nop; ret
+static const char RISCV_CODE[] =
+  "\x13\x01\x01\xff\x23\x34\x11\x00\x83\x30\x81\x00\xb3\x05\xb5\x00\x33\x05\xb5\x02\x63\x04\xb5\x00"
+  "\x2f\x35\x05\x10\x53\x75\xb5\x02\x13\x00\x00\x00\x67\x80\x00\x00";
+
+static const Corpus corpora[] = {
+  { "x86-64", dl::DL_ARCH_INTEL, dl::DL_MODE_64, X86_CODE, sizeof(X86_CODE) - 1, 0 },
+  { "ARMv8", dl::DL_ARCH_ARMv8, dl::DL_MODE_64, ARM_CODE, sizeof(ARM_CODE) - 1, 4 },
+  { "RISC-V", dl::DL_ARCH_RISCV, dl::DL_MODE_64, RISCV_CODE, sizeof(RISCV_CODE) - 1, 4 },
+};
+
+static double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// Touch everything InstructionDecoder::decode looks at, returns something that depends on all of it
+static uint64_t query(dl::Decoder *d, dl::DecodedInst *i)
+{
+  uint64_t sum = i->inst_num_id() + i->is_nop() + i->is_atomic() + i->is_conditional_branch();
+
+  for(unsigned int mem_idx = 0; mem_idx < d->num_memory_operands(i); ++mem_idx)
+  {
+    sum += d->mem_base_reg(i, mem_idx) + d->mem_index_reg(i, mem_idx) + d->size_mem_op(i, mem_idx);
+    sum += d->op_read_mem(i, mem_idx) + d->op_write_mem(i, mem_idx);
+  }
+
+  for(unsigned int idx = 0; idx < d->num_operands(i); ++idx)
+  {
+    if (d->op_is_reg(i, idx))
+    {
+      dl::Decoder::decoder_reg reg = d->largest_enclosing_register(d->get_op_reg(i, idx));
+      sum += reg + d->op_read_reg(i, idx) + d->op_write_reg(i, idx);
+      sum += (uintptr_t)d->reg_name(reg);
+    }
+  }
+
+  sum += (uintptr_t)d->inst_name(i->inst_num_id());
+  return sum;
+}
+
+static void report(const char *name, const char *what, size_t num_insns, unsigned long iterations, double elapsed)
+{
+  double count = double(iterations) * num_insns;
+  std::cout << std::setw(8) << name << ": " << num_insns << " instructions, "
+    << std::fixed << std::setprecision(1) << count / elapsed / 1e6 << " M " << what << "/s, "
+    << elapsed / count * 1e9 << " ns/" << what << std::endl;
+}
+
+// The MicroOps are never freed individually, so start a new arena every few iterations to keep memory bounded.
+// Each arena then allocates about one chunk, as it would when filling up in the simulator.
+static const unsigned long ARENA_ITERATIONS = 16;
+
+int main(int argc, const char* argv[])
+{
+  const char *config_path = "../../config/base.cfg";
+  int argi = 1;
+  if (argc > argi + 1 && strcmp(argv[argi], "-c") == 0)
+  {
+    config_path = argv[argi + 1];
+    argi += 2;
+  }
+  unsigned long iterations = argc > argi ? strtoul(argv[argi], NULL, 0) : 100000;
+
+  // InstructionDecoder gets its decoder from the simulator, configured by general/arch and general/mode
+  config::ConfigFile *cfg = new config::ConfigFile();
+  cfg->load(config_path);
+  Simulator::setConfig(cfg, Config::STANDALONE);
+  Simulator::allocate();
+  Sim()->createDecoder();
+  String sim_arch = Sim()->getCfg()->getString("general/arch");
+  dl::dl_arch uop_arch = sim_arch == "riscv" ? dl::DL_ARCH_RISCV : dl::DL_ARCH_INTEL;
+
+  dl::DecoderFactory *f = new dl::DecoderFactory;
+  uint64_t checksum = 0;
+
+  for(size_t c = 0; c < sizeof(corpora) / sizeof(corpora[0]); ++c)
+  {
+    const Corpus &corpus = corpora[c];
+    dl::Decoder *d = f->CreateDecoder(corpus.arch, corpus.mode, dl::DL_SYNTAX_DEFAULT);
+    if (d == NULL)
+    {
+      std::cout << std::setw(8) << corpus.name << ": not built" << std::endl;
+      continue;
+    }
+
+    // Split the corpus into instructions once, the x86 encodings are variable length
+    std::vector<std::pair<const uint8_t*, size_t> > insns;
+    for(size_t offset = 0; offset < corpus.size;)
+    {
+      const uint8_t *code = (const uint8_t*)corpus.code + offset;
+      size_t size = corpus.insn_size;
+      if (size == 0)
+      {
+        dl::DecodedInst *i = f->CreateInstruction(d, code, corpus.size - offset, 0x1000 + offset);
+        d->decode(i);
+        size = i->get_size();
+        delete i;
+        if (size == 0)
+        {
+          std::cerr << corpus.name << ": cannot decode instruction at offset " << offset << ", skipping the rest" << std::endl;
+          break;
+        }
+      }
+      insns.push_back(std::make_pair(code, size));
+      offset += size;
+    }
+
+    double start = now();
+    for(unsigned long it = 0; it < iterations; ++it)
+    {
+      for(size_t n = 0; n < insns.size(); ++n)
+      {
+        dl::DecodedInst *i = f->CreateInstruction(d, insns[n].first, insns[n].second, 0x1000 + n);
+        d->decode(i);
+        checksum += query(d, i);
+        delete i;
+      }
+    }
+    report(corpus.name, "decode", insns.size(), iterations, now() - start);
+
+    if (corpus.arch == uop_arch)
+    {
+      // MicroOps point back to their DecodedInst through the simulator's decoder, so decode with that one
+      dl::Decoder *sim_d = Sim()->getDecoder();
+      OperandList operands;
+      GenericInstruction instruction(operands);
+      MicroOpArena *arena = NULL;
+
+      start = now();
+      for(unsigned long it = 0; it < iterations; ++it)
+      {
+        if (it % ARENA_ITERATIONS == 0)
+        {
+          delete arena;
+          arena = new MicroOpArena();
+        }
+        for(size_t n = 0; n < insns.size(); ++n)
+        {
+          dl::DecodedInst *i = f->CreateInstruction(sim_d, insns[n].first, insns[n].second, 0x1000 + n);
+          sim_d->decode(i);
+          uint32_t num_uops;
+          const MicroOp *uops = InstructionDecoder::decode(0x1000 + n, i, &instruction, *arena, num_uops);
+          checksum += num_uops + (uops != NULL);
+          delete i;
+        }
+      }
+      report(corpus.name, "uop decode", insns.size(), iterations, now() - start);
+      delete arena;
+    }
+
+    delete d;
+  }
+
+  std::cout << "checksum " << std::hex << checksum << std::endl;
+  delete f;
+  return 0;
+}
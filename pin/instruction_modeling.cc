@@ -15,6 +15,7 @@
 #include "instruction.h"
 #include "dynamic_instruction.h"
 #include "micro_op.h"
+#include "micro_op_arena.h"
 #include "magic_client.h"
 #include "inst_mode.h"
 #include "dvfs_manager.h"
@@ -289,6 +290,9 @@ VOID InstructionModeling::addInstructionModeling(TRACE trace, INS ins, InstMode:
       addSpinLoopDetection(trace, ins, inst_mode);
 }
 
+// Instructions are never freed, neither are their MicroOps
+static MicroOpArena s_uop_arena;
+
 Instruction* InstructionModeling::decodeInstruction(INS ins)
 {
    // Timing modeling
@@ -333,8 +337,9 @@ Instruction* InstructionModeling::decodeInstruction(INS ins)
    inst->setDisassembly(INS_Disassemble(ins).c_str());
 
 
-   const std::vector<const MicroOp *> * uops = InstructionDecoder::decode(INS_Address(ins), INS_XedDec(ins), inst);
-   inst->setMicroOps(uops);
+   uint32_t num_uops;
+   const MicroOp *uops = InstructionDecoder::decode(INS_Address(ins), INS_XedDec(ins), inst, s_uop_arena, num_uops);
+   inst->setMicroOps(uops, num_uops);
 
    return inst;
 }
@@ -5,9 +5,9 @@
 class PinTLS : public TLS
 {
 public:
-    PinTLS()
+    PinTLS(DESTRUCTFUN destructor)
     {
-        m_key = PIN_CreateThreadDataKey(NULL);
+        m_key = PIN_CreateThreadDataKey(destructor);
     }
 
     ~PinTLS()
@@ -41,8 +41,8 @@ private:
 
 #if 1
 // override PthreadTLS
-TLS* TLS::create()
+TLS* TLS::create(void (*destructor)(void*))
 {
-    return new PinTLS();
+    return new PinTLS(destructor);
 }
 #endif
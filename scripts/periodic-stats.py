@@ -4,6 +4,9 @@ periodic-stats.py
 Periodically write out all statistics
 1st argument is the interval size in nanoseconds (default is 1e9 = 1 second of simulated time)
 2rd argument, if present will limit the number of snapshots and dynamically remove itermediate data
+
+For fine intervals, consider [stats/periodic] interval instead, which keeps periodic snapshots
+in memory (see sim.stats.periodic()) and writes them to sim.stats.periodic.bin without going through SQLite
 """
 
 import sim
@@ -198,12 +198,7 @@ class EveryIns:
 have_deleted_stats = False
 def db_delete(prefix, in_sim_end = False):
   global have_deleted_stats
-  cursor = sim.stats.db.cursor()
-  prefixid = sim.stats.db.execute('SELECT prefixid FROM prefixes WHERE prefixname = ?', (prefix,)).fetchall()
-  if prefixid:
-    cursor.execute('DELETE FROM prefixes WHERE prefixid = ?', (prefixid[0][0],))
-    cursor.execute('DELETE FROM `values` WHERE prefixid = ?', (prefixid[0][0],))
-  sim.stats.db.commit()
+  sim.stats.delete(prefix)
   if not have_deleted_stats:
     if in_sim_end:
       # We shouldn't be registering a new sim_end hook while in sim_end
@@ -18,6 +18,20 @@
 # define SIFT_USE_ZLIB 1
 #endif
 
+// Memory-mapped trace reading relies on mmap/madvise, which PinCRT does not provide
+#if defined(PIN_CRT)
+# define SIFT_USE_MMAP 0
+#else
+# define SIFT_USE_MMAP 1
+#endif
+
+// Reading ahead on a helper thread needs std::thread, which is not available under PinCRT
+#if defined(PIN_CRT)
+# define SIFT_USE_THREADS 0
+#else
+# define SIFT_USE_THREADS 1
+#endif
+
 namespace Sift
 {
 
@@ -42,8 +56,40 @@ namespace Sift
       ArchIA32 = 2,
       IcacheVariable = 4,
       PhysicalAddress = 8,
+      CompressionBlocked = 16,   //< Independently zlib-compressed blocks, followed by a BlockTrailer index
    } Option;
 
+   // Block-compressed traces (CompressionBlocked)
+   //
+   // After the Header, the record stream is cut into blocks at instruction boundaries. Each block is a
+   // BlockHeader followed by compressed_size bytes of zlib data, and can be decoded on its own:
+   // it starts with an InstructionExt record and repeats all icache, logical-to-physical and ISA state it needs.
+   // The file ends with one BlockIndexEntry per block, followed by a BlockTrailer.
+
+   const uint32_t BlockMagicNumber = 0x4b4c4253; // "SBLK"
+   const uint32_t IndexMagicNumber = 0x58444953; // "SIDX"
+
+   typedef struct
+   {
+      uint32_t magic;
+      uint32_t compressed_size;
+      uint32_t size;             //< Uncompressed size, in bytes
+      uint64_t icount;           //< Number of instructions in the trace before this block
+   } __attribute__ ((__packed__)) BlockHeader;
+
+   typedef struct
+   {
+      uint64_t offset;           //< File offset of the BlockHeader
+      uint64_t icount;
+   } __attribute__ ((__packed__)) BlockIndexEntry;
+
+   typedef struct
+   {
+      uint64_t index_offset;     //< File offset of the first BlockIndexEntry
+      uint64_t num_blocks;
+      uint32_t magic;
+   } __attribute__ ((__packed__)) BlockTrailer;
+
    typedef union
    {
       // Simple format for common instructions
@@ -41,9 +41,16 @@ Sift::Reader::Reader(const char *filename, const char *response_filename, uint32
    , handleRoutineAnnounceFunc(NULL)
    , handleRoutineArg(NULL)   
    , filesize(0)
+   , inputstream(NULL)
+   , mappedstream(NULL)
+   , m_inplace(NULL)
+   , m_blockstream(NULL)
+   , m_prefetchstream(NULL)
+   , m_prefetch(false)
    , last_address(0)
    , icache()
    , m_id(id)
+   , m_icount(0)
    , m_trace_has_pa(false)
    , m_seen_end(false)
    , m_last_sinst(NULL)
@@ -80,20 +87,39 @@ bool Sift::Reader::initStream()
    std::cerr << "[DEBUG:" << m_id << "] InitStream Attempting Open" << std::endl;
    #endif
 
-   inputstream = new std::ifstream(m_filename, std::ios::in);
+   struct stat filestatus;
+   bool regular_file = stat(m_filename, &filestatus) == 0 && S_ISREG(filestatus.st_mode);
+   if (regular_file)
+   {
+      // Traces replayed from disk are memory-mapped, FIFOs go through a normal stream
+      mappedstream = new vimstream(m_filename);
+      if (mappedstream->is_open())
+      {
+         input = mappedstream;
+      }
+      else
+      {
+         delete mappedstream;
+         mappedstream = NULL;
+      }
+   }
 
-   if ((!inputstream->is_open()) || (!inputstream->good()))
+   if (!input)
    {
-      std::cerr << "[SIFT:" << m_id << "] Cannot open " << m_filename << "\n";
-      return false;
+      inputstream = new std::ifstream(m_filename, std::ios::in);
+
+      if ((!inputstream->is_open()) || (!inputstream->good()))
+      {
+         std::cerr << "[SIFT:" << m_id << "] Cannot open " << m_filename << "\n";
+         return false;
+      }
+
+      input = new vifstream(inputstream);
    }
 
-   struct stat filestatus;
    stat(m_filename, &filestatus);
    filesize = filestatus.st_size;
 
-   input = new vifstream(inputstream);
-
    Sift::Header hdr;
    input->read(reinterpret_cast<char*>(&hdr), sizeof(hdr));
    if (hdr.magic != Sift::MagicNumber)
@@ -106,14 +132,23 @@ bool Sift::Reader::initStream()
       std::cerr << "[SIFT:" << m_id << "] Invalid header size\n";
    }
 
+   bool compressed = false;
 #if SIFT_USE_ZLIB
    if (hdr.options & CompressionZlib)
    {
       input = new izstream(input);
       hdr.options &= ~CompressionZlib;
+      compressed = true;
+   }
+   else if (hdr.options & CompressionBlocked)
+   {
+      m_blockstream = new ibzstream(input, regular_file);
+      input = m_blockstream;
+      hdr.options &= ~CompressionBlocked;
+      compressed = true;
    }
 #else
-   if (hdr.options & CompressionZlib)
+   if (hdr.options & (CompressionZlib | CompressionBlocked))
    {
       std::cerr << "[SIFT:" << m_id << "] Error: Compression requested, but disabled at compile time.\n";
    }
@@ -132,6 +167,19 @@ bool Sift::Reader::initStream()
 
    hdr.options &= ~IcacheVariable;
 
+   // Without compression, records can be decoded straight out of the mapping
+   if (input == mappedstream)
+      m_inplace = mappedstream;
+   else if (m_prefetch && compressed)
+   {
+#if SIFT_USE_THREADS
+      m_prefetchstream = new iastream(input);
+      input = m_prefetchstream;
+#else
+      std::cerr << "[SIFT:" << m_id << "] Warning: Prefetching requested, but disabled at compile time.\n";
+#endif
+   }
+
    // Make sure there are no unrecognized options
    if (hdr.options != 0)
    {
@@ -166,6 +214,53 @@ bool Sift::Reader::initResponse()
    return true;
 }
 
+inline int Sift::Reader::peekInput()
+{
+   // vimstream, iastream and ibzstream are final, so these calls are devirtualized
+   if (m_inplace)
+      return m_inplace->peek();
+#if SIFT_USE_THREADS
+   else if (m_prefetchstream)
+      return m_prefetchstream->peek();
+#endif
+   else if (m_blockstream)
+      return m_blockstream->peek();
+   else
+      return input->peek();
+}
+
+inline void Sift::Reader::readInput(void *data, size_t size)
+{
+   if (m_inplace)
+      m_inplace->read(reinterpret_cast<char*>(data), size);
+#if SIFT_USE_THREADS
+   else if (m_prefetchstream)
+      m_prefetchstream->read(reinterpret_cast<char*>(data), size);
+#endif
+   else if (m_blockstream)
+      m_blockstream->read(reinterpret_cast<char*>(data), size);
+   else
+      input->read(reinterpret_cast<char*>(data), size);
+}
+
+inline const Sift::Record* Sift::Reader::readRecord(Record &rec, size_t size)
+{
+   const char *data = NULL;
+   if (m_inplace)
+      data = m_inplace->map(size);
+#if SIFT_USE_THREADS
+   else if (m_prefetchstream)
+      data = m_prefetchstream->map(size);
+#endif
+   else if (m_blockstream)
+      data = m_blockstream->map(size);
+   if (data)
+      return reinterpret_cast<const Record*>(data);
+
+   input->read(reinterpret_cast<char*>(&rec), size);
+   return &rec;
+}
+
 bool Sift::Reader::Read(Instruction &inst)
 {
    if (input == NULL)
@@ -180,7 +275,7 @@ bool Sift::Reader::Read(Instruction &inst)
    while(!m_seen_end)
    {
       Record rec;
-      uint8_t byte = input->peek();
+      uint8_t byte = peekInput();
       if (input->fail())
       {
          std::cerr << "[SIFT:" << m_id << "] Error: " << strerror(errno) << "\n";
@@ -203,10 +298,12 @@ bool Sift::Reader::Read(Instruction &inst)
             {
                assert(rec.Other.size == sizeof(uint64_t) + ICACHE_SIZE);
                uint64_t address;
-               uint8_t *bytes = new uint8_t[ICACHE_SIZE];
                input->read(reinterpret_cast<char*>(&address), sizeof(uint64_t));
-               input->read(reinterpret_cast<char*>(bytes), ICACHE_SIZE);
-               icache[address] = bytes;
+               // Block-compressed traces resend the icache at the start of every block, reuse the page we already have
+               const uint8_t *&bytes = icache[address];
+               if (bytes == NULL)
+                  bytes = new uint8_t[ICACHE_SIZE];
+               input->read(const_cast<char*>(reinterpret_cast<const char*>(bytes)), ICACHE_SIZE);
                break;
             }
             case RecOtherIcacheVariable:
@@ -487,17 +584,17 @@ bool Sift::Reader::Read(Instruction &inst)
       if ((byte & 0xf) != 0)
       {
          // Instruction
-         input->read(reinterpret_cast<char*>(&rec), sizeof(rec.Instruction));
+         const Record *prec = readRecord(rec, sizeof(rec.Instruction));
 
          #if VERBOSE_HEX > 2
-         hexdump(&rec, sizeof(rec.Instruction));
+         hexdump(prec, sizeof(prec->Instruction));
          #endif
 
-         size = rec.Instruction.size;
+         size = prec->Instruction.size;
          addr = last_address;
-         inst.num_addresses = rec.Instruction.num_addresses;
-         inst.is_branch = rec.Instruction.is_branch;
-         inst.taken = rec.Instruction.taken;
+         inst.num_addresses = prec->Instruction.num_addresses;
+         inst.is_branch = prec->Instruction.is_branch;
+         inst.taken = prec->Instruction.taken;
          inst.is_predicate = false;
          inst.executed = true;
          inst.isa = m_isa;
@@ -505,19 +602,19 @@ bool Sift::Reader::Read(Instruction &inst)
       else
       {
          // InstructionExt
-         input->read(reinterpret_cast<char*>(&rec), sizeof(rec.InstructionExt));
+         const Record *prec = readRecord(rec, sizeof(rec.InstructionExt));
 
          #if VERBOSE_HEX > 2
-         hexdump(&rec, sizeof(rec.InstructionExt));
+         hexdump(prec, sizeof(prec->InstructionExt));
          #endif
 
-         size = rec.InstructionExt.size;
-         addr = rec.InstructionExt.addr;
-         inst.num_addresses = rec.InstructionExt.num_addresses;
-         inst.is_branch = rec.InstructionExt.is_branch;
-         inst.taken = rec.InstructionExt.taken;
-         inst.is_predicate = rec.InstructionExt.is_predicate;
-         inst.executed = rec.InstructionExt.executed;
+         size = prec->InstructionExt.size;
+         addr = prec->InstructionExt.addr;
+         inst.num_addresses = prec->InstructionExt.num_addresses;
+         inst.is_branch = prec->InstructionExt.is_branch;
+         inst.taken = prec->InstructionExt.taken;
+         inst.is_predicate = prec->InstructionExt.is_predicate;
+         inst.executed = prec->InstructionExt.executed;
          inst.isa = m_isa;
 
          last_address = addr;
@@ -525,10 +622,11 @@ bool Sift::Reader::Read(Instruction &inst)
 
       last_address += size;
 
-      for(int i = 0; i < inst.num_addresses; ++i)
-         input->read(reinterpret_cast<char*>(&inst.addresses[i]), sizeof(uint64_t));
+      if (inst.num_addresses)
+         readInput(inst.addresses, inst.num_addresses * sizeof(uint64_t));
 
       inst.sinst = getStaticInstruction(addr, size);
+      ++m_icount;
 
       #if VERBOSE_HEX > 2
       hexdump(inst.sinst->data, inst.sinst->size);
@@ -766,9 +864,74 @@ void Sift::Reader::sendSimpleResponse(RecOtherType type, void *data, uint32_t si
    response->flush();
 }
 
+bool Sift::Reader::isSeekable()
+{
+   if (input == NULL)
+   {
+      if (!initStream())
+      {
+         std::cerr << "[SIFT:" << m_id << "] Error: initStream failed\n";
+         return false;
+      }
+   }
+
+   return m_blockstream != NULL && m_blockstream->isSeekable();
+}
+
+bool Sift::Reader::Seek(uint64_t icount)
+{
+   if (!isSeekable())
+      return false;
+
+   // Anything the helper thread decompressed ahead is from the wrong place now
+#if SIFT_USE_THREADS
+   if (m_prefetchstream)
+      m_prefetchstream->stop();
+#endif
+
+   uint64_t block_icount;
+   bool success = m_blockstream->seekInstruction(icount, block_icount);
+
+#if SIFT_USE_THREADS
+   if (m_prefetchstream)
+      m_prefetchstream->start();
+#endif
+
+   if (!success)
+      return false;
+
+   // Each block starts with an InstructionExt record, and resends any state it needs
+   m_icount = block_icount;
+   last_address = 0;
+   m_last_sinst = NULL;
+   m_seen_end = false;
+
+   return true;
+}
+
+uint64_t Sift::Reader::getPrefetchStallTime() const
+{
+#if SIFT_USE_THREADS
+   if (m_prefetchstream)
+      return m_prefetchstream->getStallTime();
+#endif
+   return 0;
+}
+
+uint64_t Sift::Reader::getPrefetchStalls() const
+{
+#if SIFT_USE_THREADS
+   if (m_prefetchstream)
+      return m_prefetchstream->getStalls();
+#endif
+   return 0;
+}
+
 uint64_t Sift::Reader::getPosition()
 {
-   if (inputstream)
+   if (mappedstream)
+      return mappedstream->tell();
+   else if (inputstream)
       return inputstream->tellg();
    else
       return 0;
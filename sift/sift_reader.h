@@ -9,6 +9,9 @@
 #include <cassert>
 
 class vistream;
+class vimstream;
+class ibzstream;
+class iastream;
 class vostream;
 
 namespace Sift
@@ -78,6 +81,11 @@ namespace Sift
          void *handleRoutineArg;
          uint64_t filesize;
          std::ifstream *inputstream;
+         vimstream *mappedstream;
+         vimstream *m_inplace;   //< Set when records can be decoded directly from the memory-mapped trace
+         ibzstream *m_blockstream;   //< Set for block-compressed traces
+         iastream *m_prefetchstream;   //< Set when decompression runs ahead on a helper thread
+         bool m_prefetch;
 
          char *m_filename;
          char *m_response_filename;
@@ -88,6 +96,7 @@ namespace Sift
          std::unordered_map<uint64_t, uint64_t> vcache;
 
          uint32_t m_id;
+         uint64_t m_icount;
 
          bool m_trace_has_pa;
          bool m_seen_end;
@@ -96,6 +105,9 @@ namespace Sift
          int m_isa;
 
          bool initResponse();
+         int peekInput();
+         void readInput(void *data, size_t size);
+         const Record* readRecord(Record &rec, size_t size);
          const Sift::StaticInstruction* staticInfoInstruction(uint64_t addr, uint8_t size);
          const Sift::StaticInstruction* getStaticInstruction(uint64_t addr, uint8_t size);
          void sendSyscallResponse(uint64_t return_code);
@@ -120,6 +132,17 @@ namespace Sift
          void setHandleRoutineFunc(HandleRoutineChange funcChange, HandleRoutineAnnounce funcAnnounce, void* arg = NULL) { assert(funcChange); assert(funcAnnounce); handleRoutineChangeFunc = funcChange; handleRoutineAnnounceFunc = funcAnnounce; handleRoutineArg = arg; }
          void setHandleForkFunc(HandleForkFunc func, void* arg = NULL) { assert(func); handleForkFunc = func; handleForkArg = arg;}
 
+         // Jump to the start of the block containing instruction number icount, without decoding the instructions
+         // (or handling any other records) in between. Only block-compressed traces with an index, read from a regular file, can seek.
+         bool Seek(uint64_t icount);
+         bool isSeekable();
+         // Decompress compressed traces ahead on a helper thread, must be set before initStream()
+         void setPrefetch(bool prefetch) { m_prefetch = prefetch; }
+         // Time (in nanoseconds) and number of times Read() had to wait for the decompression thread
+         uint64_t getPrefetchStallTime() const;
+         uint64_t getPrefetchStalls() const;
+         uint64_t getInstructionCount() const { return m_icount; }
+
          uint64_t getPosition();
          uint64_t getLength();
          bool getTraceHasPhysicalAddresses() const { return m_trace_has_pa; }
@@ -39,7 +39,7 @@ __sift_assert_fail(__const char *__assertion, __const char *__file,
 }
 
 
-Sift::Writer::Writer(const char *filename, GetCodeFunc getCodeFunc, bool useCompression, const char *response_filename, uint32_t id, bool arch32, bool requires_icache_per_insn, bool send_va2pa_mapping, GetCodeFunc2 getCodeFunc2, void* getCodeFunc2Data)
+Sift::Writer::Writer(const char *filename, GetCodeFunc getCodeFunc, bool useCompression, const char *response_filename, uint32_t id, bool arch32, bool requires_icache_per_insn, bool send_va2pa_mapping, GetCodeFunc2 getCodeFunc2, void* getCodeFunc2Data, uint64_t compressionBlockSize)
    : response(NULL)
    , getCodeFunc(getCodeFunc)
    , getCodeFunc2(getCodeFunc2)
@@ -56,6 +56,11 @@ Sift::Writer::Writer(const char *filename, GetCodeFunc getCodeFunc, bool useComp
    , m_id(id)
    , m_requires_icache_per_insn(requires_icache_per_insn)
    , m_send_va2pa_mapping(send_va2pa_mapping)
+   , m_blocked_output(NULL)
+   , m_block_size(0)
+   , m_block_start(0)
+   , m_isa_valid(false)
+   , m_isa(0)
 {
    memset(hsize, 0, sizeof(hsize));
    memset(haddr, 0, sizeof(haddr));
@@ -64,7 +69,9 @@ Sift::Writer::Writer(const char *filename, GetCodeFunc getCodeFunc, bool useComp
 
    uint64_t options = 0;
 #if SIFT_USE_ZLIB
-   if (useCompression)
+   if (useCompression && compressionBlockSize)
+      options |= CompressionBlocked;
+   else if (useCompression)
       options |= CompressionZlib;
 #else
    if (useCompression) {
@@ -101,6 +108,12 @@ Sift::Writer::Writer(const char *filename, GetCodeFunc getCodeFunc, bool useComp
 
    if (options & CompressionZlib)
       output = new ozstream(output);
+   else if (options & CompressionBlocked)
+   {
+      m_blocked_output = new obzstream(output, sizeof(hdr));
+      m_block_size = compressionBlockSize;
+      output = m_blocked_output;
+   }
 }
 
 // Modified from http://stackoverflow.com/questions/2203159/is-there-a-c-equivalent-to-getcwd
@@ -189,6 +202,9 @@ void Sift::Writer::Instruction(uint64_t addr, uint8_t size, uint8_t num_addresse
       return;
    }
 
+   if (m_block_size && (ninstrs - m_block_start >= m_block_size || m_blocked_output->full()))
+      startBlock();
+
    if (m_requires_icache_per_insn)
    {
       if (! icache[addr])
@@ -926,6 +942,27 @@ void Sift::Writer::ISAChange(uint32_t new_isa)
 
    output->write(reinterpret_cast<char*>(&rec), sizeof(rec.Other));
    output->write(reinterpret_cast<char*>(&new_isa), sizeof(new_isa));
+
+   m_isa_valid = true;
+   m_isa = new_isa;
+}
+
+void Sift::Writer::startBlock()
+{
+   #if VERBOSE > 0
+   std::cerr << "[DEBUG:" << m_id << "] Start block at instruction " << ninstrs << std::endl;
+   #endif
+
+   m_blocked_output->nextBlock(ninstrs);
+   m_block_start = ninstrs;
+
+   // Blocks must be decodable on their own: forget which state the reader has seen so far,
+   // which makes us start with an extended instruction record and resend icache and va2pa records as needed
+   last_address = 0;
+   icache.clear();
+   m_va2pa.clear();
+   if (m_isa_valid)
+      ISAChange(m_isa);
 }
 
 bool Sift::Writer::IsOpen()
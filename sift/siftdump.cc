@@ -1,13 +1,17 @@
 #define __STDC_FORMAT_MACROS
 
 #include "sift_reader.h"
+#include "zfstream.h"
 
 #include <inttypes.h>
 #include <cassert>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #if PIN_REV >= 67254
 extern "C" {
@@ -15,6 +19,232 @@ extern "C" {
 }
 #endif
 
+static void writeOther(vostream *output, Sift::RecOtherType type, const void *data, uint32_t size)
+{
+   Sift::Record rec;
+   rec.Other.zero = 0;
+   rec.Other.type = type;
+   rec.Other.size = size;
+   output->write(reinterpret_cast<char*>(&rec), sizeof(rec.Other));
+   output->write(reinterpret_cast<const char*>(data), size);
+}
+
+// Rewrite a trace with different compression: none, zlib (one stream) or blocked[:<instructions per block>].
+// Records are copied as-is, except that when writing blocks, each block starts with an InstructionExt record
+// and repeats the icache, logical-to-physical and ISA records its instructions depend on.
+static int convert(const char *format, const char *infile, const char *outfile)
+{
+   uint64_t block_size = 0, compression = 0;
+   if (strcmp(format, "zlib") == 0)
+      compression = Sift::CompressionZlib;
+   else if (strncmp(format, "blocked", 7) == 0)
+   {
+      compression = Sift::CompressionBlocked;
+      block_size = format[7] == ':' ? strtoull(format + 8, NULL, 0) : 1000000;
+      if (block_size == 0)
+      {
+         fprintf(stderr, "Invalid block size in %s\n", format);
+         return 1;
+      }
+   }
+   else if (strcmp(format, "none") != 0)
+   {
+      fprintf(stderr, "Unknown format %s, use none, zlib or blocked[:N]\n", format);
+      return 1;
+   }
+
+   vistream *input = new vimstream(infile);
+   if (input->fail())
+   {
+      delete input;
+      input = new vifstream(infile, std::ios::in | std::ios::binary);
+   }
+   Sift::Header hdr;
+   input->read(reinterpret_cast<char*>(&hdr), sizeof(hdr));
+   if (input->fail() || hdr.magic != Sift::MagicNumber || hdr.size != 0)
+   {
+      fprintf(stderr, "Cannot read SIFT header from %s\n", infile);
+      delete input;
+      return 1;
+   }
+   if (hdr.options & Sift::CompressionZlib)
+      input = new izstream(input);
+   else if (hdr.options & Sift::CompressionBlocked)
+      input = new ibzstream(input, false /* read sequentially */);
+
+   vostream *output = new vofstream(outfile, std::ios::out | std::ios::binary | std::ios::trunc);
+   if (!output->is_open())
+   {
+      fprintf(stderr, "Cannot open %s\n", outfile);
+      delete input;
+      delete output;
+      return 1;
+   }
+   hdr.options = (hdr.options & ~(Sift::CompressionZlib | Sift::CompressionBlocked)) | compression;
+   output->write(reinterpret_cast<char*>(&hdr), sizeof(hdr));
+   obzstream *blocked = NULL;
+   if (compression == Sift::CompressionZlib)
+      output = new ozstream(output);
+   else if (compression == Sift::CompressionBlocked)
+      output = blocked = new obzstream(output, sizeof(hdr));
+
+   std::unordered_map<uint64_t, std::vector<uint8_t> > icache;
+   std::unordered_map<uint64_t, uint64_t> vcache;
+   std::unordered_set<uint64_t> icache_sent, vcache_sent;
+   bool isa_valid = false;
+   uint32_t isa = 0;
+   uint64_t icount = 0, block_start = 0, last_address = 0, out_last_address = 0;
+   std::vector<uint8_t> payload;
+   bool seen_end = false;
+
+   while (!seen_end)
+   {
+      uint8_t byte = input->peek();
+      if (input->fail())
+      {
+         fprintf(stderr, "Trace %s is truncated, no end record found\n", infile);
+         break;
+      }
+
+      Sift::Record rec;
+      if (byte == 0)
+      {
+         input->read(reinterpret_cast<char*>(&rec), sizeof(rec.Other));
+         payload.resize(rec.Other.size);
+         input->read(reinterpret_cast<char*>(payload.data()), rec.Other.size);
+
+         switch(rec.Other.type)
+         {
+            case Sift::RecOtherIcache:
+            {
+               uint64_t address = *reinterpret_cast<uint64_t*>(payload.data());
+               icache[address].assign(payload.begin() + sizeof(uint64_t), payload.end());
+               icache_sent.insert(address);
+               break;
+            }
+            case Sift::RecOtherIcacheVariable:
+            {
+               // Only store the bytes, pages are resent in full when a new block needs them
+               uint64_t address = *reinterpret_cast<uint64_t*>(payload.data());
+               for(size_t i = sizeof(uint64_t); i < payload.size(); ++i, ++address)
+               {
+                  std::vector<uint8_t> &page = icache[address & Sift::ICACHE_PAGE_MASK];
+                  page.resize(Sift::ICACHE_SIZE);
+                  page[address & Sift::ICACHE_OFFSET_MASK] = payload[i];
+               }
+               break;
+            }
+            case Sift::RecOtherLogical2Physical:
+            {
+               uint64_t vp = reinterpret_cast<uint64_t*>(payload.data())[0];
+               vcache[vp] = reinterpret_cast<uint64_t*>(payload.data())[1];
+               vcache_sent.insert(vp);
+               break;
+            }
+            case Sift::RecOtherISAChange:
+               isa_valid = true;
+               isa = *reinterpret_cast<uint32_t*>(payload.data());
+               break;
+            case Sift::RecOtherEnd:
+               seen_end = true;
+               break;
+            default:
+               break;
+         }
+
+         output->write(reinterpret_cast<char*>(&rec), sizeof(rec.Other));
+         output->write(reinterpret_cast<char*>(payload.data()), rec.Other.size);
+         continue;
+      }
+
+      uint64_t addr;
+      uint8_t size, num_addresses;
+      bool simple = (byte & 0xf) != 0;
+      if (simple)
+      {
+         input->read(reinterpret_cast<char*>(&rec), sizeof(rec.Instruction));
+         addr = last_address;
+         size = rec.Instruction.size;
+         num_addresses = rec.Instruction.num_addresses;
+      }
+      else
+      {
+         input->read(reinterpret_cast<char*>(&rec), sizeof(rec.InstructionExt));
+         addr = rec.InstructionExt.addr;
+         size = rec.InstructionExt.size;
+         num_addresses = rec.InstructionExt.num_addresses;
+      }
+      uint64_t addresses[Sift::MAX_DYNAMIC_ADDRESSES];
+      input->read(reinterpret_cast<char*>(addresses), num_addresses * sizeof(uint64_t));
+
+      if (blocked)
+      {
+         if (icount - block_start >= block_size || blocked->full())
+         {
+            blocked->nextBlock(icount);
+            block_start = icount;
+            icache_sent.clear();
+            vcache_sent.clear();
+            out_last_address = 0;
+            if (isa_valid)
+               writeOther(output, Sift::RecOtherISAChange, &isa, sizeof(isa));
+         }
+
+         for(uint64_t base_addr = addr & Sift::ICACHE_PAGE_MASK; base_addr <= ((addr + size - 1) & Sift::ICACHE_PAGE_MASK); base_addr += Sift::ICACHE_SIZE)
+         {
+            if (icache_sent.count(base_addr) == 0 && icache.count(base_addr))
+            {
+               std::vector<uint8_t> data(sizeof(uint64_t) + Sift::ICACHE_SIZE);
+               memcpy(data.data(), &base_addr, sizeof(uint64_t));
+               memcpy(data.data() + sizeof(uint64_t), icache[base_addr].data(), Sift::ICACHE_SIZE);
+               writeOther(output, Sift::RecOtherIcache, data.data(), data.size());
+               icache_sent.insert(base_addr);
+            }
+         }
+
+         for(int i = -1; i < num_addresses; ++i)
+         {
+            uint64_t vp = (i < 0 ? addr : addresses[i]) / Sift::PAGE_SIZE_SIFT;
+            if (vcache_sent.count(vp) == 0 && vcache.count(vp))
+            {
+               uint64_t data[2] = { vp, vcache[vp] };
+               writeOther(output, Sift::RecOtherLogical2Physical, data, sizeof(data));
+               vcache_sent.insert(vp);
+            }
+         }
+      }
+
+      if (simple && addr != out_last_address)
+      {
+         // The simple record relies on the previous instruction, which is in another block now
+         Sift::Record ext;
+         memset(&ext, 0, sizeof(ext));
+         ext.InstructionExt.size = size;
+         ext.InstructionExt.num_addresses = num_addresses;
+         ext.InstructionExt.is_branch = rec.Instruction.is_branch;
+         ext.InstructionExt.taken = rec.Instruction.taken;
+         ext.InstructionExt.is_predicate = 0;
+         ext.InstructionExt.executed = 1;
+         ext.InstructionExt.addr = addr;
+         output->write(reinterpret_cast<char*>(&ext), sizeof(ext.InstructionExt));
+      }
+      else if (simple)
+         output->write(reinterpret_cast<char*>(&rec), sizeof(rec.Instruction));
+      else
+         output->write(reinterpret_cast<char*>(&rec), sizeof(rec.InstructionExt));
+      output->write(reinterpret_cast<char*>(addresses), num_addresses * sizeof(uint64_t));
+
+      last_address = out_last_address = addr + size;
+      ++icount;
+   }
+
+   delete input;
+   delete output;
+
+   fprintf(stderr, "Converted %" PRId64 " instructions\n", icount);
+   return seen_end ? 0 : 1;
+}
+
 int main(int argc, char* argv[])
 {
    if (argc > 1 && strcmp(argv[1], "-d") == 0)
@@ -65,11 +295,29 @@ int main(int argc, char* argv[])
          eip_last = it->first + it->second->size;
       }
    }
+   else if (argc > 4 && strcmp(argv[1], "-c") == 0)
+   {
+      return convert(argv[2], argv[3], argv[4]);
+   }
    else if (argc > 1)
    {
-      Sift::Reader reader(argv[1]);
+      const char *filename = argv[1];
+      uint64_t seek = 0;
+      if (argc > 3 && strcmp(argv[1], "-s") == 0)
+      {
+         seek = strtoull(argv[2], NULL, 0);
+         filename = argv[3];
+      }
+
+      Sift::Reader reader(filename);
       //const xed_syntax_enum_t syntax = XED_SYNTAX_ATT;
 
+      if (seek && !reader.Seek(seek))
+      {
+         fprintf(stderr, "Cannot seek in %s, only block-compressed traces with an index, read from a regular file, support seeking\n", filename);
+         return 1;
+      }
+
       Sift::Instruction inst;
       while(reader.Read(inst))
       {
@@ -101,5 +349,7 @@ int main(int argc, char* argv[])
    else
    {
       printf("Usage: %s [-d] <file.sift>\n", argv[0]);
+      printf("       %s -s <icount> <file.sift>             Dump from the block containing instruction <icount>\n", argv[0]);
+      printf("       %s -c none|zlib|blocked[:N] <in.sift> <out.sift>   Convert to another compression format\n", argv[0]);
    }
 }
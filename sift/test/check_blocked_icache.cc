@@ -0,0 +1,88 @@
+// Regression check for block-compressed traces: every block resends the icache pages it uses, the reader must
+// reuse the pages it already has rather than allocate new ones. Writes a trace of many small blocks over a fixed
+// set of code pages, reads it back, and checks that heap use stays flat once the first blocks have been read.
+// (The resident set size is no good here: it includes the pages of the memory-mapped trace.)
+//
+// Usage: check_blocked_icache [instructions] [block size]
+
+#include "sift_writer.h"
+#include "sift_reader.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <stdint.h>
+#include <malloc.h>
+
+static const uint64_t CODE_PAGES = 16;
+static const uint64_t PAGE_SIZE = 4096;
+static uint8_t code[(CODE_PAGES + 1) * PAGE_SIZE];
+
+static void getCode(uint8_t *dst, const uint8_t *src, uint32_t size)
+{
+   memcpy(dst, src, size);
+}
+
+// Heap memory in use, in bytes
+static uint64_t heapInUse()
+{
+   struct mallinfo2 info = mallinfo2();
+   return info.uordblks + info.hblkhd;
+}
+
+int main(int argc, const char* argv[])
+{
+   uint64_t instructions = argc > 1 ? strtoull(argv[1], NULL, 0) : 2000000;
+   uint64_t block_size = argc > 2 ? strtoull(argv[2], NULL, 0) : 1000;
+   char filename[] = "/tmp/check_blocked_icache.XXXXXX";
+   int fd = mkstemp(filename);
+   if (fd < 0)
+   {
+      std::cerr << "Cannot create temporary file" << std::endl;
+      return 1;
+   }
+   close(fd);
+
+   // 4-byte nops, spread over all code pages
+   memset(code, 0x90, sizeof(code));
+   uint64_t base = ((uint64_t)code + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+   {
+      Sift::Writer writer(filename, getCode, true, "", 0, false, false, false, NULL, NULL, block_size);
+      for(uint64_t i = 0; i < instructions; ++i)
+      {
+         uint64_t addr = base + (i % CODE_PAGES) * PAGE_SIZE + (i / CODE_PAGES % (PAGE_SIZE / 4)) * 4;
+         writer.Instruction(addr, 4, 0, NULL, false, false, false, true);
+      }
+      writer.End();
+   }
+
+   Sift::Reader reader(filename);
+   Sift::Instruction inst;
+   uint64_t count = 0, heap_warm = 0;
+   while(reader.Read(inst))
+   {
+      if (++count == instructions / 10)
+         heap_warm = heapInUse();
+   }
+   uint64_t heap_end = heapInUse();
+   unlink(filename);
+
+   std::cout << count << " instructions in blocks of " << block_size << ", heap " << (heap_warm >> 20) << " MB after 10%, "
+      << (heap_end >> 20) << " MB at the end" << std::endl;
+
+   if (count != instructions)
+   {
+      std::cout << "FAIL: read " << count << " instructions, expected " << instructions << std::endl;
+      return 1;
+   }
+   // Everything the reader needs is there after the first blocks, allow some slack
+   if (heap_end > heap_warm + (1 << 20))
+   {
+      std::cout << "FAIL: heap use grows while reading" << std::endl;
+      return 1;
+   }
+   std::cout << "OK" << std::endl;
+   return 0;
+}
@@ -36,8 +36,9 @@ izstream::~izstream()
 {
 }
 
-void izstream::read(char* s, std::streamsize n)
+std::streamsize izstream::readsome(char* s, std::streamsize n)
 {
+   return 0;
 }
 
 int izstream::peek()
@@ -114,17 +115,19 @@ izstream::~izstream()
    delete input;
 }
 
-void izstream::read(char* s, std::streamsize n)
+std::streamsize izstream::readsome(char* s, std::streamsize n)
 {
+   std::streamsize count = 0;
    if (peek_valid)
    {
       s[0] = peek_value;
       peek_valid = false;
       ++s;
       --n;
+      ++count;
    }
    if (n == 0)
-      return;
+      return count;
 
    zstream.next_out = (Bytef*)s;
    zstream.avail_out = n;
@@ -133,9 +136,19 @@ void izstream::read(char* s, std::streamsize n)
    {
       if (zstream.avail_in == 0) // If input data was left over from the previous call, use that up first
       {
-         input->read(buffer, chunksize);
-         zstream.next_in = (Bytef*)buffer;
-         zstream.avail_in = chunksize;
+         std::streamsize mappable = std::min(input->mappable(), std::streamsize(chunksize));
+         if (mappable > 0)
+         {
+            // Inflate straight out of a memory-mapped input instead of copying it into our buffer first
+            zstream.next_in = (Bytef*)input->map(mappable);
+            zstream.avail_in = mappable;
+         }
+         else
+         {
+            input->read(buffer, chunksize);
+            zstream.next_in = (Bytef*)buffer;
+            zstream.avail_in = chunksize;
+         }
       }
       int ret = inflate(&zstream, Z_NO_FLUSH);
       if (ret == Z_STREAM_END) {
@@ -143,11 +156,13 @@ void izstream::read(char* s, std::streamsize n)
          if (zstream.avail_out)
          {
             m_fail = true;
-            return;
+            return count + n - zstream.avail_out;
          }
       } else
          assert(ret == Z_OK);
    } while(zstream.avail_out != 0);
+
+   return count + n;
 }
 
 int izstream::peek()
@@ -220,3 +235,436 @@ bool cvifstream::fail() const
 {
 	return this->stream == NULL;
 }
+
+#if SIFT_USE_MMAP
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+#include <cstring>
+
+vimstream::vimstream(const char * filename)
+   : base(NULL)
+   , length(0)
+   , pos(0)
+   , prefetched(0)
+   , released(0)
+   , m_fail(true)
+{
+#if SIFT_USE_MMAP
+   int fd = open(filename, O_RDONLY);
+   if (fd < 0)
+      return;
+
+   // Only regular files can be mapped, FIFOs and other special files should use a normal stream
+   struct stat filestatus;
+   if (fstat(fd, &filestatus) == 0 && S_ISREG(filestatus.st_mode) && filestatus.st_size > 0)
+   {
+      void *ptr = mmap(NULL, filestatus.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (ptr != MAP_FAILED)
+      {
+         base = (const char*)ptr;
+         length = filestatus.st_size;
+         m_fail = false;
+         madvise(ptr, length, MADV_SEQUENTIAL);
+         prefetch();
+      }
+   }
+   // The mapping stays valid after closing its file descriptor
+   close(fd);
+#endif
+}
+
+vimstream::~vimstream()
+{
+#if SIFT_USE_MMAP
+   if (base)
+      munmap((void*)base, length);
+#endif
+}
+
+void vimstream::read(char* s, std::streamsize n)
+{
+   if (pos + n > length)
+   {
+      // Mimic std::istream: copy what is left, then flag the failure
+      n = length - pos;
+      m_fail = true;
+   }
+   memcpy(s, base + pos, n);
+   advance(n);
+}
+
+void vimstream::prefetch()
+{
+#if SIFT_USE_MMAP
+   const size_t pagesize = sysconf(_SC_PAGESIZE);
+
+   // Drop the pages we are done with so replaying multi-GB traces does not grow our resident set,
+   // keeping one readahead window behind the read pointer for anyone still holding a map()ed pointer
+   size_t consumed = pos > readahead ? (pos - readahead) & ~(pagesize - 1) : 0;
+   if (consumed > released)
+   {
+      madvise((void*)(base + released), consumed - released, MADV_DONTNEED);
+      released = consumed;
+   }
+
+   // Ask the kernel to start reading in the next window
+   size_t start = std::max(prefetched, pos) & ~(pagesize - 1);
+   size_t end = std::min(pos + readahead, length);
+   if (start < end)
+      madvise((void*)(base + start), end - start, MADV_WILLNEED);
+#endif
+   prefetched = pos + readahead;
+}
+
+bool vimstream::seek(uint64_t _pos)
+{
+   if (!base || _pos > length)
+      return false;
+   pos = _pos;
+   m_fail = false;
+   prefetched = 0;
+   released = std::min(released, pos);
+   prefetch();
+   return true;
+}
+
+uint64_t vifstream::size()
+{
+   std::streampos cur = stream->tellg();
+   stream->seekg(0, std::ios::end);
+   std::streampos end = stream->tellg();
+   stream->seekg(cur);
+   return end < 0 ? 0 : uint64_t(end);
+}
+
+#if SIFT_USE_ZLIB
+# include <zlib.h>
+#endif
+
+obzstream::obzstream(vostream *output, uint64_t offset)
+   : output(output)
+   , offset(offset)
+   , block_icount(0)
+{
+#if !SIFT_USE_ZLIB
+   assert(false);
+#endif
+}
+
+obzstream::~obzstream()
+{
+   writeBlock();
+
+   Sift::BlockTrailer trailer = { offset, index.size(), Sift::IndexMagicNumber };
+   output->write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(Sift::BlockIndexEntry));
+   output->write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+   output->flush();
+   delete output;
+}
+
+void obzstream::nextBlock(uint64_t icount)
+{
+   writeBlock();
+   block_icount = icount;
+}
+
+void obzstream::writeBlock()
+{
+   if (buffer.empty())
+      return;
+
+#if SIFT_USE_ZLIB
+   uLongf compressed_size = compressBound(buffer.size());
+   compressed.resize(compressed_size);
+   int ret = compress2((Bytef*)compressed.data(), &compressed_size, (const Bytef*)buffer.data(), buffer.size(), level);
+   assert(ret == Z_OK);
+
+   Sift::BlockHeader hdr = { Sift::BlockMagicNumber, uint32_t(compressed_size), uint32_t(buffer.size()), block_icount };
+   Sift::BlockIndexEntry entry = { offset, block_icount };
+   index.push_back(entry);
+
+   output->write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+   output->write(compressed.data(), compressed_size);
+   offset += sizeof(hdr) + compressed_size;
+#endif
+
+   buffer.clear();
+}
+
+
+
+ibzstream::ibzstream(vistream *input, bool seekable)
+   : input(input)
+   , m_fail(false)
+   , length(0)
+   , pos(0)
+   , m_block_icount(0)
+   , m_index_loaded(false)
+   , m_seekable(seekable)
+{
+}
+
+ibzstream::~ibzstream()
+{
+   delete input;
+}
+
+bool ibzstream::nextBlock()
+{
+   Sift::BlockHeader hdr;
+   input->read(reinterpret_cast<char*>(&hdr), sizeof(hdr));
+   if (input->fail() || hdr.magic != Sift::BlockMagicNumber)
+      return false;
+
+   // Inflate straight out of a memory-mapped input when we can, else copy the compressed block in first
+   const char *data = input->map(hdr.compressed_size);
+   if (!data)
+   {
+      compressed.resize(hdr.compressed_size);
+      input->read(compressed.data(), hdr.compressed_size);
+      if (input->fail())
+         return false;
+      data = compressed.data();
+   }
+
+#if SIFT_USE_ZLIB
+   buffer.resize(hdr.size);
+   uLongf size = hdr.size;
+   int ret = uncompress((Bytef*)buffer.data(), &size, (const Bytef*)data, hdr.compressed_size);
+   if (ret != Z_OK || size != hdr.size)
+      return false;
+#else
+   return false;
+#endif
+
+   length = hdr.size;
+   pos = 0;
+   m_block_icount = hdr.icount;
+
+   return length > 0;
+}
+
+std::streamsize ibzstream::readsome(char* s, std::streamsize n)
+{
+   std::streamsize count = 0;
+   while (count < n)
+   {
+      if (pos == length && !nextBlock())
+      {
+         m_fail = true;
+         break;
+      }
+      size_t amount = std::min(size_t(n - count), length - pos);
+      memcpy(s + count, buffer.data() + pos, amount);
+      pos += amount;
+      count += amount;
+   }
+   return count;
+}
+
+bool ibzstream::loadIndex()
+{
+   if (m_index_loaded)
+      return !m_index.empty();
+   m_index_loaded = true;
+
+   if (!m_seekable)
+      return false;
+
+   // Read the trailer and index, then return to where we were so a missing index does not disturb sequential reading
+   uint64_t position = input->tell();
+   uint64_t filesize = input->size();
+   Sift::BlockTrailer trailer;
+   if (filesize >= sizeof(trailer) && input->seek(filesize - sizeof(trailer)))
+   {
+      input->read(reinterpret_cast<char*>(&trailer), sizeof(trailer));
+      if (!input->fail() && trailer.magic == Sift::IndexMagicNumber
+          && trailer.index_offset + trailer.num_blocks * sizeof(Sift::BlockIndexEntry) + sizeof(trailer) == filesize
+          && input->seek(trailer.index_offset))
+      {
+         m_index.resize(trailer.num_blocks);
+         input->read(reinterpret_cast<char*>(m_index.data()), trailer.num_blocks * sizeof(Sift::BlockIndexEntry));
+         if (input->fail())
+            m_index.clear();
+      }
+   }
+   input->seek(position);
+
+   return !m_index.empty();
+}
+
+bool ibzstream::seekInstruction(uint64_t icount, uint64_t &block_icount)
+{
+   if (!loadIndex())
+      return false;
+
+   // Find the last block that starts at or before icount
+   std::vector<Sift::BlockIndexEntry>::const_iterator it = std::upper_bound(m_index.begin(), m_index.end(), icount,
+      [](uint64_t icount, const Sift::BlockIndexEntry &entry) { return icount < entry.icount; });
+   if (it != m_index.begin())
+      --it;
+
+   if (!input->seek(it->offset))
+      return false;
+
+   length = pos = 0;
+   m_fail = !nextBlock();
+   block_icount = m_block_icount;
+
+   return !m_fail;
+}
+
+
+
+#if SIFT_USE_THREADS
+#include <chrono>
+
+iastream::iastream(vistream *input)
+   : input(input)
+   , head(0)
+   , tail(0)
+   , m_eof(false)
+   , m_stop(false)
+   , producer_waiting(false)
+   , consumer_waiting(false)
+   , running(false)
+   , ptr(NULL)
+   , length(0)
+   , pos(0)
+   , m_fail(false)
+   , m_stall_time(0)
+   , m_stalls(0)
+{
+   for(size_t i = 0; i < num_chunks; ++i)
+   {
+      chunks[i].resize(chunksize);
+      lengths[i] = 0;
+   }
+   start();
+}
+
+iastream::~iastream()
+{
+   stop();
+   delete input;
+}
+
+void iastream::start()
+{
+   assert(!running);
+   head = tail = 0;
+   m_eof = false;
+   m_stop = false;
+   ptr = NULL;
+   length = pos = 0;
+   m_fail = false;
+   thread = std::thread(&iastream::produce, this);
+   running = true;
+}
+
+void iastream::stop()
+{
+   if (!running)
+      return;
+   m_stop = true;
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      cond.notify_all();
+   }
+   thread.join();
+   running = false;
+}
+
+void iastream::wake(std::atomic<bool> &waiting)
+{
+   // The waiting side sets its flag before re-checking head/tail, so either it sees our update or we see its flag
+   if (waiting)
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      cond.notify_all();
+   }
+}
+
+void iastream::produce()
+{
+   while (!m_stop)
+   {
+      if (head - tail == num_chunks)
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         producer_waiting = true;
+         cond.wait(lock, [this]{ return head - tail < num_chunks || m_stop; });
+         producer_waiting = false;
+         continue;
+      }
+
+      size_t idx = head % num_chunks;
+      lengths[idx] = input->readsome(chunks[idx].data(), chunksize);
+      if (lengths[idx])
+         ++head;
+      if (lengths[idx] < chunksize)
+         m_eof = true;
+      wake(consumer_waiting);
+      if (m_eof)
+         break;
+   }
+}
+
+bool iastream::nextChunk()
+{
+   // Release the chunk we were reading from
+   if (ptr)
+   {
+      ptr = NULL;
+      length = pos = 0;
+      ++tail;
+      wake(producer_waiting);
+   }
+
+   if (head == tail)
+   {
+      if (m_eof)
+         return false;
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         consumer_waiting = true;
+         cond.wait(lock, [this]{ return head != tail || m_eof; });
+         consumer_waiting = false;
+      }
+      m_stall_time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+      ++m_stalls;
+
+      // Chunks are published before m_eof is set, so an empty ring now means the input is exhausted
+      if (head == tail)
+         return false;
+   }
+
+   size_t idx = tail % num_chunks;
+   ptr = chunks[idx].data();
+   length = lengths[idx];
+   pos = 0;
+   return true;
+}
+
+void iastream::read(char* s, std::streamsize n)
+{
+   while (n > 0)
+   {
+      if (pos == length && !nextChunk())
+      {
+         m_fail = true;
+         return;
+      }
+      size_t amount = std::min(size_t(n), length - pos);
+      memcpy(s, ptr + pos, amount);
+      pos += amount;
+      s += amount;
+      n -= amount;
+   }
+}
+#endif
@@ -6,10 +6,18 @@
 #include <ostream>
 #include <istream>
 #include <fstream>
+#include <cstdio>
+#include <vector>
 
 #if SIFT_USE_ZLIB
 # include <zlib.h>
 #endif
+#if SIFT_USE_THREADS
+# include <atomic>
+# include <condition_variable>
+# include <mutex>
+# include <thread>
+#endif
 
 class vostream
 {
@@ -66,6 +74,40 @@ class ozstream : public vostream
 
 
 
+// Block-compressed output (Sift::CompressionBlocked): data is collected until the writer
+// calls nextBlock() at an instruction boundary, after which it is compressed as one BlockHeader + zlib block.
+// The block index and trailer are appended when the stream is destroyed.
+class obzstream : public vostream
+{
+   private:
+      vostream *output;
+      static const int level = 9;
+      static const size_t max_block_size = 256*1024*1024;
+      std::vector<char> buffer;
+      std::vector<char> compressed;
+      std::vector<Sift::BlockIndexEntry> index;
+      uint64_t offset;
+      uint64_t block_icount;
+      void writeBlock();
+   public:
+      obzstream(vostream *output, uint64_t offset);
+      virtual ~obzstream();
+      virtual void write(const char* s, std::streamsize n)
+         { buffer.insert(buffer.end(), s, s + n); }
+      virtual void flush()
+         { output->flush(); }
+      virtual bool fail()
+         { return output->fail(); }
+      virtual bool is_open()
+         { return output->is_open(); }
+      // Close the current block, the next one starts with instruction number icount
+      void nextBlock(uint64_t icount);
+      // Whether the current block has grown large enough to be closed, regardless of its instruction count
+      bool full() const { return buffer.size() >= max_block_size; }
+};
+
+
+
 class vistream
 {
    public:
@@ -73,6 +115,18 @@ class vistream
       virtual void read(char* s, std::streamsize n) = 0;
       virtual int peek() = 0;
       virtual bool fail() const = 0;
+      // Read up to n bytes, returns how many were read: less than n only at the end of the stream
+      virtual std::streamsize readsome(char* s, std::streamsize n)
+         { read(s, n); return fail() ? 0 : n; }
+      // Zero-copy access: return a pointer to the next n bytes and advance past them,
+      // or NULL if this stream cannot provide them in place
+      virtual const char* map(std::streamsize n) { return NULL; }
+      // Number of bytes left that can be map()ed, zero if map() is not supported
+      virtual std::streamsize mappable() const { return 0; }
+      // Random access, only supported by file-backed streams
+      virtual bool seek(uint64_t pos) { return false; }
+      virtual uint64_t tell() { return 0; }
+      virtual uint64_t size() { return 0; }
 };
 
 class vifstream : public vistream
@@ -90,6 +144,11 @@ class vifstream : public vistream
       virtual int peek()
          { return stream->peek(); }
       virtual bool fail() const { return stream->fail(); }
+      virtual bool seek(uint64_t pos)
+         { stream->clear(); stream->seekg(pos); return !stream->fail(); }
+      virtual uint64_t tell()
+         { return stream->tellg(); }
+      virtual uint64_t size();
 };
 
 class cvifstream : public vistream
@@ -108,6 +167,51 @@ class cvifstream : public vistream
 	   virtual bool fail() const;
 };
 
+// Read-only memory mapping of a regular file, read sequentially
+class vimstream final : public vistream
+{
+   private:
+      static const size_t readahead = 16*1024*1024;
+      const char *base;
+      size_t length;
+      size_t pos;
+      size_t prefetched;
+      size_t released;
+      bool m_fail;
+      void prefetch();
+      void advance(size_t n)
+      {
+         pos += n;
+         if (pos + readahead / 2 > prefetched)
+            prefetch();
+      }
+   public:
+      vimstream(const char * filename);
+      virtual ~vimstream();
+      bool is_open() const { return base != NULL; }
+      virtual void read(char* s, std::streamsize n);
+      virtual int peek()
+      {
+         if (pos < length)
+            return (uint8_t)base[pos];
+         m_fail = true;
+         return EOF;
+      }
+      virtual bool fail() const { return m_fail; }
+      virtual const char* map(std::streamsize n)
+      {
+         if (pos + n > length)
+            return NULL;
+         const char *ptr = base + pos;
+         advance(n);
+         return ptr;
+      }
+      virtual std::streamsize mappable() const { return length - pos; }
+      virtual bool seek(uint64_t pos);
+      virtual uint64_t tell() { return pos; }
+      virtual uint64_t size() { return length; }
+};
+
 class izstream : public vistream
 {
    private:
@@ -124,10 +228,126 @@ class izstream : public vistream
    public:
       izstream(vistream *input);
       virtual ~izstream();
-      virtual void read(char* s, std::streamsize n);
+      virtual void read(char* s, std::streamsize n)
+         { readsome(s, n); }
+      virtual std::streamsize readsome(char* s, std::streamsize n);
       virtual int peek();
       virtual bool eof() const { return m_eof; }
       virtual bool fail() const { return m_fail; }
 };
 
+// Block-compressed input (Sift::CompressionBlocked). Each block is inflated as a whole, so records can be
+// map()ed straight out of the decompressed buffer, and the block index allows seeking when the input is a file.
+class ibzstream final : public vistream
+{
+   private:
+      vistream *input;
+      bool m_fail;
+      std::vector<char> buffer;
+      std::vector<char> compressed;
+      size_t length;
+      size_t pos;
+      uint64_t m_block_icount;
+      std::vector<Sift::BlockIndexEntry> m_index;
+      bool m_index_loaded;
+      const bool m_seekable;
+      bool nextBlock();
+      bool loadIndex();
+   public:
+      // seekable: input is a regular file. Pipes and FIFOs must never be seeked on, not even to look for the index,
+      // as that would put the stream in a failed state while it is still being read.
+      ibzstream(vistream *input, bool seekable);
+      virtual ~ibzstream();
+      virtual void read(char* s, std::streamsize n)
+         { readsome(s, n); }
+      virtual std::streamsize readsome(char* s, std::streamsize n);
+      virtual int peek()
+      {
+         if (pos < length || nextBlock())
+            return (uint8_t)buffer[pos];
+         m_fail = true;
+         return EOF;
+      }
+      virtual bool fail() const { return m_fail; }
+      virtual const char* map(std::streamsize n)
+      {
+         // Blocks end on record boundaries, so a record never straddles two blocks
+         if (pos + n > length)
+            return NULL;
+         const char *ptr = buffer.data() + pos;
+         pos += n;
+         return ptr;
+      }
+      virtual std::streamsize mappable() const { return length - pos; }
+      // Position the stream at the start of the last block that begins at or before instruction number icount.
+      // Returns false if the input cannot seek or has no valid index, otherwise block_icount is set to the
+      // number of instructions that precede the new position.
+      bool seekInstruction(uint64_t icount, uint64_t &block_icount);
+      bool isSeekable() const { return m_seekable; }
+      uint64_t getBlockInstructionCount() const { return m_block_icount; }
+};
+
+#if SIFT_USE_THREADS
+// Reads ahead from another stream (usually a decompressing one) on a helper thread, so that decompression
+// is taken off the consumer's critical path. The helper fills fixed-size chunks that are handed over
+// through a lock-free single-producer, single-consumer ring; either side only sleeps when the ring is full or empty.
+class iastream final : public vistream
+{
+   private:
+      static const size_t num_chunks = 4;
+      static const size_t chunksize = 1024*1024;
+      vistream *input;
+      std::vector<char> chunks[num_chunks];
+      size_t lengths[num_chunks];
+      std::atomic<uint64_t> head;         //< Number of chunks filled by the producer
+      std::atomic<uint64_t> tail;         //< Number of chunks released by the consumer
+      std::atomic<bool> m_eof;            //< Producer reached the end of the input, no more chunks will follow
+      std::atomic<bool> m_stop;
+      std::atomic<bool> producer_waiting;
+      std::atomic<bool> consumer_waiting;
+      std::mutex mutex;
+      std::condition_variable cond;
+      std::thread thread;
+      bool running;
+      // Consumer state
+      const char *ptr;
+      size_t length;
+      size_t pos;
+      bool m_fail;
+      uint64_t m_stall_time;              //< Time the consumer spent waiting for the producer, in nanoseconds
+      uint64_t m_stalls;
+      void produce();
+      bool nextChunk();
+      void wake(std::atomic<bool> &waiting);
+   public:
+      iastream(vistream *input);
+      virtual ~iastream();
+      virtual void read(char* s, std::streamsize n);
+      virtual int peek()
+      {
+         if (pos < length || nextChunk())
+            return (uint8_t)ptr[pos];
+         m_fail = true;
+         return EOF;
+      }
+      virtual bool fail() const { return m_fail; }
+      virtual const char* map(std::streamsize n)
+      {
+         // Chunks do not follow record boundaries, the caller falls back to read() for records that straddle two
+         if (pos + n > length)
+            return NULL;
+         const char *data = ptr + pos;
+         pos += n;
+         return data;
+      }
+      virtual std::streamsize mappable() const { return length - pos; }
+      // Stop the helper thread and drop everything read ahead, e.g. to reposition the underlying stream
+      void stop();
+      // (Re)start reading ahead from the current position of the underlying stream
+      void start();
+      uint64_t getStallTime() const { return m_stall_time; }
+      uint64_t getStalls() const { return m_stalls; }
+};
+#endif
+
 #endif // __ZFSTREAM_H
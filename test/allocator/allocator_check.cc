@@ -0,0 +1,149 @@
+// Check for PoolAllocator with threads that come and go, as application threads do in the simulator:
+// the heaps of a thread that exits must be reused by later threads, also when objects allocated from them
+// are still out and are freed by another thread, and the allocation count must not lose any updates.
+//
+// Every round starts a few threads that each allocate a number of objects, free most of them and hand the
+// others to the main thread, which frees them after the threads have exited. Meanwhile, another thread keeps
+// reading the allocation count, like the statistics do. Without reuse, every round adds new blocks to the pool.
+//
+// Only PoolAllocator is the real simulator code, logging is replaced by the stand-ins below.
+//
+// Usage: allocator_check [<rounds>]
+
+#include "allocator.h"
+#include "log.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
+#include <unistd.h>
+
+
+// Stand-ins for logging, the allocator only logs when something is wrong
+
+Log *Log::getSingleton()
+{
+   fprintf(stderr, "PoolAllocator error\n");
+   abort();
+}
+String Log::getModule(const char *filename) { return filename; }
+bool Log::isEnabled(const char *module) { return false; }
+void Log::log(ErrorState err, const char *source_file, SInt32 source_line, const char *format, ...) { abort(); }
+
+
+struct Object
+{
+   UInt64 a, b;
+};
+
+static const UInt32 THREADS = 4;
+static const UInt64 OBJECTS = 20000;
+// Objects every thread leaves for the main thread to free
+static const UInt64 HANDED_OVER = OBJECTS / 4;
+
+static TypedAllocator<Object> *s_allocator;
+static volatile bool s_done;
+// Not allocated by the threads themselves, so only the pool can make resident memory grow
+static void *s_objects[THREADS][OBJECTS];
+static void *s_handed_over[THREADS][HANDED_OVER];
+
+static UInt64 getResidentKB()
+{
+   UInt64 size = 0, resident = 0;
+   FILE *fp = fopen("/proc/self/statm", "r");
+   if (fp)
+   {
+      if (fscanf(fp, "%" SCNu64 " %" SCNu64, &size, &resident) != 2)
+         resident = 0;
+      fclose(fp);
+   }
+   return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void* runThread(void *arg)
+{
+   UInt64 t = (UInt64)arg;
+   void **objects = s_objects[t];
+   void **handed_over = s_handed_over[t];
+   for(UInt64 i = 0; i < OBJECTS; ++i)
+      objects[i] = s_allocator->alloc(sizeof(Object));
+   for(UInt64 i = 0; i < OBJECTS; ++i)
+   {
+      if (i % 4 == 0)
+         handed_over[i / 4] = objects[i];
+      else
+         Allocator::dealloc(objects[i]);
+   }
+   return NULL;
+}
+
+static void* runReader(void *arg)
+{
+   UInt64 last = 0;
+   while (!s_done)
+   {
+      UInt64 allocations = s_allocator->getAllocations();
+      if (allocations < last)
+      {
+         printf("allocation count went down from %" PRIu64 " to %" PRIu64 "\n", last, allocations);
+         exit(1);
+      }
+      last = allocations;
+   }
+   return NULL;
+}
+
+
+int main(int argc, char **argv)
+{
+   UInt64 rounds = argc > 1 ? strtoull(argv[1], NULL, 0) : 200;
+
+   s_allocator = new TypedAllocator<Object>();
+
+   pthread_t reader;
+   s_done = false;
+   pthread_create(&reader, NULL, runReader, NULL);
+
+   UInt64 resident_first = 0;
+   for(UInt64 r = 0; r < rounds; ++r)
+   {
+      pthread_t threads[THREADS];
+      for(UInt32 t = 0; t < THREADS; ++t)
+         pthread_create(&threads[t], NULL, runThread, (void*)(UInt64)t);
+      for(UInt32 t = 0; t < THREADS; ++t)
+         pthread_join(threads[t], NULL);
+      for(UInt32 t = 0; t < THREADS; ++t)
+         for(UInt64 i = 0; i < HANDED_OVER; ++i)
+            Allocator::dealloc(s_handed_over[t][i]);
+      if (r == 0)
+         resident_first = getResidentKB();
+   }
+   UInt64 resident_last = getResidentKB();
+
+   s_done = true;
+   pthread_join(reader, NULL);
+
+   bool ok = true;
+   UInt64 allocations = s_allocator->getAllocations();
+   if (allocations != rounds * THREADS * OBJECTS)
+   {
+      printf("%" PRIu64 " allocations counted instead of %" PRIu64 "\n", allocations, rounds * THREADS * OBJECTS);
+      ok = false;
+   }
+   // Later rounds run on the heaps of earlier threads. These can still grow: when the threads of a round run
+   // one after the other, they can all end up on the same heap, each leaving HANDED_OVER objects out.
+   // That bounds the pool, at 32 bytes per object, while without reuse it grows by 2.5 MB every round.
+   const UInt64 max_growth_kb = THREADS * (OBJECTS + (THREADS - 1) * HANDED_OVER) * 32 / 1024;
+   if (resident_last > resident_first + max_growth_kb)
+   {
+      printf("resident memory grew from %" PRIu64 " KB after the first round to %" PRIu64 " KB\n", resident_first, resident_last);
+      ok = false;
+   }
+   if (ok)
+      printf("%" PRIu64 " rounds of %u threads, %" PRIu64 " allocations, %" PRIu64 " KB resident\n", rounds, THREADS, allocations, resident_last);
+
+   // Reports any objects that were lost
+   delete s_allocator;
+
+   return ok ? 0 : 1;
+}
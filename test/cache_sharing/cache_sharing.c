@@ -0,0 +1,56 @@
+// Simulator throughput with a growing number of cores sharing one last-level cache.
+// Every thread makes random loads and stores to an array much larger than the private caches,
+// so nearly all of its accesses go to the shared cache, on sets picked independently from the other threads.
+
+#include "sim_api.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARRAY_SIZE (64 << 20)
+#define ACCESSES 1000000
+
+char *array;
+
+void * work(void * id)
+{
+   unsigned long x = (unsigned long)id * 7919 + 1, sum = 0;
+
+   for(long i = 0; i < ACCESSES; ++i)
+   {
+      x = x * 6364136223846793005UL + 1442695040888963407UL;
+      unsigned long offset = (x >> 16) % ARRAY_SIZE;
+      // One store for every three loads
+      if (i & 3)
+         sum += array[offset];
+      else
+         array[offset] = sum;
+   }
+
+   return (void *)sum;
+}
+
+int main(int argc, char **argv)
+{
+   int nthreads = argc > 1 ? atoi(argv[1]) : 1;
+   pthread_t threads[nthreads];
+
+   // Touch all pages up front, so page faults are not part of the region of interest
+   array = malloc(ARRAY_SIZE);
+   memset(array, 0, ARRAY_SIZE);
+
+   SimRoiStart();
+
+   for(long i = 1; i < nthreads; ++i)
+      pthread_create(&threads[i], NULL, work, (void *)i);
+   work((void *)0);
+   for(long i = 1; i < nthreads; ++i)
+      pthread_join(threads[i], NULL);
+
+   SimRoiEnd();
+
+   printf("%d threads done\n", nthreads);
+   return 0;
+}
@@ -0,0 +1,171 @@
+// Benchmark for the cache tag store: how long it takes to build and tear down a large cache, how much
+// memory its tags, blocks and replacement state take, and how fast lines can be looked up.
+//
+// The default is the 128 MB, 16-way DRAM cache of dram-cache.cfg, which has by far the most sets of any
+// cache in the shipped configurations. Only the cache classes are the real simulator code. The bits
+// of the simulator they reach out to (simulator singleton, stats, logging) are replaced by the minimal
+// stand-ins below, so the benchmark links without the rest of libcarbon_sim, Pin or XED.
+//
+// Usage: bench_cache_tags [<replacement policy> [<size in MB> [<associativity>]]]
+
+#include "simulator.h"
+#include "config.h"
+#include "log.h"
+#include "stats.h"
+#include "cache.h"
+#include "cache_block_info.h"
+#include "config_file.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/time.h>
+#include <unistd.h>
+
+
+// Stand-ins for the parts of the simulator that the cache uses
+
+Simulator *Simulator::m_singleton = NULL;
+config::Config *Simulator::m_config_file = NULL;
+bool Simulator::m_config_file_allowed = true;
+Config::SimulationMode Simulator::m_mode = Config::STANDALONE;
+dl::Decoder *Simulator::m_decoder = NULL;
+
+Config::Config(SimulationMode mode) {}
+Config::~Config() {}
+Log *Log::_singleton = NULL;
+Log::Log(Config &config) : _loggingEnabled(false), _anyLoggingEnabled(false) { _singleton = this; }
+Log::~Log() {}
+
+Simulator::Simulator()
+   : m_config(m_mode)
+   , m_log(m_config)
+   , m_stats_manager(new StatsManager())
+   , m_faultinjection_manager(NULL)
+{
+}
+
+void Simulator::setConfig(config::Config *cfg, Config::SimulationMode mode)
+{
+   m_config_file = cfg;
+   m_mode = mode;
+}
+
+void Simulator::allocate()
+{
+   m_singleton = new Simulator();
+}
+
+Log *Log::getSingleton() { return _singleton; }
+String Log::getModule(const char *filename) { return filename; }
+bool Log::isEnabled(const char *module) { return false; }
+void Log::log(ErrorState err, const char *source_file, SInt32 source_line, const char *format, ...)
+{
+   va_list args;
+   va_start(args, format);
+   fprintf(stderr, "%s:%d: ", source_file, source_line);
+   vfprintf(stderr, format, args);
+   va_end(args);
+   fprintf(stderr, "\n");
+   if (err == Error)
+      abort();
+}
+
+StatsManager::StatsManager() {}
+void StatsManager::registerMetric(StatsMetricBase *metric) {}
+template <> UInt64 makeStatsValue<UInt64>(UInt64 t) { return t; }
+
+
+static double getTime()
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static UInt64 getResidentKB()
+{
+   UInt64 size = 0, resident = 0;
+   FILE *fp = fopen("/proc/self/statm", "r");
+   if (fp)
+   {
+      if (fscanf(fp, "%" SCNu64 " %" SCNu64, &size, &resident) != 2)
+         resident = 0;
+      fclose(fp);
+   }
+   return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static UInt64 s_rng_state = 88172645463325252ULL;
+
+// xorshift64, so the access stream does not depend on the C library's rand()
+static UInt64 rnd()
+{
+   s_rng_state ^= s_rng_state << 13;
+   s_rng_state ^= s_rng_state >> 7;
+   s_rng_state ^= s_rng_state << 17;
+   return s_rng_state;
+}
+
+
+int main(int argc, char **argv)
+{
+   String policy = argc > 1 ? argv[1] : "lru";
+   UInt64 size_mb = argc > 2 ? strtoull(argv[2], NULL, 0) : 128;
+   UInt32 associativity = argc > 3 ? atoi(argv[3]) : 16;
+   const UInt32 block_size = 64;
+   const UInt32 num_sets = size_mb * 1024 * 1024 / (associativity * block_size);
+   // Only half of the lookups go to lines that were inserted, the others go to a different, empty part of the address space
+   const UInt64 num_lookups = 4 * UInt64(num_sets) * associativity;
+
+   config::ConfigFile *cfg = new config::ConfigFile();
+   cfg->loadConfigFromString(
+      "[perf_model/dram_cache/qbs]\n"
+      "attempts = 2\n"
+      "[perf_model/dram_cache/srrip]\n"
+      "bits = 2\n");
+   Simulator::setConfig(cfg, Config::STANDALONE);
+   Simulator::allocate();
+
+   UInt64 resident_start = getResidentKB();
+   double start = getTime();
+   Cache *cache = new Cache("dram-cache", "perf_model/dram_cache", 0, num_sets, associativity, block_size, policy, CacheBase::SHARED_CACHE);
+   double time_create = getTime() - start;
+   UInt64 resident_create = getResidentKB();
+
+   // Fill every way of every set
+   bool eviction;
+   IntPtr evict_addr;
+   CacheBlockInfo *evict_block_info = CacheBlockInfo::create(CacheBase::SHARED_CACHE);
+   start = getTime();
+   for(UInt64 i = 0; i < UInt64(num_sets) * associativity; ++i)
+      cache->insertSingleLine(i * block_size, NULL, &eviction, &evict_addr, evict_block_info, NULL, SubsecondTime::Zero());
+   double time_fill = getTime() - start;
+   UInt64 resident_fill = getResidentKB();
+
+   // Random lookups, updating the replacement state on a hit like the cache controllers do
+   UInt64 hits = 0;
+   start = getTime();
+   for(UInt64 i = 0; i < num_lookups; ++i)
+   {
+      UInt64 r = rnd();
+      IntPtr address = ((r >> 1) % (UInt64(num_sets) * associativity)) * block_size;
+      if (r & 1)
+         address += UInt64(num_sets) * associativity * block_size;
+      if (cache->accessSingleLine(address, Cache::LOAD, NULL, 0, SubsecondTime::Zero(), true))
+         ++hits;
+   }
+   double time_lookup = getTime() - start;
+
+   start = getTime();
+   delete cache;
+   double time_delete = getTime() - start;
+
+   printf("%s, %" PRIu64 " MB, %u-way (%u sets):\n", policy.c_str(), size_mb, associativity, num_sets);
+   printf("  create  %7.3f s, %6" PRIu64 " MB resident\n", time_create, (resident_create - resident_start) / 1024);
+   printf("  fill    %7.3f s, %6" PRIu64 " MB resident\n", time_fill, (resident_fill - resident_start) / 1024);
+   printf("  lookup  %7.3f s, %6.2f M lookups/s, %.1f%% hits\n", time_lookup, num_lookups / time_lookup / 1e6, 100. * hits / num_lookups);
+   printf("  delete  %7.3f s\n", time_delete);
+
+   return 0;
+}
@@ -0,0 +1,162 @@
+// Benchmark for the fast_nehalem tag lookup: the per-associativity Cache<assoc> instantiations that
+// createCache() picks for common associativities, against Cache<0>, which reads the associativity at run time
+// and is used for all others.
+//
+// Each configuration is a single cache level in front of DRAM. It is filled and then accessed at random
+// addresses in a working set of twice its size, so about half of the accesses miss and also run the LRU
+// replacement search.
+//
+// Only the fast_nehalem cache classes are the real simulator code. The bits of the simulator they reach
+// out to (simulator singleton, core, stats, logging) are replaced by the minimal stand-ins below, so the
+// benchmark links without the rest of libcarbon_sim, Pin or XED.
+//
+// Usage: bench_fast_cache [<million accesses per configuration>]
+
+#include "simulator.h"
+#include "config.h"
+#include "log.h"
+#include "core.h"
+#include "stats.h"
+#include "utils.h"
+#include "fast_nehalem/memory_manager.h"
+#include "fast_nehalem/fast_cache.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/time.h>
+
+
+// Stand-ins for the parts of the simulator that the caches use
+
+Simulator *Simulator::m_singleton = NULL;
+config::Config *Simulator::m_config_file = NULL;
+bool Simulator::m_config_file_allowed = true;
+Config::SimulationMode Simulator::m_mode = Config::STANDALONE;
+dl::Decoder *Simulator::m_decoder = NULL;
+
+Config::Config(SimulationMode mode) {}
+Config::~Config() {}
+Log *Log::_singleton = NULL;
+Log::Log(Config &config) : _loggingEnabled(false), _anyLoggingEnabled(false) { _singleton = this; }
+Log::~Log() {}
+
+Simulator::Simulator()
+   : m_config(m_mode)
+   , m_log(m_config)
+   , m_stats_manager(new StatsManager())
+{
+}
+
+void Simulator::allocate()
+{
+   m_singleton = new Simulator();
+}
+
+Log *Log::getSingleton() { return _singleton; }
+String Log::getModule(const char *filename) { return filename; }
+bool Log::isEnabled(const char *module) { return false; }
+void Log::log(ErrorState err, const char *source_file, SInt32 source_line, const char *format, ...)
+{
+   va_list args;
+   va_start(args, format);
+   fprintf(stderr, "%s:%d: ", source_file, source_line);
+   vfprintf(stderr, format, args);
+   va_end(args);
+   fprintf(stderr, "\n");
+   if (err == Error)
+      abort();
+}
+
+StatsManager::StatsManager() {}
+void StatsManager::registerMetric(StatsMetricBase *metric) {}
+template <> UInt64 makeStatsValue<UInt64>(UInt64 t) { return t; }
+template <> UInt64 makeStatsValue<SubsecondTime>(SubsecondTime t) { return t.getFS(); }
+
+BbvCount::BbvCount(core_id_t core_id) : m_core_id(core_id) {}
+BbvCount::~BbvCount() {}
+
+static ComponentPeriod *s_period;
+
+Core::Core(SInt32 id)
+   : m_core_id(id)
+   , m_dvfs_domain(s_period)
+   , m_bbv(id)
+{
+}
+
+
+static double getTime()
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static UInt64 s_rng_state = 88172645463325252ULL;
+
+// xorshift64, so the access stream does not depend on the C library's rand()
+static UInt64 rnd()
+{
+   s_rng_state ^= s_rng_state << 13;
+   s_rng_state ^= s_rng_state >> 7;
+   s_rng_state ^= s_rng_state << 17;
+   return s_rng_state;
+}
+
+static Core *s_core;
+static FastNehalem::Dram *s_dram;
+static UInt64 s_accesses;
+
+// Nanoseconds per access
+template <UInt32 assoc> static double run(UInt32 size_kb, UInt32 associativity)
+{
+   FastNehalem::Cache<assoc> cache(s_core, "L2", MemComponent::L2_CACHE, size_kb, associativity,
+      ComponentLatency(s_period, 8), ComponentLatency(s_period, 3), s_dram);
+
+   const UInt64 lines = UInt64(size_kb) * 1024 / 64;
+   HitWhere::where_t hit_where;
+   // Lines are addressed by their tag, the address divided by the line size, like MemoryManager does
+   for(UInt64 i = 0; i < lines; ++i)
+      cache.access(Core::READ, i, hit_where);
+
+   s_rng_state = 88172645463325252ULL;
+   SubsecondTime latency = SubsecondTime::Zero();
+   double start = getTime();
+   for(UInt64 i = 0; i < s_accesses; ++i)
+      latency += cache.access(Core::READ, rnd() % (2 * lines), hit_where);
+   double time = getTime() - start;
+
+   // Use the result, so the accesses cannot be optimized away
+   if (latency == SubsecondTime::Zero())
+      printf("no latency\n");
+   return time / s_accesses * 1e9;
+}
+
+template <UInt32 assoc> static void compare(UInt32 size_kb)
+{
+   double specialized = run<assoc>(size_kb, assoc);
+   double generic = run<0>(size_kb, assoc);
+   printf("  %6u KB %2u-way  Cache<%-2u> %6.2f ns  Cache<0> %6.2f ns  (%+.0f%%)\n",
+      size_kb, assoc, assoc, specialized, generic, 100. * (generic - specialized) / specialized);
+}
+
+
+int main(int argc, char **argv)
+{
+   s_accesses = (argc > 1 ? atoi(argv[1]) : 20) * 1000000ULL;
+
+   Simulator::allocate();
+   s_period = new ComponentPeriod(ComponentPeriod::fromFreqHz(2000000000ULL));
+   s_core = new Core(0);
+   s_dram = new FastNehalem::Dram(s_core, "dram", SubsecondTime::NS(60));
+
+   printf("%" PRIu64 " M accesses per configuration, time per access:\n", s_accesses / 1000000);
+   // L1, L2 and L3 sizes of the shipped configurations
+   compare<4>(32);
+   compare<8>(32);
+   compare<8>(256);
+   compare<16>(8192);
+
+   return 0;
+}
@@ -0,0 +1,309 @@
+// Regression test for PerformanceModel::iterate(instructions, count), which TraceThread uses to hand over
+// a basic block of instructions at a time: it must simulate instructions and pseudo-instructions in the
+// same order, and end up at the same time, as queueing and iterating every instruction by itself.
+//
+// A pseudo-random stream of instructions, pseudo-instructions queued from outside the performance model
+// (as SIFT callbacks do) and synchronization events is fed through both paths. Some instructions queue
+// a TLB miss while they are being handled. The batched path flushes like TraceThread does: at branches,
+// when the batch is full, and before anything else is queued.
+//
+// Only PerformanceModel and the instruction classes are the real simulator code. Everything they
+// reach out to (simulator singleton, core, fast-forward model, stats) is replaced by the minimal
+// stand-ins below, so the test links without the rest of libcarbon_sim, Pin or XED.
+//
+// Usage: iterate_check <seed> [<instructions>]
+
+#include "simulator.h"
+#include "config.h"
+#include "log.h"
+#include "core.h"
+#include "performance_model.h"
+#include "fastforward_performance_model.h"
+#include "branch_predictor.h"
+#include "instruction_tracer.h"
+#include "dynamic_instruction.h"
+#include "instruction.h"
+#include "stats.h"
+#include "dvfs_manager.h"
+#include "config_file.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static UInt64 s_rng_state;
+static ComponentPeriod *s_period;
+
+// xorshift64, so the stream does not depend on the C library's rand()
+static UInt64 rnd()
+{
+   s_rng_state ^= s_rng_state << 13;
+   s_rng_state ^= s_rng_state >> 7;
+   s_rng_state ^= s_rng_state << 17;
+   return s_rng_state;
+}
+
+
+// Stand-ins for the parts of the simulator that PerformanceModel uses
+
+Simulator *Simulator::m_singleton = NULL;
+config::Config *Simulator::m_config_file = NULL;
+bool Simulator::m_config_file_allowed = true;
+Config::SimulationMode Simulator::m_mode = Config::STANDALONE;
+dl::Decoder *Simulator::m_decoder = NULL;
+
+Config::Config(SimulationMode mode) {}
+Config::~Config() {}
+Log *Log::_singleton = NULL;
+Log::Log(Config &config) : _loggingEnabled(false), _anyLoggingEnabled(false) { _singleton = this; }
+Log::~Log() {}
+
+Simulator::Simulator()
+   : m_config(m_mode)
+   , m_log(m_config)
+   , m_stats_manager(new StatsManager())
+{
+}
+
+void Simulator::setConfig(config::Config *cfg, Config::SimulationMode mode)
+{
+   m_config_file = cfg;
+   m_mode = mode;
+}
+
+void Simulator::allocate()
+{
+   m_singleton = new Simulator();
+}
+
+Log *Log::getSingleton() { return _singleton; }
+String Log::getModule(const char *filename) { return filename; }
+bool Log::isEnabled(const char *module) { return false; }
+void Log::log(ErrorState err, const char *source_file, SInt32 source_line, const char *format, ...)
+{
+   va_list args;
+   va_start(args, format);
+   fprintf(stderr, "%s:%d: ", source_file, source_line);
+   vfprintf(stderr, format, args);
+   va_end(args);
+   fprintf(stderr, "\n");
+   if (err == Error)
+      abort();
+}
+
+StatsManager::StatsManager() {}
+void StatsManager::registerMetric(StatsMetricBase *metric) {}
+template <> UInt64 makeStatsValue<UInt64>(UInt64 t) { return t; }
+template <> UInt64 makeStatsValue<SubsecondTime>(SubsecondTime t) { return t.getFS(); }
+template <> UInt64 makeStatsValue<ComponentTime>(ComponentTime t) { return t.getElapsedTime().getFS(); }
+
+const ComponentPeriod* DvfsManager::getCoreDomain(UInt32 core_id) { return s_period; }
+
+BbvCount::BbvCount(core_id_t core_id) : m_core_id(core_id) {}
+BbvCount::~BbvCount() {}
+
+// No clock skew minimization client, so PerformanceModel::synchronize() does nothing
+Core::Core(SInt32 id)
+   : m_core_id(id)
+   , m_dvfs_domain(s_period)
+   , m_performance_model(NULL)
+   , m_clock_skew_minimization_client(NULL)
+   , m_bbv(id)
+{
+}
+
+Core::~Core() {}
+
+BranchPredictor* BranchPredictor::create(core_id_t core_id) { return NULL; }
+InstructionTracer* InstructionTracer::create(const Core *core) { return NULL; }
+
+// The fast-forward model is created, but never used as the test stays in detailed mode
+FastforwardPerformanceModel::FastforwardPerformanceModel(Core *core, PerformanceModel *perf)
+   : m_core(core)
+   , m_perf(perf)
+   , m_include_memory_latency(false)
+   , m_include_branch_mispredict(false)
+   , m_branch_misprediction_penalty(s_period, 0)
+{
+}
+void FastforwardPerformanceModel::queuePseudoInstruction(PseudoInstruction *instr) { abort(); }
+void FastforwardPerformanceModel::notifyElapsedTimeUpdate() { abort(); }
+
+// An instruction that is identified by its position in the stream
+class TestInstruction : public Instruction
+{
+   public:
+      const UInt64 m_index;
+
+      TestInstruction(UInt64 index) : Instruction(INST_GENERIC), m_index(index) {}
+};
+
+// Records the order in which instructions reach handleInstruction(). Every instruction takes one cycle,
+// every third one also has a TLB miss, which it queues while being handled like the real models do.
+class TestPerformanceModel : public PerformanceModel
+{
+   public:
+      std::vector<UInt64> m_handled;
+
+      TestPerformanceModel(Core *core) : PerformanceModel(core) {}
+
+   private:
+      void handleInstruction(DynamicInstruction *instruction)
+      {
+         if (instruction->instruction->isPseudo())
+         {
+            SubsecondTime cost = instruction->instruction->getCost(getCore());
+            m_handled.push_back((UInt64(instruction->instruction->getType()) << 48) | cost.getNS());
+            m_elapsed_time.addLatency(cost);
+         }
+         else
+         {
+            UInt64 index = ((TestInstruction*)instruction->instruction)->m_index;
+            m_handled.push_back(index);
+            m_elapsed_time.addLatency(s_period->getPeriod());
+            if (index % 3 == 0)
+               queuePseudoInstruction(new TLBMissInstruction(SubsecondTime::NS(10 + index % 7), false));
+         }
+      }
+};
+
+
+enum op_t
+{
+   OP_INSTRUCTION,
+   OP_BRANCH,
+   OP_PSEUDO,      // Queued from outside the performance model, e.g. unknown instructions from an icount callback
+   OP_SYNC,        // Wake up at a time relative to the time of the previous instruction, e.g. after a syscall
+};
+
+struct Result
+{
+   std::vector<UInt64> handled;
+   SubsecondTime elapsed;
+   SubsecondTime non_idle;
+};
+
+static Result run(const std::vector<op_t> &ops, const std::vector<TestInstruction*> &instructions, bool batched)
+{
+   Core *core = new Core(0);
+   TestPerformanceModel *prfmdl = new TestPerformanceModel(core);
+   prfmdl->enable();
+
+   // TraceThread's batch size
+   const UInt32 BATCH_SIZE = 32;
+   DynamicInstruction *batch[BATCH_SIZE];
+   UInt32 batch_size = 0;
+
+   for(UInt64 i = 0; i < ops.size(); ++i)
+   {
+      if (ops[i] == OP_INSTRUCTION || ops[i] == OP_BRANCH)
+      {
+         DynamicInstruction *dynins = prfmdl->createDynamicInstruction(instructions[i], i);
+         if (batched)
+         {
+            batch[batch_size++] = dynins;
+            if (ops[i] == OP_BRANCH || batch_size == BATCH_SIZE)
+            {
+               prfmdl->iterate(batch, batch_size);
+               batch_size = 0;
+            }
+         }
+         else
+         {
+            prfmdl->queueInstruction(dynins);
+            prfmdl->iterate();
+         }
+      }
+      else
+      {
+         // Callbacks flush the batch before they touch the performance model
+         if (batch_size)
+         {
+            prfmdl->iterate(batch, batch_size);
+            batch_size = 0;
+         }
+
+         if (ops[i] == OP_PSEUDO)
+            prfmdl->queuePseudoInstruction(new UnknownInstruction(SubsecondTime::NS(1 + i % 5)));
+         else
+            prfmdl->queuePseudoInstruction(new SyncInstruction(prfmdl->getElapsedTime() + SubsecondTime::NS(i % 50), SyncInstruction::SYSCALL));
+      }
+   }
+   if (batch_size)
+      prfmdl->iterate(batch, batch_size);
+   // Pseudo-instructions queued at the very end
+   prfmdl->iterate();
+
+   Result result;
+   result.handled = prfmdl->m_handled;
+   result.elapsed = prfmdl->getElapsedTime();
+   result.non_idle = prfmdl->getNonIdleElapsedTime();
+
+   delete prfmdl;
+   delete core;
+   return result;
+}
+
+
+int main(int argc, char **argv)
+{
+   if (argc < 2)
+   {
+      fprintf(stderr, "Usage: %s <seed> [<instructions>]\n", argv[0]);
+      return 1;
+   }
+   UInt64 seed = strtoull(argv[1], NULL, 0);
+   UInt64 num_ops = argc > 2 ? strtoull(argv[2], NULL, 0) : 100000;
+   s_rng_state = 0x9e3779b97f4a7c15ULL * (seed + 1);
+
+   config::ConfigFile *cfg = new config::ConfigFile();
+   Simulator::setConfig(cfg, Config::STANDALONE);
+   Simulator::allocate();
+   s_period = new ComponentPeriod(ComponentPeriod::fromFreqHz(2000000000ULL));
+
+   // Basic blocks of 1 to 40 instructions, so some are split because the batch is full,
+   // with a pseudo-instruction or sync event in between every now and then
+   std::vector<op_t> ops;
+   std::vector<TestInstruction*> instructions;
+   while (ops.size() < num_ops)
+   {
+      UInt64 bb_size = 1 + rnd() % 40;
+      for(UInt64 i = 0; i < bb_size; ++i)
+      {
+         instructions.push_back(new TestInstruction(ops.size()));
+         ops.push_back(i == bb_size - 1 && rnd() % 4 ? OP_BRANCH : OP_INSTRUCTION);
+      }
+      UInt64 r = rnd() % 8;
+      if (r == 0 || r == 1)
+      {
+         instructions.push_back(NULL);
+         ops.push_back(r == 0 ? OP_PSEUDO : OP_SYNC);
+      }
+   }
+
+   Result reference = run(ops, instructions, false);
+   Result batched = run(ops, instructions, true);
+
+   bool ok = true;
+   if (batched.handled != reference.handled)
+   {
+      UInt64 i = 0;
+      while (i < std::min(batched.handled.size(), reference.handled.size()) && batched.handled[i] == reference.handled[i])
+         ++i;
+      printf("seed %" PRIu64 ": handled %zu instructions instead of %zu, first difference at %" PRIu64 "\n",
+         seed, batched.handled.size(), reference.handled.size(), i);
+      ok = false;
+   }
+   if (batched.elapsed != reference.elapsed || batched.non_idle != reference.non_idle)
+   {
+      printf("seed %" PRIu64 ": elapsed %" PRIu64 " fs (%" PRIu64 " non-idle) instead of %" PRIu64 " fs (%" PRIu64 ")\n",
+         seed, batched.elapsed.getFS(), batched.non_idle.getFS(), reference.elapsed.getFS(), reference.non_idle.getFS());
+      ok = false;
+   }
+   if (ok)
+      printf("seed %" PRIu64 ": %zu instructions handled in the same order, elapsed %" PRIu64 " fs\n",
+         seed, reference.handled.size(), reference.elapsed.getFS());
+
+   return ok ? 0 : 1;
+}
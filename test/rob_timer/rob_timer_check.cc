@@ -0,0 +1,498 @@
+// Regression test for RobTimer: drive the timer with a pseudo-random uop stream and print its CPI stack
+// together with a digest of the dispatch/issue/done/commit time of every uop.
+//
+// Only RobTimer and the micro-op classes it works on are the real simulator code. Everything they
+// reach out to (simulator singleton, core, memory hierarchy, stats, decoder) is replaced by the
+// minimal stand-ins below, so the test links without the rest of libcarbon_sim, Pin or XED.
+//
+// Usage: rob_timer_check <seed> [<instructions>]
+// The seed picks both the RobTimer configuration and the instruction stream. `make check` compares
+// the output of a range of seeds against rob_timer_check.ref, which was recorded with the RobTimer
+// from before event-driven issue, built with ASSERT_SKIP so it stepped through every single cycle.
+
+#include "simulator.h"
+#include "config.h"
+#include "log.h"
+#include "core.h"
+#include "performance_model.h"
+#include "instruction_tracer.h"
+#include "rob_timer.h"
+#include "rob_contention.h"
+#include "core_model.h"
+#include "micro_op.h"
+#include "dynamic_micro_op.h"
+#include "allocator.h"
+#include "stats.h"
+#include "dvfs_manager.h"
+#include "config_file.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static UInt64 s_rng_state;
+static UInt64 s_digest = 1469598103934665603ULL;
+static UInt64 s_trace_digest = 1469598103934665603ULL;
+static ComponentPeriod *s_period;
+static std::vector<StatsMetricBase*> s_metrics;
+
+// xorshift64, so the stream does not depend on the C library's rand()
+static UInt64 rnd()
+{
+   s_rng_state ^= s_rng_state << 13;
+   s_rng_state ^= s_rng_state >> 7;
+   s_rng_state ^= s_rng_state << 17;
+   return s_rng_state;
+}
+
+// FNV-1a style digests: s_digest covers everything, s_trace_digest only the per-uop timestamps and memory accesses
+static void mix(UInt64 value)
+{
+   s_digest = (s_digest ^ value) * 1099511628211ULL;
+}
+
+static void traceMix(UInt64 value)
+{
+   s_trace_digest = (s_trace_digest ^ value) * 1099511628211ULL;
+   mix(value);
+}
+
+
+// Stand-ins for the parts of the simulator that RobTimer uses
+
+Simulator *Simulator::m_singleton = NULL;
+config::Config *Simulator::m_config_file = NULL;
+bool Simulator::m_config_file_allowed = true;
+Config::SimulationMode Simulator::m_mode = Config::STANDALONE;
+dl::Decoder *Simulator::m_decoder = NULL;
+
+Config::Config(SimulationMode mode) {}
+Config::~Config() {}
+Log *Log::_singleton = NULL;
+Log::Log(Config &config) : _loggingEnabled(false), _anyLoggingEnabled(false) { _singleton = this; }
+Log::~Log() {}
+
+Simulator::Simulator()
+   : m_config(m_mode)
+   , m_log(m_config)
+   , m_stats_manager(new StatsManager())
+{
+}
+
+void Simulator::setConfig(config::Config *cfg, Config::SimulationMode mode)
+{
+   m_config_file = cfg;
+   m_mode = mode;
+}
+
+void Simulator::allocate()
+{
+   m_singleton = new Simulator();
+}
+
+Log *Log::getSingleton() { return _singleton; }
+String Log::getModule(const char *filename) { return filename; }
+bool Log::isEnabled(const char *module) { return false; }
+void Log::log(ErrorState err, const char *source_file, SInt32 source_line, const char *format, ...)
+{
+   va_list args;
+   va_start(args, format);
+   fprintf(stderr, "%s:%d: ", source_file, source_line);
+   vfprintf(stderr, format, args);
+   va_end(args);
+   fprintf(stderr, "\n");
+   if (err == Error)
+      abort();
+}
+
+StatsManager::StatsManager() {}
+void StatsManager::registerMetric(StatsMetricBase *metric) { s_metrics.push_back(metric); }
+template <> UInt64 makeStatsValue<UInt64>(UInt64 t) { return t; }
+template <> UInt64 makeStatsValue<SubsecondTime>(SubsecondTime t) { return t.getFS(); }
+
+class TestTracer : public InstructionTracer
+{
+   public:
+      UInt64 m_count;
+
+      TestTracer() : m_count(0) {}
+
+      void traceInstruction(const DynamicMicroOp *uop, uop_times_t *times)
+      {
+         ++m_count;
+         traceMix(uop->getSequenceNumber());
+         traceMix(times->dispatch.getFS());
+         traceMix(times->issue.getFS());
+         traceMix(times->done.getFS());
+         traceMix(times->commit.getFS());
+      }
+};
+
+static TestTracer s_tracer;
+
+const ComponentPeriod* DvfsManager::getCoreDomain(UInt32 core_id) { return s_period; }
+
+PerformanceModel::PerformanceModel(Core *core)
+   : m_core(core)
+   , m_elapsed_time(s_period)
+   , m_idle_elapsed_time(s_period)
+   , m_instruction_tracer(&s_tracer)
+{
+}
+
+PerformanceModel::~PerformanceModel() {}
+void PerformanceModel::synchronize() {}
+
+// RobTimer only uses the performance model to reach the instruction tracer
+class TestPerformanceModel : public PerformanceModel
+{
+   public:
+      TestPerformanceModel(Core *core) : PerformanceModel(core) {}
+
+   private:
+      void handleInstruction(DynamicInstruction *instruction) {}
+};
+
+BbvCount::BbvCount(core_id_t core_id) : m_core_id(core_id) {}
+BbvCount::~BbvCount() {}
+
+Core::Core(SInt32 id)
+   : m_core_id(id)
+   , m_dvfs_domain(s_period)
+   , m_performance_model(new TestPerformanceModel(this))
+   , m_bbv(id)
+{
+}
+
+// A fixed latency per address, spread over L1, L2 and DRAM
+MemoryResult Core::accessMemory(lock_signal_t lock_signal, mem_op_t mem_op_type, IntPtr d_addr, char* data_buffer, UInt32 data_size, MemModeled modeled, IntPtr eip, SubsecondTime now, bool is_fault_mask)
+{
+   traceMix(mem_op_type);
+   traceMix(d_addr);
+   traceMix(now.getFS());
+
+   MemoryResult res;
+   UInt64 bucket = (d_addr * 0x9e3779b97f4a7c15ULL) >> 58;
+   if (bucket < 40)
+   {
+      res.hit_where = HitWhere::L1_OWN;
+      res.latency = SubsecondTime::NS(1);
+   }
+   else if (bucket < 56)
+   {
+      res.hit_where = HitWhere::L2_OWN;
+      res.latency = SubsecondTime::NS(4);
+   }
+   else
+   {
+      res.hit_where = HitWhere::DRAM;
+      res.latency = SubsecondTime::NS(60 + bucket);
+   }
+   return res;
+}
+
+
+// Register numbers are small integers, no instruction is a branch or has special semantics
+class TestDecoder : public dl::Decoder
+{
+   public:
+      static const decoder_reg NUM_REGS = 16;
+
+      void decode(dl::DecodedInst *inst) {}
+      void decode(dl::DecodedInst *inst, dl::dl_isa isa) {}
+      void change_isa_mode(dl::dl_isa new_isa) {}
+      const char* inst_name(unsigned int inst_id) { return ""; }
+      const char* reg_name(unsigned int reg_id) { return ""; }
+      decoder_reg largest_enclosing_register(decoder_reg r) { return r; }
+      bool invalid_register(decoder_reg r) { return r == DL_REG_INVALID; }
+      bool reg_is_program_counter(decoder_reg r) { return false; }
+      bool inst_in_group(const dl::DecodedInst *inst, unsigned int group_id) { return false; }
+      unsigned int num_operands(const dl::DecodedInst *inst) { return 0; }
+      unsigned int num_memory_operands(const dl::DecodedInst *inst) { return 0; }
+      decoder_reg mem_base_reg(const dl::DecodedInst *inst, unsigned int mem_idx) { return DL_REG_INVALID; }
+      bool mem_base_upate(const dl::DecodedInst *inst, unsigned int mem_idx) { return false; }
+      bool has_index_reg(const dl::DecodedInst *inst, unsigned int mem_idx) { return false; }
+      decoder_reg mem_index_reg(const dl::DecodedInst *inst, unsigned int mem_idx) { return DL_REG_INVALID; }
+      bool op_read_mem(const dl::DecodedInst *inst, unsigned int mem_idx) { return false; }
+      bool op_write_mem(const dl::DecodedInst *inst, unsigned int mem_idx) { return false; }
+      bool op_read_reg(const dl::DecodedInst *inst, unsigned int idx) { return false; }
+      bool op_write_reg(const dl::DecodedInst *inst, unsigned int idx) { return false; }
+      bool is_addr_gen(const dl::DecodedInst *inst, unsigned int idx) { return false; }
+      bool op_is_reg(const dl::DecodedInst *inst, unsigned int idx) { return false; }
+      decoder_reg get_op_reg(const dl::DecodedInst *inst, unsigned int idx) { return DL_REG_INVALID; }
+      unsigned int size_mem_op(const dl::DecodedInst *inst, unsigned int mem_idx) { return 0; }
+      unsigned int get_exec_microops(const dl::DecodedInst *ins, int numLoads, int numStores) { return 1; }
+      uint16_t get_operand_size(const dl::DecodedInst *ins) { return 64; }
+      bool is_cache_flush_opcode(decoder_opcode opcd) { return false; }
+      bool is_div_opcode(decoder_opcode opcd) { return false; }
+      bool is_pause_opcode(decoder_opcode opcd) { return false; }
+      bool is_branch_opcode(decoder_opcode opcd) { return false; }
+      bool is_fpvector_addsub_opcode(decoder_opcode opcd, const dl::DecodedInst *ins) { return false; }
+      bool is_fpvector_muldiv_opcode(decoder_opcode opcd, const dl::DecodedInst *ins) { return false; }
+      bool is_fpvector_ldst_opcode(decoder_opcode opcd, const dl::DecodedInst *ins) { return false; }
+      decoder_reg last_reg() { return NUM_REGS; }
+      uint32_t map_register(decoder_reg reg) { return reg; }
+      unsigned int num_read_implicit_registers(const dl::DecodedInst *inst) { return 0; }
+      decoder_reg get_read_implicit_reg(const dl::DecodedInst *inst, unsigned int idx) { return DL_REG_INVALID; }
+      unsigned int num_write_implicit_registers(const dl::DecodedInst *inst) { return 0; }
+      decoder_reg get_write_implicit_reg(const dl::DecodedInst *inst, unsigned int idx) { return DL_REG_INVALID; }
+};
+
+dl::Decoder::~Decoder() {}
+
+dl::Decoder *Simulator::getDecoder()
+{
+   if (!m_decoder)
+      m_decoder = new TestDecoder();
+   return m_decoder;
+}
+
+
+// The core model: two ALU ports and one memory port, per-uop execution latencies chosen by the stream
+
+class TestContention : public RobContention
+{
+   private:
+      int m_alu;
+      int m_mem;
+
+   public:
+      TestContention() : m_alu(0), m_mem(0) {}
+
+      void initCycle(SubsecondTime now)
+      {
+         m_alu = m_mem = 0;
+      }
+
+      bool tryIssue(const DynamicMicroOp &uop)
+      {
+         int &port = uop.getMicroOp()->isLoad() || uop.getMicroOp()->isStore() ? m_mem : m_alu;
+         int width = &port == &m_mem ? 1 : 2;
+         if (port >= width)
+            return false;
+         ++port;
+         return true;
+      }
+
+      bool noMore()
+      {
+         return m_alu >= 2 && m_mem >= 1;
+      }
+
+      void doIssue(DynamicMicroOp &uop) {}
+};
+
+class TestDynamicMicroOp : public DynamicMicroOp
+{
+   public:
+      TestDynamicMicroOp(const MicroOp *uop, const CoreModel *core_model, ComponentPeriod period)
+         : DynamicMicroOp(uop, core_model, period)
+      {}
+
+      const char* getType() const { return "test"; }
+};
+
+class TestAllocator : public Allocator
+{
+   public:
+      void *alloc(size_t bytes)
+      {
+         DataElement *elem = (DataElement*)malloc(sizeof(DataElement) + bytes);
+         elem->allocator = this;
+         return elem->data;
+      }
+
+      void _dealloc(void *ptr)
+      {
+         free(ptr);
+      }
+
+      UInt64 getAllocations() { return 0; }
+};
+
+class TestCoreModel : public CoreModel
+{
+   private:
+      bool m_contention;
+      std::map<const MicroOp*, unsigned int> m_latencies;
+
+   public:
+      TestCoreModel(bool contention) : m_contention(contention) {}
+
+      void setLatency(const MicroOp *uop, unsigned int latency) { m_latencies[uop] = latency; }
+
+      IntervalContention* createIntervalContentionModel(const Core *core) const { return NULL; }
+      unsigned int getLongLatencyCutoff() const { return 30; }
+      RobContention* createRobContentionModel(const Core *core) const { return m_contention ? new TestContention() : NULL; }
+      Allocator* createDMOAllocator() const { return new TestAllocator(); }
+      DynamicMicroOp* createDynamicMicroOp(Allocator *alloc, const MicroOp *uop, ComponentPeriod period) const
+      {
+         return DynamicMicroOp::alloc<TestDynamicMicroOp>(alloc, uop, this, period);
+      }
+      unsigned int getInstructionLatency(const MicroOp *uop) const
+      {
+         std::map<const MicroOp*, unsigned int>::const_iterator it = m_latencies.find(uop);
+         return it == m_latencies.end() ? 1 : it->second;
+      }
+      unsigned int getAluLatency(const MicroOp *uop) const { return 1; }
+      unsigned int getBypassLatency(const DynamicMicroOp *uop) const { return 0; }
+      unsigned int getLongestLatency() const { return 60; }
+};
+
+
+// Statistics that depend on how far RobTimer jumps ahead over idle cycles, which is up to the implementation:
+// time_skipped itself, the MLP histogram which is sampled once per jump, and the number of times the
+// load/store queues were polled while full.
+static bool isSkipDependent(const String &name)
+{
+   return name == "time_skipped" || name == "no-free-slots" || name.compare(0, 16, "outstandingLoads") == 0;
+}
+
+static dl::Decoder::decoder_reg randomRegister()
+{
+   return 1 + rnd() % 12;
+}
+
+
+int main(int argc, char **argv)
+{
+   if (argc < 2)
+   {
+      fprintf(stderr, "Usage: %s <seed> [<instructions>]\n", argv[0]);
+      return 1;
+   }
+   UInt64 seed = strtoull(argv[1], NULL, 0);
+   UInt64 instructions = argc > 2 ? strtoull(argv[2], NULL, 0) : 50000;
+   s_rng_state = seed * 2654435761ULL + 1;
+
+   bool in_order = rnd() % 4 == 0;
+   bool contention = rnd() % 2;
+   char cfg[1024];
+   snprintf(cfg, sizeof(cfg),
+      "[perf_model/core/rob_timer]\n"
+      "commit_width = 4\n"
+      "rs_entries = %" PRIu64 "\n"
+      "store_to_load_forwarding = %s\n"
+      "address_disambiguation = %s\n"
+      "in_order = %s\n"
+      "issue_contention = %s\n"
+      "outstanding_loads = %" PRIu64 "\n"
+      "outstanding_stores = %" PRIu64 "\n"
+      "mlp_histogram = true\n",
+      36 + rnd() % 30, rnd() % 2 ? "true" : "false", rnd() % 2 ? "true" : "false",
+      in_order ? "true" : "false", contention ? "true" : "false", 4 + rnd() % 48, 4 + rnd() % 32);
+   UInt64 window = 32 + rnd() % 200;
+   UInt64 dispatch_width = 2 + rnd() % 4;
+   UInt64 misprediction_penalty = 8 + rnd() % 10;
+
+   config::ConfigFile *cfg_file = new config::ConfigFile();
+   cfg_file->loadConfigFromString(cfg);
+   Simulator::setConfig(cfg_file, Config::STANDALONE);
+   Simulator::allocate();
+
+   s_period = new ComponentPeriod(ComponentPeriod::fromFreqHz(1000000000));
+   Core *core = new Core(0);
+
+   TestCoreModel *core_model = new TestCoreModel(contention);
+   Allocator *alloc = core_model->createDMOAllocator();
+   RobTimer *timer = new RobTimer(core, core->getPerformanceModel(), core_model, misprediction_penalty, dispatch_width, window);
+
+   printf("seed %" PRIu64 ": window %" PRIu64 " width %" PRIu64 " in_order %d contention %d\n",
+      seed, window, dispatch_width, in_order, contention);
+
+   UInt64 total_instructions = 0;
+   SubsecondTime total_latency = SubsecondTime::Zero();
+   for(UInt64 i = 0; i < instructions; ++i)
+   {
+      // [load] execute [store], with the usual intra-instruction dependencies
+      UInt64 kind = rnd() % 100;
+      bool has_load = kind < 30, has_store = kind >= 80;
+      std::vector<MicroOp*> mops;
+      if (has_load)
+      {
+         MicroOp *load = new MicroOp();
+         load->makeLoad(0, dl::Decoder::DL_OPCODE_INVALID, "load", 8);
+         load->addAddressRegister(randomRegister(), "");
+         load->addDestinationRegister(randomRegister(), "");
+         mops.push_back(load);
+      }
+
+      UInt64 special = rnd() % 1000;
+      MicroOp *exec = new MicroOp();
+      exec->makeExecute(0, has_load ? 1 : 0, dl::Decoder::DL_OPCODE_INVALID, "exec", special < 100);
+      exec->addSourceRegister(randomRegister(), "");
+      if (rnd() % 2)
+         exec->addSourceRegister(randomRegister(), "");
+      dl::Decoder::decoder_reg store_address = randomRegister();
+      dl::Decoder::decoder_reg dest = has_store && rnd() % 2 ? 13 : randomRegister();
+      // Keep the store address independent of the execute uop
+      if (has_store && dest == store_address)
+         dest = 13;
+      exec->addDestinationRegister(dest, "");
+      if (special >= 100 && special < 103)
+         exec->setSerializing(true);
+      else if (special >= 103 && special < 106)
+         exec->setMemBarrier(true);
+      core_model->setLatency(exec, special < 150 ? 1 + rnd() % 20 : 1 + rnd() % 3);
+      mops.push_back(exec);
+
+      if (has_store)
+      {
+         MicroOp *store = new MicroOp();
+         store->makeStore(0, 1, dl::Decoder::DL_OPCODE_INVALID, "store", 8);
+         store->addAddressRegister(store_address, "");
+         store->addSourceRegister(store_address, "");
+         store->addSourceRegister(randomRegister(), "");
+         mops.push_back(store);
+      }
+      mops.front()->setFirst(true);
+      mops.back()->setLast(true);
+
+      std::vector<DynamicMicroOp*> uops;
+      for(size_t j = 0; j < mops.size(); ++j)
+      {
+         DynamicMicroOp *uop = core_model->createDynamicMicroOp(alloc, mops[j], *s_period);
+         if (mops[j]->isLoad() || mops[j]->isStore())
+         {
+            Memory::Access address;
+            address.set(0x1000 + 64 * (rnd() % 64));
+            uop->setAddress(address);
+            if (rnd() % 4 == 0)
+            {
+               uop->setDCacheHitWhere(HitWhere::L1_OWN);
+               uop->setExecLatency(uop->getExecLatency() + 1);
+            }
+         }
+         if (mops[j]->isBranch())
+            uop->setBranchMispredicted(rnd() % 10 == 0);
+         if (j == 0 && rnd() % 200 == 0)
+         {
+            uop->setICacheHitWhere(HitWhere::L2_OWN);
+            uop->setICacheLatency(8 + rnd() % 30);
+         }
+         uops.push_back(uop);
+      }
+
+      boost::tuple<uint64_t,SubsecondTime> res = timer->simulate(uops);
+      total_instructions += res.get<0>();
+      total_latency += res.get<1>();
+      mix(res.get<0>());
+      mix(res.get<1>().getFS());
+   }
+
+   printf("instructions %" PRIu64 " latency %" PRIu64 " traced %" PRIu64 "\n", total_instructions, total_latency.getFS(), s_tracer.m_count);
+   for(std::vector<StatsMetricBase*>::iterator it = s_metrics.begin(); it != s_metrics.end(); ++it)
+   {
+      if (isSkipDependent((*it)->metricName))
+         continue;
+      UInt64 value = (*it)->recordMetric();
+      mix(value);
+      // Components that stay zero still go into the digest, just not into the output
+      if ((*it)->metricName.compare(0, 3, "cpi") == 0 && value)
+         printf("%s %" PRIu64 "\n", (*it)->metricName.c_str(), value);
+   }
+   printf("digest %016" PRIx64 " trace %016" PRIx64 "\n", s_digest, s_trace_digest);
+
+   return 0;
+}
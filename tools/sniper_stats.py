@@ -55,6 +55,9 @@ def SniperStats(resultsdir = '.', jobid = None):
     import sniper_stats_jobid
     stats = sniper_stats_jobid.SniperStatsJobid(jobid)
   elif os.path.exists(os.path.join(resultsdir, 'sim.stats.sqlite3')):
+    if os.path.exists(os.path.join(resultsdir, 'sim.stats.bin')):
+      import sniper_stats_bin
+      sniper_stats_bin.merge_resultsdir(resultsdir)
     import sniper_stats_sqlite
     stats = sniper_stats_sqlite.SniperStatsSqlite(os.path.join(resultsdir, 'sim.stats.sqlite3'))
   elif os.path.exists(os.path.join(resultsdir, 'sim.stats.db')):
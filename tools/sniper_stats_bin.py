@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+
+# Merge sim.stats.bin (written by [stats] backend = binary) into sim.stats.sqlite3,
+# and read sim.stats.periodic.bin (written when [stats/periodic] interval is set)
+# See common/misc/stats.cc for the file layouts
+
+import sys, os, struct, array, sqlite3, getopt
+
+MAGIC = 0x54534e53
+VERSION = 1
+RECORD_END, RECORD_LAYOUT, RECORD_SNAPSHOT, RECORD_DELETE, RECORD_PERIODIC = list(range(5))
+LAYOUT_DEFAULT_OMITTED = 1
+
+
+class StatsBinError(Exception):
+  pass
+
+
+def _read_string(payload, offset):
+  length, = struct.unpack_from('I', payload, offset)
+  offset += 4
+  return payload[offset:offset+length].decode('utf-8', 'replace'), offset + ((length + 7) & ~7)
+
+
+def read_records(filename):
+  with open(filename, 'rb') as fp:
+    header = fp.read(8)
+    if len(header) < 8:
+      raise StatsBinError('%s: file too short' % filename)
+    magic, version = struct.unpack('II', header)
+    if magic != MAGIC or version != VERSION:
+      raise StatsBinError('%s: not a sim.stats.bin file (magic %x, version %d)' % (filename, magic, version))
+    while True:
+      header = fp.read(8)
+      if not header:
+        return
+      if len(header) < 8:
+        raise StatsBinError('%s: truncated record' % filename)
+      rtype, length = struct.unpack('II', header)
+      payload = fp.read(length)
+      if len(payload) < length:
+        raise StatsBinError('%s: truncated record' % filename)
+      yield rtype, payload
+
+
+def _read_varint(payload, offset):
+  value, shift = 0, 0
+  while True:
+    byte = payload[offset]
+    offset += 1
+    value |= (byte & 0x7f) << shift
+    if not byte & 0x80:
+      return value, offset
+    shift += 7
+
+
+def _read_layout(payload):
+  count, = struct.unpack_from('Q', payload, 0)
+  entries = array.array('i')
+  entries.frombytes(payload[8:8+12*count])
+  return [ (entries[3*i], entries[3*i+1], entries[3*i+2] & LAYOUT_DEFAULT_OMITTED) for i in range(count) ]
+
+
+def read_periodic(filename = 'sim.stats.periodic.bin'):
+  # Yields (time in fs, [(nameid, core, omitted), ...], [value, ...]) for each periodic snapshot
+  layout = []
+  values = []
+  for rtype, payload in read_records(filename):
+    if rtype == RECORD_LAYOUT:
+      layout = _read_layout(payload)
+    elif rtype == RECORD_PERIODIC:
+      time, count = struct.unpack_from('QQ', payload, 0)
+      values += [0] * (count - len(values))
+      offset, idx = 16, 0
+      while offset < len(payload):
+        skip, offset = _read_varint(payload, offset)
+        zigzag, offset = _read_varint(payload, offset)
+        idx += skip
+        values[idx] = (values[idx] + ((zigzag >> 1) ^ -(zigzag & 1))) & 0xffffffffffffffff
+        idx += 1
+      yield time, layout, list(values)
+
+
+def merge(binfile, dbfile, force = False):
+  db = sqlite3.connect(dbfile)
+  c = db.cursor()
+  layout = []
+  complete = False
+  # Snapshots that are already in the database, from an earlier --force merge while the simulation was still running
+  merged = set(prefixid for prefixid, in c.execute('SELECT prefixid FROM `prefixes`'))
+  try:
+    for rtype, payload in read_records(binfile):
+      if rtype == RECORD_LAYOUT:
+        layout = _read_layout(payload)
+      elif rtype == RECORD_SNAPSHOT:
+        prefixid, = struct.unpack_from('I', payload, 0)
+        prefix, offset = _read_string(payload, 4)
+        count, = struct.unpack_from('Q', payload, offset)
+        if count != len(layout):
+          raise StatsBinError('%s: snapshot %s does not match layout' % (binfile, prefix))
+        values = array.array('q')
+        values.frombytes(payload[offset+8:offset+8+8*count])
+        if prefixid in merged:
+          c.execute('DELETE FROM `values` WHERE prefixid = ?', (prefixid,))
+          c.execute('DELETE FROM `prefixes` WHERE prefixid = ?', (prefixid,))
+        c.execute('INSERT INTO `prefixes` (prefixid, prefixname) VALUES (?, ?)', (prefixid, prefix))
+        c.executemany('INSERT INTO `values` (prefixid, nameid, core, value) VALUES (?, ?, ?, ?)',
+          ( (prefixid, nameid, core, value) for (nameid, core, omitted), value in zip(layout, values) if value or not omitted ))
+      elif rtype == RECORD_DELETE:
+        prefix, offset = _read_string(payload, 0)
+        c.execute('DELETE FROM `values` WHERE prefixid IN (SELECT prefixid FROM `prefixes` WHERE prefixname = ?)', (prefix,))
+        c.execute('DELETE FROM `prefixes` WHERE prefixname = ?', (prefix,))
+      elif rtype == RECORD_END:
+        complete = True
+  except StatsBinError:
+    if not force:
+      db.rollback()
+      raise
+  if not complete and not force:
+    db.rollback()
+    raise StatsBinError('%s: incomplete, simulation still running or did not exit cleanly (use --force to merge anyway)' % binfile)
+  db.commit()
+  db.close()
+  # After a forced merge of an incomplete file, the simulation may still be appending to it:
+  # keep it, so a later merge picks up the remaining snapshots
+  if complete:
+    os.unlink(binfile)
+
+
+def merge_resultsdir(resultsdir = '.'):
+  binfile = os.path.join(resultsdir, 'sim.stats.bin')
+  dbfile = os.path.join(resultsdir, 'sim.stats.sqlite3')
+  if os.path.exists(binfile) and os.path.exists(dbfile):
+    try:
+      merge(binfile, dbfile)
+    except (StatsBinError, IOError, OSError, sqlite3.Error) as e:
+      print('Warning: cannot merge sim.stats.bin: %s' % e, file = sys.stderr)
+
+
+if __name__ == '__main__':
+  def usage():
+    print('Usage:', sys.argv[0], '[-h|--help (help)] [-d <resultsdir (.)>] [--force (merge incomplete file)]')
+
+  resultsdir = '.'
+  force = False
+
+  try:
+    opts, args = getopt.getopt(sys.argv[1:], "hd:", [ "help", "force" ])
+  except getopt.GetoptError as e:
+    print(e)
+    usage()
+    sys.exit(1)
+  for o, a in opts:
+    if o in ('-h', '--help'):
+      usage()
+      sys.exit()
+    if o == '-d':
+      resultsdir = a
+    if o == '--force':
+      force = True
+
+  try:
+    merge(os.path.join(resultsdir, 'sim.stats.bin'), os.path.join(resultsdir, 'sim.stats.sqlite3'), force = force)
+  except StatsBinError as e:
+    print(e, file = sys.stderr)
+    sys.exit(1)